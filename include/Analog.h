@@ -3,6 +3,23 @@
 
 #include "Hardware.h"
 
+//
+// The ADS1115 inputs are read by a non-blocking state machine. Each pass of the analog thread
+// checks each ADC, if its conversion time has passed the result is read and the next channel's
+// single shot conversion is started, the thread never waits on a conversion. The two ADCs
+// convert in parallel. Each channel has its own data rate, PGA full scale, and number of
+// conversions to average, readings are scaled to the 6.144 volt range so the channel
+// calibration holds at any PGA setting. AnalogControl runs every ANAcontrolInterval mS using
+// the latest readings, independent of the conversion rate.
+//
+// The ALERT/RDY pins are not wired, the conversion end is known from the data rate.
+//
+
+#define ANAloopInterval     5             // Acquisition thread interval in mS
+#define ANAcontrolInterval  100           // AnalogControl period in mS
+#define ANAmaxAverage       64
+#define ANAfailTime         50            // A TWI access taking longer than this, in mS, disables the thread
+
 typedef struct
 {
   char    Name[20];
@@ -24,8 +41,18 @@ typedef struct
   int8_t        ADC1add;                // TWI address of first ADC device, channel 0 through 3
   int8_t        ADC2add;                // TWI address of second ADC device, channel 4 through 7
   AnalogChannel ac[8];
+  uint8_t       Rate[8];                // ADS1115 data rate code, 0 thru 7, 8 to 860 SPS
+  uint8_t       PGA[8];                 // ADS1115 PGA code, 0 thru 5, +/-6.144 to +/-0.256 volts
+  uint8_t       Average[8];             // Conversions averaged for each reading
 } Analog;
 
+typedef struct
+{
+  int8_t        Chan;                   // Channel converting, -1 if idle
+  uint32_t      Start;                  // Conversion start time in uS
+  uint32_t      Time;                   // Conversion time in uS
+} ANAdevice;
+
 // Prototypes
 void AnalogChanCal(void);
 void SaveAnalogSettings(void);
@@ -33,5 +60,13 @@ void RestoreAnalogSettings(void);
 void Analog_init(void);
 void RestoreAnalogSettings(bool);
 void RestoreAnalogSettings(void);
+void ANAsetRate(int ch, int sps);
+void ANAgetRate(int ch);
+void ANAsetPGA(int ch, int mv);
+void ANAgetPGA(int ch);
+void ANAsetAverage(int ch, int num);
+void ANAgetAverage(int ch);
+void ANAgetValue(int ch);
+void ANAreportStatus(void);
 
 #endif
@@ -0,0 +1,62 @@
+#ifndef BOOTPROFILE_H_
+#define BOOTPROFILE_H_
+
+//
+// Startup profiling and module inventory. setup marks the end of each startup phase with
+// BootMark, the time of each phase is kept for GBOOTTIME. ScanHardware records every module it
+// finds with BootModuleFound, the time to read its signature and run its init is kept for
+// GBOOTMODS.
+//
+// The module inventory, the board, address, record size, and signature name of each module, is
+// saved in FLASH. At startup the found modules are compared to the saved inventory and each is
+// reported as SAME, NEW, or CHANGED, modules in the saved inventory that were not found are
+// reported as GONE. The inventory is only written when it changes.
+//
+// The scan reads just the EEPROM record size and signature name, BOOTsigSize bytes, the module
+// init functions read their full records. The full records hold the module calibration and
+// are always read, a module that matches the inventory can still be a different board of the
+// same type.
+//
+
+#define BOOTmaxPhases   12
+#define BOOTmaxModules  16
+#define BOOTsigSize     22            // EEPROM record size word and 20 character name
+#define BOOTinvSign     0x5AA5B0C1
+
+enum BootModStates
+{
+  BOOTsame,
+  BOOTnew,
+  BOOTchanged,
+  BOOTgone
+};
+
+typedef struct
+{
+  const char *Name;
+  uint32_t   Time;                  // Phase time in mS
+} BootPhaseTime;
+
+typedef struct
+{
+  uint8_t    Board;                 // 0 = A, 1 = B
+  uint8_t    Addr;                  // EEPROM TWI address
+  uint16_t   Size;                  // EEPROM record size from the signature
+  char       Name[20];              // Signature name
+} BootModule;
+
+typedef struct
+{
+  uint32_t   Signature;
+  uint8_t    NumModules;
+  BootModule Mod[BOOTmaxModules];
+} BootInventory;
+
+// Prototypes
+void BootProfile_init(void);
+void BootMark(const char *phase);
+void BootModuleFound(int board, uint8_t addr, char *signature, uint32_t us);
+void BootReportTimes(void);
+void BootReportModules(void);
+
+#endif
@@ -29,9 +29,28 @@ typedef struct
   uint8_t	Osc;
 } CY22393_regs;
 
+// PLL solver limits, PT = 2 * (P + 3) + P0 and QT = Q + 2
+#define CYminPT       16
+#define CYmaxPT       1600
+#define CYmaxPTfaims  2047
+#define CYmaxQT       200
+#define CYmaxQTfaims  257
+#define CYvcoMin      100000000     // VCO range, Ref * PT / QT
+#define CYvcoMax      400000000
+#define CYcacheSize   8             // Recent FindPQ solutions
+
+typedef struct
+{
+  int       Freq;
+  int       Ref;
+  int16_t   P0, P, Q, Div, LF;
+  int       Error;
+} CYsolution;
+
 // Prototypes for function in ClockGenerator
 void SetRef(int Freq);
 int  FindPQ(long ClockOut);
+bool CYbestRatio(uint32_t num, uint32_t den, int maxPT, int maxQT, int *PT, int *QT);
 int  CY_Init(int8_t adr, int8_t brd = 0);
 void SetPLL2enable(int8_t adr, bool state, int8_t brd = 0);
 int  SetPLL2freq(int8_t adr, int Freq, int8_t brd = 0);
@@ -84,8 +84,25 @@ typedef struct
    unsigned int   SweepStartTime;     // In millisec counts
    unsigned int   CurrentSweepTime;   // In millisec counts
    SweepState     State;  
+   // Set by SweepBegin
+   int            Tick;               // Sweep ticks since the start
+   int            Ticks;              // Sweep ticks in SweepTime
+   float          dFreq;              // Frequency change per tick
+   float          dVolt;              // Voltage change per tick
+   int            Seg;                // Sweep table segment, index of the segment's first point
 } FreqSweep;
 
+// Sweep tick statistics, jitter is the tick ISR time from its ideal time
+typedef struct
+{
+   uint32_t       Ticks;
+   uint32_t       MaxJitter;          // In uS
+   uint32_t       SumJitter;          // In uS
+   bool           Timed;              // True when the sweep timer is running
+} SweepStats;
+
+#define SWPtick   20                  // Sweep tick in millisec
+
 #define MAXSWEEPTABLE 10
 
 // This structure defines a piecewise linear sweep table
@@ -112,6 +129,7 @@ void GetSweepTimeTWSW(int chan);
 void StartSweepTWSW(int chan);
 void StopSweepTWSW(int chan);
 void GetStatusTWSW(int chan);
+void GetJitterTWSW(void);
 void QueueCompressionTrigger(int num);
 void ProcessCompressionTrigger(void);
 
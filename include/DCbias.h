@@ -99,6 +99,7 @@ void  DCbiasPower(void);
 void  DelayMonitoring(void);
 
 void  DCbiasRead(int, float **);
+bool  DCbiasGetReadback(int chan, float *fVal);
 void  DCbiasRead(int);
 bool  DCbiasReadMax(int chan, float *fVal);
 void  DCbiasReadMax(int chan);
@@ -1,10 +1,17 @@
 #ifndef DCBIASSTATE_H_
 #define DCBIASSTATE_H_
 
+// States and segments are kept in linked lists in the order they are defined, the segment
+// list order is the play order. Both are also indexed by a hash of the name so the lookups
+// made while building a list don't walk the list. Segments and time points hold pointers to
+// their states so playback does no lookups.
+#define DCBLhashSize  32      // Hash buckets, must be a power of 2
+
 typedef struct
 {
    int8_t    Address;  // SPI address for the DAC
    int8_t    Count;
+   int8_t    Next;     // Next module with data, -1 if this is the last
    uint32_t  *data;   // This is the DMA data buffer, three words per transfer.
                       // DMA does 16 bit transfers to SPI, two transfers for 
                       // each channel update then a transfer to a dummy SPI
@@ -18,6 +25,8 @@ struct DCstate
 {
   char        name[10];
   DCstate     *next;
+  DCstate     *hnext;           // Next state in the same hash bucket
+  int8_t      First;            // First module with data, -1 if none
   ModuleData  md[4];
 };
 
@@ -38,6 +47,7 @@ struct DCsegment
 {
   char         name[10];
   DCsegment    *next;
+  DCsegment    *hnext;          // Next segment in the same hash bucket
   DCsegment    *repeat;
   char         TriggerSource;   // Segment trigger source, Q, R, or S. If S is it started from ISR
                                 // If null then start from a software command
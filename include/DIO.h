@@ -28,6 +28,7 @@ typedef struct
 
 extern PulseCounter *pulseCounter;
 extern uint32_t  DIOholdOff;
+extern void (*AuxTriggerFunction)(void);
 int FindInList(const char *list, char *entry);
 
 // Macros
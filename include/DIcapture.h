@@ -0,0 +1,66 @@
+#ifndef DICAPTURE_H_
+#define DICAPTURE_H_
+
+//
+// Digital input event capture. Edges on the selected inputs, Q thru X, are time stamped in the
+// DIhandler port ISR and saved in a RAM ring. The time stamp is the Cortex-M3 DWT cycle counter,
+// 84 MHz or 11.9 nS per count, extended to 48 bits, so events can be placed against the table
+// and ramp timing to well under a microsecond. The ISR is the only writer and the host readout
+// is the only reader, the reader never disables interrupts.
+//
+// When the ring is full new records are dropped and counted as overflows for the input, the
+// edge counts are always updated so they stay exact.
+//
+// Binary readout frame, GDICAPBIN, all multi byte values are little endian:
+//    DICsync1, DICsync2      2 byte frame marker
+//    Count                   16 bit number of records in the frame
+//    Overflow                32 bit total records dropped since the last clear
+//    Records                 Count 8 byte records:
+//                              32 bit cycle count, low word
+//                              16 bit cycle count, high word
+//                              8 bit input, 0 = Q thru 7 = X
+//                              8 bit level after the edge, 1 = rising, 0 = falling
+//    Checksum                8 bit, two's complement of the sum of all bytes from Count
+//                            through the last record
+//
+
+#define DICmaxRecords   256       // Ring size in records, must be a power of 2
+#define DICmaxFrame     64        // Maximum records in one binary frame
+#define DICsync1        0x55
+#define DICsync2        0xC3
+
+typedef struct
+{
+  uint32_t   Time;                  // DWT cycle count, low 32 bits
+  uint16_t   TimeHigh;              // Cycle count wraps, every 51 seconds
+  uint8_t    Input;                 // 0 = Q thru 7 = X
+  uint8_t    Level;                 // Input level after the edge
+} DICrecord;
+
+typedef struct
+{
+  uint8_t    Edge[8];               // Captured edges per input, 0 = off, RISING, FALLING, or CHANGE
+  uint32_t   Rising[8];
+  uint32_t   Falling[8];
+  uint32_t   Overflow[8];
+  uint32_t   MaxCycles;             // Longest capture ISR time in cycles
+  volatile uint32_t Head;           // Next record to write, only the ISR changes this
+  volatile uint32_t Tail;           // Next record to read, only the readout changes this
+  DICrecord  Rec[DICmaxRecords];
+} DICdata;
+
+extern DICdata dicdata;
+
+// Prototypes
+void DIcapture_init(void);
+void DIcapture_loop(void);
+uint64_t DIcaptureTime(void);
+int  DIcaptureInput(char *input);
+void DIcaptureSet(char *input, char *edge);
+void DIcaptureCounts(char *input);
+void DIcaptureClear(void);
+void DIcaptureStatus(void);
+void DIcaptureList(int max);
+void DIcaptureBinary(int max);
+
+#endif
@@ -69,22 +69,6 @@ typedef struct
   float        Bias;        // Actual bias voltage
 } CVBIASreadBacks;
 
-typedef struct
-{
-  bool          update;
-  bool          Enable[2];
-  float         CV[2];
-  float         Bias[2];
-  float         PosZero;
-  float         NegZero;
-  float         PosOffset;
-  float         NegOffset;
-  float         CVstart[2];
-  float         CVend[2];
-  int           Steps;
-  int           StepDuration;
-} CVBIASstate;
-
 typedef struct
 {
   bool          Enable;
@@ -149,23 +133,6 @@ typedef struct
   float        Vrf;        // Vrf actual voltage, M0 ADC channel A0
 } WAVEFORMSreadBacks;
 
-typedef struct
-{
-  bool          update;
-  bool          Enable[2];            // Turns the FAIMS drive on or off
-  float         Vrf[2];               // Setpoint voltage
-  int           Freq[2];              // FAIMS frequency
-  int8_t        Duty[2];              // FAIMS duty cycle
-  float         Drive[2];             // Drive level, in percentage
-  bool          Mode[2];              // True if in closed loop control
-  float         MaxPower[2];
-  float         MaxDrive[2];
-  float         VRFstart[2];
-  float         VRFend[2];
-  int           Steps;
-  int           StepDuration;
-} WAVEFORMSstate;
-
 typedef struct
 {
   bool          Enable;
@@ -215,6 +182,64 @@ typedef struct
 extern CVBIASdata      cvbiasdata;
 extern WAVEFORMSdata   waveformsdata;
 
+//
+// Scan capture. The scan timer ISR captures the electrometer currents and the CV and Vrf
+// readbacks of the selected channel once per step, before it advances the step, and saves
+// them in a RAM ring with the step number and time. The report drains the ring while the
+// scan runs, as text lines with DDSCNSTRT or as binary blocks with DDSCNSTRTB. When the ring
+// is full new records are dropped and counted, the step numbers in the report show the gap.
+//
+// A step that starts more than half a step period late is flagged, Missed holds the number
+// of whole step periods that passed without a step. Flags also mark captures where the TWI
+// bus was busy or a read failed, the last good values are saved for those.
+//
+// Binary block, all multi byte values are little endian:
+//    DDSsync1, DDSsync2      2 byte block marker
+//    Count                   16 bit number of records in the block, 0 ends the scan
+//    Dropped                 32 bit records dropped since the scan started
+//    Records                 Count 28 byte records, see DDSrecord
+//    Checksum                8 bit, two's complement of the sum of all bytes from Count
+//                            through the last record
+//
+
+#define DDSmaxRecords       128      // Ring size in records, must be a power of 2
+#define DDSmaxBlock         16       // Maximum records in one binary block
+#define DDSsync1            0x55
+#define DDSsync2            0xD5
+
+#define DDSFelec            0x01     // Electrometer read failed
+#define DDSFreadback        0x02     // Readback read failed
+#define DDSFbusy            0x04     // TWI bus was busy, nothing was read
+#define DDSFlate            0x08     // Step started late, see Missed
+
+typedef struct
+{
+  uint32_t     Step;                 // Step number, 1 thru the number of steps
+  uint32_t     Time;                 // uS from the scan start
+  uint16_t     Flags;
+  uint16_t     Missed;               // Step periods missed before this step
+  float        PosCurrent;
+  float        NegCurrent;
+  float        CV;                   // CV readback
+  float        Vrf;                  // Vrf readback
+} DDSrecord;
+
+typedef struct
+{
+  uint32_t     StartTime;            // Scan start in uS
+  uint32_t     LastTime;             // Last step in uS
+  uint32_t     Period;               // Step period in uS
+  int          Point;                // Last step captured
+  int          Steps;
+  uint32_t     Dropped;              // Records dropped, ring full
+  uint32_t     Missed;               // Step periods missed
+  uint32_t     Failed;               // Captures with a failed or skipped read
+  uint32_t     MaxISR;               // Longest capture in uS
+  volatile uint32_t Head;            // Next record to write, only the ISR changes this
+  volatile uint32_t Tail;            // Next record to read, only the report changes this
+  DDSrecord    Rec[DDSmaxRecords];
+} DDScapture;
+
 bool RestoreDMSDMSsettings(int brd, CVBIASdata  *cvd,bool NoDisplay);
 bool RestoreDMSDMSsettings(int brd, WAVEFORMSdata  *wfd,bool NoDisplay);
 void RestoreDMSDMSsettings(void);
@@ -9,6 +9,11 @@ extern const char *DILlist;
 extern const char *DOlist;
 extern const char *DOLlist;
 
+#define DLGmaxCache     48            // Entries tracked for change, entries past this are always drawn
+#define DLGmaxText      64            // Longest formatted entry
+#define DLGframeBudget  2000          // Default RefreshAllDialogEntries time per call in uS
+
+extern int DialogFrameBudget;
 
 enum DialogTypes
 {
@@ -77,6 +82,8 @@ void DisplayAllDialogEntryNames(DialogBox *d);
 void DialogBoxDisplay(DialogBox *d);
 DialogBoxEntry *GetDialogEntries(DialogBoxEntry *de, const char *rname);
 void RefreshAllDialogEntries(DialogBox *d);
+void DialogInvalidate(void);
+void DialogReportStats(void);
 void PrintDialog(DialogBox *d, int X, int Y, const char *text);
 bool RangeTest(DialogBoxEntry *des, const char *EntryName, float fval);
 
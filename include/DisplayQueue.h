@@ -0,0 +1,66 @@
+#ifndef DISPLAYQUEUE_H_
+#define DISPLAYQUEUE_H_
+
+//
+// Display queue. Dialog entry text is queued by the dialog functions and drawn by the Display
+// thread, so module loops that refresh a dialog don't wait on the display. A queued entry
+// that is redrawn before it is drawn is replaced, only the latest text is drawn. Drawing a
+// window discards the queue, the queued entries belonged to the old window.
+//
+// The queue draws a text entry as one address window, each pixel row is rendered into a line
+// buffer and sent to the display with SPI DMA bursts of DSPburstPixels. The display chip select
+// is held low only for a burst. Interrupts stay enabled during a burst, the modes where
+// interrupt code sends to the SPI pause the queue. The window clear and the boot image use
+// the same bursts. The library draws text one font pixel at a time, each with its own address
+// window.
+//
+// The DMA channel is shared with the DC bias list DMA, the queue is paused
+// while a table is ready or running, while a DC bias state is being sent, and while any
+// module holds the display with DSPhold. While paused the window clear and boot image are
+// drawn with the library calls and queued entries wait. If the queue fills while paused new
+// entries are dropped and the dialog entries are all redrawn once the queue empties, while
+// running the oldest entry is drawn to make room. Text longer than DSPmaxText and
+// text queued before DisplayQueue_init is drawn right away with the library calls, an entry
+// waiting at the same place is dropped.
+//
+
+#define DSPqueueSize    24
+#define DSPmaxText      24
+#define DSPburstPixels  32            // Pixels per DMA burst
+#define DSPbudget       3000          // Display thread drawing time per pass in uS
+#define DSPinterval     10            // Display thread interval in mS
+
+typedef struct
+{
+  int16_t    X, Y;                  // Upper left corner in pixels
+  uint16_t   Fcolor, Bcolor;
+  uint8_t    Size;                  // Text size
+  char       Text[DSPmaxText];
+} DSPop;
+
+typedef struct
+{
+  uint32_t   Queued;
+  uint32_t   Replaced;              // Queued ops that replaced a waiting op at the same place
+  uint32_t   Drawn;
+  uint32_t   Discarded;
+  uint32_t   Overflows;             // Entries drawn right away or dropped because the queue was full
+  uint32_t   Bytes;                 // SPI bytes sent with DMA
+  uint32_t   MaxPass;               // Longest thread pass in uS
+} DSPstats;
+
+extern DSPstats dspstats;
+
+// Prototypes
+void DisplayQueue_init(void);
+void DisplayQueue_loop(void);
+bool DSPpaused(void);
+void DSPhold(void);
+void DSPrelease(void);
+void DSPqueueText(int16_t x, int16_t y, uint8_t size, uint16_t fcolor, uint16_t bcolor, const char *text);
+void DSPdiscard(void);
+void DSPfillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+void DSPpushColors(uint16_t *colors, int n);
+void DSPreportStatus(void);
+
+#endif
@@ -74,6 +74,9 @@ void SetESIchannel(char *Chan, char *Value);
 void GetESIchannel(int chan);
 void GetESIchannelV(int chan);
 void GetESIchannelI(int chan);
+bool ESIgetReadbackV(int chan, float *fVal);
+bool ESIgetReadbackI(int chan, float *fVal);
+void ESIoverCurrent(int b, bool over, float current);
 void GetESIchannelMax(int chan);
 void GetESIchannelMin(int chan);
 void GetESIstatus(int chan);
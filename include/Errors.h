@@ -91,4 +91,13 @@ extern int ErrorCode;
 #define ERR_QUADTOOMANYPOINTS       130     // QUAD scan, point count exceeds QUADscanMAXPOINTS
 #define ERR_QUADOUTSIDECAL          131     // QUAD scan, range too far outside the calibration table
 #define ERR_QUADNODCBCHAN           132     // QUAD scan, Rev 1/2 module has no valid resolving DC bias channel configured
+// Macro script errors
+#define ERR_MACROSYNTAX             133     // Macro script compile error, GMSERR reports the line and error
+#define ERR_MACRORUNNING            134     // Macro script is running
+// Timer manager errors
+#define ERR_TIMERINUSE              135     // Hardware timer is owned by another module, GTMRLIST reports the owner
+// Pulse train errors
+#define ERR_PTRNOTENABLED           136     // Pulse train generator is not enabled
+// TWI profile errors
+#define ERR_TWIBUSY                 137     // TWI bus is in use
 #endif
@@ -0,0 +1,60 @@
+#ifndef FAIMSSCAN_H_
+#define FAIMSSCAN_H_
+
+//
+// Timer driven FAIMS DC CV scan engine. The DAC codes for every step are known before the
+// scan starts so the timer ISR only indexes or interpolates a code and writes it to the CV
+// DAC. Step timing is set by the timer and does not depend on the FAIMS loop period.
+//
+// Scan modes:
+//    CVSlinear     Ramp from CVstart to CVend over Duration, one step every CVscanTick mS
+//    CVSstep       Steps steps from CVstart, each StepDuration mS, same values as the
+//                  original step scan
+//    CVSlist       Arbitrary list of CV values, each StepDuration mS
+//
+// If a capture ADC channel is defined the DUE ADC is read at the end of every step, just
+// before the next CV is output, and saved. GFMSCNDAT reports the captured values.
+//
+
+#define CVSmaxList      200       // Maximum number of CV values in a list scan
+#define CVSmaxCapture   1000      // Maximum number of saved per step ADC captures
+
+enum CVscanMode
+{
+  CVSlinear,
+  CVSstep,
+  CVSlist
+};
+
+typedef struct
+{
+  volatile bool     Running;        // True while the timer is stepping
+  volatile bool     Done;           // Set by the ISR after the last step
+  CVscanMode        Mode;
+  int               Ticks;          // Number of steps in the scan
+  int               Div;            // Linear and step modes, code = Code0 + (Code1 - Code0) * Step / Div
+  volatile int      Step;           // Index of the next step to output
+  uint16_t          Code0;          // DAC code at CVstart
+  uint16_t          Code1;          // DAC code at CVend
+  uint16_t          Code;           // Code being written
+  volatile int      NumCaptured;    // Number of saved ADC captures
+} CVscanData;
+
+extern CVscanData   cvscan;
+extern bool         FAIMSlistScan;
+extern int          CVscanTick;
+extern int          CVscanADCchan;
+extern int          CVlistLength;
+
+// Prototypes
+bool  CVscanStart(CVscanMode mode);
+void  CVscanStop(void);
+float CVscanCV(int step);
+void  CVlistClear(void);
+void  CVlistAdd(char *volts);
+void  CVlistReport(void);
+void  CVscanSetTick(int msec);
+void  CVscanSetADC(int chan);
+void  CVscanReportData(void);
+
+#endif
@@ -45,6 +45,22 @@ enum FPGA_array {
   FPGA_DAC  = STARTdac
 };
 
+// Registers 0 through STARTadc-1, the config word, masks, and m and b arrays, are only written by
+// MIPS. A copy of these registers as last written is kept and the write macros send only the
+// bytes that changed, the ADC and DAC arrays are written by the FPGA and are always sent.
+// Register accesses made between FPGAbegin and FPGAend share one SPI mode and address setup,
+// each access is still one chip select with the address auto incremented by the FPGA.
+#define FPGAcacheSize   STARTadc
+#define FPGAregSize     68            // Config word through the DAC array
+#define FPGAsampleTime  5             // ADC average sample interval in mS
+
+typedef struct
+{
+  uint32_t   Transfers;             // Chip selects
+  uint32_t   Bytes;                 // Register bytes read and written
+  uint32_t   Cached;                // Register bytes not written because they were unchanged
+} FPGAstats;
+
 // Note; ADC values are converted to DAC values using the following equation:
 // dac = (adc * m)/1024 + b
 
@@ -67,19 +83,19 @@ extern FPGAdata  *fpga;
 #define setBUSSEL(var,val)  {var &= ~(0x01 << BRDSELbit); var |= ((val & 0x01) << BRDSELbit);}
 #define setADDR(var,val)    {var &= ~(0x07 << ADDR0bit); var |= ((val & 0x07) << ADDR0bit);}
 
-#define writeFPGAcfg  writeFPGA(fpga, STARTcfg, 2, (uint8_t *)&fpga->cfg);
+#define writeFPGAcfg  writeFPGAcached(fpga, STARTcfg, 2, (uint8_t *)&fpga->cfg);
 #define readFPGAcfg   readFPGA(fpga, STARTcfg, 2, (uint8_t *)&fpga->cfg);
 
-#define writeFPGAadcMSK  writeFPGA(fpga, STARTadcMSK, 1, (uint8_t *)&fpga->ADCmask);
+#define writeFPGAadcMSK  writeFPGAcached(fpga, STARTadcMSK, 1, (uint8_t *)&fpga->ADCmask);
 #define readFPGAadcMSK   readFPGA(fpga, STARTadcMSK, 1, (uint8_t *)&fpga->ADCmask);
 
-#define writeFPGAdacMSK  writeFPGA(fpga, STARTdacMSK, 1, (uint8_t *)&fpga->DACmask);
+#define writeFPGAdacMSK  writeFPGAcached(fpga, STARTdacMSK, 1, (uint8_t *)&fpga->DACmask);
 #define readFPGAdacMSK   readFPGA(fpga, STARTdacMSK, 1, (uint8_t *)&fpga->DACmask);
 
-#define writem  writeFPGA(fpga, STARTm, 16, (uint8_t *)&fpga->m);
+#define writem  writeFPGAcached(fpga, STARTm, 16, (uint8_t *)&fpga->m);
 #define readm   readFPGA(fpga, STARTm, 16, (uint8_t *)&fpga->m);
 
-#define writeb  writeFPGA(fpga, STARTb, 16, (uint8_t *)&fpga->b);
+#define writeb  writeFPGAcached(fpga, STARTb, 16, (uint8_t *)&fpga->b);
 #define readb   readFPGA(fpga, STARTb, 16, (uint8_t *)&fpga->b);
 
 #define writeADC  writeFPGA(fpga, STARTadc, 16, (uint8_t *)&fpga->adc);
@@ -92,7 +108,11 @@ extern FPGAdata  *fpga;
 void FPGAinit(void);
 void readFPGAdacDisplay(void);
 
+void FPGAbegin(void);
+void FPGAend(void);
 void writeFPGA(FPGAdata *fd, int offset, int numBytes, uint8_t *ptr);
+void writeFPGAcached(FPGAdata *fd, int offset, int numBytes, uint8_t *ptr);
 void readFPGA(FPGAdata *fd, int offset, int numBytes, uint8_t *ptr);
+void readADCaverages(int num, int *avg);
 
 #endif
\ No newline at end of file
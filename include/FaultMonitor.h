@@ -0,0 +1,85 @@
+#ifndef FAULTMONITOR_H_
+#define FAULTMONITOR_H_
+
+//
+// Fault monitor, shared arc and over current trip policy for the high voltage modules.
+//
+// A module owns a FaultChannel for each thing it protects, registers it at init, and calls
+// FaultCheck every loop pass with its detector result and the monitored value. The monitor
+// applies the debounce count and decides when the module should trip. After a trip the module
+// calls FaultRestart each pass, it returns true once when an automatic restart is due. When the
+// retries are used up the channel is locked out, no more automatic restarts until the retry
+// window passes without a trip or the host sends FLTRESET. The module still decides what a
+// trip does to its hardware.
+//
+// Every trip, lockout, and restart is saved in an event ring with the millisecond time, the
+// value that tripped, and the last FLTpre values seen before the trip. The trip that uses up
+// the retries is logged as a TRIP followed by one LOCKOUT.
+//
+
+#define FLTmaxChannels  16        // Maximum number of registered fault channels
+#define FLTmaxEvents    16        // Event ring size
+#define FLTpre          4         // Number of pre trigger values saved with each event
+
+enum FaultState
+{
+  FLTok,                          // Monitoring
+  FLTtripped,                     // Tripped, automatic restart pending
+  FLTlocked                       // Tripped, no automatic restart
+};
+
+enum FaultEventType
+{
+  FLTEtrip,
+  FLTElockout,
+  FLTErestart,
+  FLTEreset
+};
+
+typedef struct
+{
+  const char *Name;               // Channel name used by the host commands
+  // Policy
+  int        Debounce;            // Consecutive fault detections to trip, 1 trips on the first
+  int        Retries;             // Automatic restarts allowed in the window, 0 = none
+  uint32_t   RetryDelay;          // mS from a trip to the automatic restart
+  uint32_t   RetryWindow;         // mS without a trip that clears the restart count
+  // State, maintained by the fault monitor
+  FaultState State;
+  int        Count;               // Consecutive detections
+  int        Tries;               // Restarts used in the current window
+  int        Inject;              // Synthetic detections pending, set by FLTINJ
+  uint32_t   TripTime;            // millis() at the last trip
+  uint32_t   Trips;               // Total trips since power up
+  float      Pre[FLTpre];         // Pre trigger values, ring buffer
+  int8_t     PreIndex;
+} FaultChannel;
+
+typedef struct
+{
+  uint32_t       Time;            // millis() when the event was logged
+  FaultChannel   *Channel;
+  FaultEventType Type;
+  float          Value;           // Monitored value at the event
+  float          Pre[FLTpre];     // Values before the event, oldest first
+} FaultEvent;
+
+extern CommandList FaultMonitorCmdList;
+
+// Prototypes
+void FaultMonitor_init(void);
+void FaultRegister(FaultChannel *fc);
+bool FaultCheck(FaultChannel *fc, bool fault, float value);
+bool FaultRestart(FaultChannel *fc);
+void FaultReset(FaultChannel *fc);
+void FaultReportLog(void);
+void FaultClearLog(void);
+void FaultReportStatus(void);
+void FaultHostReset(char *name);
+void FaultInject(char *name);
+void FaultSetDebounce(char *name, char *count);
+void FaultSetRetries(char *name, char *count);
+void FaultSetDelay(char *name, char *msec);
+void FaultReportPolicy(char *name);
+
+#endif
@@ -82,6 +82,9 @@ void SetFilamentSupplyVoltage(char *Chan, char *Voltage);
 void GetFilamentActualSupplyVoltage(int channel);
 void GetFilamentVoltage(int channel);
 void GetFilamentPower(int channel);
+bool FilamentGetReadbackI(int channel, float *fVal);
+bool FilamentGetReadbackV(int channel, float *fVal);
+bool FilamentGetReadbackP(int channel, float *fVal);
 void GetCurrentRampRate(int channel);
 void SetCurrentRampRate(char *chan, char *RampRate);
 void ResetFilamentSerialWD(void);
@@ -1,18 +1,43 @@
 #ifndef HVPS_h
 #define HVPS_h
 
+// HVPS_loop collects all of a module's DAC changes for one pass and sends them to the DAC7678
+// in one TWI transfer, then reads the monitor channels with one AD7994 sequence read. Turning a
+// channel on zeros the pos and neg control voltages then waits HVPSsettleMS before closing the
+// switch, the wait is a channel phase so the loop never blocks. GHVPSLOOP reports the loop time
+// for each module.
+#define HVPSsettleMS    10
+#define HVPSmaxWrites   8             // DAC writes per module per pass, 4 per channel
+
+enum HVPSphases
+{
+  HVPSPidle,
+  HVPSPsettle                         // Control voltages zeroed, waiting to close the switch
+};
+
 typedef struct
 {
   bool          Enable;
   int           Voltage;
+  uint8_t       Phase;
+  uint32_t      SettleStart;          // millis when the settle phase started
 } HVPSchState;
 
 typedef struct
 {
   bool          Update;
   HVPSchState   HVPSCH[2];
+  uint32_t      LoopTime;             // Last module update and readback time in uS
+  uint32_t      MaxLoop;
 } HVPSstate;
 
+typedef struct
+{
+  uint8_t       Num;
+  uint8_t       Chan[HVPSmaxWrites];
+  uint16_t      Counts[HVPSmaxWrites];
+} HVPSwrites;
+
 // Channel data structure
 typedef struct
 {
@@ -61,5 +86,7 @@ extern HVPSdata *HVPSarray[];
 // Prototypes
 void HVPSNumberOfChannels(void);
 void HVPS_init(int8_t Board, int8_t addr);
+bool HVPSgetReadback(int chan, float *fVal);
+void HVPSreportLoop(void);
 
 #endif
@@ -264,6 +264,7 @@ int  AD7998(int8_t adr, int8_t chan, int8_t num);
 int  AD7994(int8_t adr, int8_t chan);
 int  AD7994(int8_t adr, uint16_t *vals);
 int  AD7994(int8_t adr, int8_t chan, int8_t num);
+int  AD7994seq(int8_t adr, uint8_t mask, uint16_t *vals);
 int  AD5625(int8_t adr, uint8_t chan, uint16_t val);
 int  AD5625(int8_t adr, uint8_t chan, uint16_t val, int8_t Cmd);
 int  AD5625_EnableRef(int8_t adr);
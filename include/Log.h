@@ -1,26 +1,91 @@
 #ifndef LOG_H_
 #define LOG_H_
 
-#define MAXLOG  5
+//
+// Event log. Each event is saved as a fixed size binary record in a RAM ring, the oldest
+// records are overwritten when the ring is full. Every record has a sequence number so the
+// host can page through the ring and tell when records were lost.
+//
+// The time stamp is the RTC unix time plus microseconds. The RTC is read once per second by
+// Log_loop and the time between reads comes from micros(), so logging an event does not read
+// the RTC. The time only steps back if the RTC is set.
+//
+// If spill is enabled the records are also appended to LOGspillFile on the SD card, in
+// sequence order, once per second as CSV lines.
+//
 
-extern DialogBoxEntry MIPSlogEntries[];
-extern DialogBox MIPSlog;
+#define LOGsize       128              // RAM ring size in records
+#define LOGspillMax   16               // Maximum records written to SD per second
+#define LOGspillFile  "MIPSLOG.CSV"
+
+enum LogSeverity
+{
+  LOGinfo,
+  LOGwarning,
+  LOGerror,
+  LOGfault
+};
+
+enum LogCode
+{
+  LOGCmessage,                         // General message
+  LOGCpower,                           // Power supply on or off
+  LOGCtrip,                            // Arc or over current trip
+  LOGCrestart,                         // Automatic restart after a trip
+  LOGCreset,                           // Trip or lockout cleared by the host
+  LOGChardware,                        // Hardware read or write fault
+  LOGCtimer                            // Timer channel conflict, denied claim, or preemption, Mess is the user name
+};
+
+enum LogModule
+{
+  LOGMsystem,
+  LOGMdcbias,
+  LOGMrf,
+  LOGMesi,
+  LOGMfaims,
+  LOGMfault                            // Fault monitor, Mess is the fault channel name
+};
+
+typedef struct
+{
+  uint32_t   Seconds;                  // Unix time
+  uint32_t   Usec;                     // Microseconds within the second
+  uint8_t    Code;                     // LogCode
+  uint8_t    Severity;                 // LogSeverity
+  uint8_t    Module;                   // LogModule
+  int8_t     Board;                    // -1 if not board specific
+  int8_t     Chan;                     // -1 if not channel specific
+  float      Value;                    // Value that caused the event, for example the arc voltage
+  char const *Mess;                    // Constant message string
+} LogRecord;
 
 typedef struct
 {
   bool       enabled=true;
-  uint32_t   LogTime[MAXLOG];
-  char const *Mess[MAXLOG];
-  int8_t     head=0;
-  int8_t     tail=0;
-  int8_t     count=0;
+  int        Level=LOGinfo;            // Events below this severity are not logged
+  bool       Spill=false;              // Append records to the SD card if true
+  uint32_t   Cleared=0;                // Sequence number of the first record after the last clear
+  uint32_t   Next=0;                   // Sequence number of the next record
+  uint32_t   Read=0;                   // Sequence number of the next record for LogGetMessage
+  uint32_t   Spilled=0;                // Sequence number of the next record to spill
+  LogRecord  Rec[LOGsize];
 } LogData;
 
+extern DialogBoxEntry MIPSlogEntries[];
+extern DialogBox MIPSlog;
+
 extern LogData logdata;
 
 void DisplayLog(void);
+void Log_loop(void);
+void LogEvent(LogCode code, LogSeverity severity, LogModule module, int board, int chan, float value, char const *mess);
 void LogMessage(char const *mess);
 bool LogGetMessage(uint32_t *logTime, char **mess);
 void ReportLogEntry(void);
+void ReportLogPage(int first, int count);
+void ReportLogSequence(void);
+void ClearLog(void);
+void SetLogLevel(int level);
 
 #endif
@@ -0,0 +1,146 @@
+#ifndef MACROENGINE_H_
+#define MACROENGINE_H_
+
+//
+// Macro script engine. A script is a .mac file on the SD card, it is compiled when loaded and
+// then run by a thread a few lines per pass, so a script never blocks the other threads.
+// A plain recorded macro is a valid script, every line that does not start with a keyword is
+// a MIPS command. Several commands can be on one line separated by ;
+//
+// Keywords:
+//    # text                  Comment
+//    LET name = expr         Set a variable, variables are floats and are created on first use
+//    IF expr                 Run the lines up to ELSE or ENDIF if expr is not 0
+//    ELSE
+//    ENDIF
+//    LOOP expr               Run the lines up to ENDLOOP expr times
+//    ENDLOOP
+//    WHILE expr              Run the lines up to ENDWHILE while expr is not 0
+//    ENDWHILE
+//    WAIT expr               Wait expr mS
+//    WAITFOR expr, timeout   Wait until expr is not 0 or timeout mS. Sets TIMEOUT to 1 if it timed out, else 0
+//    STOP                    End the script
+//
+// Expressions use numbers, variables, $1 to $9 for the MSRUN parameters, and readbacks. A readback
+// is a MIPS command in brackets, for example [GDCBV,1], it is run and the value it returns is used,
+// TRUE is 1 and FALSE is 0. Operators are + - * / < > <= >= == != && || and parentheses.
+// In commands and readbacks $name is replaced by the variable value and $1 to $9 by the parameter.
+//
+// Example, ramp a DC bias channel and wait for it to settle:
+//    LET v = 0
+//    WHILE v < $2
+//      LET v = v + 10
+//      SDCB,$1,$v
+//      WAITFOR [GDCBV,$1] > v - 1, 2000
+//      IF TIMEOUT
+//        STOP
+//      ENDIF
+//    ENDWHILE
+//
+
+#define MSmaxLines    200         // Maximum number of compiled lines
+#define MSmaxTokens   400         // Expression token pool, all expressions in the script
+#define MSmaxText     2048        // Command and readback text pool
+#define MSmaxVars     16
+#define MSmaxDepth    8           // Maximum IF, LOOP, and WHILE nesting
+#define MSmaxParams   9
+#define MSnameLen     12
+#define MSargLen      20          // Command argument length, same as the command processor
+#define MSlineLen     100         // Maximum script line length
+#define MSstepsPerRun 20          // Maximum lines run per thread pass
+
+enum MSop
+{
+  MSOcmd,
+  MSOlet,
+  MSOif,
+  MSOelse,
+  MSOendif,
+  MSOloop,
+  MSOendloop,
+  MSOwhile,
+  MSOendwhile,
+  MSOwait,
+  MSOwaitfor,
+  MSOstop
+};
+
+enum MStokenType
+{
+  MSTend,
+  MSTnum,
+  MSTvar,
+  MSTparam,
+  MSTread,
+  MSTop
+};
+
+enum MSstate
+{
+  MSSidle,
+  MSSrunning,
+  MSSwaiting,
+  MSSerror
+};
+
+// Expression token, expressions are saved in RPN
+typedef struct
+{
+  uint8_t  Type;
+  char     Op;
+  int16_t  Index;                 // Variable, parameter, or readback text offset
+  float    Value;
+} MStoken;
+
+typedef struct
+{
+  uint8_t  Op;
+  uint8_t  Var;                   // LET target variable
+  int16_t  Line;                  // Source line, for error reports
+  int16_t  Jump;                  // Branch target
+  int16_t  Expr;                  // First expression
+  int16_t  Expr2;                 // WAITFOR timeout expression
+  int16_t  Text;                  // Command text offset
+} MSinst;
+
+typedef struct
+{
+  char     Name[21];              // Loaded script name
+  MSinst   Prog[MSmaxLines];
+  int      NumInst;
+  MStoken  Expr[MSmaxTokens];
+  int      NumTokens;
+  char     Text[MSmaxText];
+  int      TextLen;
+  char     VarName[MSmaxVars][MSnameLen];
+  int      NumVars;
+} MSprogram;
+
+typedef struct
+{
+  MSstate    State;
+  int        PC;
+  float      Vars[MSmaxVars];
+  char       Params[MSmaxParams][MSargLen];
+  int        LoopCount[MSmaxDepth];
+  int        LoopDepth;
+  uint32_t   WaitStart;
+  uint32_t   WaitTime;
+  int        ErrLine;
+  const char *ErrMess;
+} MSrun;
+
+extern MSrun msrun;
+
+// Prototypes
+void MacroEngine_init(void);
+void MacroEngine_loop(void);
+void MacroScriptLoad(char *name);
+void MacroScriptRun(void);
+void MacroScriptStop(void);
+void MacroScriptStatus(void);
+void MacroScriptError(void);
+void MacroScriptGetVar(char *name);
+void MacroScriptSetVar(char *name, char *value);
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef MEMPOOL_H_
+#define MEMPOOL_H_
+
+//
+// Memory pools and heap telemetry. The Due has 96K of RAM shared by the heap and the stack, the
+// heap only grows, so blocks that are freed and allocated in different sizes leave holes that
+// can't be used for a larger block later.
+//
+// Node pools hold fixed size nodes, the DC bias list states, segments, and time points. Nodes
+// are carved from chunks of MEMnodesPerChunk and freed nodes go back on the pool's free list,
+// so defining and removing list entries reuses the same memory. When a pool has no nodes in
+// use MemPoolCompact returns its chunks to the heap.
+//
+// Variable size blocks, the table buffers, the DC bias DMA words, and the ADC record buffer,
+// are allocated with MemAlloc, MemRealloc, and MemFree. Each block carries a small header with
+// its size and subsystem so the usage of every subsystem is known. A table buffer grows in
+// MEMtableStep byte steps while loading and is trimmed to the loaded size when the load is
+// done, the space is compacted between runs.
+//
+// GMEMSTAT reports the heap, GMEMUSE reports the usage of each subsystem and pool. Module data
+// allocated at startup is not tracked, it is part of the heap in use reported by GMEMSTAT.
+//
+
+#define MEMnodesPerChunk  8
+#define MEMtableStep      1000
+
+enum MemSubsystems
+{
+  MEMtable,
+  MEMdcbl,
+  MEMadc,
+  MEMnumSubsystems
+};
+
+typedef struct
+{
+  const char *Name;
+  uint32_t   Bytes;                 // Bytes in use, not including the block headers
+  uint32_t   Peak;                  // Most bytes in use
+  uint16_t   Blocks;                // Blocks in use
+  uint16_t   Failed;                // Allocations that failed
+} MemUsage;
+
+typedef struct MemNode MemNode;
+struct MemNode
+{
+  MemNode    *next;
+};
+
+typedef struct MemChunk MemChunk;
+struct MemChunk
+{
+  MemChunk   *next;
+};
+
+typedef struct
+{
+  const char *Name;
+  uint8_t    Sub;                   // Subsystem charged for the chunks
+  uint16_t   Size;                  // Node size in bytes, rounded up to a multiple of 4
+  uint16_t   InUse;
+  uint16_t   Peak;
+  uint16_t   Chunks;
+  uint16_t   Failed;
+  MemNode    *Free;
+  MemChunk   *Chunk;
+} MemPool;
+
+extern MemPool  DCstatePool;
+extern MemPool  DCsegmentPool;
+extern MemPool  DCtimePointPool;
+
+// Prototypes
+void MemPool_init(void);
+void *MemAlloc(int sub, size_t size);
+void *MemRealloc(int sub, void *ptr, size_t size);
+void MemFree(void *ptr);
+size_t MemSize(void *ptr);
+void *MemPoolGet(MemPool *mp);
+void MemPoolPut(MemPool *mp, void *node);
+void MemPoolCompact(MemPool *mp);
+int  MemLargestBlock(void);
+void MemReportStatus(void);
+void MemReportUsage(void);
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef PARAMMIRROR_H_
+#define PARAMMIRROR_H_
+
+//
+// Parameter mirror for smart TWI modules, modules with their own processor that take their
+// settings as TWI commands. A module describes each parameter once in a PMparam table, the
+// TWI command, channel byte, type, the variable holding the setting, and the limits. The
+// mirror keeps the last value sent for each parameter and PMsync sends only the parameters
+// that changed, or all of them when the mirror's Update flag is set.
+//
+// PMsync acquires the TWI bus and selects the module's board once for all of the pending
+// parameters, the modules take one command per transmission so each parameter is still its
+// own transmission. A parameter that is not acknowledged is sent again by the next sync.
+// Values outside the limits are clamped, the clamped value is written back to the variable
+// and sent. Min equal to Max disables the limits.
+//
+// Readback structures are read with PMreadBlock, every float field listed in the PMlimit
+// table must be a number in range or the block is dropped and the last good readback kept.
+// Values the module changes itself, like the drive level in closed loop mode, are read back
+// and marked as sent with PMaccept so they are not sent back to the module.
+//
+// Each mirror is registered with PMregister for the GMIRRORS report.
+//
+
+#define PMmaxMirrors    8
+#define PMmaxReadback   32            // Largest readback structure in bytes
+
+enum PMtypes
+{
+  PMfloat,
+  PMint,
+  PMbool,
+  PMint8
+};
+
+typedef struct
+{
+  int8_t     Cmd;                   // TWI command
+  int8_t     Ch;                    // Channel byte sent after the command, -1 for none
+  uint8_t    Type;                  // PMtypes
+  void       *Value;                // Variable holding the setting, NULL ends the table
+  float      Min, Max;
+  uint32_t   Sent;                  // Last value sent, raw bytes
+} PMparam;
+
+typedef struct
+{
+  const char *Name;
+  uint8_t    TWIadd;
+  int8_t     Brd;
+  bool       Update;                // Set to send all parameters on the next sync
+  PMparam    *Params;
+  // Statistics
+  uint32_t   Syncs;                 // Syncs that sent at least one parameter
+  uint32_t   Writes;
+  uint32_t   Clamped;
+  uint32_t   Failed;                // Writes not acknowledged
+  uint32_t   RBfailed;              // Readback blocks dropped
+} PMmirror;
+
+typedef struct
+{
+  int16_t    Offset;                // Float field offset in the readback structure, -1 ends the table
+  float      Min, Max;
+} PMlimit;
+
+// Prototypes
+void PMregister(PMmirror *pm, uint8_t TWIadd, int8_t brd);
+int  PMsync(PMmirror *pm);
+void PMaccept(PMmirror *pm, void *value);
+bool PMvalid(void *rb, const PMlimit *limits);
+bool PMreadBlock(PMmirror *pm, int ch, int cmd, void *dest, int size, const PMlimit *limits);
+void PMreport(void);
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef PULSETRAIN_H_
+#define PULSETRAIN_H_
+
+//
+// Pulse train generator. Generates a burst of Count pulses, Width wide and Period apart, Delay
+// after a trigger. The timing comes from timer TMR_PulseTrain clocked at MCK/2, 23.8 nS per count.
+// Period is set by RC and the pulse end by RA so the pulse timing does not depend on the main loop.
+//
+// Outputs:
+//    D2          Timer TIOA output. The compare hardware drives the pin, RC sets the pin and RA
+//                clears it, so the edges are exact to the timer clock. Only the RC interrupt
+//                is used to count the pulses.
+//    TRGOUT      Trigger output, driven from the RC and RA interrupts. The edges follow the
+//    AUXTRG      compare events by the interrupt latency, GPTRSTAT reports the worst case.
+//    A thru P    Digital outputs, driven from the interrupts through the shift register, this
+//                adds the SPI shift out time of about 6 uS to every edge.
+// The outputs are toggled from their level at the trigger, the same as TriggerOut.
+//
+// Trigger sources:
+//    SW          PTRTRG command only
+//    TABLE       Pulse sequence table start, hardware or software
+//    TRIGOUT     Every trigger output pulse, from the TRIGOUT commands or a table
+//    AUX         Every aux trigger output pulse
+//    Q thru X    Digital input edge, POS, NEG, or BOTH
+// A trigger that arrives while a burst is running is ignored and counted as missed.
+//
+// Jitter is measured by wiring the output back to a digital input and enabling edge capture
+// on the input with SDICAP, GPTRJIT then reports the period and width spread from the capture
+// records without removing them.
+//
+
+#define PTRticksPerUS   ((float)VARIANT_MCK / 2000000.0)
+#define PTRmaxTime      100000000.0   // Longest delay or period in uS, 32 bit counter limit
+#define PTRminPeriodHW  5.0           // Minimum period in uS for the D2 output, the RC ISR counts pulses
+#define PTRminPeriodSW  5.0           // Minimum period in uS for the trigger outputs
+#define PTRminPeriodDIO 25.0          // Minimum period in uS for the digital outputs
+#define PTRminGap       1.0           // Minimum off time in uS
+
+enum PTRoutputs
+{
+  PTRoutHW,
+  PTRoutPin,
+  PTRoutDIO
+};
+
+enum PTRphases
+{
+  PTRPidle,
+  PTRPdelay,
+  PTRPrun,
+  PTRPlast
+};
+
+typedef struct
+{
+  char     Output[7];               // D2, TRGOUT, AUXTRG, or A thru P
+  char     Source[8];               // SW, TABLE, TRIGOUT, AUX, or Q thru X
+  char     Level[5];                // Input edge for Q thru X, POS, NEG, or BOTH
+  float    Width;                   // Pulse width in uS
+  float    Period;                  // Pulse period in uS
+  float    Delay;                   // Delay from trigger to the first pulse in uS
+  int      Count;                   // Pulses per trigger, 0 = run until disabled
+  bool     Enable;                  // True when armed and waiting for triggers
+} PTRdata;
+
+extern PTRdata  ptrdata;
+
+// Prototypes
+void PulseTrain_init(void);
+void PTRtrigger(void);
+void PTRsetOutput(char *output);
+void PTRsetTrigger(char *source, char *level);
+void PTRreportTrigger(void);
+void PTRsetEnable(char *state);
+void PTRsoftwareTrigger(void);
+void PTRreportStatus(void);
+void PTRreportJitter(char *input);
+
+#endif
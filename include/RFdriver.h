@@ -13,6 +13,7 @@ extern float RFarcV;
 extern bool  RFgatingOff;
 extern bool  TuneAbort;
 extern bool  TuneRFfullRange;
+extern int   RFctlLogCH;
 
 // ADC control structure. This allows an ADC channel to control a RF channel's
 // drive or setpoint depending on the RF driver channels mode. ADC input is assumed
@@ -117,6 +118,10 @@ void RFvoltageReportN(int channel);
 void RFdriveReport(int channel);
 void RFvoltageReport(int channel);
 void RFheadPower(int channel);
+bool RFgetReadbackP(int channel, float *fVal);
+bool RFgetReadbackN(int channel, float *fVal);
+bool RFgetDriveLevel(int channel, float *fVal);
+bool RFgetPower(int channel, float *fVal);
 void RFreportAll(void);
 void RFautoTune(int channel);
 void RFautoRetune(int channel);
@@ -130,6 +135,14 @@ float PWLlookup(int ch, int ph, int adcval);
 int8_t BoardFromSelectedChannel(int8_t SC);
 void RFgateDisable(char *cmd);
 void SetRFautoTuneAbort(void);
+bool RFtuneStart(int chan, bool retune, bool report);
+bool RFtuneBusy(int brd);
+void setRFkp(char *Chan, char *Val);
+void getRFkp(int Chan);
+void setRFki(char *Chan, char *Val);
+void getRFki(int Chan);
+void setRFslew(char *Chan, char *Val);
+void getRFslew(int Chan);
 
 void RFmodeReport(int);
 void RFmodeSet(char *, char *);
@@ -204,4 +217,37 @@ typedef struct
   float        PWR;        // Driver power level
 } RFreadBacks;
 
+// Closed loop amplitude control for one model 1 RF driver channel. In auto mode a PI controller
+// sets the drive level from the average of the RF+ and RF- amplitudes.
+typedef struct
+{
+  float        Kp;         // Proportional gain, percent drive per volt of error
+  float        Ki;         // Integral gain, percent drive per volt of error per second
+  float        Slew;       // Maximum drive level change, percent per second
+  float        Vpp;        // Lightly filtered amplitude used by the controller
+  float        Integral;   // Integrator, percent drive
+  bool         Active;     // Cleared when not in auto mode, the integrator is loaded on the next auto pass
+} RFpiControl;
+
+// Auto tune state for one model 1 RF driver channel. Each channel has its own state so
+// channels on different boards can tune at the same time.
+typedef struct
+{
+  int8_t       State;      // Tune state, TUNE_IDLE when not tuning
+  int8_t       Chan;       // Channel number, 0 to 3
+  bool         Report;     // If true a report is sent when tuning finishes
+  int8_t       Passes;     // Loop passes at the current frequency
+  int8_t       NumDown;    // Number of decreasing samples in a row
+  int8_t       Shifts;     // Number of times the fit window has moved in this stage
+  int          Step;       // Frequency step size in Hz
+  int          Start;      // Coarse scan starting frequency
+  float        StartAmp;   // Amplitude at the starting frequency
+  int          Freq;       // Frequency being measured
+  float        Prev;       // Previous unfiltered amplitude, used to test for settling
+  int          LastFreq;   // Frequency of the last settled sample
+  float        Last;       // Amplitude of the last settled sample
+  int          FreqMax;    // Frequency of the peak sample in this stage
+  float        Amp[3];     // Amplitude at FreqMax-Step, FreqMax, and FreqMax+Step, negative if not measured
+} RFtuneState;
+
 #endif
@@ -152,6 +152,8 @@ void SerialInit(void);
 char *GetToken(bool ReturnComma);
 char *LastToken(void);
 int  ProcessCommand(void);
+Commands *FindCommand(char *Cmd2Find);
+void ExecuteCommand(const Commands *cmd, int arg1, int arg2, char *args1, char *args2, float farg1);
 void GetNumChans(char *cmd);
 void RB_Init(Ring_Buffer *);
 int  RB_Size(Ring_Buffer *);
@@ -85,6 +85,8 @@ int TWIstart(uint8_t add, int board, int cmd);
 void TWIend(uint8_t add, int board);
 
 // Function prototypes for TWI data types read and write functions
+int  TWIsend(uint8_t add, int board, uint8_t *buf, int n, bool atomic);
+int  TWIrecv(uint8_t add, int board, uint8_t *cmd, int ncmd, uint8_t *dest, int n, bool atomic);
 void TWIcmd(uint8_t add, int board, int cmd);
 void TWIcmd(uint8_t add, int board, int ch, int cmd);
 void TWIsetBool(uint8_t add, int board, int cmd, bool flag);
@@ -0,0 +1,71 @@
+#ifndef TWIPROFILE_H_
+#define TWIPROFILE_H_
+
+//
+// TWI device profiles. Each device on the TWI busses has a profile with its bus clock, the
+// minimum time between transactions, and the number of times a write that is not acknowledged
+// is sent again. A device is registered by its first acknowledged transaction with the class
+// of the function that talks to it, the module EEPROMs are registered by ScanHardware.
+//
+// The TWI functions call TWIbegin after the board is selected, it waits out the gap and sets
+// the bus clock for the device. TWIfinish records the result and puts the bus back to its
+// default clock, so code that uses the Wire functions directly always runs at the default.
+// A profile starts at the bus default clock. After TWIdownshift failed transactions in a row
+// the profile's clock is lowered one step.
+//
+// TWICHAR measures the error rate of each device at each clock up to its class limit, EEPROMs
+// are read and compared, DACs and ADCs are probed for an acknowledge. Each device is then set
+// to the fastest clock with no errors at that clock and all slower clocks. Smart module
+// command ports are not probed, they take the clock found for their EEPROM, which is emulated
+// by the same processor.
+//
+
+#define TWImaxProfiles  32
+#define TWIdownshift    3             // Failed transactions in a row that lower the clock
+#define TWImaxTries     1000          // TWICHAR tries per clock limit
+
+enum TWIclass
+{
+  TWIcEEPROM,
+  TWIcSmart,                          // Module processor command port
+  TWIcDAC,
+  TWIcADC
+};
+
+typedef struct
+{
+  const char *Name;
+  uint32_t   MaxClock;
+  uint8_t    Retries;
+} TWIclassData;
+
+typedef struct
+{
+  int8_t     Bus;                   // 0 = Wire, 1 = Wire1
+  int8_t     Brd;                   // Board select, -1 for Wire1
+  uint8_t    Addr;
+  uint8_t    Class;                 // TWIclass
+  uint32_t   Clock;
+  uint16_t   Gap;                   // Minimum time between transactions in uS
+  uint8_t    Retries;               // Times a write that is not acknowledged is sent again
+  uint8_t    Fails;                 // Failed transactions in a row
+  uint32_t   LastEnd;               // End of the last transaction in uS
+  // Statistics
+  uint32_t   Transactions;
+  uint32_t   Errors;
+  uint32_t   Retried;
+  uint16_t   Downshifts;
+} TWIprofile;
+
+// Prototypes
+void       TWIprofile_init(void);
+TWIprofile *TWIprofileAdd(int bus, int brd, uint8_t add, uint8_t cls);
+TWIprofile *TWIprofileFind(int bus, int brd, uint8_t add);
+TWIprofile *TWIbegin(int bus, uint8_t add, uint8_t cls);
+void       TWIfinish(TWIprofile *tp, int status);
+void       TWIsetBusClock(int bus, uint32_t clock);
+void       TWIreportProfiles(void);
+void       TWIsetProfile(void);
+void       TWIcharacterize(int tries);
+
+#endif
@@ -95,6 +95,7 @@ extern int  TimeDelta;
 extern const char *TableStatus;
 extern bool TrigEvyCycle;
 extern bool TBLportTest;
+extern void (*TableStartFunction)(void);
 
 // Funtion queue enum and structures to support queuing functions that need
 // to execute at compare events when LDAC is generated
@@ -164,11 +165,13 @@ void SetTableEntryCount(int Count, int Chan, float NewCount);
 void EnableRamp(char *ena, char *freq);
 void ProcessRamp(volatile TableEntry *TE);
 void StartRampClock(void);
+void RampReportStatus(void);
 void StopRampClock(void);
 void TriggerOnChange(char *TWIadd);
 
 int DefineTableNumber(int tblnum);
 void TableCheck(void);
+void TableLint(void);
 void GetTableStatus(void);
 
 // Real time processing routines
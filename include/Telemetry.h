@@ -0,0 +1,71 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include "Serial.h"
+
+//
+// Telemetry supports periodic push of readback values to the host. The host subscribes
+// to a list of signals, each defined by the readback command mnemonic and a channel
+// number, for example TLMADD,GDCBV,3 or TLMADD,GRFPPVP,1. A thread then sends one binary
+// frame per period holding the filtered readback value for every subscribed signal. The
+// values are the same ones the modules compute in their loops and report through the
+// readback commands, no additional hardware access is done.
+//
+// Frame format, all multi byte values are little endian:
+//    TLMsync1, TLMsync2      2 byte frame marker
+//    Count                   8 bit number of values in the frame
+//    Sequence                16 bit frame counter, wraps
+//    Time                    32 bit millisecond time stamp, millis() when the frame was built
+//    Values                  Count 32 bit IEEE floats, in subscription order. A value is NaN
+//                            if the channel was not available when the frame was built
+//    Checksum                8 bit, two's complement of the sum of all bytes from Count
+//                            through the last value
+//
+// A frame for 16 signals is 74 bytes, compared to roughly 10 bytes of ASCII reply per value
+// plus the command traffic for polling.
+//
+
+#define TLMmaxSignals     16        // Maximum number of subscribed signals
+#define TLMminPeriod      10        // Minimum frame period in mS
+#define TLMmaxPeriod      60000     // Maximum frame period in mS
+#define TLMsync1          0x55
+#define TLMsync2          0xA5
+#define TLMheaderSize     9         // Sync 2, count 1, sequence 2, time 4
+#define TLMframeSize      (TLMheaderSize + TLMmaxSignals * sizeof(float) + 1)
+
+// Readback source, one for each supported readback command
+typedef struct
+{
+  const char *Name;                           // Readback command mnemonic
+  bool       (*Read)(int chan, float *fVal);  // Returns false if the channel is invalid
+} TLMsource;
+
+typedef struct
+{
+  const TLMsource *Source;
+  int             Chan;
+} TLMsignal;
+
+typedef struct
+{
+  bool       Enabled;
+  int        Period;                  // Frame period in mS
+  int        NumSignals;
+  uint16_t   Sequence;
+  TLMsignal  Signals[TLMmaxSignals];
+} TLMdata;
+
+extern TLMdata     tlmdata;
+extern CommandList TelemetryCmdList;
+
+// Prototypes
+void Telemetry_init(void);
+void Telemetry_loop(void);
+void TelemetryAdd(char *name, char *chan);
+void TelemetryClear(void);
+void TelemetryList(void);
+void SetTelemetryPeriod(int period);
+void SetTelemetryEnable(char *state);
+void TelemetrySources(void);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef TIMERMANAGER_H_
+#define TIMERMANAGER_H_
+
+//
+// Timer resource manager. The Due has 9 timer channels, MIPStimer 0 thru 8, and most modules
+// use a fixed channel defined in Variants.h. Each user of a channel defines a TimerUser and
+// registers it when its module is found, users without an init function are registered by
+// their first claim. A channel with more than one registered user is logged as a conflict and
+// reported by GTMRCONF.
+//
+// A user claims its channel before it starts the timer and releases it when the timer stops.
+// A claim is granted if the channel is free or already owned by the user. If another user owns
+// the channel the claim is denied, unless the owner has a Release function and a lower priority,
+// then the owner is stopped by calling Release and the claim is granted. Release is called with
+// interrupts disabled so it must only stop the timer and clear flags. Claims and releases can be
+// made from an ISR. A claim only sets the user's log flags, the denials, preemptions, and new
+// conflicts are logged by TimerManager_loop.
+//
+
+#define TMRnumTimers   9
+#define TMRmaxUsers    24
+
+// Log flags, set by claims and registers and cleared when logged
+#define TMRlogDenied     0x01
+#define TMRlogPreempted  0x02
+#define TMRlogConflict   0x04
+
+enum TimerPriority
+{
+  TMRPlow,
+  TMRPnormal,
+  TMRPhigh
+};
+
+typedef struct
+{
+  const char *Name;
+  int8_t     Timer;                 // MIPStimer channel, 0 thru 8
+  uint8_t    Priority;              // TimerPriority
+  void       (*Release)(void);      // Stops the user when it is preempted, NULL if it can't be preempted
+  bool       Active;                // True while the user owns the channel
+  uint16_t   Claims;
+  uint16_t   Denied;
+  uint16_t   Preempted;
+  volatile uint8_t Pending;         // Log flags waiting for TimerManager_loop
+} TimerUser;
+
+// Prototypes
+void TimerManager_init(void);
+void TimerManager_loop(void);
+void TimerRegister(TimerUser *tu);
+bool TimerClaim(TimerUser *tu);
+void TimerRelease(TimerUser *tu);
+TimerUser *TimerOwner(int timer);
+void TimerReportList(void);
+void TimerReportUsers(void);
+void TimerReportConflicts(void);
+
+#endif
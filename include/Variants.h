@@ -37,6 +37,7 @@
 #include "RFdriver.h"
 #include "Twave.h"
 #include "FAIMS.h"
+#include "FAIMSscan.h"
 #include "ESI.h"
 #include "Filament.h"
 #include "ARB.h"
@@ -59,6 +60,17 @@
 #include "FAIMSfb.h"
 #include "DCBcurrent.h"
 #include "DCBswitch.h"
+#include "Telemetry.h"
+#include "FaultMonitor.h"
+#include "MacroEngine.h"
+#include "TimerManager.h"
+#include "DIcapture.h"
+#include "PulseTrain.h"
+#include "MemPool.h"
+#include "BootProfile.h"
+#include "DisplayQueue.h"
+#include "ParamMirror.h"
+#include "TWIprofile.h"
 
 // Test mode flags, uncomment to enable selected test mode
 //#define TestMode
@@ -104,6 +116,9 @@ extern softRTC rtc;
 #define    TMR_ADCclock       1       // Used by the ADC digitizer function
 #define    FAIMSFB_ScanClock  6       // Used to generate scan clock in FAIMSFB module
 #define    TMR_RampClock      2       // Used to generate voltage ramps in table mode
+#define    TMR_FAIMSscan      6       // Used to step the FAIMS CV scan engine, shared with the ARB clock and FAIMSFB scan
+#define    TMR_PulseTrain     0       // Used by the pulse train generator, TIOA output is D2
+#define    TMR_Sweep          5       // Used to step the Twave/ARB frequency and voltage sweeps, shared with the DC bias pulse
 
 // Table mode software clock input pin, use S (DI2), default
 #define    SoftClockDIO DI2
@@ -129,6 +129,15 @@ inline void Adafruit_ILI9340::spiwrite16(uint16_t w)
 
 
 
+void Adafruit_ILI9340::beginBurst(void) {
+  SET_BIT(dcport, dcpinmask);
+  CLEAR_BIT(csport, cspinmask);
+}
+
+void Adafruit_ILI9340::endBurst(void) {
+  SET_BIT(csport, cspinmask);
+}
+
 void Adafruit_ILI9340::writecommand(uint8_t c) {
 //  if(disable) return;
   CLEAR_BIT(dcport, dcpinmask);
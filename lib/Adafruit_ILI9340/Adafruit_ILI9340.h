@@ -159,6 +159,12 @@ class Adafruit_ILI9340 : public Adafruit_GFX {
   void     dummyclock(void);
   */  
 
+  // Burst pixel writes, selects the display for data with the chip select held low so the
+  // caller can stream pixel bytes to the SPI, used by the MIPS display queue
+  void        beginBurst(void),
+              endBurst(void);
+  bool        isDisabled(void) { return disable; }
+
   uint8_t     spiwrite(uint8_t);
   void        spiwrite16(uint16_t w); 
   void        writecommand(uint8_t c),
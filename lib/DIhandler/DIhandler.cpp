@@ -34,6 +34,8 @@ void (*DIhandler::DI_ISR[8])(void) = {NULL,NULL,NULL,NULL,NULL,NULL,NULL,NULL};
 void (*DI_ISRs[8])(void) = {DI_Q_ISR,DI_R_ISR,DI_S_ISR,DI_T_ISR,DI_U_ISR,DI_V_ISR,DI_W_ISR,DI_X_ISR};
 int DIhandler::NumHandlers = 0;
 int DIhandler::NumInterrupts = 0;
+void (*DIhandler::CaptureISR)(int Index, bool Level) = NULL;
+uint8_t DIhandler::CaptureMask = 0;
 DIhandler *DIhandler::handlers[MaxDIhandlers];
 
 DIhandler::DIhandler(void)
@@ -114,10 +116,43 @@ void DIhandler::detach(void)
    {
       if(handlers[i] != NULL) if(handlers[i]->di == ('Q'+Index)) return;
    }
+   if(CaptureMask & (1 << Index)) return;
    if(DIpin[Index] != 0) detachInterrupt(DIpin[Index]);
    DI_ISR[Index] = NULL;
 }
 
+void DIhandler::setCapture(void (*isr)(int Index, bool Level))
+{
+   CaptureISR = isr;
+}
+
+bool DIhandler::capture(char DI, bool enable)
+{
+   int Index,i;
+   
+   Index = DI - 'Q';
+   if((Index < 0) || (Index > 7)) return false;
+   if(enable)
+   {
+      CaptureMask |= 1 << Index;
+      if(DI_ISR[Index] == NULL)
+      {
+         attachInterrupt(DIpin[Index], DI_ISRs[Index], CHANGE);
+         DI_ISR[Index] = DI_ISRs[Index];
+      }
+      return true;
+   }
+   CaptureMask &= ~(1 << Index);
+   // If this input is no longer used then detach the port interrupt
+   for(i=0;i<MaxDIhandlers;i++)
+   {
+      if(handlers[i] != NULL) if(handlers[i]->di == DI) return true;
+   }
+   if(DI_ISR[Index] != NULL) detachInterrupt(DIpin[Index]);
+   DI_ISR[Index] = NULL;
+   return true;
+}
+
 void DIhandler::setPriority(uint8_t pri)
 {
    int Index;
@@ -197,6 +232,9 @@ void DI_Generic_ISR(int Index)
    int i,pinstate = HIGH;
    void  (*userISRptr)(void);
    
+   // Capture first so the time stamp is as close to the edge as possible
+   if((DIhandler::CaptureMask & (1 << Index)) && (DIhandler::CaptureISR != NULL))
+      DIhandler::CaptureISR(Index, (DIhandler::pio[Index]->PIO_PDSR & DIhandler::pin[Index]) != 0);
    DIhandler::NumInterrupts++;
 //   if((DIhandler::pio[Index]->PIO_ODSR & DIhandler::pin[Index]) == 0) pinstate = LOW;
    pinstate = digitalRead(DIhandler::DIpin[Index]);
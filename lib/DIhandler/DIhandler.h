@@ -18,6 +18,8 @@ public:
 	static  int NumHandlers;
 	static  DIhandler *handlers[MaxDIhandlers];
 	static  int NumInterrupts;
+	static  void (*CaptureISR)(int Index, bool Level);  // Called first on every edge of a captured input
+	static  uint8_t CaptureMask;     // Inputs with capture enabled, bit 0 is Q
 	
 	char   di;				 // Digital input channel, Q - X
 	int    mode;		 	 // Mode used for this call back, Pos, Neg, or Change
@@ -34,6 +36,8 @@ public:
 	bool activeLevel(void);	// Returns true if the active level is true
 	bool state(void);	      // Returns the inputs state, true if high
 	bool test(int mode);	  // Returns true if input state matches the level
+	static void setCapture(void (*isr)(int Index, bool Level));
+	static bool capture(char DI, bool enable);	// Enables the port interrupt for capture even with no handler attached
 };
 
 #endif
@@ -34,6 +34,7 @@
 
 uint16_t  *ADCbuffer = NULL;  // Pointer to ADC buffer used to hold the raw data.
 MIPStimer *ADCclock = NULL;   // Timer used to set the digitization rate
+TimerUser ADCtimer  = {"ADC", TMR_ADCclock, TMRPnormal, NULL};
 
 #define      SMPS 32
 
@@ -213,15 +214,20 @@ int ADCsetup(void)
 {
   if(ADCready) return(ERR_ADCALREARYSETUP);
   if(!AcquireADC()) return(ERR_ADCNOTAVALIABLE);
+  if(!TimerClaim(&ADCtimer))
+  {
+    ReleaseADC();
+    return(ERR_TIMERINUSE);
+  }
   ADCacquire = true;
   // Allocate the buffers, four sets of sample buffers
-  if(ADCbuffer == NULL) ADCbuffer = new uint16_t [SMPS * 4];
+  if(ADCbuffer == NULL) ADCbuffer = (uint16_t *)MemAlloc(MEMadc, SMPS * 4 * sizeof(uint16_t));
   if(ADCbuffer == NULL) return(ERR_CANTALLOCATE);
   // Setup the timer used to set the ADC trigger rate
   if(ADCclock == NULL) ADCclock = new MIPStimer(TMR_ADCclock);
   if(ADCclock == NULL) 
   {
-    delete[] ADCbuffer;
+    MemFree(ADCbuffer);
     ADCbuffer = NULL;
     return(ERR_CANTALLOCATE);
   }
@@ -379,17 +385,22 @@ int ADCrbSetup(void)
 {
   if(ADCready) return(ERR_ADCALREARYSETUP);
   if(!AcquireADC()) return(ERR_ADCNOTAVALIABLE);
+  if(!TimerClaim(&ADCtimer))
+  {
+    ReleaseADC();
+    return(ERR_TIMERINUSE);
+  }
   ADCacquire = true;
   // Allocate the buffer
-  if(ADCbuffer != NULL) delete [] ADCbuffer;
+  MemFree(ADCbuffer);
   ADCbuffer = NULL;
-  ADCbuffer = new uint16_t [ADCnumsamples];
+  ADCbuffer = (uint16_t *)MemAlloc(MEMadc, ADCnumsamples * sizeof(uint16_t));
   if(ADCbuffer == NULL) return(ERR_CANTALLOCATE);
   // Setup the timer used to set the ADC trigger rate
   if(ADCclock == NULL) ADCclock = new MIPStimer(TMR_ADCclock);
   if(ADCclock == NULL) 
   {
-    delete[] ADCbuffer;
+    MemFree(ADCbuffer);
     ADCbuffer = NULL;
     return(ERR_CANTALLOCATE);
   }
@@ -591,6 +602,7 @@ void ADCstop(void)
   ADCsamples = 0;
   // Initialize Analog Controller
   ADCclock->stop();
+  TimerRelease(&ADCtimer);
   NVIC_ClearPendingIRQ(ADC_IRQn);
   pmc_enable_periph_clk(ID_ADC);
   adc_set_writeprotect(ADC, 1);  // Enable the write registers
@@ -99,6 +99,7 @@ extern ThreadController control;
 Thread ARBthread  = Thread();
 
 MIPStimer *ARBclock;
+TimerUser ARBclockTimer = {"ARBCLK", TMR_ARBclock, TMRPhigh, NULL};
 
 #define ARB ARBarray[SelectedARBboard]
 
@@ -776,6 +777,7 @@ void SetARBcommonClock(ARBdata *ad, int freq)
   int actualF;
 
   if(ad == NULL) return;
+  if(!TimerClaim(&ARBclockTimer)) return;
   //ARBclock->stop();      // Removing this stop command will remove a 200uS gap in clock when in the sweep mode. GAA 3/3/23
                            // Does not seem to need this stop command.
   if(strcmp(ad->Mode,"TWAVE") == 0)
@@ -794,6 +796,15 @@ void SetARBcommonClock(ARBdata *ad, int freq)
   ARBclock->start(-1, 0, true);
 }
 
+// Stops the common clock and frees its timer when no module is using it
+void ARBcommonClockRelease(void)
+{
+  for(int b=0;b<MAXARBMODULES;b++) if((ARBarray[b] != NULL) && ARBarray[b]->UseCommonClock) return;
+  if(!ARBclockTimer.Active) return;
+  ARBclock->stop();
+  TimerRelease(&ARBclockTimer);
+}
+
 void SetFrequency(int board, int freq)
 {
   uint8_t *b;
@@ -1060,8 +1071,10 @@ void ARB_init(int8_t Board, int8_t addr)
     ARBthread.setInterval(100);
     // Add threads to the controller
     control.add(&ARBthread);
-     // Start the common clock in case we need it
+     // Create the common clock in case we need it, the timer is claimed when a module
+     // uses the common clock
     ARBclock = new MIPStimer(TMR_ARBclock);
+    TimerRegister(&ARBclockTimer);
   }
   else
   {
@@ -1497,6 +1510,7 @@ void SetARBUseCommonClock(char *module, char *flag)
      {
         ARBarray[b]->UseCommonClock = false;
         SetBool(b, TWI_ARB_SET_EXT_CLOCK, false);
+        ARBcommonClockRelease();
      }
      SendACK;
      return;
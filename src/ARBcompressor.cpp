@@ -15,10 +15,13 @@ void CompressorStackInit(void);
 bool CompressorLoopStart(int Index);
 int  CompressorProcessLoop(int Count);
 void SetARBcommonClock(ARBdata *ad, int freq);
+extern TimerUser ARBclockTimer;
 bool IsARBmodule(int index);
 
 static DIhandler *restart = NULL;
 
+TimerUser ARBCmpTimer = {"ARBCMP", TMR_TwaveCmp, TMRPnormal, NULL};
+
 DialogBoxEntry ARBCompressorEntries[] = {
   {" Mode"                , 0, 1, D_LIST   , 0,  0, 8, 15, false, CmodeList, Cmode, NULL, ARBupdateMode},
   {" Order"               , 0, 2, D_INT    , 0, 65535, 1, 18, false, "%5d", &arb.Corder, NULL, ARBupdateCorder},
@@ -151,6 +154,7 @@ void ARBcompressorTimerISR(void)
   {
     // Stop the timer
     CompressorTimer.stop();
+    TimerRelease(&ARBCmpTimer);
     // Restore the mode
     if(!NoCompressInit) ARBupdateMode();
     return;    
@@ -222,6 +226,7 @@ void ARBcompressorTimerISR(void)
   {
     // Stop the timer
     CompressorTimer.stop();
+    TimerRelease(&ARBCmpTimer);
     // Restore the mode
     if(!NoCompressInit) ARBupdateMode();
     return;
@@ -233,6 +238,8 @@ void ARBcompressorTimerISR(void)
 void ARBcompressorTriggerISR(void)
 {
   if(CompressorDisable) return;
+  // Ignore the trigger if another module owns the timer
+  if(!TimerClaim(&ARBCmpTimer)) return;
   // Clear and setup variables
   if(!NoCompressInit) ARBnormal;             // Put system in normal mode
   ARBgetNextOperationFromTable(true);
@@ -668,8 +675,8 @@ char ARBgetNextOperationFromTable(bool init)
           if(AcquireTWI()) SetFloat(b-1,TWI_ARB_SET_AUX, -fval); else TWIqueue(SetFloat,b-1,TWI_ARB_SET_AUX, -fval);
        }
     }
-    else if(OP == 's') ARBclock->stop();                            // Stop the clock
-    else if(OP == 'r') ARBclock->start(-1, 0, true);                // Restart the clock
+    else if((OP == 's') && ARBclockTimer.Active) ARBclock->stop();              // Stop the clock
+    else if((OP == 'r') && ARBclockTimer.Active) ARBclock->start(-1, 0, true);  // Restart the clock
     else if(OP == 'o') C_SwitchTime = (count / 1000.0) * C_clock;   // Sets the switch open time
     else if(OP == 'M') C_NormAmpMode = count;                       // Set compressor normal amplitude mode
     else if(OP == '[') CompressorLoopStart(tblindex);
@@ -697,6 +704,7 @@ void ARBcompressor_init(void)
   ClearOutput(ARBarray[0]->Cswitch,ARBarray[0]->CswitchLevel);
   // Setup the trigger line and ISR
   CtrigInput = new DIhandler;
+  TimerRegister(&ARBCmpTimer);
   ARBupdateMode();
   ARBupdateCorder();
   ARBsetSwitch();
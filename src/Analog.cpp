@@ -13,6 +13,18 @@
 //  RFD1 through RFD2 or RFD4 depending on how many channels are available.
 //
 //
+// The ADS1115s are read by a non-blocking state machine, see Analog.h.
+//
+// Commands:
+//    SANARATE,ch,sps         Set a channel's data rate, 8,16,32,64,128,250,475, or 860 SPS
+//    GANARATE,ch             Report a channel's data rate
+//    SANAPGA,ch,mV           Set a channel's PGA full scale, 6144,4096,2048,1024,512, or 256 mV
+//    GANAPGA,ch              Report a channel's PGA full scale
+//    SANAAVG,ch,num          Set the number of conversions averaged for a channel's reading
+//    GANAAVG,ch              Report a channel's number of conversions averaged
+//    GANAV,ch                Report a channel's input in volts
+//    GANASTAT                Report conversions per second, TWI errors, longest pass in uS
+//
 // Gordon Anderson
 // July 9, 2015
 //
@@ -37,6 +49,7 @@ extern ThreadController control;
 void AddMainMenuEntry(MenuEntry *me);
 void UpdateMinMax(void);
 void Analog_loop(void);
+void ANAcheckSettings(void);
 
 // MIPS Threads
 Thread AnalogThread  = Thread();
@@ -56,8 +69,44 @@ Analog analog = {sizeof(Analog), "Analog", 1, false, 8, 0x48, 0x49,
                  "NONE", 0, 0.0, -250, 250, 1, 2667, 0, NULL,
                  "NONE", 0, 0.0, -250, 250, 2, 2667, 0, NULL,
                  "NONE", 0, 0.0, -250, 250, 3, 2667, 0, NULL,
+                 {6, 6, 6, 6, 6, 6, 6, 6},
+                 {0, 0, 0, 0, 0, 0, 0, 0},
+                 {1, 1, 1, 1, 1, 1, 1, 1},
                 };
 
+// ADS1115 data rates in SPS and PGA full scales in mV by code
+const int ANAsps[] = {8, 16, 32, 64, 128, 250, 475, 860};
+const int ANAfs[]  = {6144, 4096, 2048, 1024, 512, 256};
+
+// Acquisition state, not saved
+ANAdevice ANAdev[2] = {{-1}, {-1}};
+float     ANAsum[8];
+uint8_t   ANAcount[8];
+uint32_t  ANAconversions = 0;
+uint32_t  ANAerrors = 0;
+uint32_t  ANAmaxLoop = 0;
+uint32_t  ANAstatStart = 0;
+uint32_t  ANAlastControl = 0;
+
+const Commands  AnalogCmdArray[] = {
+// Start of command block
+//
+// Analog input commands
+//
+  {"SANARATE", CMDfunction, 2, (char *)ANAsetRate},             // Set a channel's data rate, 8,16,32,64,128,250,475, or 860 SPS
+  {"GANARATE", CMDfunction, 1, (char *)ANAgetRate},             // Report a channel's data rate in SPS
+  {"SANAPGA",  CMDfunction, 2, (char *)ANAsetPGA},              // Set a channel's PGA full scale, 6144,4096,2048,1024,512, or 256 mV
+  {"GANAPGA",  CMDfunction, 1, (char *)ANAgetPGA},              // Report a channel's PGA full scale in mV
+  {"SANAAVG",  CMDfunction, 2, (char *)ANAsetAverage},          // Set the number of conversions averaged for a channel's reading, 1 to 64
+  {"GANAAVG",  CMDfunction, 1, (char *)ANAgetAverage},          // Report a channel's number of conversions averaged
+  {"GANAV",    CMDfunction, 1, (char *)ANAgetValue},            // Report a channel's input in volts
+  {"GANASTAT", CMDfunction, 0, (char *)ANAreportStatus},        // Report conversions per second, TWI errors, and the longest thread pass in uS
+// End of table marker
+  {0},
+};
+
+CommandList AnalogCmdList = { (Commands *)AnalogCmdArray, NULL };
+
 char *AnalogOptionList;
 
 extern DialogBoxEntry AnalogEntriesPage2[];
@@ -204,6 +253,8 @@ int ADS1115readAverage(int8_t adr, int8_t chan, int8_t num)
     if(adr == analog.ADC1add) sum += (int16_t)ads1->readADC_SingleEnded(chan);
     else sum += (int16_t)ads2->readADC_SingleEnded(chan);
   }
+  // The acquisition state machine's conversions were overwritten, restart them
+  ANAdev[0].Chan = ANAdev[1].Chan = -1;
   return(sum/num);
 }
 
@@ -280,8 +331,11 @@ void RestoreAnalogSettings(bool NoDisplay)
       b[i] = iVal;
     }
     file.close();
-    // Copy to MIPS config struct
+    // Copy to MIPS config struct, files saved before the acquisition settings were added
+    // are shorter and leave them at their defaults
+    if ((a.Size > (int)sizeof(Analog)) || (a.Size < 0)) break;
     memcpy(&analog, &a, a.Size);
+    ANAcheckSettings();
     // Update the min / max values this also update the control function pointers
     UpdateMinMax();
     if (!NoDisplay) DisplayMessage("Parameters Restored!", 2000);
@@ -316,23 +370,133 @@ char *BuildAnalogOptionList(void)
   return (char *)OptionList.c_str();
 }
 
-// Read all the analog input channels and save results in data structure.
+// Makes sure the acquisition settings are valid, they can be missing from an old settings file.
+void ANAcheckSettings(void)
+{
+  for (int i = 0; i < 8; i++)
+  {
+    if (analog.Rate[i] > 7) analog.Rate[i] = 6;
+    if (analog.PGA[i] > 5) analog.PGA[i] = 0;
+    if ((analog.Average[i] < 1) || (analog.Average[i] > ANAmaxAverage)) analog.Average[i] = 1;
+  }
+}
+
+static bool ANAwrite(uint8_t addr, uint16_t config)
+{
+  Wire1.beginTransmission(addr);
+  Wire1.write((uint8_t)ADS1015_REG_POINTER_CONFIG);
+  Wire1.write((uint8_t)(config >> 8));
+  Wire1.write((uint8_t)(config & 0xFF));
+  return (Wire1.endTransmission() == 0);
+}
+
+static bool ANAread(uint8_t addr, int16_t *val)
+{
+  uint16_t hb;
+
+  Wire1.beginTransmission(addr);
+  Wire1.write((uint8_t)ADS1015_REG_POINTER_CONVERT);
+  if (Wire1.endTransmission() != 0) return false;
+  if (Wire1.requestFrom(addr, (uint8_t)2) != 2) return false;
+  hb = Wire1.read();
+  *val = (int16_t)((hb << 8) | Wire1.read());
+  return true;
+}
+
+// Starts a single shot conversion of channel i, channels 0 thru 3 are on the first ADC and
+// 4 thru 7 are on the second.
+static bool ANAstart(int i)
+{
+  ANAdevice *d = &ANAdev[i >> 2];
+  uint16_t  config;
+
+  config = ADS1015_REG_CONFIG_OS_SINGLE | ADS1015_REG_CONFIG_MODE_SINGLE | ADS1015_REG_CONFIG_CQUE_NONE;
+  config |= ADS1015_REG_CONFIG_MUX_SINGLE_0 + ((analog.ac[i].DCmon.Chan & 3) << 12);
+  config |= analog.PGA[i] << 9;
+  config |= analog.Rate[i] << 5;
+  if (!ANAwrite(i < 4 ? analog.ADC1add : analog.ADC2add, config))
+  {
+    ANAerrors++;
+    d->Chan = -1;
+    return false;
+  }
+  d->Chan = i;
+  d->Start = micros();
+  // The ADS1115 data rate is within 10%
+  d->Time = 1100000 / ANAsps[analog.Rate[i]] + 100;
+  return true;
+}
+
+// Returns the raw counts scaled to the 6.144 volt range of the channel calibration.
+static float ANAscale(int i, int16_t raw)
+{
+  return (float)raw * (float)ANAfs[analog.PGA[i]] / 6144.0;
+}
+
+// Applies the channel calibration to scaled counts in float so the finer PGA ranges keep
+// their resolution, Counts2Value would truncate to whole 6.144 volt range counts.
+static float ANAvalue(int i, float counts)
+{
+  return (counts - analog.ac[i].DCmon.b) / analog.ac[i].DCmon.m;
+}
+
+// Called every pass for each ADC, reads the finished conversion and starts the next channel.
+// Returns right away if the conversion is not done.
+static void ANAstep(int dev)
+{
+  ANAdevice *d = &ANAdev[dev];
+  int16_t   raw;
+  int       i, first, last;
+
+  first = dev * 4;
+  last = min(first + 4, analog.NumChannels);
+  if (first >= last) return;
+  if (d->Chan >= 0)
+  {
+    if ((micros() - d->Start) < d->Time) return;
+    i = d->Chan;
+    if (ANAread(i < 4 ? analog.ADC1add : analog.ADC2add, &raw))
+    {
+      ANAconversions++;
+      ANAsum[i] += ANAscale(i, raw);
+      if (++ANAcount[i] >= analog.Average[i])
+      {
+        analog.ac[i].ADCvalue = ANAvalue(i, ANAsum[i] / ANAcount[i]);
+        ANAsum[i] = 0;
+        ANAcount[i] = 0;
+      }
+    }
+    else ANAerrors++;
+    if (++i >= last) i = first;
+  }
+  else i = first;
+  ANAstart(i);
+}
+
+// Read all the analog input channels and save results in data structure. This waits on each
+// conversion and is only used at startup, the thread uses ANAstep.
 //  2/3x gain +/- 6.144V (default)
 //  single ended operation means only 1/2 range of ADC is used 0 to 27,000 for 5 volt operation with 2/3 gain
 void ReadAnalog(void)
 {
-  int i, iVal;
+  int     i;
+  int16_t raw;
 
   if (analog.Enabled)
   {
     for (i = 0; i < analog.NumChannels; i++)
     {
-      // Read raw ADC counts
-      if (i < 4) iVal = (int16_t)ads1->readADC_SingleEnded(analog.ac[i].DCmon.Chan);
-      else iVal = (int16_t)ads2->readADC_SingleEnded(analog.ac[i].DCmon.Chan);
+      if (!ANAstart(i)) continue;
+      delayMicroseconds(ANAdev[i >> 2].Time);
+      if (!ANAread(i < 4 ? analog.ADC1add : analog.ADC2add, &raw))
+      {
+        ANAerrors++;
+        continue;
+      }
       // Convert to voltage
-      analog.ac[i].ADCvalue = Counts2Value(iVal, &analog.ac[i].DCmon);
+      analog.ac[i].ADCvalue = ANAvalue(i, ANAscale(i, raw));
     }
+    ANAdev[0].Chan = ANAdev[1].Chan = -1;
   }
 }
 
@@ -414,11 +578,13 @@ void Analog_init(void)
     // Configure Threads
     AnalogThread.setName("Analog");
     AnalogThread.onRun(Analog_loop);
-    AnalogThread.setInterval(100);
+    AnalogThread.setInterval(ANAloopInterval);
     // Add threads to the controller
     control.add(&AnalogThread);
+    AddToCommandList(&AnalogCmdList);
     // Read the inputs now
     ReadAnalog();
+    ANAstatStart = ANAlastControl = millis();
   }
 }
 
@@ -426,21 +592,27 @@ void Analog_init(void)
 void Analog_loop(void)
 {
   static int disIndex = 0;
-  uint32_t   startTime;
+  uint32_t   startTime, us;
 
   if (!analog.Enabled) return;
-  // Read all the ADC input channels and save them in the data structure.
+  // Read the finished conversions and start the next ones, this does not wait on the ADCs.
   // This TWI device can fail and take a long time to complete, so test the
   // function run time, if over 50 milli sec then kill the this thead and 
   // display an error message.
   startTime = millis();
-  ReadAnalog();
-  if((millis()-startTime) > 50000)
+  us = micros();
+  ANAstep(0);
+  ANAstep(1);
+  us = micros() - us;
+  if (us > ANAmaxLoop) ANAmaxLoop = us;
+  if((millis()-startTime) > ANAfailTime)
   {
     DisplayMessage("Analog module failed!",2000);
     AnalogThread.enabled = false;
     return;
   }
+  if ((millis() - ANAlastControl) < ANAcontrolInterval) return;
+  ANAlastControl = millis();
   // Adjust all the mapped values
   AnalogControl();
   // If we are displaying the analog values then update one each pass through this loop
@@ -450,3 +622,118 @@ void Analog_loop(void)
     if(disIndex >= analog.NumChannels) disIndex = 0;
   }
 }
+
+//
+// Host commands
+//
+
+// Returns the channel index, 0 thru 7, or -1 if the channel number is not valid
+static int ANAchannel(int ch)
+{
+  if ((ch < 1) || (ch > analog.NumChannels)) return -1;
+  return ch - 1;
+}
+
+// Changing a channel's settings drops its partial average
+static void ANArestart(int i)
+{
+  ANAsum[i] = 0;
+  ANAcount[i] = 0;
+}
+
+void ANAsetRate(int ch, int sps)
+{
+  int i, code;
+
+  if ((i = ANAchannel(ch)) == -1) BADARG;
+  for (code = 0; code < 8; code++) if (ANAsps[code] == sps) break;
+  if (code >= 8) BADARG;
+  analog.Rate[i] = code;
+  ANArestart(i);
+  SendACK;
+}
+
+void ANAgetRate(int ch)
+{
+  int i;
+
+  if ((i = ANAchannel(ch)) == -1) BADARG;
+  SendACKonly;
+  if (SerialMute) return;
+  serial->println(ANAsps[analog.Rate[i]]);
+}
+
+void ANAsetPGA(int ch, int mv)
+{
+  int i, code;
+
+  if ((i = ANAchannel(ch)) == -1) BADARG;
+  for (code = 0; code < 6; code++) if (ANAfs[code] == mv) break;
+  if (code >= 6) BADARG;
+  analog.PGA[i] = code;
+  ANArestart(i);
+  SendACK;
+}
+
+void ANAgetPGA(int ch)
+{
+  int i;
+
+  if ((i = ANAchannel(ch)) == -1) BADARG;
+  SendACKonly;
+  if (SerialMute) return;
+  serial->println(ANAfs[analog.PGA[i]]);
+}
+
+void ANAsetAverage(int ch, int num)
+{
+  int i;
+
+  if ((i = ANAchannel(ch)) == -1) BADARG;
+  if ((num < 1) || (num > ANAmaxAverage)) BADARG;
+  analog.Average[i] = num;
+  ANArestart(i);
+  SendACK;
+}
+
+void ANAgetAverage(int ch)
+{
+  int i;
+
+  if ((i = ANAchannel(ch)) == -1) BADARG;
+  SendACKonly;
+  if (SerialMute) return;
+  serial->println(analog.Average[i]);
+}
+
+void ANAgetValue(int ch)
+{
+  int i;
+
+  if ((i = ANAchannel(ch)) == -1) BADARG;
+  SendACKonly;
+  if (SerialMute) return;
+  serial->println(analog.ac[i].ADCvalue, 3);
+}
+
+// Reports the conversion rate since the last report, the TWI errors, and the longest thread
+// pass, the pass time is reset.
+void ANAreportStatus(void)
+{
+  uint32_t now = millis();
+  uint32_t maxLoop;
+  float    rate = 0;
+
+  if (now != ANAstatStart) rate = (float)ANAconversions * 1000.0 / (float)(now - ANAstatStart);
+  ANAconversions = 0;
+  ANAstatStart = now;
+  maxLoop = ANAmaxLoop;
+  ANAmaxLoop = 0;
+  SendACKonly;
+  if (SerialMute) return;
+  serial->print(rate, 1);
+  serial->print(",");
+  serial->print(ANAerrors);
+  serial->print(",");
+  serial->println(maxLoop);
+}
@@ -0,0 +1,152 @@
+//
+// BootProfile
+//
+// Startup phase timing and the FLASH module inventory, see BootProfile.h.
+//
+// Commands:
+//    GBOOTTIME               Report the startup phase times, phase,mS one per line, then TOTAL,mS
+//    GBOOTMODS               Report the modules, board,address,name,mS,state one per line
+//
+#include "Variants.h"
+#include "BootProfile.h"
+#include <DueFlashStorage.h>
+
+extern DueFlashStorage dueFlashStorage;
+
+const PROGMEM byte BootInventoryStorage[sizeof(BootInventory)] = {};
+
+BootPhaseTime BootPhases[BOOTmaxPhases];
+int           NumBootPhases = 0;
+uint32_t      BootLast = 0;
+
+BootInventory BootFound;                  // Modules found by this startup
+uint32_t      BootModTime[BOOTmaxModules];  // Signature read and init time in uS
+uint8_t       BootModState[BOOTmaxModules];
+BootInventory BootSaved;                  // Inventory from the last startup
+uint8_t       BootSavedFound[BOOTmaxModules];
+
+const char    *BootStateNames[] = {"SAME", "NEW", "CHANGED", "GONE"};
+
+const Commands  BootProfileCmdArray[] = {
+// Start of command block
+//
+// Startup profile commands
+//
+  {"GBOOTTIME", CMDfunction, 0, (char *)BootReportTimes},       // Report the startup phase times, phase,mS one per line, then TOTAL,mS
+  {"GBOOTMODS", CMDfunction, 0, (char *)BootReportModules},     // Report the modules found at startup, board,address,name,mS,state one per line, state is SAME, NEW, CHANGED, or GONE
+// End of table marker
+  {0},
+};
+
+CommandList BootProfileCmdList = { (Commands *)BootProfileCmdArray, NULL };
+
+// Marks the end of a startup phase, the phase time is the time since the last mark or reset.
+void BootMark(const char *phase)
+{
+  uint32_t now = millis();
+
+  if(NumBootPhases >= BOOTmaxPhases) return;
+  BootPhases[NumBootPhases].Name = phase;
+  BootPhases[NumBootPhases++].Time = now - BootLast;
+  BootLast = now;
+}
+
+// Called by ScanHardware for every signature it reads, signature holds the BOOTsigSize byte
+// EEPROM header and us is the time to read it and init the module.
+void BootModuleFound(int board, uint8_t addr, char *signature, uint32_t us)
+{
+  BootModule *bm;
+
+  if(BootFound.NumModules >= BOOTmaxModules) return;
+  BootModTime[BootFound.NumModules] = us;
+  bm = &BootFound.Mod[BootFound.NumModules++];
+  bm->Board = board;
+  bm->Addr = addr;
+  bm->Size = *(uint16_t *)signature;
+  strncpy(bm->Name, &signature[2], sizeof(bm->Name) - 1);
+  bm->Name[sizeof(bm->Name) - 1] = 0;
+}
+
+// Called once from setup after ScanHardware. Compares the modules found to the saved inventory
+// and saves the new inventory if anything changed.
+void BootProfile_init(void)
+{
+  byte *b = (byte *)&BootSaved;
+  bool changed = false;
+  int  i,j;
+
+  for(i=0;i<(int)sizeof(BootInventory);i++) b[i] = dueFlashStorage.readAbs(((uint32_t)BootInventoryStorage) + i);
+  if((BootSaved.Signature != BOOTinvSign) || (BootSaved.NumModules > BOOTmaxModules)) BootSaved.NumModules = 0;
+  for(i=0;i<BootFound.NumModules;i++)
+  {
+    BootModState[i] = BOOTnew;
+    for(j=0;j<BootSaved.NumModules;j++)
+    {
+      if((BootSaved.Mod[j].Board != BootFound.Mod[i].Board) || (BootSaved.Mod[j].Addr != BootFound.Mod[i].Addr)) continue;
+      BootSavedFound[j] = true;
+      if((BootSaved.Mod[j].Size == BootFound.Mod[i].Size) && (strcmp(BootSaved.Mod[j].Name, BootFound.Mod[i].Name) == 0)) BootModState[i] = BOOTsame;
+      else BootModState[i] = BOOTchanged;
+      break;
+    }
+    if(BootModState[i] != BOOTsame) changed = true;
+  }
+  for(j=0;j<BootSaved.NumModules;j++) if(!BootSavedFound[j]) changed = true;
+  if(changed)
+  {
+    BootFound.Signature = BOOTinvSign;
+    dueFlashStorage.writeAbs((uint32_t)BootInventoryStorage, (byte *)&BootFound, sizeof(BootInventory));
+  }
+  AddToCommandList(&BootProfileCmdList);
+}
+
+//
+// Host commands
+//
+
+void BootReportTimes(void)
+{
+  uint32_t total = 0;
+
+  SendACKonly;
+  if(SerialMute) return;
+  for(int i=0;i<NumBootPhases;i++)
+  {
+    serial->print(BootPhases[i].Name);
+    serial->print(",");
+    serial->println(BootPhases[i].Time);
+    total += BootPhases[i].Time;
+  }
+  serial->print("TOTAL,");
+  serial->println(total);
+  serial->println("");
+}
+
+void BootReportModules(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  for(int i=0;i<BootFound.NumModules;i++)
+  {
+    serial->print((char)('A' + BootFound.Mod[i].Board));
+    serial->print(",");
+    serial->print(BootFound.Mod[i].Addr, HEX);
+    serial->print(",");
+    serial->print(BootFound.Mod[i].Name);
+    serial->print(",");
+    serial->print((float)BootModTime[i] / 1000.0, 1);
+    serial->print(",");
+    serial->println(BootStateNames[BootModState[i]]);
+  }
+  for(int j=0;j<BootSaved.NumModules;j++)
+  {
+    if(BootSavedFound[j]) continue;
+    serial->print((char)('A' + BootSaved.Mod[j].Board));
+    serial->print(",");
+    serial->print(BootSaved.Mod[j].Addr, HEX);
+    serial->print(",");
+    serial->print(BootSaved.Mod[j].Name);
+    serial->print(",0,");
+    serial->println(BootStateNames[BOOTgone]);
+  }
+  serial->println("");
+}
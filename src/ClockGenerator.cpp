@@ -7,6 +7,12 @@
  * Updated to disable the PLL before update. This is recommended in the data sheet to
  * prevent any out of bound PLL conditions.
  *
+ * The PLL values are found with the continued fraction expansion of the output to reference
+ * ratio for each post divider, this gives the closest PT/QT within the limits without testing
+ * every QT. When two dividers give the same error the one that keeps the VCO in range is used.
+ * The last CYcacheSize solutions are kept so a retune to a recent frequency, common when
+ * scanning, doesn't repeat the search.
+ *
  * Created: 12/27/2011 7:26:02 PM
  *  Author: Gordon Anderson
  */
@@ -26,67 +32,133 @@ int16_t  LF;
 
 int Ref = 8000000;
 
+CYsolution CYcache[CYcacheSize];
+int        CYcacheNext = 0;
+
 void SetRef(int Freq)
 {
   Ref = Freq;
 }
 
+// Returns the absolute difference between p1/q1 and num/den scaled by q1 * den.
+static int64_t CYratioError(int64_t p1, int64_t q1, uint32_t num, uint32_t den)
+{
+  int64_t e = p1 * den - q1 * num;
+
+  return e < 0 ? -e : e;
+}
+
+// Finds the PT/QT closest to num/den with PT <= maxPT and 2 <= QT <= maxQT, PT is at least
+// CYminPT. The closest ratio within the limits is the last continued fraction convergent that
+// fits or the largest semiconvergent that fits. Returns false if no ratio fits the limits.
+bool CYbestRatio(uint32_t num, uint32_t den, int maxPT, int maxQT, int *PT, int *QT)
+{
+  uint32_t n = num, d = den, r;
+  int64_t  a, t, tp, tq, p0 = 0, q0 = 1, p1 = 1, q1 = 0, p2, q2, sp, sq;
+  int      k;
+
+  if(den == 0) return false;
+  while(true)
+  {
+    a = n / d;
+    p2 = a * p1 + p0;
+    q2 = a * q1 + q0;
+    if((p2 > maxPT) || (q2 > maxQT))
+    {
+      tp = (p1 == 0) ? a : (maxPT - p0) / p1;
+      tq = (q1 == 0) ? a : (maxQT - q0) / q1;
+      t = min(tp, tq);
+      if(t >= 1)
+      {
+        sp = t * p1 + p0;
+        sq = t * q1 + q0;
+        if((q1 == 0) || (CYratioError(sp, sq, num, den) * q1 < CYratioError(p1, q1, num, den) * sq))
+        {
+          p1 = sp;
+          q1 = sq;
+        }
+      }
+      break;
+    }
+    p0 = p1;
+    q0 = q1;
+    p1 = p2;
+    q1 = q2;
+    if((r = n - a * d) == 0) break;
+    n = d;
+    d = r;
+  }
+  if((q1 == 0) || (p1 == 0)) return false;
+  // Scale up to the minimum QT and PT, the ratio is unchanged
+  k = max((2 + q1 - 1) / q1, (CYminPT + p1 - 1) / p1);
+  if((p1 * k > maxPT) || (q1 * k > maxQT)) return false;
+  *PT = p1 * k;
+  *QT = q1 * k;
+  return true;
+}
+
 int FindPQ(long ClockOut)
 {
-  int  Pt, Qt, Divider, D, MaxQ, AClockOut;
-  int  Cerror, CerrorMin, A, B;
+  int     i, D, Dfirst, Dlast, Divider, Pt, Qt, Cerror, CerrorMin = -1;
+  int     BestPT = 0, BestQT = 0, BestD = 0;
+  int64_t vco;
+  bool    VCOok, BestVCOok = false;
 
-  // Set the reference
-  //  Ref = 8000000;
-  //  MaxQ = Ref/40000;
-  MaxQ = 200;
-//  if(ClockOut > 5000000) MaxQ = 75;
-  // Determine starting divider
-  Divider = ((Ref / MaxQ) * 1600) / ClockOut;
+  if(ClockOut <= 0) return (0);
+  // Look for a recent solution
+  for (i = 0; i < CYcacheSize; i++)
+  {
+    if ((CYcache[i].Freq != ClockOut) || (CYcache[i].Ref != Ref)) continue;
+    P0 = CYcache[i].P0;
+    P = CYcache[i].P;
+    Q = CYcache[i].Q;
+    Div = CYcache[i].Div;
+    LF = CYcache[i].LF;
+    return (CYcache[i].Error);
+  }
+  // Determine starting divider, search 10 divider values on each side
+  Divider = ((Ref / CYmaxQT) * CYmaxPT) / ClockOut;
   if (Divider > 117) Divider = 117;
   if (Divider < 11) Divider = 11; 
-  // Loop through 20 Divider values
-  CerrorMin = ClockOut;
-  for (D = Divider - 10; D <= Divider + 10; D++)
+  Dfirst = Divider - 10;
+  Dlast = Divider + 10;
+  for (D = Dfirst; D <= Dlast; D++)
   {
-    // Loop through Qt values
-    A = (ClockOut / 1000) * D;
-    B = Ref / 1000;
-    for (Qt = 2; Qt <= MaxQ; Qt++)
+    vco = (int64_t)ClockOut * D;
+    if (!CYbestRatio((uint32_t)vco, Ref, CYmaxPT, CYmaxQT, &Pt, &Qt)) continue;
+    VCOok = (vco >= CYvcoMin) && (vco <= CYvcoMax);
+    // Actual ClockOut = Ref * Pt / (Qt * D), rounded
+    Cerror = labs((long)((((int64_t)Ref * Pt) + ((int64_t)Qt * D) / 2) / ((int64_t)Qt * D)) - ClockOut);
+    if ((CerrorMin == -1) || (Cerror < CerrorMin) || ((Cerror == CerrorMin) && VCOok && !BestVCOok))
     {
-      // Calculate Pt
-      Pt = (A * Qt) / B;
-      if(Pt > 1600) Pt = 1600;
-      // Now calculate Actual ClockOut
-      AClockOut = ((Ref / Qt) * Pt) / D;
-      Cerror = labs(AClockOut - ClockOut);
-      if (Cerror < CerrorMin)
-      {
-        CerrorMin = Cerror;
-        Q = Qt;
-        P = Pt;
-        Div = D;
-        if (Cerror < 50) Cerror = 0;
-      }
-      if (Cerror == 0) break;
+      CerrorMin = Cerror;
+      BestPT = Pt;
+      BestQT = Qt;
+      BestD = D;
+      BestVCOok = VCOok;
     }
-    if (Cerror == 0) break;
+    if ((CerrorMin == 0) && BestVCOok) break;
   }
-  //serial->println(P);
-  //serial->println(Q);
-  P0 = P & 1;
-  P = ((P - P0) / 2) - 3;
-  Q = Q - 2;
+  if (CerrorMin == -1) return (ClockOut);
+  P0 = BestPT & 1;
+  P = ((BestPT - P0) / 2) - 3;
+  Q = BestQT - 2;
+  Div = BestD;
   LF = 0;
   if (P > 231) LF = 1;
   if (P > 626) LF = 2;
   if (P > 834) LF = 3;
   if (P > 1043) LF = 4;
-  //  P = ((P - P0) / 2) - 3;
-  //serial->println(P);
-  //serial->println(Q);
-  //serial->println(LF);
-  //serial->println(Div);
+  // Save the solution
+  CYcache[CYcacheNext].Freq = ClockOut;
+  CYcache[CYcacheNext].Ref = Ref;
+  CYcache[CYcacheNext].P0 = P0;
+  CYcache[CYcacheNext].P = P;
+  CYcache[CYcacheNext].Q = Q;
+  CYcache[CYcacheNext].Div = Div;
+  CYcache[CYcacheNext].LF = LF;
+  CYcache[CYcacheNext].Error = CerrorMin;
+  CYcacheNext = (CYcacheNext + 1) % CYcacheSize;
   return (CerrorMin);
 }
 
@@ -265,10 +337,11 @@ int SetPLL3freq(int8_t adr, int Freq, int8_t brd)
 // Output E = unused
 int FAIMSclockSet(int8_t adr, int Freq)
 {
-  float PTdivQT,error;
-  int   PT,QT,Q,P,PO,BestPT=0,BestQT=0;
+  int   PT,QT,Q,P,PO;
   int iStat;
 
+  // Find the PLL values first, Ref * PT/QT = Freq * 120
+  if(!CYbestRatio((uint32_t)Freq * 120, Ref, CYmaxPTfaims, CYmaxQTfaims, &PT, &QT)) return(-1);
   CYregs[0].PLL2_Misc &= ~0x40;
   Wire.beginTransmission(adr);
   Wire.write(0x13);
@@ -292,22 +365,6 @@ int FAIMSclockSet(int8_t adr, int Freq)
   CYregs[0].Clk_DCadj = 0b00000000;
   // Set the frequency for the PLL, set them all to 20 * Freq.
   // Nominal Freq = 1mHz, Ref osc 20MHz = Ref * PT/QT
-  PTdivQT = (float)(Freq * 120) / (float)Ref;
-  error = 10000;
-  for(QT = 1; QT <= 256; QT++)
-  {
-    PT = PTdivQT * QT;
-    if(PT < 2048 )
-    {
-      if(error > abs(PTdivQT - (float)PT/(float)QT))
-      {
-        BestPT = PT;
-        BestQT = QT;
-      }
-    }
-  }
-  PT = BestPT;
-  QT = BestQT;
   //serial->println(Freq);
   //serial->println(PT);
   //serial->println(QT);
@@ -112,33 +112,58 @@ int CompressorProcessLoop(int Count)
 //      STWSGO,chan           // Starts the sweep on channel 1 or 2, or 3 for both
 //      STWSHLT,chan          // Stops the sweep on channel 1 or 2, or 3 for both
 //      GTWSTA,chan           // Returns selected channel scan status, running or stopped
+//      GTWSJIT               // Returns the sweep tick stats, ticks,max jitter uS,average jitter uS,TIMER or LOOP
 //   Implementation details
 //    - Parameters are not saved
-//    - Updated 10 times per second
+//    - Updated every SWPtick millisec by the sweep timer. SweepBegin sets the start values and
+//      precomputes the frequency and voltage change per tick, each tick sets the channel's values
+//      to start plus tick times the change so the sweep is linear in the requested time and rounding
+//      does not accumulate. The tick ISR only updates the module data and kicks the module's thread,
+//      the thread sends the new values.
+//    - The sweep timer is shared with the DC bias pulse and profile functions. The timer is claimed
+//      by STWSGO or by the first ProcessSweep pass after a triggered start, never from an ISR. If the
+//      timer can't be claimed, or the sweep is preempted, the Twave and ARB loops step the sweep
+//      from millis().
+//    - Sweep tables are stepped one segment at a time, the segment only moves forward.
+
+extern Thread TwaveThread;
 
 FreqSweep fSweep[2] = {{100000,100000,200000,20,30,30,10,0,0,SS_IDLE},
                        {100000,100000,200000,20,30,30,10,0,0,SS_IDLE}};
 
-// The ISR sets the sweep state and exits
-void ARBTWAVEsweepISR(void)
+MIPStimer     SweepClock(TMR_Sweep);
+void          SweepRelease(void);
+TimerUser     SweepTimer = {"SWEEP", TMR_Sweep, TMRPlow, SweepRelease};
+SweepStats    swpstats;
+uint32_t      SweepNextTick;          // Ideal time of the next tick in uS
+bool          SweepClaimTried = false;// Set when the timer claim was made for the running sweeps
+
+// Stops the sweep timer, the loops step any running sweep
+void SweepRelease(void)
 {
-  if(fSweep[0].State == SS_IDLE) fSweep[0].State = SS_START;
-  if(fSweep[1].State == SS_IDLE) fSweep[1].State = SS_START;
-  ARBthread.setNextRunTime(millis());
+  SweepClock.stop();
+  swpstats.Timed = false;
 }
 
-bool SweepLookup(int TP, float *V1, float *V2, float *F)
+// Returns true if a sweep table is defined for the ARB sweeps
+bool SweepTableValid(void)
 {
-  int i;
-  
   if(sweeptable == NULL) return false;
   if(sweeptable->num < 2) return false;
-  for(i=0;i<sweeptable->num-1;i++)
-  {
-    if(TP < sweeptable->timePnt[i]) break;
-    if((TP >= sweeptable->timePnt[i]) && (TP <= sweeptable->timePnt[i+1])) break;
-  }
-  if(i == sweeptable->num-1) i--;
+  return true;
+}
+
+// Calculates the sweep table values at TP millisec, seg is the segment used for the last point and
+// is moved forward to the segment holding TP. Points before the first segment or after the last are
+// extrapolated from the end segments.
+bool SweepLookup(int TP, int *seg, float *V1, float *V2, float *F)
+{
+  int i;
+
+  if(!SweepTableValid()) return false;
+  if((*seg < 0) || (*seg > sweeptable->num-2)) *seg = 0;
+  while((*seg < sweeptable->num-2) && (TP > sweeptable->timePnt[*seg+1])) (*seg)++;
+  i = *seg;
   // The points at i and i+1 will be used to calculate the output voltages and frequency
   // y = y1 + (x-x1) * (y2-y1)/(x2-x1)
   if(V1 != NULL) *V1 = (float)sweeptable->voltage1[i] + (float)(TP - sweeptable->timePnt[i]) * (float)(sweeptable->voltage1[i+1] - sweeptable->voltage1[i]) / (float)(sweeptable->timePnt[i+1] - sweeptable->timePnt[i]);
@@ -147,37 +172,138 @@ bool SweepLookup(int TP, float *V1, float *V2, float *F)
   return true;
 }
 
+// Sets the channel's values for its current tick, sets SS_STOP after the last tick
+void SweepStep(int chan)
+{
+  FreqSweep *fs = &fSweep[chan];
+  float     f,v;
+
+  if(fs->Tick > fs->Ticks) fs->Tick = fs->Ticks;
+  f = (float)fs->StartFreq + fs->dFreq * (float)fs->Tick;
+  v = fs->StartVoltage + fs->dVolt * (float)fs->Tick;
+  if(NumberOfTwaveModules > 0)
+  {
+    TDarray[chan].Velocity = f;
+    TDarray[chan].TWCD[0].VoltageSetpoint = v;
+  }
+  if(NumberOfARBchannels > 0)
+  {
+    if(chan == 0) SweepLookup(fs->Tick * SWPtick, &fs->Seg, &v, NULL, &f);
+    if(chan == 1) SweepLookup(fs->Tick * SWPtick, &fs->Seg, NULL, &v, &f);
+    ARBarray[chan]->Frequency = f;
+    ARBarray[chan]->Voltage = v;
+  }
+  fs->CurrentSweepTime = fs->SweepStartTime + fs->Tick * SWPtick;
+  if(fs->Tick >= fs->Ticks) fs->State = SS_STOP;
+}
+
+// Sends the updated values, the module thread is run on the next pass of the thread controller
+void SweepKick(void)
+{
+  if(NumberOfTwaveModules > 0) TwaveThread.setNextRunTime(millis());
+  if(NumberOfARBchannels > 0) ARBthread.setNextRunTime(millis());
+}
+
+// Sweep timer ISR, advances every sweeping channel one tick
+void SweepTickISR(void)
+{
+  uint32_t now = micros();
+  int32_t  jitter;
+  bool     kick = false;
+
+  jitter = (int32_t)(now - SweepNextTick);
+  if(jitter < 0) jitter = -jitter;
+  SweepNextTick += SWPtick * 1000;
+  swpstats.Ticks++;
+  swpstats.SumJitter += jitter;
+  if(jitter > (int32_t)swpstats.MaxJitter) swpstats.MaxJitter = jitter;
+  for(int chan = 0; chan < 2; chan++)
+  {
+    if(fSweep[chan].State != SS_SWEEPING) continue;
+    fSweep[chan].Tick++;
+    SweepStep(chan);
+    kick = true;
+  }
+  if(kick) SweepKick();
+}
+
+// Starts the sweep timer if it's not running, if the timer can't be claimed the sweep is
+// stepped by ProcessSweep. The claim is made once per sweep start. Not called from ISRs, the
+// timer manager logs claims.
+void SweepTimerStart(void)
+{
+  if(swpstats.Timed) return;
+  SweepClaimTried = true;
+  if(!TimerClaim(&SweepTimer)) return;
+  // The timer is shared, the callbacks are set after every claim
+  SweepClock.detachInterrupt();
+  swpstats.Ticks = swpstats.MaxJitter = swpstats.SumJitter = 0;
+  SweepClock.attachInterrupt(SweepTickISR);
+  SweepClock.setPriority(8);
+  SweepClock.setPeriod(SWPtick * 1000, 8);
+  SweepNextTick = micros() + SWPtick * 1000;
+  swpstats.Timed = true;
+  SweepClock.start(-1, 8, false);
+}
+
+// Saves the channel's values, sets the start values and precomputes the change per tick.
+// Called from ISRs.
+void SweepBegin(int chan)
+{
+  FreqSweep *fs = &fSweep[chan];
+
+  if(fs->State != SS_IDLE) return;
+  if(NumberOfTwaveModules > 0)
+  {
+    fs->OrginalFreq = TDarray[chan].Velocity;
+    fs->OrginalVoltage = TDarray[chan].TWCD[0].VoltageSetpoint;
+  }
+  if(NumberOfARBchannels > 0)
+  {
+    fs->OrginalFreq = ARBarray[chan]->Frequency;
+    fs->OrginalVoltage = ARBarray[chan]->Voltage;
+  }
+  fs->Ticks = fs->SweepTime * 1000 / SWPtick + 0.5;
+  if(fs->Ticks < 1) fs->Ticks = 1;
+  fs->dFreq = (float)(fs->StopFreq - fs->StartFreq) / (float)fs->Ticks;
+  fs->dVolt = (fs->StopVoltage - fs->StartVoltage) / (float)fs->Ticks;
+  fs->Tick = 0;
+  fs->Seg = 0;
+  fs->SweepStartTime = millis();
+  fs->State = SS_SWEEPING;
+  SweepClaimTried = false;
+  SweepStep(chan);
+  SweepKick();
+}
+
+// The ISR starts the sweep on both channels and exits, ProcessSweep claims the sweep timer
+void ARBTWAVEsweepISR(void)
+{
+  SweepBegin(0);
+  SweepBegin(1);
+}
+
 // This function is called in the Twave and ARB polling loops and processes frequency/voltage sweep requests. The FreqSweep
 // data structure contains all of the needed parameters. This code looks at the modules present to determine if its Twave or ARB.
+// The sweep timer steps the sweeps, this function restores the channels when their sweeps stop and steps the sweeps if the
+// timer is not running.
 void ProcessSweep(void)
 {
-  int           chan;
-  uint32_t      RightNow;
-  float         rnf,rnv;
+  int           chan,tick;
+  bool          active = false;
 
-  RightNow = millis();
   for(chan = 0; chan < 2; chan++)
   {
     if(fSweep[chan].State == SS_IDLE) continue;
-    if(fSweep[chan].State == SS_START)
+    if(fSweep[chan].State == SS_START) SweepBegin(chan);
+    if((fSweep[chan].State == SS_SWEEPING) && !swpstats.Timed)
     {
-      if(NumberOfTwaveModules > 0)
+      tick = (millis() - fSweep[chan].SweepStartTime) / SWPtick;
+      if(tick != fSweep[chan].Tick)
       {
-        fSweep[chan].OrginalFreq = TDarray[chan].Velocity;
-        fSweep[chan].OrginalVoltage = TDarray[chan].TWCD[0].VoltageSetpoint;
-        TDarray[chan].Velocity = fSweep[chan].StartFreq;
-        TDarray[chan].TWCD[0].VoltageSetpoint = fSweep[chan].StartVoltage;
+        fSweep[chan].Tick = tick;
+        SweepStep(chan);
       }
-      if(NumberOfARBchannels > 0)
-      {
-        fSweep[chan].OrginalFreq = ARBarray[chan]->Frequency;
-        fSweep[chan].OrginalVoltage = ARBarray[chan]->Voltage;
-        ARBarray[chan]->Frequency = fSweep[chan].StartFreq;
-        ARBarray[chan]->Voltage = fSweep[chan].StartVoltage;        
-      }
-      fSweep[chan].SweepStartTime = RightNow;
-      fSweep[chan].CurrentSweepTime = RightNow;
-      fSweep[chan].State = SS_SWEEPING;
     }
     if(fSweep[chan].State == SS_STOP)
     {
@@ -193,34 +319,14 @@ void ProcessSweep(void)
       }
       fSweep[chan].State = SS_IDLE;
     }
-    if(fSweep[chan].State == SS_SWEEPING)
-    {
-      // Calculate the right now frequency.
-      // Right now freq = StartFreq + ((StopFreq - StartFreq) * SweepTime/(RightNow - SweepStartTime))
-      rnv = rnf = ((float)RightNow - (float)fSweep[chan].SweepStartTime) / (fSweep[chan].SweepTime * 1000);
-      rnf = fSweep[chan].StartFreq + (float)(fSweep[chan].StopFreq - fSweep[chan].StartFreq) * rnf;
-      // Calculate the right now voltage
-      rnv = fSweep[chan].StartVoltage + (float)(fSweep[chan].StopVoltage - fSweep[chan].StartVoltage) * rnv;      
-      if(RightNow >= (fSweep[chan].SweepStartTime + fSweep[chan].SweepTime * 1000))
-      {
-        fSweep[chan].State = SS_STOP;
-      }
-      if(NumberOfTwaveModules > 0)
-      {
-        TDarray[chan].Velocity = rnf;
-        TDarray[chan].TWCD[0].VoltageSetpoint = rnv;
-      }
-      if(NumberOfARBchannels > 0)
-      {
-        if(chan == 0) SweepLookup(RightNow - fSweep[chan].SweepStartTime, &rnv, NULL, &rnf);
-        if(chan == 1) SweepLookup(RightNow - fSweep[chan].SweepStartTime, NULL, &rnv, &rnf);
-        ARBarray[chan]->Frequency = rnf;
-        ARBarray[chan]->Voltage = rnv;   
-      }
-      fSweep[chan].CurrentSweepTime = RightNow;
-    }
-    //ARBthread.run();
+    if(fSweep[chan].State != SS_IDLE) active = true;
   }  
+  if(active && !swpstats.Timed && !SweepClaimTried) SweepTimerStart();
+  if(!active && SweepTimer.Active)
+  {
+    SweepRelease();
+    TimerRelease(&SweepTimer);
+  }
 }
 
 // Following are the serial command processing functions that support the frequency sweep function for Twave
@@ -449,8 +555,9 @@ void StartSweepTWSW(int chan)
     SendNAK;
     return;
   }
-  if((chan == 1) || (chan == 3)) if(fSweep[0].State == SS_IDLE) fSweep[0].State = SS_START;
-  if((chan == 2) || (chan == 3)) if(fSweep[1].State == SS_IDLE) fSweep[1].State = SS_START;
+  if((chan == 1) || (chan == 3)) SweepBegin(0);
+  if((chan == 2) || (chan == 3)) SweepBegin(1);
+  SweepTimerStart();
   SendACK;
 }
 
@@ -491,6 +598,21 @@ void GetStatusTWSW(int chan)
   }
 }
 
+void GetJitterTWSW(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  serial->print(swpstats.Ticks);
+  serial->print(",");
+  serial->print(swpstats.MaxJitter);
+  serial->print(",");
+  if(swpstats.Ticks > 0) serial->print(swpstats.SumJitter / swpstats.Ticks);
+  else serial->print(0);
+  serial->print(",");
+  if(swpstats.Timed) serial->println("TIMER");
+  else serial->println("LOOP");
+}
+
 bool CompressionTriggerQueued = false;
 int CompressionTriggerTarget = 0;
 
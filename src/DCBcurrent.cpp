@@ -110,7 +110,7 @@ void DCbiasCur_loop(void)
     SetPowerSource();
     // Display a popup error message
     DisplayMessageButtonDismiss("DCBias Over Current!");
-    LogMessage("DCBias over current!");
+    LogEvent(LOGCtrip, LOGfault, LOGMdcbias, -1, -1, 0, "DCBias over current!");
   }
 }
 
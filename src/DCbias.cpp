@@ -113,18 +113,21 @@ DCbiasData  *DCbDarray[4] = {NULL,NULL,NULL,NULL};
 DCbiasState *DCbiasStates[4] = {NULL,NULL,NULL,NULL};
 DCbiasData dcbd;    // Holds the selected channel's data
 
-// The following variables support automatic reset of a power supply trip
-#define   TrippedTries 3         // Number of times to try resetting in 30 secs
+// The following variables support automatic reset of a power supply trip. The fault monitor
+// restarts the supply 5 seconds after a trip, up to TrippedTries times in 45 seconds.
+#define   TrippedTries 3         // Number of times to try resetting in 45 secs
 bool      AutoReset=false;       // Automatic trip reset enable if true
 bool      Tripped=false;         // True when supply trips
-uint8_t   TrippedTimes=0;        // Number of times the supply tripped
-uint32_t  TrippedTime=0;         // Tripped time
-uint32_t  ResetTime=0;           // Time to reset power supply if not 0
+FaultChannel DCBverrFault = {"DCBVERR", 1, 0, 5000, 45000};
 
 // Waveform generation variables
 
 MIPStimer WFMtimer(4);
 Waveforms *wfs = NULL;
+void WFMrelease(void);
+TimerUser WFMtimerUser   = {"DCBWFM", 4, TMRPlow, WFMrelease};
+TimerUser ProfileTimer   = {"DCBPROF", 5, TMRPnormal, NULL};     // TMR_Profiles
+TimerUser DCbiasPulseTimer = {"DCBPULSE", TMR_DCbiasPulse, TMRPnormal, NULL};
 
 DialogBoxEntry DCDialogEntriesPage1[] = {
   {" Ch 1, V",  0, 1, D_FLOAT, dcbd.MinVoltage+dcbd.DCoffset.VoltageSetpoint, dcbd.MaxVoltage+dcbd.DCoffset.VoltageSetpoint, 1, 11, false, NULL, &dcbd.DCCD[0].VoltageSetpoint, NULL, NULL},
@@ -569,13 +572,13 @@ void SetPowerSource(void)
     Verror = VerrorFiltered = 0;
     // Delay output alarm monitoring to let things stabalize
     DelayMonitoring();
-    LogMessage("DC bias power on");
+    LogEvent(LOGCpower, LOGinfo, LOGMdcbias, -1, -1, 1, "DC bias power on");
   }
   else 
   {
     // Turn power off
     digitalWrite(PWR_ON,HIGH);
-    LogMessage("DC bias power off");
+    LogEvent(LOGCpower, LOGinfo, LOGMdcbias, -1, -1, 0, "DC bias power off");
   }
 }
 
@@ -679,6 +682,7 @@ void DCbias_init(int8_t Board, int8_t addr)
 
   // On first call set the profile pointers to NULL
   if(NumberOfDCChannels == 0) for(i=0;i<NumProfiles;i++) DCbiasProfiles[i] = NULL;
+  FaultRegister(&DCBverrFault);
   // If there are already two or more modules add 2 to the board number
 //  if(NumberOfDCChannels >= 16) Board += 2;
   if(DCbDarray[Board] != NULL) Board += 2;
@@ -889,7 +893,7 @@ void DCbias_loop(void)
     // Read the monitor inputs and update the display buffer
     ValueChange = false;
     //delay(1);
-    if(AD7998(DCbDarray[b]->ADCadr, ADCvals)!=0) LogMessage("ADC read fault!"); 
+    if(AD7998(DCbDarray[b]->ADCadr, ADCvals)!=0) LogEvent(LOGChardware, LOGerror, LOGMdcbias, b, -1, 0, "ADC read fault!"); 
     else for(i=0;i<DCbDarray[b]->NumChannels;i++)
     {
       if(!ValueChange)
@@ -919,7 +923,7 @@ void DCbias_loop(void)
               if(ov==-1) 
               {
                 offsetV = DCbDarray[b]->DCoffset.VoltageSetpoint;
-                LogMessage("ADC readoff fault!");
+                LogEvent(LOGChardware, LOGerror, LOGMdcbias, b, -1, 0, "ADC readoff fault!");
               }
            }
            else if((DCbDarray[0]->UseOneOffset) && (tempInt != 2))
@@ -984,7 +988,8 @@ void DCbias_loop(void)
       Tripped = false;
     }
     // Test the threshold
-    if((VerrorFiltered > MIPSconfigData.VerrorThreshold) && (MIPSconfigData.VerrorThreshold > 0))
+    DCBverrFault.Retries = AutoReset ? TrippedTries : 0;
+    if(FaultCheck(&DCBverrFault, (VerrorFiltered > MIPSconfigData.VerrorThreshold) && (MIPSconfigData.VerrorThreshold > 0), VerrorFiltered))
     {
       // Turn off the power supply
       MIPSconfigData.PowerEnable = false;
@@ -992,7 +997,7 @@ void DCbias_loop(void)
       // Display a popup error message
       if(VerrorCh >= 0) sprintf(mess,"Output Verror, ch %1d",VerrorCh);
       else snprintf(mess, sizeof(mess), "Offset Verror, brd %1d", (int8_t)(-VerrorCh) - 1);
-      LogMessage("DCBias Verror!");
+      LogEvent(LOGCtrip, LOGfault, LOGMdcbias, -1, VerrorCh, VerrorFiltered, "DCBias Verror!");
       DisplayMessageButtonDismiss(mess);
       Tripped = true;
       // Disable all ESI channels if mode flag is set
@@ -1003,26 +1008,13 @@ void DCbias_loop(void)
         esi.ESIchan[0].Enable = esi.ESIchan[1].Enable = false;
         esich.Enable = false;
       #endif
-      if(AutoReset)
-      {
-        // Here if auto reset is enabled
-        if(millis() > (TrippedTime + 45000))  // If it has not tripped in last 30 seconds then reset the number of tries
-        {
-          TrippedTime = millis();
-          TrippedTimes = 0;
-        }
-        if(TrippedTimes++ < TrippedTries) ResetTime = millis() + 5000;
-      }
     }
   }
-  if(ResetTime != 0)
+  // Auto reset, only true if enabled and the number of tries is not used up
+  if(FaultRestart(&DCBverrFault))
   {
-    if(millis() > ResetTime)
-    {
-      ResetTime = 0;
-      MIPSconfigData.PowerEnable = true;
-      SetPowerSource();
-    }
+    MIPSconfigData.PowerEnable = true;
+    SetPowerSource();
   }
   SelectBoard(SelectedDCBoard);
   // Display update the readback values update
@@ -1243,6 +1235,18 @@ void DCbiasReadV(int chan)
   if(!SerialMute) serial->println(DCbiasStates[brd]->Readbacks[(chan-1) & 0x07]);
 }
 
+// Returns the filtered readback voltage for the channel without sending any response
+// to the host. Returns false if the channel is invalid.
+bool DCbiasGetReadback(int chan, float *fVal)
+{
+  int brd;
+
+  if((brd = GetDCbiasBoard(chan,false)) == -1) return false;
+  if(DCbiasStates[brd] == NULL) return false;
+  *fVal = DCbiasStates[brd]->Readbacks[(chan-1) & 0x07];
+  return true;
+}
+
 // Set the float or offset voltage
 void DCbiasSetFloat(char *Chan, char *Value)
 {
@@ -1890,6 +1894,7 @@ void SetDCbiasProfileToggle(void)
      // Apply the first profile and setup the timer and ISR for
      // profile toggling
      if(ProfileDwell < 0) break;
+     if(!TimerClaim(&ProfileTimer)) ERR(ERR_TIMERINUSE);
      ApplyDCbiasProfile(Profile1);
      TMR_Profiles.attachInterrupt(ProfileISR);
      TMR_Profiles.start(ProfileDwell*1000);
@@ -1905,7 +1910,8 @@ void SetDCbiasProfileToggle(void)
 void StopProfileToggle(void)
 {
   if(ProfileTrig != NULL) ProfileTrig->detach();
-  TMR_Profiles.stop();
+  if(ProfileTimer.Active) TMR_Profiles.stop();
+  TimerRelease(&ProfileTimer);
   detachInterrupt(LT);
   SendACK;
 }
@@ -2049,11 +2055,13 @@ void SetDCbiasPena(char *state)
   if(token == "FALSE")
   {
     DCbiasPena = false;
-    if(DCbiasPulseTMR != NULL) DCbiasPulseTMR->stop();
+    if((DCbiasPulseTMR != NULL) && DCbiasPulseTimer.Active) DCbiasPulseTMR->stop();
+    TimerRelease(&DCbiasPulseTimer);
     if(DIDCbiasPulse != NULL)  DIDCbiasPulse->detach();
     SendACK;
     return;
   }
+  if(!TimerClaim(&DCbiasPulseTimer)) ERR(ERR_TIMERINUSE);
   // Load the default because we don't know the state
   int b=SelectedBoard();
   int brd = DCbiasCH2Brd(DCbiasPchan-1);
@@ -2591,7 +2599,8 @@ void WFMinit(int sps)
 
    if(wfs != NULL) 
    {
-      WFMtimer.stop();
+      if(WFMtimerUser.Active) WFMtimer.stop();
+      TimerRelease(&WFMtimerUser);
       // Delete all the current waveforms
       while(wfs->wf != NULL)
       {
@@ -2604,9 +2613,6 @@ void WFMinit(int sps)
    else wfs = new Waveforms;
    wfs->wf = NULL;
    wfs->sps = sps;
-  // Start the real time interrupt
-  WFMtimer.attachInterrupt(WaveformISR);
-  WFMtimer.setFrequency((double)sps);
 }
 
 // This function defines a waveform and adds it to the Waveforms structure's
@@ -2678,6 +2684,10 @@ void WFMaddWF(void)
 void WFMenable(void)
 {
    if(wfs == NULL) BADARG;
+   if(!TimerClaim(&WFMtimerUser)) ERR(ERR_TIMERINUSE);
+   // Start the real time interrupt
+   WFMtimer.attachInterrupt(WaveformISR);
+   WFMtimer.setFrequency((double)wfs->sps);
    WFMtimer.start(-1, 0, false);
    DCbiasTestEnable = false;
    SendACK;
@@ -2687,12 +2697,21 @@ void WFMenable(void)
 void WFMdisable(void)
 {
    if(wfs == NULL) BADARG;
-   WFMtimer.stop();
+   if(WFMtimerUser.Active) WFMtimer.stop();
+   TimerRelease(&WFMtimerUser);
    DCbiasUpdate = true;
    DCbiasTestEnable = true;
    SendACK;
 }
 
+// Called by the timer manager when a higher priority module takes timer 4
+void WFMrelease(void)
+{
+   WFMtimer.stop();
+   DCbiasUpdate = true;
+   DCbiasTestEnable = true;
+}
+
 // Report a channel's waveform parameter. valid parameters are:
 // 0 = freq
 // 1 = min
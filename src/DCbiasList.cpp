@@ -54,9 +54,13 @@
 // Forward declarations for functions used before their definitions
 void NextBufferISR(void);
 void SetupNextTimePoint(void);
+DCstate* FindInList(DCstate *list, char *name);
+DCsegment* FindInList(DCsegment *list, char *name);
 
 // States (modules)
 DCstate           *DCstateList = NULL;
+DCstate           **DCstateEnd = &DCstateList;    // Next pointer of the last state
+DCstate           *DCstateHash[DCBLhashSize];
 DCstate           *CurrentState;
 uint8_t           CurrentDCbiasModule;
 volatile bool     DCbiasStateBusy = false;
@@ -65,10 +69,13 @@ volatile bool     SegmentsAbort = false;
 
 // Sequences
 DCsegment           *DCsegmentList = NULL;
+DCsegment           **DCsegmentEnd = &DCsegmentList;
+DCsegment           *DCsegmentHash[DCBLhashSize];
 volatile DCsegment  *CurrentSegment = NULL;
 uint8_t             CurrentTimePoint = 0;
 
 MIPStimer MPST(TMR_Table);               // timer used for segment generation
+TimerUser SegmentTimer = {"DCBSEG", TMR_Table, TMRPhigh, NULL};
 #define   MPSTtc   TC2->TC_CHANNEL[2]    // Pointer to the timers control block
 
 // 
@@ -167,6 +174,14 @@ void PlaySegments(void)
   CurrentSegment = DCsegmentList;
   CurrentTimePoint = 0;
   if(CurrentSegment ==  NULL) return;
+  // The segment timer is shared with the table mode
+  if(!TimerClaim(&SegmentTimer))
+  {
+    CurrentSegment = NULL;
+    SetErrorCode(ERR_TIMERINUSE);
+    SendNAK;
+    return;
+  }
   // Clear all the current counts
   do
   {
@@ -218,6 +233,7 @@ void PlaySegments(void)
   CurrentSegment = NULL;
   SegmentsAbort = false;
   MPST.stop();
+  TimerRelease(&SegmentTimer);
   LDACcapture;
   pinMode(LDAC,OUTPUT);
   LDAClow;
@@ -231,8 +247,7 @@ void DACsetup(void)
   for(i=0;i<CurrentSegment->TimePoint[CurrentTimePoint]->NumStates;i++)
   {
      // Find the first module and setup 
-     for(j=0;j<4;j++) if(CurrentSegment->TimePoint[CurrentTimePoint]->States[i]->md[j].Count > 0) break;
-     if(j==4) return; // Nothing to do
+     if((j = CurrentSegment->TimePoint[CurrentTimePoint]->States[i]->First) < 0) return; // Nothing to do
      // Set the state variables
      CurrentState = CurrentSegment->TimePoint[CurrentTimePoint]->States[i];
      CurrentDCbiasModule = j;
@@ -286,8 +301,15 @@ void DeleteEntry(DCstate *dcs)
 {
    int i;
    
-   for(i=0;i<4;i++) if(dcs->md[i].data != NULL) delete [] dcs->md[i].data;
-   delete dcs;
+   for(i=0;i<4;i++) MemFree(dcs->md[i].data);
+   MemPoolPut(&DCstatePool, dcs);
+}
+
+// Delete a segment time point
+void DeleteEntry(DCsegmentTP *dcsTP)
+{
+   MemFree(dcsTP->States);
+   MemPoolPut(&DCtimePointPool, dcsTP);
 }
 
 // Delete a segment entry
@@ -295,130 +317,93 @@ void DeleteEntry(DCsegment *dcs)
 {
    int i;
 
-   // Delete all of the state pointers in each time point
-   for(i=0;i<dcs->NumTimePoints;i++)
-   {
-      free(dcs->TimePoint[i]->States);
-   }
-   free(dcs->TimePoint);
-   delete dcs;
+   // Delete all of the state pointers in each time point and the time points
+   for(i=0;i<dcs->NumTimePoints;i++) DeleteEntry(dcs->TimePoint[i]);
+   MemFree(dcs->TimePoint);
+   MemPoolPut(&DCsegmentPool, dcs);
 }
 
-// This function removes a named entry from the list
-void RemoveFromList(DCstate *list, char *name)
+// Returns the hash bucket for a name, FNV-1a hash
+uint8_t DCBLhash(char *name)
 {
-   DCstate *next, *last;
-   
-   if(list == NULL) return;
-   if(strcmp(name,list->name)==0)
-   {
-      last = list;
-      list = list->next;
-      DeleteEntry(last);
-      return; 
-   }
-   last = DCstateList;
-   next = DCstateList->next;
-   while(1)
-   {
-      if(strcmp(name,next->name)==0)
-      {
-         last->next = next->next;
-         DeleteEntry(next);
-         return;
-      }
-      last = next;
-      next = next->next;
-      if(next == NULL) return;
-   }
+   uint32_t h = 2166136261;
+
+   while(*name != 0) h = (h ^ (uint8_t)*name++) * 16777619;
+   return(h & (DCBLhashSize - 1));
 }
 
-void RemoveFromList(DCsegment *list, char *name)
+// Adds an entry to the end of the list and to the hash index
+void AddToList(DCstate *dcs)
 {
-   DCsegment *next, *last;
-   
-   if(list == NULL) return;
-   if(strcmp(name,list->name)==0)
-   {
-      last = list;
-      list = list->next;
-      DeleteEntry(last);
-      return; 
-   }
-   last = DCsegmentList;
-   next = DCsegmentList->next;
-   while(1)
-   {
-      if(strcmp(name,next->name)==0)
-      {
-         last->next = next->next;
-         DeleteEntry(next);
-         return;
-      }
-      last = next;
-      next = next->next;
-      if(next == NULL) return;
-   }
+   uint8_t b = DCBLhash(dcs->name);
+
+   dcs->next = NULL;
+   dcs->hnext = DCstateHash[b];
+   DCstateHash[b] = dcs;
+   *DCstateEnd = dcs;
+   DCstateEnd = &dcs->next;
 }
 
-// Return the end of list next pointer, used to add an entry to the 
-// end of list.
-DCstate** EndOfList(DCstate *list)
+void AddToList(DCsegment *dcs)
 {
-   DCstate *next;
-   
-   if(list == NULL) return(&DCstateList);
-   next = list;
-   while(1)
-   {
-      if(next->next == NULL) return(&next->next);
-      next = next->next;
-   }
-   return(&DCstateList);  // Should never get here but just in case
+   uint8_t b = DCBLhash(dcs->name);
+
+   dcs->next = NULL;
+   dcs->hnext = DCsegmentHash[b];
+   DCsegmentHash[b] = dcs;
+   *DCsegmentEnd = dcs;
+   DCsegmentEnd = &dcs->next;
 }
 
-DCsegment** EndOfList(DCsegment *list)
+// This function removes a named entry from the list and deletes it
+void RemoveFromList(DCstate *list, char *name)
 {
-   DCsegment *next;
-   
-   if(list == NULL) return(&DCsegmentList);
-   next = list;
-   while(1)
-   {
-      if(next->next == NULL) return(&next->next);
-      next = next->next;
-   }
-   return(&DCsegmentList);  // Should never get here but just in case
+   DCstate **pp, *dcs;
+
+   if((dcs = FindInList(list, name)) == NULL) return;
+   for(pp = &DCstateHash[DCBLhash(name)];*pp != dcs;pp = &(*pp)->hnext);
+   *pp = dcs->hnext;
+   for(pp = &DCstateList;*pp != dcs;pp = &(*pp)->next);
+   *pp = dcs->next;
+   if(DCstateEnd == &dcs->next) DCstateEnd = pp;
+   DeleteEntry(dcs);
 }
 
-// This function finds a named entry in the last and returns the pointer,
+void RemoveFromList(DCsegment *list, char *name)
+{
+   DCsegment **pp, *dcs;
+
+   if((dcs = FindInList(list, name)) == NULL) return;
+   for(pp = &DCsegmentHash[DCBLhash(name)];*pp != dcs;pp = &(*pp)->hnext);
+   *pp = dcs->hnext;
+   for(pp = &DCsegmentList;*pp != dcs;pp = &(*pp)->next);
+   *pp = dcs->next;
+   if(DCsegmentEnd == &dcs->next) DCsegmentEnd = pp;
+   DeleteEntry(dcs);
+}
+
+// This function finds a named entry in the list and returns the pointer,
 // or NULL if not found
 DCstate* FindInList(DCstate *list, char *name)
 {
-   DCstate *next;
-   
+   DCstate *dcs;
+
    if(list == NULL) return(NULL);
-   next = list;
-   while(1)
+   for(dcs = DCstateHash[DCBLhash(name)];dcs != NULL;dcs = dcs->hnext)
    {
-      if(strcmp(name,next->name)==0) return(next);
-      next = next->next;
-      if(next == NULL) return(NULL);
+      if(strcmp(name,dcs->name)==0) return(dcs);
    }
    return(NULL);
 }
 
 DCsegment* FindInList(DCsegment *list, char *name)
 {
-   DCsegment *next;
-   
+   DCsegment *dcs;
+
    if(list == NULL) return(NULL);
-   next = list;
-   while(1)
+   for(dcs = DCsegmentHash[DCBLhash(name)];dcs != NULL;dcs = dcs->hnext)
    {
-      if(strcmp(name,next->name)==0) return(next);
-      next = next->next;
-      if(next == NULL) return(NULL);
+      if(strcmp(name,dcs->name)==0) return(dcs);
    }
    return(NULL);
 }
@@ -431,10 +416,9 @@ void NextBufferISR(void)
 
 i = DMAC->DMAC_EBCISR;
 spiDmaWait();
-DMAC->DMAC_EBCIER = 0;
+DMAC->DMAC_EBCIDR = 1 << (SPI_DMAC_TX_CH);
    // Get the next module and start transfer
-   for(i=CurrentDCbiasModule+1;i<4;i++) if(CurrentState->md[i].Count > 0) break;
-   if((i==4) || (CurrentDCbiasModule >= 3))
+   if((i = CurrentState->md[CurrentDCbiasModule].Next) < 0)
    {
       // Nothing to do, clear flag and exit
       DCbiasStateBusy = false;
@@ -461,8 +445,7 @@ void SetDBbiasState(DCstate *dcs)
 
     spiDMAinit();
     // Find the first module and setup 
-    for(i=0;i<4;i++) if(dcs->md[i].Count > 0) break;
-    if(i==4) return; // Nothing to do
+    if((i = dcs->First) < 0) return; // Nothing to do
     // Set the state variables
     CurrentState = dcs;
     CurrentDCbiasModule = i;
@@ -507,17 +490,15 @@ void SetDBbiasState(DCstate *dcs)
 //        ERR_CANTALLOCATE =  Memory allocation error
 //        ERR_BADARG       =  Command parsing error
 //        ERR_NAMEINLIST   =  Name already in linked list
-int ReadDCbiasState(void)
+// The state is read into dcs, on error the caller deletes it.
+int ReadDCbiasStateData(DCstate *dcs)
 {
-   DCstate  *dcs;
    char     *Token;
    String   sToken;
    int      i,module,num,chans[8];
    uint32_t iVal;
    float    vals[8];
    
-   dcs = new DCstate;
-   if(dcs == NULL) return ERR_CANTALLOCATE;
    // Init the structure
    dcs->next = NULL;
    for(i=0;i<4;i++)
@@ -559,13 +540,8 @@ int ReadDCbiasState(void)
       }
       // Allocate space for this module and save
       dcs->md[module].Count = num;
-      dcs->md[module].data = new uint32_t [num * 3];
-      if(dcs->md[module].data == NULL)
-      {
-         // Delete this structure and exit
-         DeleteEntry(dcs);
-         return ERR_CANTALLOCATE;
-      }
+      dcs->md[module].data = (uint32_t *)MemAlloc(MEMdcbl, num * 3 * sizeof(uint32_t));
+      if(dcs->md[module].data == NULL) return ERR_CANTALLOCATE;
       // Convert the voltage values to DAC control word and save
       for(i=0;i<num;i++) 
       {
@@ -581,13 +557,32 @@ int ReadDCbiasState(void)
       // Exit on EOL
       if(strcmp(Token,"\n")==0) break;
    }
+   // Chain the modules with data so a state change only follows the chain
+   dcs->First = -1;
+   for(i=3;i>=0;i--)
+   {
+      dcs->md[i].Next = -1;
+      if(dcs->md[i].Count == 0) continue;
+      dcs->md[i].Next = dcs->First;
+      dcs->First = i;
+   }
    // Here with a defined data structure, insert in linked list and exit
-   // Find end of list and append
-   DCstate **eol = EndOfList(DCstateList);
-   *eol = dcs;
+   AddToList(dcs);
    return 0;
 }
 
+// Reads a state and adds it to the list, the state node is returned to its pool on any error
+int ReadDCbiasState(void)
+{
+   DCstate  *dcs;
+   int      status;
+
+   dcs = (DCstate *)MemPoolGet(&DCstatePool);
+   if(dcs == NULL) return ERR_CANTALLOCATE;
+   if((status = ReadDCbiasStateData(dcs)) != 0) DeleteEntry(dcs);
+   return status;
+}
+
 // Called with a full command line in the input ringbuffer.
 void DefineState(void)
 {
@@ -679,9 +674,12 @@ void RemoveStates(void)
    while(DCstateList != NULL)
    {
       dcs = DCstateList;
-      DeleteEntry(dcs); 
       DCstateList = DCstateList->next;
+      DeleteEntry(dcs); 
    }
+   DCstateEnd = &DCstateList;
+   memset(DCstateHash, 0, sizeof(DCstateHash));
+   MemPoolCompact(&DCstatePool);
    SendACK;
 }
 
@@ -710,29 +708,21 @@ void IsState(char *name)
 int ReadSegment(void)
 {
    DCsegment *dcs;
+   DCsegment *repeat = NULL;
    char      *Token;
    String    sToken;
+   char      name[10];
+   int       Length,RepeatCount = 0;
    
-   dcs = new DCsegment;
-   if(dcs == NULL) return ERR_CANTALLOCATE;
-   // Init the structure
-   dcs->TriggerSource = 'R';
-   dcs->TriggerEdge = POS;
-   dcs->next = NULL;
-   dcs->repeat = NULL;
-   dcs->RepeatCount = 0;
-   dcs->CurrentCount = 0;
-   dcs->NumTimePoints = 0;
-   dcs->TimePoint = NULL;
    // Get name
    GetToken(true); if((Token = GetToken(true)) == NULL) return ERR_BADARG;
-   strcpy(dcs->name,Token);
+   strcpy(name,Token);
    // See if this entry is in list, if so exit with error
    if(FindInList(DCsegmentList,Token) != NULL) return ERR_NAMEINLIST;
    // Get the segment maximum length in counts
    GetToken(true); if((Token = GetToken(true)) == NULL) return ERR_BADARG;
    sToken = Token;
-   dcs->Length = sToken.toInt();
+   Length = sToken.toInt();
    // If next token is end of line we are done else next and repeat count are expected
    if((Token = GetToken(true)) == NULL)return ERR_BADARG;
    sToken = Token;
@@ -741,16 +731,27 @@ int ReadSegment(void)
       // Here if we expect next and repeat count
       if((Token = GetToken(true)) == NULL) return ERR_BADARG;  // next
       // Find the named segment and error out if not found
-      if((dcs->repeat = FindInList(DCsegmentList, Token)) == NULL) return ERR_NAMENOTFOUND;     
+      if((repeat = FindInList(DCsegmentList, Token)) == NULL) return ERR_NAMENOTFOUND;     
       GetToken(true); if((Token = GetToken(true)) == NULL) return ERR_BADARG;  // repeat count
       sToken = Token;
-      dcs->RepeatCount = sToken.toInt();
+      RepeatCount = sToken.toInt();
       GetToken(true);  // should be \n
    }
+   // Allocate once the arguments are read so an error does not leave a node out of the pool
+   dcs = (DCsegment *)MemPoolGet(&DCsegmentPool);
+   if(dcs == NULL) return ERR_CANTALLOCATE;
+   strcpy(dcs->name,name);
+   dcs->TriggerSource = 'R';
+   dcs->TriggerEdge = POS;
+   dcs->next = NULL;
+   dcs->repeat = repeat;
+   dcs->Length = Length;
+   dcs->RepeatCount = RepeatCount;
+   dcs->CurrentCount = 0;
+   dcs->NumTimePoints = 0;
+   dcs->TimePoint = NULL;
    // Here with a defined data structure, insert in linked list and exit
-   // Find end of list and append
-   DCsegment **eol = EndOfList(DCsegmentList);
-   *eol = dcs;
+   AddToList(dcs);
    return 0;
 }
 // Defines a segment with the following arguments: name, next, repeat count
@@ -798,7 +799,7 @@ int ReadSegmentTimePoint(void)
    GetToken(true); if((Token = GetToken(true)) == NULL) return ERR_BADARG;
    sToken = Token;
    // Allocate the timepoint structure
-   dcsTP = new DCsegmentTP;
+   dcsTP = (DCsegmentTP *)MemPoolGet(&DCtimePointPool);
    if(dcsTP == NULL) return ERR_CANTALLOCATE;
    dcsTP->Count = sToken.toInt();
    dcsTP->NumStates = 0;
@@ -809,20 +810,24 @@ int ReadSegmentTimePoint(void)
    {
       Token = GetToken(true);
       if(strcmp(Token,"\n") == 0) break;  // Done at EOL
-      if((Token = GetToken(true)) == NULL) return ERR_BADARG;  // Get the state name
-      if((dcState = FindInList(DCstateList, Token)) == NULL) return ERR_NAMENOTFOUND;
+      if((Token = GetToken(true)) == NULL) {DeleteEntry(dcsTP); return ERR_BADARG;}  // Get the state name
+      if((dcState = FindInList(DCstateList, Token)) == NULL) {DeleteEntry(dcsTP); return ERR_NAMENOTFOUND;}
       // Add the state to list of states, realloc to get space
-      dcsTP->NumStates++;
-      DCstate **temp = (DCstate **) realloc(dcsTP->States, dcsTP->NumStates * sizeof(DCstate *));
+      DCstate **temp = (DCstate **) MemRealloc(MEMdcbl, dcsTP->States, (dcsTP->NumStates + 1) * sizeof(DCstate *));
+      if(temp == NULL) {DeleteEntry(dcsTP); return(ERR_CANTALLOCATE);}
       dcsTP->States = temp;
-      if(dcsTP->States == NULL) return(ERR_CANTALLOCATE);
+      dcsTP->NumStates++;
       dcsTP->States[dcsTP->NumStates-1] = dcState;
    }
    // Make space for the new time point and insert it in the sequence structure
-   dcs->NumTimePoints++;
-   DCsegmentTP **temp = (DCsegmentTP **) realloc(dcs->TimePoint, dcs->NumTimePoints * sizeof(DCsegmentTP *));
+   DCsegmentTP **temp = (DCsegmentTP **) MemRealloc(MEMdcbl, dcs->TimePoint, (dcs->NumTimePoints + 1) * sizeof(DCsegmentTP *));
+   if(temp == NULL)
+   {
+      DeleteEntry(dcsTP);
+      return(ERR_CANTALLOCATE);
+   }
    dcs->TimePoint = temp;
-   if(dcs->TimePoint == NULL) return(ERR_CANTALLOCATE);
+   dcs->NumTimePoints++;
    dcs->TimePoint[dcs->NumTimePoints-1] = dcsTP;
    return(0);
 }
@@ -861,6 +866,7 @@ int ReadSegmentTrigger(void)
    String         sToken;
    DCsegment      *dcs;
    DCsegmentTP    *dcsTP;
+   int            count;
 
    // Find the named segment
    GetToken(true); if((Token = GetToken(true)) == NULL) return ERR_BADARG;
@@ -868,13 +874,7 @@ int ReadSegmentTrigger(void)
    // Read count
    GetToken(true); if((Token = GetToken(true)) == NULL) return ERR_BADARG;
    sToken = Token;
-   // Allocate the timepoint structure
-   dcsTP = new DCsegmentTP;
-   if(dcsTP == NULL) return ERR_CANTALLOCATE;
-   dcsTP->Count = sToken.toInt();
-   dcsTP->NumStates = 0;
-   dcsTP->States = NULL;
-   dcsTP->Setup = DIOsetup;
+   count = sToken.toInt();
    // Read the port number and the level
    GetToken(true); if((Token = GetToken(true)) == NULL) return ERR_BADARG;
    if((Token[0] < 'A') || (Token[0] > 'P')) return ERR_BADARG;
@@ -882,15 +882,26 @@ int ReadSegmentTrigger(void)
    GetToken(true); if((Token = GetToken(true)) == NULL) return ERR_BADARG;
    sToken = Token;
    if((sToken.toInt() < 0) || (sToken.toInt() > 1)) return ERR_BADARG;
+   // Allocate the timepoint structure once the arguments are read
+   dcsTP = (DCsegmentTP *)MemPoolGet(&DCtimePointPool);
+   if(dcsTP == NULL) return ERR_CANTALLOCATE;
+   dcsTP->Count = count;
+   dcsTP->NumStates = 0;
+   dcsTP->States = NULL;
+   dcsTP->Setup = DIOsetup;
    dcsTP->DIOimage = (MIPSconfigData.DOmsb << 8) | MIPSconfigData.DOlsb;
    if(sToken.toInt() == 1) dcsTP->DIOimage |= mask;
    else dcsTP->DIOimage &= ~mask;
    dcsTP->DIOimage |= SPI_PCS(BOARD_PIN_TO_SPI_CHANNEL(SPI_CS));
    // Make space for the new time point and insert it in the sequence structure
-   dcs->NumTimePoints++;
-   DCsegmentTP **temp = (DCsegmentTP **) realloc(dcs->TimePoint, dcs->NumTimePoints * sizeof(DCsegmentTP *));
+   DCsegmentTP **temp = (DCsegmentTP **) MemRealloc(MEMdcbl, dcs->TimePoint, (dcs->NumTimePoints + 1) * sizeof(DCsegmentTP *));
+   if(temp == NULL)
+   {
+      DeleteEntry(dcsTP);
+      return(ERR_CANTALLOCATE);
+   }
    dcs->TimePoint = temp;
-   if(dcs->TimePoint == NULL) return(ERR_CANTALLOCATE);
+   dcs->NumTimePoints++;
    dcs->TimePoint[dcs->NumTimePoints-1] = dcsTP;
    return(0);
 }
@@ -1067,9 +1078,13 @@ void RemoveSegments(void)
    while(DCsegmentList != NULL)
    {
       dcs = DCsegmentList;
-      DeleteEntry(dcs); 
       DCsegmentList = DCsegmentList->next;
+      DeleteEntry(dcs); 
    }
+   DCsegmentEnd = &DCsegmentList;
+   memset(DCsegmentHash, 0, sizeof(DCsegmentHash));
+   MemPoolCompact(&DCsegmentPool);
+   MemPoolCompact(&DCtimePointPool);
    SendACK;  
 }
 
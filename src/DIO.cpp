@@ -476,6 +476,9 @@ void PlayTpulseFunctions(void)
   }
 }
 
+// Called after every aux trigger output pulse, used to chain the pulse train generator
+void (*AuxTriggerFunction)(void) = NULL;
+
 void AuxTrigger(void)
 {
   static Pio *pio = g_APinDescription[AUXTRGOUT].pPort;
@@ -491,6 +494,7 @@ void AuxTrigger(void)
   pio->PIO_CODR = pin;         // Set output high
   delayMicroseconds(PulseWidth);
   pio->PIO_SODR = pin;         // Set output low  
+  if(AuxTriggerFunction != NULL) AuxTriggerFunction();
 }
 
 bool TriggerOutQueued = false;
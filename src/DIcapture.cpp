@@ -0,0 +1,231 @@
+//
+// DIcapture
+//
+// Time stamped digital input edge capture, see DIcapture.h.
+//
+// Commands:
+//    SDICAP,input,edge       Capture edges on input Q thru X, edge is POS, NEG, BOTH, or NA to stop
+//    GDICAPCNT,input         Report the input counts, rising,falling,overflow
+//    CDICAP                  Clear the ring and all counts
+//    GDICAPSTAT              Report records waiting,total overflow,max ISR cycles,cycle counter Hz
+//    GDICAPLST,max           Report and remove up to max records, input,level,cycles one per line
+//    GDICAPBIN,max           Send and remove up to max records as one binary frame
+//
+#include "Variants.h"
+#include "DIcapture.h"
+#include "AtomicBlock.h"
+#include <DIhandler.h>
+
+DICdata  dicdata;
+
+uint32_t DIClast = 0;
+uint16_t DIChigh = 0;
+
+const Commands  DIcaptureCmdArray[] = {
+// Start of command block
+//
+// Digital input capture commands
+//
+  {"SDICAP",     CMDfunctionStr, 2, (char *)DIcaptureSet},      // Capture edges on a digital input, input Q thru X, edge POS, NEG, BOTH, or NA to stop
+  {"GDICAPCNT",  CMDfunctionStr, 1, (char *)DIcaptureCounts},   // Report the capture counts for an input, rising,falling,overflow
+  {"CDICAP",     CMDfunction, 0, (char *)DIcaptureClear},       // Clear the capture ring and all counts
+  {"GDICAPSTAT", CMDfunction, 0, (char *)DIcaptureStatus},      // Report capture status, records waiting,total overflow,max ISR cycles,cycle counter Hz
+  {"GDICAPLST",  CMDfunction, 1, (char *)DIcaptureList},        // Report and remove up to max records, input,level,cycles one per line
+  {"GDICAPBIN",  CMDfunction, 1, (char *)DIcaptureBinary},      // Send and remove up to max records as a binary frame, see DIcapture.h
+// End of table marker
+  {0},
+};
+
+CommandList DIcaptureCmdList = { (Commands *)DIcaptureCmdArray, NULL };
+
+// Returns the 48 bit cycle count. Must be called at least once every 51 seconds to catch
+// the counter wrap, DIcapture_loop does this. Call with interrupts disabled or from the ISR.
+uint64_t DIcaptureTime(void)
+{
+  uint32_t now = DWT->CYCCNT;
+
+  if(now < DIClast) DIChigh++;
+  DIClast = now;
+  return(((uint64_t)DIChigh << 32) | now);
+}
+
+// Called from the DIhandler port ISR on every edge of a captured input, before any of
+// the input handlers.
+void DIcaptureISR(int index, bool level)
+{
+  uint64_t  t = DIcaptureTime();
+  uint32_t  cycles;
+  DICrecord *rec;
+
+  if((MIPSconfigData.DIinvert >> index) & 1) level = !level;
+  if(level)
+  {
+    if(dicdata.Edge[index] == FALLING) return;
+    dicdata.Rising[index]++;
+  }
+  else
+  {
+    if(dicdata.Edge[index] == RISING) return;
+    dicdata.Falling[index]++;
+  }
+  if((dicdata.Head - dicdata.Tail) >= DICmaxRecords)
+  {
+    dicdata.Overflow[index]++;
+    return;
+  }
+  rec = &dicdata.Rec[dicdata.Head & (DICmaxRecords - 1)];
+  rec->Time = (uint32_t)t;
+  rec->TimeHigh = (uint16_t)(t >> 32);
+  rec->Input = index;
+  rec->Level = level;
+  dicdata.Head++;
+  cycles = DWT->CYCCNT - (uint32_t)t;
+  if(cycles > dicdata.MaxCycles) dicdata.MaxCycles = cycles;
+}
+
+// Called once from setup, starts the DWT cycle counter.
+void DIcapture_init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  DIhandler::setCapture(DIcaptureISR);
+  AddToCommandList(&DIcaptureCmdList);
+}
+
+// Called from the system loop to keep the cycle count extension current.
+void DIcapture_loop(void)
+{
+  AtomicBlock< Atomic_RestoreState > a_Block;
+  DIcaptureTime();
+}
+
+// Returns the input index, 0 thru 7, or -1 if not valid.
+int DIcaptureInput(char *input)
+{
+  if((input[0] < 'Q') || (input[0] > 'X') || (input[1] != 0)) return -1;
+  return input[0] - 'Q';
+}
+
+//
+// Host commands
+//
+
+void DIcaptureSet(char *input, char *edge)
+{
+  int i,dil;
+
+  if((i = DIcaptureInput(input)) == -1) BADARG;
+  if(strcmp(edge,"NA") == 0)
+  {
+    dicdata.Edge[i] = 0;
+    DIhandler::capture(input[0], false);
+    SendACK;
+    return;
+  }
+  // DILlist is NA,LOW,HIGH,BOTH,NEG,POS, BOTH thru POS map to CHANGE, FALLING, and RISING
+  dil = FindInList(DILlist, edge) - 2;
+  if((dil != CHANGE) && (dil != FALLING) && (dil != RISING)) BADARG;
+  dicdata.Edge[i] = dil;
+  DIhandler::capture(input[0], true);
+  SendACK;
+}
+
+void DIcaptureCounts(char *input)
+{
+  int i;
+
+  if((i = DIcaptureInput(input)) == -1) BADARG;
+  SendACKonly;
+  if(SerialMute) return;
+  serial->print(dicdata.Rising[i]);
+  serial->print(",");
+  serial->print(dicdata.Falling[i]);
+  serial->print(",");
+  serial->println(dicdata.Overflow[i]);
+}
+
+void DIcaptureClear(void)
+{
+  {
+    AtomicBlock< Atomic_RestoreState > a_Block;
+    dicdata.Tail = dicdata.Head;
+    for(int i=0;i<8;i++) dicdata.Rising[i] = dicdata.Falling[i] = dicdata.Overflow[i] = 0;
+    dicdata.MaxCycles = 0;
+  }
+  SendACK;
+}
+
+void DIcaptureStatus(void)
+{
+  uint32_t overflow = 0;
+
+  for(int i=0;i<8;i++) overflow += dicdata.Overflow[i];
+  SendACKonly;
+  if(SerialMute) return;
+  serial->print(dicdata.Head - dicdata.Tail);
+  serial->print(",");
+  serial->print(overflow);
+  serial->print(",");
+  serial->print(dicdata.MaxCycles);
+  serial->print(",");
+  serial->println(VARIANT_MCK);
+}
+
+void DIcaptureList(int max)
+{
+  DICrecord *rec;
+  uint64_t  t;
+
+  if((max < 1) || (max > DICmaxRecords)) BADARG;
+  SendACKonly;
+  if(SerialMute) return;
+  for(;(max > 0) && (dicdata.Tail != dicdata.Head);max--)
+  {
+    rec = &dicdata.Rec[dicdata.Tail & (DICmaxRecords - 1)];
+    t = ((uint64_t)rec->TimeHigh << 32) | rec->Time;
+    serial->print((char)('Q' + rec->Input));
+    serial->print(",");
+    serial->print(rec->Level);
+    serial->print(",");
+    serial->println((double)t, 0);
+    dicdata.Tail++;
+  }
+  serial->println("");
+}
+
+void DIcaptureBinary(int max)
+{
+  uint8_t  buf[sizeof(DICrecord)];
+  uint8_t  sum = 0;
+  uint32_t overflow = 0;
+  uint32_t n;
+
+  if((max < 1) || (max > DICmaxFrame)) BADARG;
+  SendACKonly;
+  if(SerialMute) return;
+  n = dicdata.Head - dicdata.Tail;
+  if(n > (uint32_t)max) n = max;
+  for(int i=0;i<8;i++) overflow += dicdata.Overflow[i];
+  buf[0] = DICsync1;
+  buf[1] = DICsync2;
+  serial->write(buf, 2);
+  buf[0] = n & 0xFF;
+  buf[1] = (n >> 8) & 0xFF;
+  buf[2] = overflow & 0xFF;
+  buf[3] = (overflow >> 8) & 0xFF;
+  buf[4] = (overflow >> 16) & 0xFF;
+  buf[5] = (overflow >> 24) & 0xFF;
+  for(int i=0;i<6;i++) sum += buf[i];
+  serial->write(buf, 6);
+  for(;n > 0;n--)
+  {
+    // The record layout is the frame layout, the Due is little endian
+    memcpy(buf, &dicdata.Rec[dicdata.Tail & (DICmaxRecords - 1)], sizeof(DICrecord));
+    for(unsigned int i=0;i<sizeof(DICrecord);i++) sum += buf[i];
+    serial->write(buf, sizeof(DICrecord));
+    dicdata.Tail++;
+  }
+  buf[0] = (uint8_t)(-sum);
+  serial->write(buf, 1);
+}
@@ -1,11 +1,13 @@
 #include "Variants.h"
 #include "DMSDMSMB.h"
+#include "ParamMirror.h"
 #include "Arduino.h"
 #include <Wire.h>
 
 #if DMSDMSMB
 
 MIPStimer *DMSDMSScanClock = NULL;
+TimerUser DMSDMSScanTimer = {"DMSDMS", FAIMSFB_ScanClock, TMRPnormal, NULL};
 
 int CVBIASbrd    = -1;
 int WAVEFORMSbrd = -1;
@@ -18,13 +20,76 @@ Thread DMSDMSthread  = Thread();
 
 CVBIASdata        cvbiasdata;
 CVBIASChanParams  cvbiasCH;
-CVBIASstate       cvbiasState;
-CVBIASreadBacks   cvbiasRB[2],cvbiasrb,cvbiasrbTemp;
+CVBIASreadBacks   cvbiasRB[2],cvbiasrb;
 
 WAVEFORMSdata        waveformsdata;
 WAVEFORMSChanParams  waveformsCH;
-WAVEFORMSstate       waveformsState;
-WAVEFORMSreadBacks   waveformsRB[2],waveformsrb,waveformsrbTemp;
+WAVEFORMSreadBacks   waveformsRB[2],waveformsrb;
+
+// Parameters mirrored to the CVBIAS processor
+PMparam cvbiasParams[] = {
+  {TWI_SET_STEPS,       -1, PMint,   &cvbiasdata.Steps, 3, 100000},
+  {TWI_SET_DURATION,    -1, PMint,   &cvbiasdata.StepDuration, 1, 100000},
+  {TWI_SET_ENABLE,       0, PMbool,  &cvbiasdata.channel[0].Enable},
+  {TWI_SET_CV,           0, PMfloat, &cvbiasdata.channel[0].CV, -50, 50},
+  {TWI_SET_BIAS,         0, PMfloat, &cvbiasdata.channel[0].Bias, -50, 50},
+  {TWI_SET_CV_START,     0, PMfloat, &cvbiasdata.channel[0].CVstart, -50, 50},
+  {TWI_SET_CV_END,       0, PMfloat, &cvbiasdata.channel[0].CVend, -50, 50},
+  {TWI_SET_ENABLE,       1, PMbool,  &cvbiasdata.channel[1].Enable},
+  {TWI_SET_CV,           1, PMfloat, &cvbiasdata.channel[1].CV, -50, 50},
+  {TWI_SET_BIAS,         1, PMfloat, &cvbiasdata.channel[1].Bias, -50, 50},
+  {TWI_SET_CV_START,     1, PMfloat, &cvbiasdata.channel[1].CVstart, -50, 50},
+  {TWI_SET_CV_END,       1, PMfloat, &cvbiasdata.channel[1].CVend, -50, 50},
+  {TWI_SET_ELEC_POSOFF, -1, PMfloat, &cvbiasdata.electrometer.PosOffset, 0, 5},
+  {TWI_SET_ELEC_NEGOFF, -1, PMfloat, &cvbiasdata.electrometer.NegOffset, 0, 5},
+  {TWI_SET_ELEC_POSZ,   -1, PMfloat, &cvbiasdata.electrometer.PosZero, 0, 5},
+  {TWI_SET_ELEC_NEGZ,   -1, PMfloat, &cvbiasdata.electrometer.NegZero, 0, 5},
+  {0, 0, 0, NULL}
+};
+
+// Parameters mirrored to the waveforms processor, the duty cycle is sent as a byte
+PMparam waveformsParams[] = {
+  {TWI_SET_STEPS,     -1, PMint,   &waveformsdata.Steps, 3, 100000},
+  {TWI_SET_DURATION,  -1, PMint,   &waveformsdata.StepDuration, 1, 100000},
+  {TWI_SET_ENABLE,     0, PMbool,  &waveformsdata.channel[0].Enable},
+  {TWI_SET_MODE,       0, PMbool,  &waveformsdata.channel[0].Mode},
+  {TWI_SET_FREQ,       0, PMint,   &waveformsdata.channel[0].Freq, 100000, 2000000},
+  {TWI_SET_DUTY,       0, PMint8,  &waveformsdata.channel[0].Duty, 0, 99},
+  {TWI_SET_DRIVE,      0, PMfloat, &waveformsdata.channel[0].Drive, 0, 100},
+  {TWI_SET_VRF,        0, PMfloat, &waveformsdata.channel[0].Vrf, 0, 2000},
+  {TWI_SET_MAXPWR,     0, PMfloat, &waveformsdata.channel[0].MaxPower, 0, 50},
+  {TWI_SET_MAXDRV,     0, PMfloat, &waveformsdata.channel[0].MaxDrive, 0, 100},
+  {TWI_SET_VRF_START,  0, PMfloat, &waveformsdata.channel[0].VRFstart, 0, 2000},
+  {TWI_SET_VRF_END,    0, PMfloat, &waveformsdata.channel[0].VRFend, 0, 2000},
+  {TWI_SET_ENABLE,     1, PMbool,  &waveformsdata.channel[1].Enable},
+  {TWI_SET_MODE,       1, PMbool,  &waveformsdata.channel[1].Mode},
+  {TWI_SET_FREQ,       1, PMint,   &waveformsdata.channel[1].Freq, 100000, 2000000},
+  {TWI_SET_DUTY,       1, PMint8,  &waveformsdata.channel[1].Duty, 0, 99},
+  {TWI_SET_DRIVE,      1, PMfloat, &waveformsdata.channel[1].Drive, 0, 100},
+  {TWI_SET_VRF,        1, PMfloat, &waveformsdata.channel[1].Vrf, 0, 2000},
+  {TWI_SET_MAXPWR,     1, PMfloat, &waveformsdata.channel[1].MaxPower, 0, 50},
+  {TWI_SET_MAXDRV,     1, PMfloat, &waveformsdata.channel[1].MaxDrive, 0, 100},
+  {TWI_SET_VRF_START,  1, PMfloat, &waveformsdata.channel[1].VRFstart, 0, 2000},
+  {TWI_SET_VRF_END,    1, PMfloat, &waveformsdata.channel[1].VRFend, 0, 2000},
+  {0, 0, 0, NULL}
+};
+
+PMmirror cvbiasMirror    = {"CVBIAS", 0, -1, true, cvbiasParams};
+PMmirror waveformsMirror = {"WAVEFORMS", 0, -1, true, waveformsParams};
+
+// Readback limits
+const PMlimit cvbiasRBlimits[] = {
+  {offsetof(CVBIASreadBacks, CV), -50, 50},
+  {offsetof(CVBIASreadBacks, Bias), -50, 50},
+  {-1}
+};
+
+const PMlimit waveformsRBlimits[] = {
+  {offsetof(WAVEFORMSreadBacks, V), -1, 50},
+  {offsetof(WAVEFORMSreadBacks, I), -9000, 9000},
+  {offsetof(WAVEFORMSreadBacks, Vrf), -3000, 3000},
+  {-1}
+};
 
 float        PosCurrent = 0;               // Positive electrometer channel
 float        NegCurrent = 0;               // Negative electrometer channel
@@ -84,6 +149,8 @@ void ReturnDMSDMSVRFend(int chan);
 void SetDMSDMSStepDuration(int value);
 void SetDMSDMSSteps(int value);
 void InitDMSDMSScan(void);
+void InitDMSDMSScanBinary(void);
+void ReportDMSDMSScanStats(void);
 void StopDMSDMSScan(void);
 void SetEMRTM4enable(char *value);
 void SetEMRTposOff(char *value);
@@ -99,7 +166,7 @@ void hvmGetEnable(void);
 void hvmSetVoltage(char *val);
 void hvmGetVoltage(void);
 void hvmGetReadback(void);
-void StartDMSDMSScan(void);
+bool StartDMSDMSScan(void);
 void AbortDMSDMSScan(void);
 void DMSDMS_loop(void);
 
@@ -230,7 +297,9 @@ const Commands DMSDMSCmdArray[] = {
   {"GDDSTEPDUR", CMDint, 0, (char *)&cvbiasdata.StepDuration},       // returns the scan step duration in mS 
   {"SDDNUMSTP",  CMDfunction, 1, (char *)SetDMSDMSSteps},            // set the scan number of steps
   {"GDDNUMSTP",  CMDint, 0, (char *)&cvbiasdata.Steps},              // returns the scan number of steps 
-  {"DDSCNSTRT",  CMDfunction, 0, (char *)InitDMSDMSScan},            // Start the scan 
+  {"DDSCNSTRT",  CMDfunction, 0, (char *)InitDMSDMSScan},            // Start the scan, reports step,time in mS,positive current,negative current one per line
+  {"DDSCNSTRTB", CMDfunction, 0, (char *)InitDMSDMSScanBinary},      // Start the scan, reports the step captures in binary blocks, see DMSDMSMB.h
+  {"GDDSCNSTAT", CMDfunction, 0, (char *)ReportDMSDMSScanStats},     // Report the last scan, steps,dropped,missed,failed,max capture uS
   {"DDSCNSTP",  CMDfunction, 0, (char *)StopDMSDMSScan},             // Stop a scan that is in process
 /*
   {"SFBADCSMP",  CMDint, 1, (char *)&NumSamples},                    // Set the number of adc sample to average, 1 to 16 
@@ -388,9 +457,10 @@ void DMSDMS_init(void)
   // Add threads to the controller
   control.add(&DMSDMSthread);
   if (ActiveDialog == NULL) DialogBoxDisplay(&DMSDMSdialog);
-  cvbiasState.update = true;
-  waveformsState.update = true;
+  PMregister(&cvbiasMirror, cvbiasdata.TWIadd | 0x20, CVBIASbrd);
+  PMregister(&waveformsMirror, waveformsdata.TWIadd | 0x20, WAVEFORMSbrd);
   if(DMSDMSScanClock == NULL) DMSDMSScanClock = new MIPStimer(FAIMSFB_ScanClock);
+  TimerRegister(&DMSDMSScanTimer);
 }
 
 void CVBIAS_init(int brd, int add)
@@ -413,100 +483,6 @@ void WAVEFORMS_init(int brd, int add)
   if(CVBIASbrd != -1) DMSDMS_init();
 }
 
-bool UpdateParameter(uint8_t TWIadd,int brd, int ch, int TWIcmd, float *value, float *svalue, bool update)
-{
-  if((*value != *svalue) || update)
-  {
-    int bd = TWIstart(TWIadd, brd, TWIcmd);
-    // Send the channel byte
-    if(ch != -1) Wire.write(ch);
-    // Set the float value
-    uint8_t *b = (uint8_t *)value;
-    Wire.write(b[0]);
-    Wire.write(b[1]);
-    Wire.write(b[2]);
-    Wire.write(b[3]);
-    TWIend(TWIadd, bd);
-    *svalue = *value;
-    return true;
-  }
-  return false;
-}
-
-bool UpdateParameter(uint8_t TWIadd,int brd, int ch, int TWIcmd, int *value, int *svalue, bool update)
-{
-  if((*value != *svalue) || update)
-  {
-    int bd = TWIstart(TWIadd, brd, TWIcmd);
-    // Send the channel byte
-    if(ch != -1) Wire.write(ch);
-    // Set the int value
-    uint8_t *b = (uint8_t *)value;
-    Wire.write(b[0]);
-    Wire.write(b[1]);
-    Wire.write(b[2]);
-    Wire.write(b[3]);
-    TWIend(TWIadd, bd);
-    *svalue = *value;
-    return true;
-  }
-  return false;
-}
-
-bool UpdateParameter(uint8_t TWIadd,int brd, int ch, int TWIcmd, bool *value, bool *svalue, bool update)
-{
-  if((*value != *svalue) || update)
-  {
-    int bd = TWIstart(TWIadd, brd, TWIcmd);
-    // Send the channel byte
-    if(ch != -1) Wire.write(ch);
-    // Set the bool value
-    uint8_t *b = (uint8_t *)value;
-    Wire.write(b[0]);
-    TWIend(TWIadd, bd);
-    *svalue = *value;
-    return true;
-  }
-  return false;
-}
-
-bool UpdateParameter(uint8_t TWIadd,int brd, int ch, int TWIcmd, int8_t *value, int8_t *svalue, bool update)
-{
-  if((*value != *svalue) || update)
-  {
-    int bd = TWIstart(TWIadd, brd, TWIcmd);
-    // Send the channel byte
-    if(ch != -1) Wire.write(ch);
-    // Set the bool value
-    uint8_t *b = (uint8_t *)value;
-    Wire.write(b[0]);
-    TWIend(TWIadd, bd);
-    *svalue = *value;
-    return true;
-  }
-  return false;
-}
-
-bool validateWaveformsRB(void)
-{
-  if((fpclassify(waveformsrbTemp.Vrf) != FP_NORMAL) && (fpclassify(waveformsrbTemp.Vrf) != FP_ZERO)) return false;
-  if((fpclassify(waveformsrbTemp.I) != FP_NORMAL) && (fpclassify(waveformsrbTemp.I) != FP_ZERO)) return false;
-  if((fpclassify(waveformsrbTemp.V) != FP_NORMAL) && (fpclassify(waveformsrbTemp.V) != FP_ZERO)) return false;
-  if((waveformsrbTemp.Vrf > 3000) || (waveformsrbTemp.Vrf < -3000)) return false;
-  if((waveformsrbTemp.I > 9000) || (waveformsrbTemp.I < -9000)) return false;
-  if((waveformsrbTemp.V > 50) || (waveformsrbTemp.V < -1)) return false;
-  return true;
-}
-
-bool validateCVbiasRB(void)
-{
-  if((fpclassify(cvbiasrbTemp.Bias) != FP_NORMAL) && (fpclassify(cvbiasrbTemp.Bias) != FP_ZERO)) return false;
-  if((fpclassify(cvbiasrbTemp.CV) != FP_NORMAL) && (fpclassify(cvbiasrbTemp.CV) != FP_ZERO)) return false;
-  if((cvbiasrbTemp.Bias > 50) || (cvbiasrbTemp.Bias < -50)) return false;
-  if((cvbiasrbTemp.CV > 50) || (cvbiasrbTemp.CV < -50)) return false;
-  return true;
-}
-
 void DMSDMS_loop(void)
 {
   float fval;
@@ -524,54 +500,26 @@ void DMSDMS_loop(void)
   waveformsdata.channel[1].Enable = cvbiasdata.channel[1].Enable;
   waveformsdata.Steps = cvbiasdata.Steps;
   waveformsdata.StepDuration = cvbiasdata.StepDuration;
-  // Process each DMSDMS channel. Look for changes in parameters and update as needed
-  UpdateParameter(cvbiasdata.TWIadd | 0x20,CVBIASbrd,-1,TWI_SET_STEPS,&cvbiasdata.Steps,&cvbiasState.Steps,cvbiasState.update);
-  UpdateParameter(cvbiasdata.TWIadd | 0x20,CVBIASbrd,-1,TWI_SET_DURATION,&cvbiasdata.StepDuration,&cvbiasState.StepDuration,cvbiasState.update);
-  UpdateParameter(waveformsdata.TWIadd | 0x20,WAVEFORMSbrd,-1,TWI_SET_STEPS,&waveformsdata.Steps,&waveformsState.Steps,waveformsState.update);
-  UpdateParameter(waveformsdata.TWIadd | 0x20,WAVEFORMSbrd,-1,TWI_SET_DURATION,&waveformsdata.StepDuration,&waveformsState.StepDuration,waveformsState.update);
+  // Send the parameters that changed to each processor
+  PMsync(&waveformsMirror);
+  PMsync(&cvbiasMirror);
   for(int ch = 0; ch < 2; ch++)
   {
-    // Waveforms processor updates
-    UpdateParameter(waveformsdata.TWIadd | 0x20,WAVEFORMSbrd,ch,TWI_SET_ENABLE,&waveformsdata.channel[ch].Enable,&waveformsState.Enable[ch],waveformsState.update);
-    UpdateParameter(waveformsdata.TWIadd | 0x20,WAVEFORMSbrd,ch,TWI_SET_MODE,&waveformsdata.channel[ch].Mode,&waveformsState.Mode[ch],waveformsState.update);
-    UpdateParameter(waveformsdata.TWIadd | 0x20,WAVEFORMSbrd,ch,TWI_SET_FREQ,&waveformsdata.channel[ch].Freq,&waveformsState.Freq[ch],waveformsState.update);
-    UpdateParameter(waveformsdata.TWIadd | 0x20,WAVEFORMSbrd,ch,TWI_SET_DUTY,(int8_t *)&waveformsdata.channel[ch].Duty,&waveformsState.Duty[ch],waveformsState.update);
-    UpdateParameter(waveformsdata.TWIadd | 0x20,WAVEFORMSbrd,ch,TWI_SET_DRIVE,&waveformsdata.channel[ch].Drive,&waveformsState.Drive[ch],waveformsState.update);
-    UpdateParameter(waveformsdata.TWIadd | 0x20,WAVEFORMSbrd,ch,TWI_SET_VRF,&waveformsdata.channel[ch].Vrf,&waveformsState.Vrf[ch],waveformsState.update);
-    UpdateParameter(waveformsdata.TWIadd | 0x20,WAVEFORMSbrd,ch,TWI_SET_MAXPWR,&waveformsdata.channel[ch].MaxPower,&waveformsState.MaxPower[ch],waveformsState.update);
-    UpdateParameter(waveformsdata.TWIadd | 0x20,WAVEFORMSbrd,ch,TWI_SET_MAXDRV,&waveformsdata.channel[ch].MaxDrive,&waveformsState.MaxDrive[ch],waveformsState.update);
-    UpdateParameter(waveformsdata.TWIadd | 0x20,WAVEFORMSbrd,ch,TWI_SET_VRF_START,&waveformsdata.channel[ch].VRFstart,&waveformsState.VRFstart[ch],waveformsState.update);
-    UpdateParameter(waveformsdata.TWIadd | 0x20,WAVEFORMSbrd,ch,TWI_SET_VRF_END,&waveformsdata.channel[ch].VRFend,&waveformsState.VRFend[ch],waveformsState.update);
-    // CVBIAS processor updates
-    UpdateParameter(cvbiasdata.TWIadd | 0x20,CVBIASbrd,ch,TWI_SET_ENABLE,&cvbiasdata.channel[ch].Enable,&cvbiasState.Enable[ch],cvbiasState.update);
-    UpdateParameter(cvbiasdata.TWIadd | 0x20,CVBIASbrd,ch,TWI_SET_CV,&cvbiasdata.channel[ch].CV,&cvbiasState.CV[ch],cvbiasState.update);
-    UpdateParameter(cvbiasdata.TWIadd | 0x20,CVBIASbrd,ch,TWI_SET_BIAS,&cvbiasdata.channel[ch].Bias,&cvbiasState.Bias[ch],cvbiasState.update);
-    UpdateParameter(cvbiasdata.TWIadd | 0x20,CVBIASbrd,ch,TWI_SET_CV_START,&cvbiasdata.channel[ch].CVstart,&cvbiasState.CVstart[ch],cvbiasState.update);
-    UpdateParameter(cvbiasdata.TWIadd | 0x20,CVBIASbrd,ch,TWI_SET_CV_END,&cvbiasdata.channel[ch].CVend,&cvbiasState.CVend[ch],cvbiasState.update);
     // Read the readback structures
-    TWIreadBlock(waveformsdata.TWIadd | 0x20, WAVEFORMSbrd,ch,TWI_READ_READBACKS, (void *)&waveformsrbTemp, sizeof(WAVEFORMSreadBacks));
-    if(validateWaveformsRB()) waveformsRB[ch] = waveformsrbTemp;
+    PMreadBlock(&waveformsMirror, ch, TWI_READ_READBACKS, (void *)&waveformsRB[ch], sizeof(WAVEFORMSreadBacks), waveformsRBlimits);
     delay(1);
-    TWIreadBlock(cvbiasdata.TWIadd | 0x20, CVBIASbrd,ch,TWI_READ_READBACKS, (void *)&cvbiasrbTemp, sizeof(CVBIASreadBacks));
-    if(validateCVbiasRB()) cvbiasRB[ch] = cvbiasrbTemp;
+    PMreadBlock(&cvbiasMirror, ch, TWI_READ_READBACKS, (void *)&cvbiasRB[ch], sizeof(CVBIASreadBacks), cvbiasRBlimits);
     // Read selected values that the controller can change depending on mode
-    if(TWIreadFloat(waveformsdata.TWIadd | 0x20, WAVEFORMSbrd,ch,TWI_READ_DRIVE, &fval)) waveformsState.Drive[ch] = waveformsdata.channel[ch].Drive = fval;
-    if(TWIreadFloat(waveformsdata.TWIadd | 0x20, WAVEFORMSbrd,ch,TWI_READ_VRF, &fval)) waveformsState.Vrf[ch] = waveformsdata.channel[ch].Vrf = fval;
-    if(TWIreadFloat(cvbiasdata.TWIadd | 0x20, CVBIASbrd,ch,TWI_READ_CV, &fval)) cvbiasState.CV[ch] = cvbiasdata.channel[ch].CV = fval;
+    if(TWIreadFloat(waveformsMirror.TWIadd, WAVEFORMSbrd,ch,TWI_READ_DRIVE, &fval)) {waveformsdata.channel[ch].Drive = fval; PMaccept(&waveformsMirror, &waveformsdata.channel[ch].Drive);}
+    if(TWIreadFloat(waveformsMirror.TWIadd, WAVEFORMSbrd,ch,TWI_READ_VRF, &fval)) {waveformsdata.channel[ch].Vrf = fval; PMaccept(&waveformsMirror, &waveformsdata.channel[ch].Vrf);}
+    if(TWIreadFloat(cvbiasMirror.TWIadd, CVBIASbrd,ch,TWI_READ_CV, &fval)) {cvbiasdata.channel[ch].CV = fval; PMaccept(&cvbiasMirror, &cvbiasdata.channel[ch].CV);}
   }
-  // Electrometer updates
-  UpdateParameter(cvbiasdata.TWIadd | 0x20,CVBIASbrd,-1,TWI_SET_ELEC_POSOFF,&cvbiasdata.electrometer.PosOffset,&cvbiasState.PosOffset,cvbiasState.update);
-  UpdateParameter(cvbiasdata.TWIadd | 0x20,CVBIASbrd,-1,TWI_SET_ELEC_NEGOFF,&cvbiasdata.electrometer.NegOffset,&cvbiasState.NegOffset,cvbiasState.update);
-  UpdateParameter(cvbiasdata.TWIadd | 0x20,CVBIASbrd,-1,TWI_SET_ELEC_POSZ,&cvbiasdata.electrometer.PosZero,&cvbiasState.PosZero,cvbiasState.update);
-  UpdateParameter(cvbiasdata.TWIadd | 0x20,CVBIASbrd,-1,TWI_SET_ELEC_NEGZ,&cvbiasdata.electrometer.NegZero,&cvbiasState.NegZero,cvbiasState.update);
   // Read electometer currents and zero values
-  if(TWIreadFloat(cvbiasdata.TWIadd | 0x20, CVBIASbrd,TWI_READ_ELEC_POS, &fval)) PosCurrent = fval;
-  if(TWIreadFloat(cvbiasdata.TWIadd | 0x20, CVBIASbrd,TWI_READ_ELEC_NEG, &fval)) NegCurrent = fval;
-  if(TWIreadFloat(cvbiasdata.TWIadd | 0x20, CVBIASbrd,TWI_READ_ELEC_POSZ, &fval)) cvbiasdata.electrometer.PosZero = fval;
-  if(TWIreadFloat(cvbiasdata.TWIadd | 0x20, CVBIASbrd,TWI_READ_ELEC_NEGZ, &fval)) cvbiasdata.electrometer.NegZero = fval;
+  if(TWIreadFloat(cvbiasMirror.TWIadd, CVBIASbrd,TWI_READ_ELEC_POS, &fval)) PosCurrent = fval;
+  if(TWIreadFloat(cvbiasMirror.TWIadd, CVBIASbrd,TWI_READ_ELEC_NEG, &fval)) NegCurrent = fval;
+  if(TWIreadFloat(cvbiasMirror.TWIadd, CVBIASbrd,TWI_READ_ELEC_POSZ, &fval)) {cvbiasdata.electrometer.PosZero = fval; PMaccept(&cvbiasMirror, &cvbiasdata.electrometer.PosZero);}
+  if(TWIreadFloat(cvbiasMirror.TWIadd, CVBIASbrd,TWI_READ_ELEC_NEGZ, &fval)) {cvbiasdata.electrometer.NegZero = fval; PMaccept(&cvbiasMirror, &cvbiasdata.electrometer.NegZero);}
 
-  cvbiasState.update = false;
-  waveformsState.update = false;
   cvbiasCH    = cvbiasdata.channel[DMSDMSchannel-1];
   waveformsCH = waveformsdata.channel[DMSDMSchannel-1];
   cvbiasrb    = cvbiasRB[DMSDMSchannel-1];
@@ -581,49 +529,86 @@ void DMSDMS_loop(void)
 }
 
 //
-// Scanning functions and variables;
+// Scanning functions and variables, see the scan capture notes in DMSDMSMB.h
 //
-typedef struct
-{
-  bool      Updated;
-  uint32_t  StartTime;
-  uint32_t  TimeStamp;
-  int       Point;
-  int       steps;
-} MIPSscanData;
+DDScapture  *dds = NULL;
+bool        DDSbinary = false;          // True to report the scan in binary blocks
 
-volatile MIPSscanData  *msd = NULL;
-
-// Scanning ISR
+// Scanning ISR, captures the values for the step and then advances to the next step
 void DMSDMSscanISR(void)
 {
-  float fval;
+  DDSrecord *r;
+  float     fval;
+  uint32_t  now,n;
+  uint16_t  flags = 0, missed = 0;
+  int       ch = DMSDMSchannel - 1;
 
   //interrupts();
   __enable_irq();
-  msd->TimeStamp = millis();
-  msd->Point++;
-  // Read the electrometer values
-  if(TWIreadFloat(cvbiasdata.TWIadd | 0x20, CVBIASbrd,TWI_READ_ELEC_POS, &fval)) PosCurrent = fval;
-  if(TWIreadFloat(cvbiasdata.TWIadd | 0x20, CVBIASbrd,TWI_READ_ELEC_NEG, &fval)) NegCurrent = fval;
+  now = micros();
+  // Whole step periods since the last step, more than one means steps were missed
+  n = (now - dds->LastTime + dds->Period / 2) / dds->Period;
+  if(n > 1)
+  {
+    missed = (n - 1 > 0xFFFF) ? 0xFFFF : n - 1;
+    flags |= DDSFlate;
+    dds->Missed += n - 1;
+  }
+  dds->LastTime = now;
+  dds->Point++;
+  // Read the electrometer values and the readbacks, the TWI functions can't be used if
+  // the interrupted code owns the bus
+  if(TWIbusy) flags |= DDSFbusy;
+  else
+  {
+    if(TWIreadFloat(cvbiasMirror.TWIadd, CVBIASbrd,TWI_READ_ELEC_POS, &fval)) PosCurrent = fval; else flags |= DDSFelec;
+    if(TWIreadFloat(cvbiasMirror.TWIadd, CVBIASbrd,TWI_READ_ELEC_NEG, &fval)) NegCurrent = fval; else flags |= DDSFelec;
+    if(!PMreadBlock(&cvbiasMirror, ch, TWI_READ_READBACKS, (void *)&cvbiasRB[ch], sizeof(CVBIASreadBacks), cvbiasRBlimits)) flags |= DDSFreadback;
+    if(!PMreadBlock(&waveformsMirror, ch, TWI_READ_READBACKS, (void *)&waveformsRB[ch], sizeof(WAVEFORMSreadBacks), waveformsRBlimits)) flags |= DDSFreadback;
+  }
   // Advance to next scan point
   digitalWrite(MIPSscanAdv,HIGH);
   digitalWrite(MIPSscanAdv,LOW);
-  // Set flag that data is ready
-  msd->Updated = true;
+  if(flags & (DDSFelec | DDSFreadback | DDSFbusy)) dds->Failed++;
+  if((dds->Head - dds->Tail) >= DDSmaxRecords) dds->Dropped++;
+  else
+  {
+    r = &dds->Rec[dds->Head & (DDSmaxRecords - 1)];
+    r->Step = dds->Point;
+    r->Time = now - dds->StartTime;
+    r->Flags = flags;
+    r->Missed = missed;
+    r->PosCurrent = PosCurrent;
+    r->NegCurrent = NegCurrent;
+    r->CV = cvbiasRB[ch].CV;
+    r->Vrf = waveformsRB[ch].Vrf;
+    dds->Head++;
+  }
+  // Stop after the last step so no extra advance pulses are sent
+  if(dds->Point >= dds->Steps)
+  {
+    DMSDMSScanClock->stop();
+    TimerRelease(&DMSDMSScanTimer);
+  }
+  n = micros() - now;
+  if(n > dds->MaxISR) dds->MaxISR = n;
 }
 
 // This function starts a scan on the DMSDMS system. 
 //
 // The system is configured to use the external scan advance signal. The
-// system is also configured to return no report.
-void StartDMSDMSScan(void)
+// system is also configured to return no report. Returns false if the scan
+// clock timer is owned by another module.
+bool StartDMSDMSScan(void)
 {
+  if(!TimerClaim(&DMSDMSScanTimer)) return false;
   DMSDMSScanClock->stop();
-  if(msd == NULL) msd = new MIPSscanData;
-  msd->Updated = false;
-  msd->Point = 0;
-  msd->steps = cvbiasdata.Steps;
+  if(dds == NULL) dds = new DDScapture;
+  dds->Point = 0;
+  dds->Steps = cvbiasdata.Steps;
+  dds->Period = cvbiasdata.StepDuration * 1000;
+  dds->Dropped = dds->Missed = dds->Failed = dds->MaxISR = 0;
+  dds->Head = dds->Tail = 0;
   // Set the scan advance pin to output and set low
   pinMode(MIPSscanAdv,OUTPUT);
   digitalWrite(MIPSscanAdv,LOW);
@@ -634,7 +619,6 @@ void StartDMSDMSScan(void)
   TWIsetBool(waveformsdata.TWIadd | 0x20, WAVEFORMSbrd, TWI_SET_EXTSTEP, true);
   TWIsetBool(waveformsdata.TWIadd | 0x20, WAVEFORMSbrd, TWI_SET_SCNRPT, false);
   TWIcmd(waveformsdata.TWIadd | 0x20, WAVEFORMSbrd, TWI_SET_STEPSTR);
-  msd->StartTime = millis();
   // Setup the timer ISR
   DMSDMSScanClock->attachInterrupt(DMSDMSscanISR);
   DMSDMSScanClock->setPriority(8);
@@ -642,38 +626,83 @@ void StartDMSDMSScan(void)
   NVIC_SetPriority(WIRE1_ISR_ID, 8);
   NVIC_SetPriority(WIRE_ISR_ID, 8);
   NVIC_SetPriority((IRQn_Type) ID_UOTGHS, 8UL);
-  DMSDMSScanClock->setPeriod(cvbiasdata.StepDuration * 1000,8);
+  DMSDMSScanClock->setPeriod(dds->Period,8);
+  dds->StartTime = dds->LastTime = micros();
    // Start the timer
   DMSDMSScanClock->start(-1, 8, false);
+  return true;
 }
 
+// Sends the oldest capture record as a text line, point,time in mS,positive current,negative current
+void DDSsendLine(void)
+{
+  DDSrecord *r = &dds->Rec[dds->Tail & (DDSmaxRecords - 1)];
+
+  serial->print(r->Step); serial->print(",");
+  serial->print(r->Time / 1000);
+  serial->print(","); serial->print(r->PosCurrent);
+  serial->print(","); serial->print(r->NegCurrent);
+  serial->println();
+  dds->Tail++;
+}
+
+// Sends and removes n capture records as one binary block, n = 0 sends the end of scan block
+void DDSsendBlock(uint32_t n)
+{
+  uint8_t  buf[sizeof(DDSrecord)];
+  uint8_t  sum = 0;
+
+  buf[0] = DDSsync1;
+  buf[1] = DDSsync2;
+  serial->write(buf, 2);
+  buf[0] = n & 0xFF;
+  buf[1] = (n >> 8) & 0xFF;
+  buf[2] = dds->Dropped & 0xFF;
+  buf[3] = (dds->Dropped >> 8) & 0xFF;
+  buf[4] = (dds->Dropped >> 16) & 0xFF;
+  buf[5] = (dds->Dropped >> 24) & 0xFF;
+  for(int i=0;i<6;i++) sum += buf[i];
+  serial->write(buf, 6);
+  for(;n > 0;n--)
+  {
+    // The record layout is the block layout, the Due is little endian
+    memcpy(buf, &dds->Rec[dds->Tail & (DDSmaxRecords - 1)], sizeof(DDSrecord));
+    for(unsigned int i=0;i<sizeof(DDSrecord);i++) sum += buf[i];
+    serial->write(buf, sizeof(DDSrecord));
+    dds->Tail++;
+  }
+  buf[0] = (uint8_t)(-sum);
+  serial->write(buf, 1);
+}
+
+// Reports the capture records as the scan runs, returns when the last step is reported
 void ReportDMSDMSScan(void)
 {
-  // Wait for scan data and report
+  uint32_t n;
+  bool     done;
+
   while(1)
   {
     WDT_Restart(WDT);
-    if(msd->Updated)
+    // The ISR has saved the last record when the scan is done
+    done = !DMSDMSScanTimer.Active;
+    n = dds->Head - dds->Tail;
+    if(DDSbinary)
     {
-       msd->Updated = false;
-       serial->print(msd->Point); serial->print(",");
-       serial->print(msd->TimeStamp - msd->StartTime);
-       serial->print(","); serial->print(PosCurrent);
-       serial->print(","); serial->print(NegCurrent);
-       serial->println();
-       if(msd->Point >= msd->steps) 
-       {
-          DMSDMSScanClock->stop();
-          return;
-       }
+      if(n > DDSmaxBlock) n = DDSmaxBlock;
+      if((n == DDSmaxBlock) || ((n > 0) && done)) DDSsendBlock(n);
     }
+    else for(;n > 0;n--) DDSsendLine();
+    if(done && (dds->Head == dds->Tail)) break;
   }
+  if(DDSbinary) DDSsendBlock(0);
 }
 
 // Stops a scan in progress
 void AbortDMSDMSScan(void)
 {
-  DMSDMSScanClock->stop();
+  if(DMSDMSScanTimer.Active) DMSDMSScanClock->stop();
+  TimerRelease(&DMSDMSScanTimer);
   TWIcmd(cvbiasdata.TWIadd | 0x20, CVBIASbrd, TWI_SET_STEPSTP);
   TWIcmd(waveformsdata.TWIadd | 0x20, WAVEFORMSbrd, TWI_SET_STEPSTP);
 }
@@ -796,7 +825,19 @@ void SetDMSDMSVRFend(char *chan, char *value) {int i; if((i = checkChannel(chan)
 void ReturnDMSDMSVRFend(int chan) {if(checkChannel(chan) == -1) return; SendACKonly; if(!SerialMute) serial->println(waveformsdata.channel[checkChannel(chan)].VRFend);}
 void SetDMSDMSStepDuration(int value) {setVariable(&cvbiasdata.StepDuration,value,5,100000);}
 void SetDMSDMSSteps(int value) {setVariable(&cvbiasdata.Steps,value,3,100000);}
-void InitDMSDMSScan(void) {StartDMSDMSScan(); SendACK; ReportDMSDMSScan();}
+void InitDMSDMSScan(void) {if(!StartDMSDMSScan()) ERR(ERR_TIMERINUSE); DDSbinary = false; SendACK; ReportDMSDMSScan();}
+void InitDMSDMSScanBinary(void) {if(!StartDMSDMSScan()) ERR(ERR_TIMERINUSE); DDSbinary = true; SendACK; ReportDMSDMSScan();}
+void ReportDMSDMSScanStats(void)
+{
+  if(dds == NULL) BADARG;
+  SendACKonly;
+  if(SerialMute) return;
+  serial->print(dds->Point); serial->print(",");
+  serial->print(dds->Dropped); serial->print(",");
+  serial->print(dds->Missed); serial->print(",");
+  serial->print(dds->Failed); serial->print(",");
+  serial->println(dds->MaxISR);
+}
 void StopDMSDMSScan(void) {AbortDMSDMSScan(); SendACK;}
 
 void SetEMRTM4enable(char *value) 
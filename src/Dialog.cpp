@@ -3,6 +3,12 @@
 //
 // This file contains functions to support display of a dialog box on the display.
 //
+// The entries of the dialog on the screen are change tracked. Each entry's formatted text,
+// position, and highlight are hashed when it's drawn, the refresh functions only redraw the
+// entries whose hash changed. RefreshAllDialogEntries checks entries until it has used
+// DialogFrameBudget uS, at least one per call. Drawing a window clears the tracking, the
+// entries are then redrawn by the dialog display. GDSPSTAT reports the drawn and skipped
+// entries and the approximate pixels and SPI bytes sent per second.
 //
 #include <Arduino.h>
 #include "Variants.h"
@@ -28,6 +34,55 @@ const char *DOLlist = "NA,LOW,HIGH";
 
 DialogBox *ActiveDialog = NULL;
 
+// Change tracking for the entries on the screen
+int            DialogFrameBudget = DLGframeBudget;
+DialogBoxEntry *DLGcacheEntry = NULL;     // Entry array being tracked, NULL if none
+int            DLGcacheCount = 0;
+uint32_t       DLGcache[DLGmaxCache];     // Entry hash when last drawn, 0 if not drawn
+uint32_t       DLGdrawn = 0;
+uint32_t       DLGskipped = 0;
+uint32_t       DLGpixels = 0;
+uint32_t       DLGstatStart = 0;
+
+// Clears the change tracking, called when the screen is drawn over
+void DialogInvalidate(void)
+{
+  DLGcacheEntry = NULL;
+}
+
+// Starts tracking the dialog's entries if they are not already tracked
+static void DialogTrack(DialogBox *d)
+{
+  if (d->Entry == DLGcacheEntry) return;
+  DLGcacheEntry = d->Entry;
+  for (DLGcacheCount = 0; d->Entry[DLGcacheCount].Name != NULL; DLGcacheCount++);
+  if (DLGcacheCount > DLGmaxCache) DLGcacheCount = DLGmaxCache;
+  memset(DLGcache, 0, sizeof(DLGcache));
+}
+
+// Returns the tracking index of the entry, -1 if not tracked
+static int DialogTrackIndex(DialogBoxEntry *de)
+{
+  int i;
+
+  if (DLGcacheEntry == NULL) return -1;
+  i = de - DLGcacheEntry;
+  if ((i < 0) || (i >= DLGcacheCount)) return -1;
+  return i;
+}
+
+static uint32_t DialogHash(DialogBoxEntry *de, const char *text, bool HighLight)
+{
+  uint32_t h = 2166136261;
+
+  while (*text) h = (h ^ (uint8_t)*text++) * 16777619;
+  h = (h ^ (uint8_t)(de->X + de->Xpos)) * 16777619;
+  h = (h ^ (uint8_t)de->Y) * 16777619;
+  if (HighLight) h = ~h;
+  if (h == 0) h = 1;
+  return h;
+}
+
 // This function is called when an encoder position change is detected.
 // This function will check the state and process the change.
 void DialogBoxProcessChange(DialogBox *d, int8_t change)
@@ -252,60 +307,51 @@ void DialogBoxAdjust(DialogBox *d, int8_t change)
 }
 
 
-// The function displays the selected dialog entry in the window selected.
-void DisplayDialogEntry(Window *w, DialogBoxEntry *de, bool HighLight)
+// Formats the entry's value into text, returns false if the entry has nothing to display.
+static bool DialogFormatEntry(DialogBoxEntry *de, char *text, int len)
 {
   int  i;
   char entry[10];
   char *str;
 
-  if (de->Value == NULL) return;
-  if (de->Type == D_OFF) return;
-  SetWindowTextPos(w, de->X + de->Xpos, de->Y);
-  if (HighLight) tft.setTextColor(w->Bcolor, w->Fcolor);
-  else tft.setTextColor(w->Fcolor, w->Bcolor);
+  text[0] = 0;
+  if (de->Value == NULL) return false;
+  if (de->Type == D_OFF) return false;
   switch (de->Type)
   {
     case D_STRING:
-      p(de->fmt, (char *)de->Value);
+      snprintf(text, len, de->fmt, (char *)de->Value);
       break;
     case D_INT:
-      p(de->fmt, *(int *)de->Value);
+      snprintf(text, len, de->fmt, *(int *)de->Value);
       break;
     case D_INT8:
-      p(de->fmt, *(int8_t *)de->Value);
+      snprintf(text, len, de->fmt, *(int8_t *)de->Value);
       break;
     case D_UINT8:
-      p(de->fmt, *(uint8_t *)de->Value);
+      snprintf(text, len, de->fmt, *(uint8_t *)de->Value);
       break;
     case D_FLOAT:
-      p(de->fmt, *(float *)de->Value);
+      snprintf(text, len, de->fmt, *(float *)de->Value);
       break;
     case D_BINARY8:
-      for (int j = 7; j >= 0; j--)
-      {
-        if (*(uint8_t *)de->Value & (1 << j)) p("1");
-        else p("0");
-      }
+      for (int j = 7; j >= 0; j--) *text++ = (*(uint8_t *)de->Value & (1 << j)) ? '1' : '0';
+      *text = 0;
       break;
     case D_YESNO:
-      if (*(bool *)de->Value) p("YES");
-      else p("NO ");
+      strcpy(text, *(bool *)de->Value ? "YES" : "NO ");
       break;
     case D_FWDREV:
-      if (*(bool *)de->Value) p("FWD");
-      else p("REV");
+      strcpy(text, *(bool *)de->Value ? "FWD" : "REV");
       break;
     case D_ONOFF:
-      if (*(bool *)de->Value) p(" ON");
-      else p("OFF");
+      strcpy(text, *(bool *)de->Value ? " ON" : "OFF");
       break;
     case D_OPENCLOSE:
-      if (*(bool *)de->Value) p(" OPEN");
-      else p("CLOSE");
+      strcpy(text, *(bool *)de->Value ? " OPEN" : "CLOSE");
       break;
     case D_LIST:
-      if (de->Value != NULL) p("%*.*s", (int)de->StepSize, (int)de->StepSize, (char *)de->Value);
+      snprintf(text, len, "%*.*s", (int)de->StepSize, (int)de->StepSize, (char *)de->Value);
       break;
     case D_DI:
       entry[0] = * (char *)de->Value;
@@ -314,7 +360,7 @@ void DisplayDialogEntry(Window *w, DialogBoxEntry *de, bool HighLight)
       if(i<1) i = 1;
       str = GetEntry(DIlist,i);
       if (str == NULL) break;
-      p("%*.*s", (int)de->StepSize, (int)de->StepSize, str);
+      snprintf(text, len, "%*.*s", (int)de->StepSize, (int)de->StepSize, str);
       break;
     case D_DO:
       entry[0] = * (char *)de->Value;
@@ -323,25 +369,67 @@ void DisplayDialogEntry(Window *w, DialogBoxEntry *de, bool HighLight)
       if(i<1) i = 1;
       str = GetEntry(DOlist,i);
       if (str == NULL) break;
-      p("%*.*s", (int)de->StepSize, (int)de->StepSize, str);
+      snprintf(text, len, "%*.*s", (int)de->StepSize, (int)de->StepSize, str);
       break;
     case D_DILEVEL:
       i = (int) * (int8_t *)de->Value + 2;
       if(i<1) i = 1;
       str = GetEntry(DILlist,i);
       if (str == NULL) break;
-      p("%*.*s", (int)de->StepSize, (int)de->StepSize, str);
+      snprintf(text, len, "%*.*s", (int)de->StepSize, (int)de->StepSize, str);
       break;
     case D_DOLEVEL:
       i = (int) * (int8_t *)de->Value + 2;
       if(i<1) i = 1;
       str = GetEntry(DOLlist,i);
       if (str == NULL) break;
-      p("%*.*s", (int)de->StepSize, (int)de->StepSize, str);
+      snprintf(text, len, "%*.*s", (int)de->StepSize, (int)de->StepSize, str);
       break;
     default:
       break;
   }
+  return true;
+}
+
+// Queues the formatted entry text for the display thread and records it if the entry is tracked
+static void DialogDrawEntry(Window *w, DialogBoxEntry *de, const char *text, bool HighLight, uint32_t hash)
+{
+  int i;
+
+  SetWindowTextPos(w, de->X + de->Xpos, de->Y);
+  if (HighLight) DSPqueueText(tft.getCursorX(), tft.getCursorY(), w->Tsize, w->Bcolor, w->Fcolor, text);
+  else DSPqueueText(tft.getCursorX(), tft.getCursorY(), w->Tsize, w->Fcolor, w->Bcolor, text);
+  DLGdrawn++;
+  DLGpixels += strlen(text) * w->Tsize * w->Tsize * (C_WIDTH + 1) * (C_HEIGHT + 1);
+  if ((i = DialogTrackIndex(de)) != -1) DLGcache[i] = hash;
+}
+
+// The function displays the selected dialog entry in the window selected.
+void DisplayDialogEntry(Window *w, DialogBoxEntry *de, bool HighLight)
+{
+  char text[DLGmaxText];
+
+  if (!DialogFormatEntry(de, text, sizeof(text))) return;
+  DialogDrawEntry(w, de, text, HighLight, DialogHash(de, text, HighLight));
+}
+
+// Displays the entry only if its text changed since it was last drawn, returns true if drawn.
+// Entries that are not tracked are always drawn.
+static bool DialogUpdateEntry(Window *w, DialogBoxEntry *de)
+{
+  char     text[DLGmaxText];
+  uint32_t hash;
+  int      i;
+
+  if (!DialogFormatEntry(de, text, sizeof(text))) return false;
+  hash = DialogHash(de, text, false);
+  if (((i = DialogTrackIndex(de)) != -1) && (DLGcache[i] == hash))
+  {
+    DLGskipped++;
+    return false;
+  }
+  DialogDrawEntry(w, de, text, false, hash);
+  return true;
 }
 
 void UpdateNoEditDialogEntries(Window *w, DialogBoxEntry *de)
@@ -361,36 +449,39 @@ void UpdateNoEditDialogEntries(DialogBox *d)
 {
   int   i = 0;
 
-  // Loop through all the DialogBox entries and print the entries
+  if (d == ActiveDialog) DialogTrack(d);
+  // Loop through all the DialogBox entries and print the entries that changed
   while (1)
   {
     if (d->Entry[i].Name == NULL) return;
-    if (d->Entry[i].NoEdit == true) DisplayDialogEntry(&d->w, &d->Entry[i], false);
+    if (d->Entry[i].NoEdit == true) DialogUpdateEntry(&d->w, &d->Entry[i]);
     i++;
   }
 }
 
+// Displays all the entries, entries that are unchanged since they were last drawn are skipped.
 void DisplayAllDialogEntries(DialogBox *d)
 {
   int   i = 0;
 
+  if (d == ActiveDialog) DialogTrack(d);
   // Loop through all the DialogBox entries and print the entries
   while (1)
   {
     if (d->Entry[i].Name == NULL) return;
-    //    if(i==d->Selected) DisplayDialogEntry(&d->w, &d->Entry[i++], true);
-    //    else DisplayDialogEntry(&d->w, &d->Entry[i++], false);
-    DisplayDialogEntry(&d->w, &d->Entry[i++], false);
+    DialogUpdateEntry(&d->w, &d->Entry[i++]);
   }
 }
 
-// This function will refresh one entry value per call and then advance to the next
-// entry. The idea is to call this function in the polling loop to refesh the display in the
-// event of any changes. If an entry is selected it will not be updated.
+// This function will refresh the changed entry values, it checks entries until the frame
+// budget is used, at least one per call, and the next call continues from the next entry.
+// The idea is to call this function in the polling loop to refesh the display in the event
+// of any changes. If an entry is selected it will not be updated.
 void RefreshAllDialogEntries(DialogBox *d)
 {
-  DialogTypes Type;
+  uint32_t start = micros();
 
+  if (d == ActiveDialog) DialogTrack(d);
   while (1)
   {
     if (d->Entry[d->LastUpdated].Name == NULL)
@@ -398,10 +489,9 @@ void RefreshAllDialogEntries(DialogBox *d)
       d->LastUpdated = 0;
       return;
     }
-    if ((d->LastUpdated != d->Selected) || (d->State != M_ENTRYSELECTED)) DisplayDialogEntry(&d->w, &d->Entry[d->LastUpdated], false);
-    Type = d->Entry[d->LastUpdated++].Type;
-    // Exit if its not a type that has no display
-    if ((Type != D_MENU) && (Type != D_DIALOG) && (Type != D_TITLE) && (Type != D_FUNCTION)) return;
+    if ((d->LastUpdated != d->Selected) || (d->State != M_ENTRYSELECTED)) DialogUpdateEntry(&d->w, &d->Entry[d->LastUpdated]);
+    d->LastUpdated++;
+    if ((int)(micros() - start) >= DialogFrameBudget) return;
   }
 }
 
@@ -454,6 +544,32 @@ void DialogBoxDisplay(DialogBox *d)
   ActiveDialog = d;
 }
 
+// Reports the display statistics since the last report, entries drawn/S, entries skipped/S,
+// pixels/S, and SPI bytes/S. Pixels are the character cells drawn, the bytes are 2 per pixel.
+void DialogReportStats(void)
+{
+  uint32_t now = millis();
+  uint32_t drawn, skipped, pixels;
+  float    sec;
+
+  sec = (float)(now - DLGstatStart) / 1000.0;
+  if (sec <= 0) sec = 1;
+  drawn = DLGdrawn;
+  skipped = DLGskipped;
+  pixels = DLGpixels;
+  DLGdrawn = DLGskipped = DLGpixels = 0;
+  DLGstatStart = now;
+  SendACKonly;
+  if (SerialMute) return;
+  serial->print((float)drawn / sec, 1);
+  serial->print(",");
+  serial->print((float)skipped / sec, 1);
+  serial->print(",");
+  serial->print((float)pixels / sec, 0);
+  serial->print(",");
+  serial->println((float)pixels * 2.0 / sec, 0);
+}
+
 // This function returns a pointer to the requested dialog box entry.
 // The entry is specifided by name. The name search is case sensitive.
 // A pointer to the dialog box entry is retuned or NULL is not found.
@@ -0,0 +1,280 @@
+//
+// DisplayQueue
+//
+// Queued dialog entry drawing and SPI DMA bursts to the display, see DisplayQueue.h.
+//
+// Commands:
+//    GDSPQSTAT               Report queued,replaced,drawn,discarded,overflows,bytes,max pass uS,waiting
+//
+#include <Thread.h>
+#include <ThreadController.h>
+#include "Variants.h"
+#include "DisplayQueue.h"
+#include <glcdfont.c>
+
+extern ThreadController control;
+extern volatile bool TableReady;
+extern volatile bool DCbiasStateBusy;
+
+// MIPS Threads
+Thread DisplayQueueThread  = Thread();
+
+DSPstats      dspstats;
+
+DSPop         DSPops[DSPqueueSize];     // Waiting entries, oldest first
+int           DSPnum = 0;
+bool          DSPready = false;
+bool          DSPlost = false;          // Set when an entry was dropped, the dialog is redrawn
+volatile int  DSPholds = 0;
+
+uint32_t      DSPline[DSPburstPixels * 2];
+int           DSPwords = 0;
+uint32_t      DSPpcs;
+
+const Commands  DisplayQueueCmdArray[] = {
+// Start of command block
+//
+// Display queue commands
+//
+  {"GDSPQSTAT", CMDfunction, 0, (char *)DSPreportStatus},      // Report queued,replaced,drawn,discarded,overflows,bytes,max pass uS,waiting
+// End of table marker
+  {0},
+};
+
+CommandList DisplayQueueCmdList = { (Commands *)DisplayQueueCmdArray, NULL };
+
+// Called once from setup
+void DisplayQueue_init(void)
+{
+  DSPpcs = SPI_PCS(BOARD_PIN_TO_SPI_CHANNEL(BOARD_SPI_DEFAULT_SS));
+  spiDMAinit();
+  // Configure Threads
+  DisplayQueueThread.setName("Display");
+  DisplayQueueThread.onRun(DisplayQueue_loop);
+  DisplayQueueThread.setInterval(DSPinterval);
+  // Add threads to the controller
+  control.add(&DisplayQueueThread);
+  AddToCommandList(&DisplayQueueCmdList);
+  DSPready = true;
+}
+
+// Returns true if the DMA can't be used for the display
+bool DSPpaused(void)
+{
+  if (!DSPready) return true;
+  if (TableReady || DCbiasStateBusy) return true;
+  return (DSPholds > 0);
+}
+
+// Pauses the display queue, called by modules running timing critical modes. Every hold
+// needs a release.
+void DSPhold(void)
+{
+  DSPholds++;
+}
+
+void DSPrelease(void)
+{
+  if (DSPholds > 0) DSPholds--;
+}
+
+//
+// SPI DMA bursts
+//
+
+// Sends the line buffer to the display, the display is selected only for the burst.
+// Interrupts stay enabled while the burst is sent.
+static void DSPburst(void)
+{
+  if (DSPwords == 0) return;
+  tft.beginBurst();
+  spiDmaTX(DSPline, DSPwords);
+  spiDmaWait();
+  tft.endBurst();
+  dspstats.Bytes += DSPwords;
+  DSPwords = 0;
+}
+
+static inline void DSPpixel(uint16_t color)
+{
+  DSPline[DSPwords++] = DSPpcs | (color >> 8);
+  DSPline[DSPwords++] = DSPpcs | (color & 0xFF);
+  if (DSPwords >= DSPburstPixels * 2) DSPburst();
+}
+
+// Fills a rectangle, the window must be on the display.
+void DSPfillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  int32_t n;
+
+  if (DSPpaused() || tft.isDisabled())
+  {
+    tft.fillRect(x, y, w, h, color);
+    return;
+  }
+  if ((x >= tft.width()) || (y >= tft.height()) || (w <= 0) || (h <= 0)) return;
+  if ((x + w - 1) >= tft.width())  w = tft.width()  - x;
+  if ((y + h - 1) >= tft.height()) h = tft.height() - y;
+  tft.setAddrWindow(x, y, x + w - 1, y + h - 1);
+  for (n = (int32_t)w * h; n > 0; n--) DSPpixel(color);
+  DSPburst();
+}
+
+// Sends n pixels to the current address window, used by bmpDraw.
+void DSPpushColors(uint16_t *colors, int n)
+{
+  if (DSPpaused() || tft.isDisabled())
+  {
+    while (n-- > 0) tft.pushColor(*colors++);
+    return;
+  }
+  while (n-- > 0) DSPpixel(*colors++);
+  DSPburst();
+}
+
+// Draws the text as one address window, the classic 6 by 8 font scaled by Size.
+static void DSPdrawText(DSPop *op)
+{
+  const unsigned char *glyph;
+  int     len, w, h, r, c, i, k, n;
+  uint8_t bit, line;
+  uint16_t color;
+
+  if (tft.isDisabled()) return;
+  len = strlen(op->Text);
+  w = len * 6 * op->Size;
+  h = 8 * op->Size;
+  if ((op->X >= tft.width()) || (op->Y >= tft.height()) || (w == 0)) return;
+  if ((op->X + w - 1) >= tft.width())  w = tft.width()  - op->X;
+  if ((op->Y + h - 1) >= tft.height()) h = tft.height() - op->Y;
+  tft.setAddrWindow(op->X, op->Y, op->X + w - 1, op->Y + h - 1);
+  for (r = 0; r < h; r++)
+  {
+    bit = 1 << (r / op->Size);
+    n = 0;
+    for (c = 0; (c < len) && (n < w); c++)
+    {
+      glyph = &font[(uint8_t)op->Text[c] * 5];
+      for (i = 0; i < 6; i++)
+      {
+        line = (i < 5) ? pgm_read_byte(&glyph[i]) : 0;
+        color = (line & bit) ? op->Fcolor : op->Bcolor;
+        for (k = 0; (k < op->Size) && (n < w); k++, n++) DSPpixel(color);
+      }
+    }
+  }
+  DSPburst();
+  dspstats.Drawn++;
+}
+
+//
+// Queue
+//
+
+// Draws the oldest waiting entry and removes it from the queue.
+static void DSPdrawNext(void)
+{
+  DSPdrawText(&DSPops[0]);
+  if (--DSPnum > 0) memmove(&DSPops[0], &DSPops[1], DSPnum * sizeof(DSPop));
+}
+
+// Queues text at x,y in pixels, an entry waiting at the same place is replaced.
+void DSPqueueText(int16_t x, int16_t y, uint8_t size, uint16_t fcolor, uint16_t bcolor, const char *text)
+{
+  DSPop *op;
+  int   i;
+
+  if (!DSPready || (strlen(text) >= DSPmaxText))
+  {
+    // Drop an older entry at the same place so it is not drawn over this text
+    for (i = 0; i < DSPnum; i++) if ((DSPops[i].X == x) && (DSPops[i].Y == y))
+    {
+      if (--DSPnum > i) memmove(&DSPops[i], &DSPops[i + 1], (DSPnum - i) * sizeof(DSPop));
+      dspstats.Replaced++;
+      break;
+    }
+    tft.setCursor(x, y);
+    tft.setTextSize(size);
+    tft.setTextColor(fcolor, bcolor);
+    tft.print(text);
+    return;
+  }
+  dspstats.Queued++;
+  for (i = 0; i < DSPnum; i++) if ((DSPops[i].X == x) && (DSPops[i].Y == y)) break;
+  if (i < DSPnum) dspstats.Replaced++;
+  else
+  {
+    if (DSPnum >= DSPqueueSize)
+    {
+      dspstats.Overflows++;
+      if (DSPpaused())
+      {
+        DSPlost = true;
+        return;
+      }
+      DSPdrawNext();
+    }
+    i = DSPnum++;
+  }
+  op = &DSPops[i];
+  op->X = x;
+  op->Y = y;
+  op->Size = size;
+  op->Fcolor = fcolor;
+  op->Bcolor = bcolor;
+  strcpy(op->Text, text);
+}
+
+// Discards the waiting entries, called when a window is drawn.
+void DSPdiscard(void)
+{
+  dspstats.Discarded += DSPnum;
+  DSPnum = 0;
+  DSPlost = false;
+}
+
+// Draws waiting entries until the time budget is used.
+void DisplayQueue_loop(void)
+{
+  uint32_t start, us;
+
+  if (DSPpaused()) return;
+  if (DSPnum == 0)
+  {
+    if (DSPlost)
+    {
+      DSPlost = false;
+      DialogInvalidate();
+    }
+    return;
+  }
+  start = micros();
+  while ((DSPnum > 0) && ((micros() - start) < DSPbudget)) DSPdrawNext();
+  us = micros() - start;
+  if (us > dspstats.MaxPass) dspstats.MaxPass = us;
+}
+
+//
+// Host commands
+//
+
+void DSPreportStatus(void)
+{
+  SendACKonly;
+  if (SerialMute) return;
+  serial->print(dspstats.Queued);
+  serial->print(",");
+  serial->print(dspstats.Replaced);
+  serial->print(",");
+  serial->print(dspstats.Drawn);
+  serial->print(",");
+  serial->print(dspstats.Discarded);
+  serial->print(",");
+  serial->print(dspstats.Overflows);
+  serial->print(",");
+  serial->print(dspstats.Bytes);
+  serial->print(",");
+  serial->print(dspstats.MaxPass);
+  serial->print(",");
+  serial->println(DSPnum);
+}
@@ -126,6 +126,8 @@ bool  ESIcurrentTest=true;           // Flag to enable over current testing, tru
 float ReadbackV[MAXESI][2];               // Readback voltage [board][channel]
 float ReadbackI[MAXESI][2];               // Readback currect [board][channel]
 float Imonitor[MAXESI];                   // Used for rev 3 current readback monitor
+// Over current fault channels, one per board
+FaultChannel ESIfault[MAXESI] = {{"ESIOC1",5,0,0,0},{"ESIOC2",5,0,0,0},{"ESIOC3",5,0,0,0},{"ESIOC4",5,0,0,0}};
 
 #define esidata ESIarray[SelectedESIboard]
 
@@ -713,6 +715,9 @@ void ESI_init(int8_t Board, int8_t addr)
     de = GetDialogEntries(ESIentriesLimits, "Level threshold");
     if(de != NULL) de->Type = D_FLOAT;
   }
+  // Over current trips after 5 loop passes, rev 1, 2, and 9 trip on the first pass
+  ESIfault[Board].Debounce = ((esidata->Rev == 1) || (esidata->Rev == 2) || (esidata->Rev == 9)) ? 1 : 5;
+  FaultRegister(&ESIfault[Board]);
   if(NumberOfESIchannels == 0)
   {
     // Setup the menu
@@ -746,6 +751,18 @@ void ESI_init(int8_t Board, int8_t addr)
   }
 }
 
+// Runs the over current fault check for a board and disables both channels if it trips.
+void ESIoverCurrent(int b, bool over, float current)
+{
+  if(FaultCheck(&ESIfault[b], over && ESIcurrentTest && ESIarray[b]->Enable, current))
+  {
+     LogEvent(LOGCtrip, LOGfault, LOGMesi, b, -1, current, "ESI excess current!");
+     ESIarray[b]->ESIchan[0].Enable = ESIarray[b]->ESIchan[1].Enable = false;
+     ESIarray[b]->Enable = false;
+     DisplayMessageButtonDismiss("ESI excess current!");
+  }
+}
+
 // ESI_ADC_Control() iterates over the configured ESI channels, checks each channel’s enable input, 
 // and updates the corresponding board or per-channel enable state based on the board revision. When 
 // a channel is enabled and has a valid ADC input, it averages 10 ADC readings, applies the channel’s 
@@ -810,7 +827,6 @@ void ESI_loop(void)
   static   float  SetpointsR3[MAXESI] = {0,0,0,0};
   static   bool   Enabled[MAXESI] = {false,false,false,false};
   static   bool   Enable[MAXESI][2] = {false,false,false,false,false,false,false,false};
-  static   int8_t ESIoverCurrentTimer[MAXESI] = {5,5,5,5};
   
   ESI_ADC_Control();
   if(--relayDly < 0) relayDly = 100;
@@ -1022,23 +1038,16 @@ void ESI_loop(void)
       // Test the current limits and disable if limit is exceeded
       if((ESIarray[b]->Rev == 1) || (ESIarray[b]->Rev == 2) || (ESIarray[b]->Rev == 9))
       {
-        if((ReadbackI[b][0] > ESIarray[b]->ESIchan[0].MaxCurrent) && (ESIarray[b]->ESIchan[0].Enable))
+        // These revs only disable the channel that is over current, an injected fault disables both
+        bool over0 = (ESIarray[b]->ESIchan[0].MaxCurrent > 0) && (ReadbackI[b][0] > ESIarray[b]->ESIchan[0].MaxCurrent) && ESIarray[b]->ESIchan[0].Enable;
+        bool over1 = (ESIarray[b]->ESIchan[1].MaxCurrent > 0) && (ReadbackI[b][1] > ESIarray[b]->ESIchan[1].MaxCurrent) && ESIarray[b]->ESIchan[1].Enable;
+        if(FaultCheck(&ESIfault[b], (over0 || over1) && ESIcurrentTest, max(ReadbackI[b][0], ReadbackI[b][1])))
         {
-          if((ESIarray[b]->ESIchan[0].MaxCurrent > 0) && (ESIcurrentTest) && ESIarray[b]->ESIchan[0].Enable)
-          {
-            ESIarray[b]->ESIchan[0].Enable = false;
-            ESIarray[b]->Enable = false;
-            DisplayMessageButtonDismiss("ESI excess current!");
-          }
-        }
-        if((ReadbackI[b][1] > ESIarray[b]->ESIchan[1].MaxCurrent) && (ESIarray[b]->ESIchan[1].Enable))
-        {
-          if((ESIarray[b]->ESIchan[1].MaxCurrent > 0) && (ESIcurrentTest) && ESIarray[b]->ESIchan[1].Enable)
-          {
-            ESIarray[b]->ESIchan[1].Enable = false;
-            ESIarray[b]->Enable = false;
-            DisplayMessageButtonDismiss("ESI excess current!");
-          }
+          LogEvent(LOGCtrip, LOGfault, LOGMesi, b, over0 ? 0 : 1, max(ReadbackI[b][0], ReadbackI[b][1]), "ESI excess current!");
+          if(over0 || !over1) ESIarray[b]->ESIchan[0].Enable = false;
+          if(over1 || !over0) ESIarray[b]->ESIchan[1].Enable = false;
+          ESIarray[b]->Enable = false;
+          DisplayMessageButtonDismiss("ESI excess current!");
         }
       }
       if(ESIarray[b]->Rev == 3)
@@ -1049,18 +1058,7 @@ void ESI_loop(void)
         else Imonitor[b] = (ReadbackI[b][1] - (abs(SetpointsR3[b]) / abs(ESIarray[b]->ESIchan[1].MaxVoltage *10))) / 1.53;
         if(Imonitor[b] < 0) Imonitor[b] = 0;
         if(ESIarray[b]->ESIchan[0].MaxCurrent > 0)
-        {
-          if((Imonitor[b] > ESIarray[b]->ESIchan[0].MaxCurrent) || (Imonitor[b] > ESIarray[b]->ESIchan[1].MaxCurrent))
-          {
-            if((--ESIoverCurrentTimer[b] <= 0) && (ESIcurrentTest) && ESIarray[b]->Enable)
-            {
-               ESIarray[b]->ESIchan[0].Enable = ESIarray[b]->ESIchan[1].Enable = false;
-               ESIarray[b]->Enable = false;
-               DisplayMessageButtonDismiss("ESI excess current!");
-            }
-          }
-          else ESIoverCurrentTimer[b] = 5;
-        }
+          ESIoverCurrent(b, (Imonitor[b] > ESIarray[b]->ESIchan[0].MaxCurrent) || (Imonitor[b] > ESIarray[b]->ESIchan[1].MaxCurrent), Imonitor[b]);
       }
       if(ESIarray[b]->Rev == 5)
       {
@@ -1088,18 +1086,7 @@ void ESI_loop(void)
         }
         if(Imonitor[b] < 0) Imonitor[b] = 0;
         if(ESIarray[b]->ESIchan[0].MaxCurrent > 0)
-        {
-          if((Imonitor[b] > ESIarray[b]->ESIchan[0].MaxCurrent) || (Imonitor[b] > ESIarray[b]->ESIchan[1].MaxCurrent))
-          {
-            if((--ESIoverCurrentTimer[b] <= 0) && (ESIcurrentTest) && ESIarray[b]->Enable)
-            {
-               ESIarray[b]->ESIchan[0].Enable = ESIarray[b]->ESIchan[1].Enable = false;
-               ESIarray[b]->Enable = false;
-               DisplayMessageButtonDismiss("ESI excess current!");
-            }
-          }
-          else ESIoverCurrentTimer[b] = 5;
-        }
+          ESIoverCurrent(b, (Imonitor[b] > ESIarray[b]->ESIchan[0].MaxCurrent) || (Imonitor[b] > ESIarray[b]->ESIchan[1].MaxCurrent), Imonitor[b]);
       }
       if((ESIarray[b]->Rev == 6) || (ESIarray[b]->Rev == 8))
       {
@@ -1108,33 +1095,14 @@ void ESI_loop(void)
         else Imonitor[b] = ReadbackI[b][1];
         if(Imonitor[b] < 0) Imonitor[b] = 0;
         if(ESIarray[b]->ESIchan[0].MaxCurrent > 0)
-        {
-          if((Imonitor[b] > ESIarray[b]->ESIchan[0].MaxCurrent) || (Imonitor[b] > ESIarray[b]->ESIchan[1].MaxCurrent))
-          {
-            if((--ESIoverCurrentTimer[b] <= 0) && (ESIcurrentTest) && ESIarray[b]->Enable)
-            {
-               ESIarray[b]->ESIchan[0].Enable = ESIarray[b]->ESIchan[1].Enable = false;
-               ESIarray[b]->Enable = false;
-               DisplayMessageButtonDismiss("ESI excess current!");
-            }
-          }
-          else ESIoverCurrentTimer[b] = 5;
-        }
+          ESIoverCurrent(b, (Imonitor[b] > ESIarray[b]->ESIchan[0].MaxCurrent) || (Imonitor[b] > ESIarray[b]->ESIchan[1].MaxCurrent), Imonitor[b]);
       }
       if(ESIarray[b]->Rev == 7)
       {
 
-        if(((ESIarray[b]->ESIchan[0].MaxCurrent > 0) && (ReadbackI[b][0] > ESIarray[b]->ESIchan[0].MaxCurrent)) ||
-           ((ESIarray[b]->ESIchan[1].MaxCurrent > 0) && (ReadbackI[b][1] > ESIarray[b]->ESIchan[1].MaxCurrent)))
-        {
-          if((--ESIoverCurrentTimer[b] <= 0) && (ESIcurrentTest) && ESIarray[b]->Enable)
-          {
-             ESIarray[b]->ESIchan[0].Enable = ESIarray[b]->ESIchan[1].Enable = false;
-             ESIarray[b]->Enable = false;
-             DisplayMessageButtonDismiss("ESI excess current!");
-          }
-        }
-        else ESIoverCurrentTimer[b] = 5;
+        ESIoverCurrent(b, ((ESIarray[b]->ESIchan[0].MaxCurrent > 0) && (ReadbackI[b][0] > ESIarray[b]->ESIchan[0].MaxCurrent)) ||
+                          ((ESIarray[b]->ESIchan[1].MaxCurrent > 0) && (ReadbackI[b][1] > ESIarray[b]->ESIchan[1].MaxCurrent)),
+                          max(ReadbackI[b][0], ReadbackI[b][1]));
       }
       if(ESIarray[b]->Rev == 4)
       {
@@ -1143,17 +1111,9 @@ void ESI_loop(void)
         ReadbackI[b][0] = abs((ReadbackI[b][0] - (abs(Setpoints[b][0]) / abs(ESIarray[b]->ESIchan[0].MaxVoltage * 10))) / 1.53);
         ReadbackI[b][1] = abs((ReadbackI[b][1] - (abs(Setpoints[b][1]) / abs(ESIarray[b]->ESIchan[1].MaxVoltage *10))) / 1.53);
 
-        if(((ESIarray[b]->ESIchan[0].MaxCurrent > 0) && (ReadbackI[b][0] > ESIarray[b]->ESIchan[0].MaxCurrent)) ||
-           ((ESIarray[b]->ESIchan[1].MaxCurrent > 0) && (ReadbackI[b][1] > ESIarray[b]->ESIchan[1].MaxCurrent)))
-        {
-            if((--ESIoverCurrentTimer[b] <= 0) && (ESIcurrentTest) && ESIarray[b]->Enable)
-            {
-               ESIarray[b]->ESIchan[0].Enable = ESIarray[b]->ESIchan[1].Enable = false;
-               ESIarray[b]->Enable = false;
-               DisplayMessageButtonDismiss("ESI excess current!");
-            }   
-        }
-        else ESIoverCurrentTimer[b] = 5;
+        ESIoverCurrent(b, ((ESIarray[b]->ESIchan[0].MaxCurrent > 0) && (ReadbackI[b][0] > ESIarray[b]->ESIchan[0].MaxCurrent)) ||
+                          ((ESIarray[b]->ESIchan[1].MaxCurrent > 0) && (ReadbackI[b][1] > ESIarray[b]->ESIchan[1].MaxCurrent)),
+                          max(ReadbackI[b][0], ReadbackI[b][1]));
       }
       MaxESIvoltage = 0;
     }
@@ -1295,6 +1255,33 @@ void GetESIchannelI(int chan)
   else serial->println(ReadbackI[ESIchannel2board(chan)][(chan-1)&1]);
 }
 
+// Returns the filtered output voltage readback for the channel without sending any
+// response to the host. Returns false if the channel is invalid.
+bool ESIgetReadbackV(int chan, float *fVal)
+{
+  int b;
+
+  if((chan < 1) || (chan > NumberOfESIchannels)) return false;
+  if((b = ESIchannel2board(chan)) == -1) return false;
+  if(ESIisRelayRev(ESIarray[b]->Rev)) *fVal = ReadbackV[b][0];
+  else *fVal = ReadbackV[b][(chan-1)&1];
+  return true;
+}
+
+// Returns the filtered output current readback for the channel without sending any
+// response to the host. Returns false if the channel is invalid or has no current monitor.
+bool ESIgetReadbackI(int chan, float *fVal)
+{
+  int b;
+
+  if((chan < 1) || (chan > NumberOfESIchannels)) return false;
+  if((b = ESIchannel2board(chan)) == -1) return false;
+  if(ESIarray[b]->Rev == 8) return false;
+  if(ESIisRelayRev(ESIarray[b]->Rev)) *fVal = Imonitor[b];
+  else *fVal = ReadbackI[b][(chan-1)&1];
+  return true;
+}
+
 // Reads the selected channels maximum voltage output
 void GetESIchannelMax(int chan)
 {
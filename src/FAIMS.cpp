@@ -151,8 +151,9 @@ int    FMnumTries   = 0;          // If greater then 0 then the system will auto
                                   // This count defines how many time the system will try to restart.
 int    FMrestartDelay = 2000;     // Number of mS the system will wait after a arc shutdown before an auto restart
                                   // is attempted. 
-int    FMcurrentTry = 0;          // This cound is the current retry number. If the system remains enable for 10 times
-                                  // FMrestartDelay then this value will be cleared
+// Arc fault channel, the retries, delay, and window follow FMnumTries and FMrestartDelay. The
+// retry count clears after 10 times FMrestartDelay with no arc.
+FaultChannel FMarcFault = {"FMARC", 1, 0, 2000, 20000};
 
 // DC output readback values
 float  DCoffsetRB = 0;
@@ -414,6 +415,16 @@ const Commands  FAIMSCmdArray[] = {
   {"GFMSTEPS", CMDint, 0, (char *)&faims.Steps},                   // Returns FAIMS DC CV step scan number of steps
   {"SFMSTRTSTP", CMDbool, 1, (char *)&FAIMSstepScan},              // Sets FAIMS DC CV step scan flag
   {"GFMSTRTSTP", CMDbool, 0, (char *)&FAIMSstepScan},              // Returns FAIMS DC CV step scan flag
+  {"SFMCVLCLR", CMDfunction, 0, (char *)CVlistClear},              // Clears the FAIMS DC CV scan list
+  {"SFMCVLADD", CMDfunctionStr, 1, (char *)CVlistAdd},             // Adds a CV value to the FAIMS DC CV scan list, up to 200 values
+  {"GFMCVLIST", CMDfunction, 0, (char *)CVlistReport},             // Returns the FAIMS DC CV scan list, comma separated
+  {"SFMSTRTLST", CMDbool, 1, (char *)&FAIMSlistScan},              // Sets FAIMS DC CV list scan flag, each value is output for the step duration
+  {"GFMSTRTLST", CMDbool, 0, (char *)&FAIMSlistScan},              // Returns FAIMS DC CV list scan flag
+  {"SFMSCNTCK", CMDfunction, 1, (char *)CVscanSetTick},            // Sets FAIMS DC CV linear scan step period in mS, 1 to 1000
+  {"GFMSCNTCK", CMDint, 0, (char *)&CVscanTick},                   // Returns FAIMS DC CV linear scan step period in mS
+  {"SFMSCNADC", CMDfunction, 1, (char *)CVscanSetADC},             // Sets the DUE ADC channel captured at the end of each scan step, 0 to 11, -1 = off
+  {"GFMSCNADC", CMDint, 0, (char *)&CVscanADCchan},                // Returns the scan capture ADC channel
+  {"GFMSCNDAT", CMDfunction, 0, (char *)CVscanReportData},         // Returns the last scan captures, step,CV,ADC counts one per line
 // FAIMS configuration / calibration commands
   {"SRFHPCAL", CMDfunctionStr, 2, (char *)FAIMSsetRFharPcal},      // Set FAIMS RF harmonic positive peak readback calibration
   {"SRFHNCAL", CMDfunctionStr, 2, (char *)FAIMSsetRFharNcal},      // Set FAIMS RF harmonic negative peak readback calibration
@@ -724,6 +735,7 @@ void FAIMS_init(int8_t Board)
   NumberOfFAIMS = 1;
   // Add the commands to the command processor
   AddToCommandList(&FAIMSCmdList);
+  FaultRegister(&FMarcFault);
   // Set active board to board being inited
   FAIMSBoardAddress = Board;
   SelectBoard(Board);
@@ -897,12 +909,16 @@ bool TestClock(void)
   return (false);
 }
 
-// FAIMS dc bias control for normal, non field driven FAIMS operation.
+// FAIMS dc bias control for normal, non field driven FAIMS operation. CV scans are run by
+// the timer driven scan engine in FAIMSscan.cpp, this function starts the engine and follows
+// its progress.
 void FAIMSDCbiasControl(void)
 {
   static bool SuppliesOff = true;
   static int  SuppliesStableCount = 10;
-  static unsigned long StartTime, StepTime, Duration;
+  static unsigned long StartTime;
+  static bool TriggerOut = false;
+  static int  LastStep;
 
   // Monitor power on output bit. If power comes on hold all output at zero until power is stable, short delay.
   if (digitalRead(PWR_ON) != 0)
@@ -916,10 +932,20 @@ void FAIMSDCbiasControl(void)
     // Here when supplies are on
     if (--SuppliesStableCount <= 0) SuppliesOff = false;
   }
+  // Reset output A after the scan start pulse, the pulse is at least 10mS
+  if (TriggerOut && ((millis() - StartTime) >= 10))
+  {
+    SDIO_Set_Image('A', '0');
+    DOrefresh;
+    PulseLDAC;
+    TriggerOut = false;
+  }
   // Output the DC supply voltages. Set all to 0 if power supply is off.
-  // If the system is scanning then calculate the next value and output.
+  // If the system is scanning then the scan engine outputs the CV.
   if (SuppliesOff)
   {
+    if (FAIMSscanning) CVscanStop();
+    FAIMSscanning = false;
     AD5625(faims.DACadr, faims.DCoffset.DCctrl.Chan, Value2Counts(0, &faims.DCoffset.DCctrl));
     AD5625(faims.DACadr, faims.DCbias.DCctrl.Chan, Value2Counts(0, &faims.DCbias.DCctrl));
     AD5625(faims.DACadr, faims.DCcv.DCctrl.Chan, Value2Counts(0, &faims.DCcv.DCctrl));
@@ -928,43 +954,42 @@ void FAIMSDCbiasControl(void)
   {
     AD5625(faims.DACadr, faims.DCoffset.DCctrl.Chan, Value2Counts(faims.DCoffset.VoltageSetpoint, &faims.DCoffset.DCctrl));
     AD5625(faims.DACadr, faims.DCbias.DCctrl.Chan, Value2Counts(faims.DCbias.VoltageSetpoint - faims.DCoffset.VoltageSetpoint, &faims.DCbias.DCctrl));
-    if ((!FAIMSscan) && (!FAIMSstepScan))
+    if ((!FAIMSscan) && (!FAIMSstepScan) && (!FAIMSlistScan))
     {
-      if (FAIMSscanning) DCcvRB = faims.DCcv.VoltageSetpoint;
+      if (FAIMSscanning)
+      {
+        CVscanStop();
+        DCcvRB = faims.DCcv.VoltageSetpoint;
+      }
       FAIMSscanning = false;
       AD5625(faims.DACadr, faims.DCcv.DCctrl.Chan, Value2Counts(faims.DCcv.VoltageSetpoint - faims.DCoffset.VoltageSetpoint, &faims.DCcv.DCctrl));
     }
     else
     {
-      // Here if FAIMS scan flag is true.
-      // Check if we are currently scanning and update the voltage if true.
-      // If we are not currently scanning then init the scan mode and start.
+      // Here if a FAIMS scan flag is true.
+      // If we are not currently scanning then start the scan engine, else follow its progress.
       if (!FAIMSscanning)
       {
+        // Setup the scanning parameters, stop if the scan is not valid
+        ScanTime  = 0;
+        StartTime = millis();
+        LastStep  = 0;
+        if(FAIMSscan) FAIMSscanning = CVscanStart(CVSlinear);
+        else if(FAIMSstepScan) FAIMSscanning = CVscanStart(CVSstep);
+        else FAIMSscanning = CVscanStart(CVSlist);
+        if(!FAIMSscanning)
+        {
+          FAIMSscan = FAIMSscanEnable = false;
+          FAIMSstepScan = FAIMSstepScanEnable = false;
+          FAIMSlistScan = false;
+          return;
+        }
         // Pulse output A to trigger a mass spec, added 6/17/2016
-        // Set output A
-        // Set the image bits
         SDIO_Set_Image('A', '1');
-        // Send to the hardware
         DOrefresh;
-        // Toggle LDAC
         PulseLDAC;
-        delay(10);
-        // Reset output A
-        // Set the image bits
-        SDIO_Set_Image('A', '0');
-        // Send to the hardware
-        DOrefresh;
-        // Toggle LDAC
-        PulseLDAC;
-        if(FAIMSstepScan) Duration = faims.StepDuration * faims.Steps;
-        else Duration = faims.Duration * 1000;
-        // Setup the scanning parameters
-        ScanTime  = 0;
-        StartTime = millis();
-        StepTime  = StartTime;
-        FAIMSscanning = true;
-        ScanCV = faims.CVstart;
+        TriggerOut = true;
+        ScanCV = CVscanCV(0);
         DCcvRB = ScanCV;  // Reset the filter
         // Refresh the menu in case this was an external trigger
         if (ActiveDialog == &FAIMSDCMenu) 
@@ -973,43 +998,37 @@ void FAIMSDCbiasControl(void)
           FAIMSDCMenu.State = M_SCROLLING;
         }
       }
-      else
+      else if (cvscan.Done)
       {
-        // Here if system is scanning
-        // Determine the total scan time in seconds
-        ScanTime = (millis() - StartTime)/1000;
-        if ((ScanTime * 1000) > Duration)
+        // Stop scanning and clear all the scanning flags if all loops are done
+        if(--Loops <= 0)
         {
-          // Stop scanning and clear all the scanning flags if all loops are done
-          if(--Loops <= 0)
-          {
-             FAIMSscan = FAIMSscanEnable = false;
-             FAIMSstepScan = FAIMSstepScanEnable = false;
-             FAIMSscanning = false;
-             DCcvRB = faims.DCcv.VoltageSetpoint;
-             Loops = faims.Loops;
-             // Refresh the menu
-             if (ActiveDialog == &FAIMSDCMenu) 
-             {
-               DisplayAllDialogEntries(&FAIMSDCMenu);
-               FAIMSDCMenu.State = M_SCROLLING;
-             }
-          }
-          else FAIMSscanning = false;
+           FAIMSscan = FAIMSscanEnable = false;
+           FAIMSstepScan = FAIMSstepScanEnable = false;
+           FAIMSlistScan = false;
+           FAIMSscanning = false;
+           DCcvRB = faims.DCcv.VoltageSetpoint;
+           Loops = faims.Loops;
+           // Refresh the menu
+           if (ActiveDialog == &FAIMSDCMenu) 
+           {
+             DisplayAllDialogEntries(&FAIMSDCMenu);
+             FAIMSDCMenu.State = M_SCROLLING;
+           }
         }
-        else
+        else FAIMSscanning = false;
+      }
+      else
+      {
+        // Here if system is scanning, update the scan time and the displayed CV
+        ScanTime = (millis() - StartTime)/1000;
+        if (cvscan.Step != LastStep)
         {
-          // Update the scan voltage
-          if(FAIMSscan) ScanCV = faims.CVstart + (faims.CVend - faims.CVstart) * ScanTime / faims.Duration;
-          else if((millis()-StepTime) > (unsigned int)faims.StepDuration)
-          {
-            StepTime += faims.StepDuration;
-            ScanCV += (faims.CVend - faims.CVstart) / faims.Steps;
-            DCcvRB = ScanCV;  // Reset the filter
-          }
+          LastStep = cvscan.Step;
+          ScanCV = CVscanCV(LastStep - 1);
+          if (!FAIMSscan) DCcvRB = ScanCV;  // Reset the filter on each step
         }
       }
-      AD5625(faims.DACadr, faims.DCcv.DCctrl.Chan, Value2Counts(ScanCV - faims.DCoffset.VoltageSetpoint, &faims.DCcv.DCctrl));
     }
   }
 }
@@ -1152,11 +1171,12 @@ void FAIMS_loop(void)
   static DialogBoxEntry *TMde = GetDialogEntries(FAIMSentriesTuneMenu, " Frequency");
   static DialogBoxEntry *PCde = GetDialogEntries(FAIMSentriesTuneMenu, " Pri capacitance");
   static DialogBoxEntry *HCde = GetDialogEntries(FAIMSentriesTuneMenu, " Har capacitance");
-  static uint32_t FMarcTime=0;
-  static bool FMrestart = false;
 
   if(FMnumTries < 0) FMnumTries = 0;
   if(FMnumTries > 10) FMnumTries = 10;
+  FMarcFault.Retries = FMnumTries;
+  FMarcFault.RetryDelay = FMrestartDelay;
+  FMarcFault.RetryWindow = 10 * FMrestartDelay;
   if(DiableArcDetectTimer > 0) DiableArcDetectTimer--;
   // If the active dialog is the tune menu or the drive menu and there has been an entry
   // change then disable the arc detector for a bit.
@@ -1188,10 +1208,6 @@ void FAIMS_loop(void)
     PCde->NoEdit = false;
     HCde->NoEdit = false;
   }
-  if((faims.Enable) && (FMcurrentTry > 0))
-  {
-    if((millis() - OnMillis) > (unsigned int)(10 * FMrestartDelay)) FMcurrentTry = 0;
-  }
   // If the global enable has just changed state to on, then check the clock to
   // make sure its running and correct. If not do not enable and issue a warning.
   if ((!LastEnable) && (faims.Enable))
@@ -1275,14 +1291,12 @@ void FAIMS_loop(void)
     analogWrite(faims.Drv1.PWMchan, 0);
     analogWrite(faims.Drv2.PWMchan, 0);
     analogWrite(faims.Drv3.PWMchan, 0);
-    if(FMrestart && ((millis() - FMarcTime) > (unsigned int)FMrestartDelay))
+    if(FaultRestart(&FMarcFault))
     {
       // if here we will try and restart the system and ramp the drive level back up
-      FMcurrentTry++;
       FMdrvStep = 3.0;
       LastDrv = 5.0;
       faims.Enable=true;
-      FMrestart = false;
     }
   }
   else
@@ -1400,28 +1414,23 @@ void FAIMS_loop(void)
     // Compare the unfiltered value to the filtered value and if there is a sudden drop it
     // could indicate an arc so turn off the system.
 //    if((DiableArcDetectTimer == 0) && !DiableArcDetect) if (faims.Enable) if (((KVoutP + KVoutN) - (Vp + Vn)) > (KVoutP + KVoutN) / 3)
-    if((DiableArcDetectTimer == 0) && !DiableArcDetect) if (faims.Enable) if((KVoutP > 0.5) || (KVoutN > 0.5))
+    bool arc = (DiableArcDetectTimer == 0) && !DiableArcDetect && faims.Enable && ((KVoutP > 0.5) || (KVoutN > 0.5)) &&
+               (((KVoutP + KVoutN) - (Vp + Vn)) > ((KVoutP + KVoutN) * (100 - faims.ArcSens))/ 100);
+    if(FaultCheck(&FMarcFault, arc, Vp + Vn))
     {
-      if (((KVoutP + KVoutN) - (Vp + Vn)) > ((KVoutP + KVoutN) * (100 - faims.ArcSens))/ 100)
+      // Arc detected! Shutdown
+      // Disable the drivers and display a estop warning, the fault monitor sets the auto restart time
+      faims.Enable = false;
+      // Lower the drive level
+      faims.Drv = 5;
+      LogEvent(LOGCtrip, LOGfault, LOGMfaims, -1, -1, Vp + Vn, "FAIMS arc detected.");
+      if (ActiveDialog != NULL) ActiveDialog->State = M_SCROLLING;
+      if(FMarcFault.State == FLTlocked)
       {
-        // Arc detected! Shutdown
-        // Disable the drivers and display a estop warning
-        faims.Enable = false;
-        // Lower the drive level
-        faims.Drv = 5;
-        // Set arc detected flag and set arc detect time
-        FMrestart = true;
-        FMarcTime = millis();
-        LogMessage("FAIMS arc detected.");
-        if (ActiveDialog != NULL) ActiveDialog->State = M_SCROLLING;
-        if(FMcurrentTry >= FMnumTries)
-        {
-           FMrestart = false;
-           if(ArcMessAutoDismiss) DisplayMessage(" Arc detected! ", 2000);
-           else DisplayMessageButtonDismiss(" Arc detected! ");     
-        }
-        else DisplayMessage(" Arc detected! ", 2000);
+         if(ArcMessAutoDismiss) DisplayMessage(" Arc detected! ", 2000);
+         else DisplayMessageButtonDismiss(" Arc detected! ");     
       }
+      else DisplayMessage(" Arc detected! ", 2000);
     }
     if(FieldDriven)
     {
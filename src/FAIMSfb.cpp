@@ -45,7 +45,7 @@ int AD5593writeWire1(uint8_t addr, uint8_t pb, uint16_t val);
 int AD5593readADCWire1(int8_t addr, int8_t chan);
 int AD5593readADCWire1(int8_t addr, int8_t chan, int8_t num);
 int AD5593writeDACWire1(int8_t addr, int8_t chan, int val);
-void InitFBScan(int module);
+bool InitFBScan(int module);
 void ReportFBScan(void);
 void StopFBScan(int module);
 void SaveFAIMSFBsettings(void);
@@ -119,6 +119,7 @@ void SendFrag(void);
 void PollFrag(void);
 
 MIPStimer *FAIMSfbScanClock = NULL;
+TimerUser FAIMSfbScanTimer  = {"FAIMSFB", FAIMSFB_ScanClock, TMRPnormal, NULL};
 
 //MIPS Threads
 Thread FAIMSFBthread  = Thread();
@@ -428,6 +429,7 @@ void FAIMSfb_init(int8_t Board, int8_t addr)
   de = GetDialogEntries(FAIMSFBentries, "Module");
   if(de != NULL) de->Max = NumberOfFAIMSFBchannels;
   if(FAIMSfbScanClock == NULL) FAIMSfbScanClock = new MIPStimer(FAIMSFB_ScanClock);
+  TimerRegister(&FAIMSfbScanTimer);
 }
 
 void FAIMSfb_loop(void)
@@ -583,11 +585,13 @@ void FAIMSFBscanISR(void)
 // scan duration is used and the largest steps value is use.
 //
 // The modules are configured to use the external scan advance signal. The
-// modules are also configured to return no report.
-void InitFBScan(int module)
+// modules are also configured to return no report. Returns false if the scan
+// clock timer is owned by another module.
+bool InitFBScan(int module)
 {
   int brd;
 
+  if(!TimerClaim(&FAIMSfbScanTimer)) return false;
   FAIMSfbScanClock->stop();
   if(msd == NULL) msd = new MIPSscanData;
   msd->Updated = false;
@@ -615,6 +619,7 @@ void InitFBScan(int module)
   FAIMSfbScanClock->setPeriod(FAIMSFBarray[msd->brd1]->StepDuration * 1000,8);
   // Start the timer
   FAIMSfbScanClock->start(-1, 8, false);
+  return true;
 }
 
 void ReportFBScan(void)
@@ -638,6 +643,7 @@ void ReportFBScan(void)
        if(msd->Point >= msd->steps) 
        {
           FAIMSfbScanClock->stop();
+          TimerRelease(&FAIMSfbScanTimer);
           return;
        }
     }
@@ -649,7 +655,8 @@ void StopFBScan(int module)
 {
   int brd;
     
-  FAIMSfbScanClock->stop();
+  if(FAIMSfbScanTimer.Active) FAIMSfbScanClock->stop();
+  TimerRelease(&FAIMSfbScanTimer);
   for(int i=1;i<=2;i++)
   {
     if((brd=FAIMSfbModule2Brd(module & i, false)) != -1)
@@ -977,7 +984,7 @@ void GenerateVrfTable(int module)
 // modules are also configured to return no report.
 void InitFAIMSfbScan(int module)
 {
-   InitFBScan(module);
+   if(!InitFBScan(module)) ERR(ERR_TIMERINUSE);
    SendACK;
    //delay(10);
    ReportFBScan();
@@ -0,0 +1,211 @@
+//
+// FAIMSscan
+//
+// Timer driven DC CV scan engine for the FAIMS module, see FAIMSscan.h for the scan modes.
+//
+// The FAIMS loop starts the engine when a scan flag is set and then only follows its progress
+// to update the display and the CV readback filter. The timer ISR outputs every step. The CV
+// DAC is on the TWI bus so the ISR writes it directly if the bus is free, else the write is
+// queued and done when the current TWI operation releases the bus.
+//
+// The DAC codes are computed when the scan starts, using the DC offset at that time. The linear
+// and step modes use the codes at the scan end points and interpolate, the DAC calibration
+// is linear so this gives the same codes as converting each CV value. The list mode converts
+// every value into a code table.
+//
+#include "Variants.h"
+#include "FAIMSscan.h"
+#include "Arduino.h"
+#include <MIPStimer.h>
+
+#if FAIMScode
+
+MIPStimer *CVscanClock = NULL;
+TimerUser CVscanTimer  = {"CVSCAN", TMR_FAIMSscan, TMRPnormal, NULL};
+
+CVscanData cvscan = {false, false, CVSlinear, 0, 1, 0};
+bool       FAIMSlistScan = false;   // True when the DCcv list scan is requested
+int        CVscanTick    = 10;      // Linear scan step period in mS
+int        CVscanADCchan = -1;      // DUE ADC channel captured at each step, -1 = disabled
+int        CVlistLength  = 0;
+
+float      *CVlist     = NULL;      // List scan CV values, allocated on first use
+uint16_t   *CVlistCode = NULL;      // List scan DAC codes
+uint16_t   *CVcapture  = NULL;      // Per step ADC captures, allocated on first use
+
+// Returns the DAC code for a scan step
+uint16_t CVscanCode(int step)
+{
+  if(cvscan.Mode == CVSlist) return CVlistCode[step];
+  return cvscan.Code0 + ((int32_t)cvscan.Code1 - (int32_t)cvscan.Code0) * step / cvscan.Div;
+}
+
+// Returns the CV voltage for a scan step, used for display and the readback filter
+float CVscanCV(int step)
+{
+  if(cvscan.Mode == CVSlist) return CVlist[step];
+  return faims.CVstart + (faims.CVend - faims.CVstart) * step / cvscan.Div;
+}
+
+// Writes the current code to the CV DAC. Called from the ISR or from the TWI queue, the
+// FAIMS board is selected for the write and the interrupted code's board is restored.
+void CVscanWrite(void)
+{
+  int cb = SelectedBoard();
+  SelectBoard(FAIMSBoardAddress);
+  AD5625(faims.DACadr, faims.DCcv.DCctrl.Chan, cvscan.Code);
+  if(cb != FAIMSBoardAddress) SelectBoard(cb);
+}
+
+// Timer ISR, called once per step. Captures the ADC for the step that is ending and
+// outputs the next step.
+void CVscanClockISR(void)
+{
+  if(!cvscan.Running) return;
+  if((CVscanADCchan >= 0) && (CVcapture != NULL) && (cvscan.NumCaptured < CVSmaxCapture)) CVcapture[cvscan.NumCaptured++] = analogRead(CVscanADCchan);
+  if(cvscan.Step >= cvscan.Ticks)
+  {
+    CVscanClock->stop();
+    TimerRelease(&CVscanTimer);
+    cvscan.Running = false;
+    cvscan.Done = true;
+    return;
+  }
+  cvscan.Code = CVscanCode(cvscan.Step++);
+  if(AcquireTWI()) CVscanWrite(); else TWIqueue(CVscanWrite);
+}
+
+// Sets up the code table for the requested mode, outputs the first step, and starts the
+// timer. Returns false if the scan is not valid, for example an empty list, or if the timer
+// is owned by another module.
+bool CVscanStart(CVscanMode mode)
+{
+  int period;
+
+  CVscanStop();
+  if(CVscanClock == NULL) CVscanClock = new MIPStimer(TMR_FAIMSscan);
+  cvscan.Mode = mode;
+  cvscan.Code0 = Value2Counts(faims.CVstart - faims.DCoffset.VoltageSetpoint, &faims.DCcv.DCctrl);
+  cvscan.Code1 = Value2Counts(faims.CVend - faims.DCoffset.VoltageSetpoint, &faims.DCcv.DCctrl);
+  if(mode == CVSlinear)
+  {
+    // The last step is at CVend, the scan ends one tick later at Duration
+    cvscan.Ticks = (faims.Duration * 1000) / CVscanTick;
+    if(cvscan.Ticks < 2) cvscan.Ticks = 2;
+    cvscan.Div = cvscan.Ticks - 1;
+    period = CVscanTick;
+  }
+  else if(mode == CVSstep)
+  {
+    if(faims.Steps < 1) return false;
+    cvscan.Ticks = cvscan.Div = faims.Steps;
+    period = faims.StepDuration;
+  }
+  else
+  {
+    if(CVlistLength < 1) return false;
+    for(int i=0;i<CVlistLength;i++) CVlistCode[i] = Value2Counts(CVlist[i] - faims.DCoffset.VoltageSetpoint, &faims.DCcv.DCctrl);
+    cvscan.Ticks = CVlistLength;
+    cvscan.Div = 1;
+    period = faims.StepDuration;
+  }
+  if((CVscanADCchan >= 0) && (CVcapture == NULL)) CVcapture = new uint16_t[CVSmaxCapture];
+  if(!TimerClaim(&CVscanTimer)) return false;
+  cvscan.NumCaptured = 0;
+  cvscan.Done = false;
+  // Output the first step now, the timer outputs the rest
+  cvscan.Code = CVscanCode(0);
+  cvscan.Step = 1;
+  CVscanWrite();
+  cvscan.Running = true;
+  // Timer 6 is shared with the ARB clock and FAIMSFB scan, clear their callbacks
+  CVscanClock->detachInterrupt();
+  CVscanClock->attachInterrupt(CVscanClockISR);
+  CVscanClock->setPriority(8);
+  NVIC_SetPriority(WIRE_ISR_ID, 8);
+  CVscanClock->setPeriod(period * 1000, 8);
+  CVscanClock->start(-1, 8, false);
+  return true;
+}
+
+// Stops a scan in progress, the FAIMS loop restores the CV setpoint
+void CVscanStop(void)
+{
+  if((CVscanClock != NULL) && CVscanTimer.Active) CVscanClock->stop();
+  TimerRelease(&CVscanTimer);
+  cvscan.Running = false;
+}
+
+//
+// Host commands
+//
+
+void CVlistClear(void)
+{
+  CVlistLength = 0;
+  SendACK;
+}
+
+void CVlistAdd(char *volts)
+{
+  String token;
+  float  v;
+
+  if(CVlist == NULL)
+  {
+    CVlist = new float[CVSmaxList];
+    CVlistCode = new uint16_t[CVSmaxList];
+  }
+  if((CVlist == NULL) || (CVlistCode == NULL)) ERR(ERR_INTERNAL);
+  if(cvscan.Running && (cvscan.Mode == CVSlist)) ERR(ERR_VALUERANGE);
+  if(CVlistLength >= CVSmaxList) ERR(ERR_VALUERANGE);
+  token = volts;
+  v = token.toFloat();
+  if((v < -250) || (v > 250)) BADARG;
+  CVlist[CVlistLength++] = v;
+  SendACK;
+}
+
+void CVlistReport(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  for(int i=0;i<CVlistLength;i++)
+  {
+    if(i > 0) serial->print(",");
+    serial->print(CVlist[i]);
+  }
+  serial->println("");
+}
+
+void CVscanSetTick(int msec)
+{
+  if((msec < 1) || (msec > 1000)) BADARG;
+  CVscanTick = msec;
+  SendACK;
+}
+
+void CVscanSetADC(int chan)
+{
+  if((chan < -1) || (chan > 11)) BADARG;
+  CVscanADCchan = chan;
+  SendACK;
+}
+
+// Reports the per step captures of the last scan, one line per step, step number, CV, ADC counts
+void CVscanReportData(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  for(int i=0;i<cvscan.NumCaptured;i++)
+  {
+    serial->print(i);
+    serial->print(",");
+    serial->print(CVscanCV(i));
+    serial->print(",");
+    serial->println(CVcapture[i]);
+  }
+  serial->println("");
+}
+
+#endif
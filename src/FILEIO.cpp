@@ -16,16 +16,15 @@ uint32_t read32(File f);
 // This function opens a Windows Bitmap (BMP) file and
 // displays it at the given coordinates.  It's sped up
 // by reading many pixels worth of data at a time
-// (rather than pixel by pixel).  Increasing the buffer
-// size takes more of the Arduino's precious RAM but
-// makes loading a little faster.  20 pixels seems a
-// good balance.
+// (rather than pixel by pixel).  The pixels of each
+// buffer are sent to the display in DMA bursts, see
+// DisplayQueue.h.
 
 // MIPS display is 320 x 240 pixels in size.
 // This function requires the bmp file to be 24 bit
 // depth and use no compression.
 
-#define BUFFPIXEL 20
+#define BUFFPIXEL (DSPburstPixels * 2)
 
 // Returns false if any error is detected
 bool bmpDraw(char *filename, uint8_t x, uint8_t y) 
@@ -36,6 +35,8 @@ bool bmpDraw(char *filename, uint8_t x, uint8_t y)
   uint32_t bmpImageoffset;        // Start of image data in file
   uint32_t rowSize;               // Not always = bmpWidth; may have padding
   uint8_t  sdbuffer[3*BUFFPIXEL]; // pixel buffer (R+G+B per pixel)
+  uint16_t colors[BUFFPIXEL];     // Converted pixels waiting to be sent
+  int      ncolors = 0;
   uint8_t  buffidx = sizeof(sdbuffer); // Current position in sdbuffer
   boolean  goodBmp = false;       // Set to true on valid header parse
   boolean  flip    = true;        // BMP is stored bottom-to-top
@@ -112,7 +113,9 @@ bool bmpDraw(char *filename, uint8_t x, uint8_t y)
           { // For each pixel...
             // Time to read more pixel data?
             if (buffidx >= sizeof(sdbuffer)) 
-            { // Indeed
+            { // Indeed, send the converted pixels first, the SD shares the SPI
+              DSPpushColors(colors, ncolors);
+              ncolors = 0;
               bmpFile.read(sdbuffer, sizeof(sdbuffer));
               buffidx = 0; // Set index to beginning
             }
@@ -120,8 +123,10 @@ bool bmpDraw(char *filename, uint8_t x, uint8_t y)
             b = sdbuffer[buffidx++];
             g = sdbuffer[buffidx++];
             r = sdbuffer[buffidx++];
-            tft.pushColor(tft.Color565(r,g,b));
+            colors[ncolors++] = tft.Color565(r,g,b);
           } // end pixel
+          DSPpushColors(colors, ncolors);
+          ncolors = 0;
         } // end scanline
       } // end goodBmp
     }
@@ -30,6 +30,7 @@ void saveFPGA(void);
 void restoreFPGA(void);
 void calADCchan(int chan);
 void calDACreflect(int firstDCBch);
+void reportFPGAstats(void);
 
 //MIPS Threads
 Thread FPGAthread  = Thread();
@@ -39,6 +40,11 @@ FPGAmodule *fpgaM   = NULL;
 FPGAdata   *fpga    = NULL;
 float      *ADCvals = NULL;
 
+FPGAstats  fpgastats;
+uint8_t    FPGAregs[FPGAcacheSize];     // Registers as last written
+bool       FPGAregsValid = false;
+int        FPGAdepth = 0;
+
 const Commands FPGACmdArray[] = {
 // Start of command block
 //
@@ -67,27 +73,24 @@ const Commands FPGACmdArray[] = {
   {"FPGACAL",   CMDfunction,    1, (char *)calADCchan},              // Calibrate ADC channel
   {"FPGACALR",   CMDfunction,   1, (char *)calDACreflect},           // Calibrate ADC to DAC reflector, first DAC channel to use, must 
                                                                      // 1 or 9
+  {"GFPGASTAT", CMDfunction,    0, (char *)reportFPGAstats},         // Report SPI transfers,bytes,cached bytes not written
 // End of table marker
   {0}
 };
 
 CommandList FPGACmdList = {(Commands *)FPGACmdArray, NULL };
 
+// Writes all of the registers, the masks through the DAC array in one block and then the
+// config word.
 void FPGAinit(void)
 {
-  int cfg = 0;
-
   if(fpga == NULL) return;
-  cfg = fpga->cfg;
-  writeFPGAcfg;
-  writeFPGAadcMSK;
-  writeFPGAdacMSK;
-  writem;
-  writeb;
-  writeADC;
-  writeDAC;
-  fpga->cfg = cfg;
-  writeFPGAcfg;
+  FPGAregsValid = false;
+  FPGAbegin();
+  writeFPGA(fpga, STARTadcMSK, FPGAregSize - STARTadcMSK, (uint8_t *)&fpga->ADCmask);
+  writeFPGA(fpga, STARTcfg, 2, (uint8_t *)&fpga->cfg);
+  FPGAend();
+  FPGAregsValid = true;
 }
 
 void readFPGAdacDisplay(void)
@@ -117,13 +120,13 @@ bool writeFPGAarrayElement(FPGA_array array, int index, int val)
       break;
     case FPGA_DAC:
       fpga->dac[index] = val;
-      ptr = (uint8_t *)&fpga->adc[index];
+      ptr = (uint8_t *)&fpga->dac[index];
       break;
     default:
       return false;
       break;
   }
-  writeFPGA(fpga, offset + 2 * index, 2, ptr);
+  writeFPGAcached(fpga, offset + 2 * index, 2, ptr);
   return true;
 }
 
@@ -144,7 +147,7 @@ bool readFPGAarrayElement(FPGA_array array, int index, int *val)
       ptr = (uint8_t *)&fpga->adc[index];
       break;
     case FPGA_DAC:
-      ptr = (uint8_t *)&fpga->adc[index];
+      ptr = (uint8_t *)&fpga->dac[index];
       break;
     default:
       return false;
@@ -155,28 +158,44 @@ bool readFPGAarrayElement(FPGA_array array, int index, int *val)
   return true;
 }
 
-int readADCaverage(int chan, int num)
+// Averages num samples of all 8 ADC channels, each sample reads the ADC array in one block.
+void readADCaverages(int num, int *avg)
 {
-  int val,average=0;
+  int sum[8] = {0,0,0,0,0,0,0,0};
 
   for(int i=0;i<num;i++)
   {
-    readFPGAarrayElement(FPGA_ADC,chan,&val);
-    average += val;
-    delay(5);
+    if(i > 0) delay(FPGAsampleTime);
+    readADC;
+    for(int j=0;j<8;j++) sum[j] += fpga->adc[j];
   }
-  return(average/num);
+  for(int j=0;j<8;j++) avg[j] = sum[j] / num;
 }
 
-void writeFPGA(FPGAdata *fd, int offset, int numBytes, uint8_t *ptr)
+// Starts a group of register accesses, the SPI mode and FPGA address are set once for the
+// group. Groups can be nested.
+void FPGAbegin(void)
 {
-  if(fd == NULL) return;
+  if(FPGAdepth++ > 0) return;
   // Select the board address
   SelectBoard(0);
   // Set SPI mode
   SPI.setDataMode(SPI_CS, SPI_MODE0);
   // Set the address bits
-  SetAddress(fd->boardAdd);
+  SetAddress(fpga->boardAdd);
+}
+
+void FPGAend(void)
+{
+  if(FPGAdepth == 0) return;
+  // Restore mode
+  if(--FPGAdepth == 0) SPI.setDataMode(SPI_CS, SPI_MODE1);
+}
+
+void writeFPGA(FPGAdata *fd, int offset, int numBytes, uint8_t *ptr)
+{
+  if((fd == NULL) || (numBytes <= 0)) return;
+  FPGAbegin();
   // Send the FPGA address
   SPI.transfer(SPI_CS, (uint8_t)(fd->baseAdd + offset) , SPI_CONTINUE);
   // Write the data
@@ -185,19 +204,40 @@ void writeFPGA(FPGAdata *fd, int offset, int numBytes, uint8_t *ptr)
     if(i == (numBytes-1)) SPI.transfer(SPI_CS, ptr[i], SPI_LAST);
     else SPI.transfer(SPI_CS, ptr[i], SPI_CONTINUE);
   }
-  // Restore mode
-  SPI.setDataMode(SPI_CS, SPI_MODE1);
+  FPGAend();
+  fpgastats.Transfers++;
+  fpgastats.Bytes += numBytes;
+  // Update the copy of the written registers
+  for(int i=0;(i<numBytes) && (offset + i < FPGAcacheSize);i++) FPGAregs[offset + i] = ptr[i];
 }
 
-void readFPGA(FPGAdata *fd, int offset, int numBytes, uint8_t *ptr)
+// Writes only the bytes that differ from the last value written, the changed bytes are sent
+// as one block. Registers at and above FPGAcacheSize are always written.
+void writeFPGAcached(FPGAdata *fd, int offset, int numBytes, uint8_t *ptr)
 {
+  int first, last;
+
   if(fd == NULL) return;
-  // Select the board address
-  SelectBoard(0);
-  // Set SPI mode
-  SPI.setDataMode(SPI_CS, SPI_MODE0);
-  // Set the address bits
-  SetAddress(fd->boardAdd);
+  if(!FPGAregsValid || (offset + numBytes > FPGAcacheSize))
+  {
+    writeFPGA(fd, offset, numBytes, ptr);
+    return;
+  }
+  for(first=0;(first<numBytes) && (ptr[first] == FPGAregs[offset + first]);first++);
+  if(first == numBytes)
+  {
+    fpgastats.Cached += numBytes;
+    return;
+  }
+  for(last=numBytes-1;ptr[last] == FPGAregs[offset + last];last--);
+  fpgastats.Cached += numBytes - (last - first + 1);
+  writeFPGA(fd, offset + first, last - first + 1, &ptr[first]);
+}
+
+void readFPGA(FPGAdata *fd, int offset, int numBytes, uint8_t *ptr)
+{
+  if((fd == NULL) || (numBytes <= 0)) return;
+  FPGAbegin();
   // Send the FPGA address
   SPI.transfer(SPI_CS, (uint8_t)(fd->baseAdd + offset) | 0x80, SPI_CONTINUE);
   // Need two dummy reads, not sure why?
@@ -209,8 +249,9 @@ void readFPGA(FPGAdata *fd, int offset, int numBytes, uint8_t *ptr)
     if(i == (numBytes-1)) ptr[i] = SPI.transfer(SPI_CS, 0, SPI_LAST);
     else ptr[i] = SPI.transfer(SPI_CS, 0, SPI_CONTINUE);
   }
-  // Restore mode
-  SPI.setDataMode(SPI_CS, SPI_MODE1);
+  FPGAend();
+  fpgastats.Transfers++;
+  fpgastats.Bytes += numBytes;
 }
 
 // Write the current board parameters to the EEPROM on the FPGA board.
@@ -483,14 +524,18 @@ void reportADC(int chan)
 }
 void calADCchan(int chan)
 {
+  int avg[8];
+
   if((chan<1) || (chan>8)) BADARG;
   chan--;
   // Apply voltage 1 and read the ADC channels raw data
   float val1 = UserInputFloat("Apply voltage 1 and enter value : ", ReadAllSerial);
-  int adc1   = readADCaverage(chan, 10);
+  readADCaverages(10, avg);
+  int adc1   = avg[chan];
   // Apply voltage 2 and read the ADC channels raw data
   float val2 = UserInputFloat("Apply voltage 2 and enter value : ", ReadAllSerial);
-  int adc2   = readADCaverage(chan, 10);
+  readADCaverages(10, avg);
+  int adc2   = avg[chan];
   // Calculate and apply calibration parameters
   fpgaM->adc[chan].m = ((float)adc1 - (float)adc2) / (val1 - val2);
   fpgaM->adc[chan].b = (float)adc1 - fpgaM->adc[chan].m * val1;
@@ -520,9 +565,22 @@ void calDACreflect(int firstDCBch)
     fpga->b[i] = (b + 0.5);
     fpga->b[i] = (int)dac1 - ((int)adc1 * fpga->m[i])/1024;
   }
+  FPGAbegin();
   writem;
   writeb;
+  FPGAend();
 }
 
 void saveFPGA(void) {if(SaveFPGAsettings()) {SendACK;} else BADARG;}
 void restoreFPGA(void) {if(RestoreFPGAsettings()) {SendACK;} else BADARG;}
+
+void reportFPGAstats(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  serial->print(fpgastats.Transfers);
+  serial->print(",");
+  serial->print(fpgastats.Bytes);
+  serial->print(",");
+  serial->println(fpgastats.Cached);
+}
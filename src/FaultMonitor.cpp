@@ -0,0 +1,284 @@
+//
+// FaultMonitor
+//
+// Shared fault trip, restart, and lockout policy with an event log, see FaultMonitor.h.
+// The monitor has no thread, it runs in the module loops through FaultCheck and FaultRestart.
+//
+// Commands:
+//    GFLTLOG                 Report the event log, oldest first
+//    CFLTLOG                 Clear the event log
+//    GFLTSTAT                Report all channels, name,state,trips,restarts used
+//    FLTRESET,name           Clear a trip or lockout
+//    FLTINJ,name             Inject a synthetic fault, the channel trips on its next checks
+//    SFLTDEB,name,count      Set the debounce count
+//    SFLTRTY,name,count      Set the automatic restart count
+//    SFLTDLY,name,msec       Set the restart delay
+//    GFLTPOL,name            Report the policy, debounce,retries,delay,window
+//
+#include "Variants.h"
+#include "FaultMonitor.h"
+
+FaultChannel *FaultChannels[FLTmaxChannels];
+int          NumFaultChannels = 0;
+
+FaultEvent   FaultEvents[FLTmaxEvents];
+int          FaultEventHead  = 0;           // Next event to write
+int          FaultEventCount = 0;
+
+const char   *FaultStateNames[] = {"OK", "TRIPPED", "LOCKED"};
+const char   *FaultEventNames[] = {"TRIP", "LOCKOUT", "RESTART", "RESET"};
+
+const Commands  FaultMonitorCmdArray[] = {
+// Start of command block
+//
+// Fault monitor commands
+//
+  {"GFLTLOG",  CMDfunction, 0, (char *)FaultReportLog},         // Report the fault event log, time,channel,event,value,pre trigger values one per line
+  {"CFLTLOG",  CMDfunction, 0, (char *)FaultClearLog},          // Clear the fault event log
+  {"GFLTSTAT", CMDfunction, 0, (char *)FaultReportStatus},      // Report all fault channels, name,state,trips,restarts used one per line
+  {"FLTRESET", CMDfunctionStr, 1, (char *)FaultHostReset},      // Clear a trip or lockout on a fault channel, name
+  {"FLTINJ",   CMDfunctionStr, 1, (char *)FaultInject},         // Inject a synthetic fault on a fault channel, name. The module trips as it would for a real fault
+  {"SFLTDEB",  CMDfunctionStr, 2, (char *)FaultSetDebounce},    // Set a fault channel debounce count, name,count
+  {"SFLTRTY",  CMDfunctionStr, 2, (char *)FaultSetRetries},     // Set a fault channel automatic restart count, name,count. FAIMS and DCbias
+                                                                // channels follow SFARCR and the DCbias auto reset flag
+  {"SFLTDLY",  CMDfunctionStr, 2, (char *)FaultSetDelay},       // Set a fault channel restart delay in mS, name,delay
+  {"GFLTPOL",  CMDfunctionStr, 1, (char *)FaultReportPolicy},   // Report a fault channel policy, debounce,retries,delay,window
+// End of table marker
+  {0},
+};
+
+CommandList FaultMonitorCmdList = { (Commands *)FaultMonitorCmdArray, NULL };
+
+void FaultMonitor_init(void)
+{
+  AddToCommandList(&FaultMonitorCmdList);
+}
+
+// Adds a channel to the monitor, a channel can be registered more than once.
+void FaultRegister(FaultChannel *fc)
+{
+  for(int i=0;i<NumFaultChannels;i++) if(FaultChannels[i] == fc) return;
+  if(NumFaultChannels >= FLTmaxChannels) return;
+  FaultChannels[NumFaultChannels++] = fc;
+}
+
+void FaultLogEvent(FaultChannel *fc, FaultEventType type, float value)
+{
+  FaultEvent *fe = &FaultEvents[FaultEventHead];
+
+  fe->Time = millis();
+  fe->Channel = fc;
+  fe->Type = type;
+  fe->Value = value;
+  for(int i=0;i<FLTpre;i++) fe->Pre[i] = fc->Pre[(fc->PreIndex + i) % FLTpre];
+  if(++FaultEventHead >= FLTmaxEvents) FaultEventHead = 0;
+  if(FaultEventCount < FLTmaxEvents) FaultEventCount++;
+}
+
+// Called every loop pass by the module. Returns true when the module must trip.
+bool FaultCheck(FaultChannel *fc, bool fault, float value)
+{
+  bool trip = false;
+
+  if(fc->Inject > 0)
+  {
+    fc->Inject--;
+    fault = true;
+  }
+  // Only a monitoring channel counts and logs a trip. A locked channel that the user enables
+  // again still trips so the module turns off, the lockout was already logged.
+  if(fault && (fc->State == FLTlocked))
+  {
+    if(++fc->Count >= fc->Debounce)
+    {
+      fc->Count = 0;
+      trip = true;
+    }
+  }
+  else if(fault && (fc->State == FLTok))
+  {
+    if(++fc->Count >= fc->Debounce)
+    {
+      fc->Count = 0;
+      fc->Trips++;
+      FaultLogEvent(fc, FLTEtrip, value);
+      if(fc->Tries < fc->Retries)
+      {
+        fc->Tries++;
+        fc->State = FLTtripped;
+      }
+      else
+      {
+        fc->State = FLTlocked;
+        FaultLogEvent(fc, FLTElockout, value);
+      }
+      fc->TripTime = millis();
+      trip = true;
+    }
+  }
+  else fc->Count = 0;
+  // Clear the restart count once the window has passed without a trip
+  if((fc->State != FLTtripped) && (fc->Tries > 0 || fc->State == FLTlocked) && ((millis() - fc->TripTime) > fc->RetryWindow))
+  {
+    fc->Tries = 0;
+    fc->State = FLTok;
+  }
+  // Save the value in the pre trigger ring after the event so it holds the values before the trip
+  fc->Pre[fc->PreIndex] = value;
+  if(++fc->PreIndex >= FLTpre) fc->PreIndex = 0;
+  return trip;
+}
+
+// Returns true once when an automatic restart is due.
+bool FaultRestart(FaultChannel *fc)
+{
+  if(fc->State != FLTtripped) return false;
+  if((millis() - fc->TripTime) < fc->RetryDelay) return false;
+  fc->State = FLTok;
+  fc->Count = 0;
+  FaultLogEvent(fc, FLTErestart, 0);
+  LogEvent(LOGCrestart, LOGwarning, LOGMfault, -1, -1, 0, fc->Name);
+  return true;
+}
+
+// Clears a trip or lockout, the module output stays off until the user enables it.
+void FaultReset(FaultChannel *fc)
+{
+  fc->State = FLTok;
+  fc->Count = fc->Tries = fc->Inject = 0;
+  FaultLogEvent(fc, FLTEreset, 0);
+  LogEvent(LOGCreset, LOGwarning, LOGMfault, -1, -1, 0, fc->Name);
+}
+
+// Finds a channel by name, sends NAK and returns NULL if not found.
+FaultChannel *FaultFind(char *name)
+{
+  for(int i=0;i<NumFaultChannels;i++) if(strcmp(FaultChannels[i]->Name, name) == 0) return FaultChannels[i];
+  SetErrorCode(ERR_BADARG);
+  SendNAK;
+  return NULL;
+}
+
+//
+// Host commands
+//
+
+void FaultReportLog(void)
+{
+  FaultEvent *fe;
+  int        i;
+
+  SendACKonly;
+  if(SerialMute) return;
+  i = FaultEventHead - FaultEventCount;
+  if(i < 0) i += FLTmaxEvents;
+  for(int n=0;n<FaultEventCount;n++)
+  {
+    fe = &FaultEvents[i];
+    serial->print(fe->Time);
+    serial->print(",");
+    serial->print(fe->Channel->Name);
+    serial->print(",");
+    serial->print(FaultEventNames[fe->Type]);
+    serial->print(",");
+    serial->print(fe->Value);
+    for(int j=0;j<FLTpre;j++)
+    {
+      serial->print(",");
+      serial->print(fe->Pre[j]);
+    }
+    serial->println("");
+    if(++i >= FLTmaxEvents) i = 0;
+  }
+  serial->println("");
+}
+
+void FaultClearLog(void)
+{
+  FaultEventHead = FaultEventCount = 0;
+  SendACK;
+}
+
+void FaultReportStatus(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  for(int i=0;i<NumFaultChannels;i++)
+  {
+    serial->print(FaultChannels[i]->Name);
+    serial->print(",");
+    serial->print(FaultStateNames[FaultChannels[i]->State]);
+    serial->print(",");
+    serial->print(FaultChannels[i]->Trips);
+    serial->print(",");
+    serial->println(FaultChannels[i]->Tries);
+  }
+  serial->println("");
+}
+
+void FaultHostReset(char *name)
+{
+  FaultChannel *fc;
+
+  if((fc = FaultFind(name)) == NULL) return;
+  FaultReset(fc);
+  SendACK;
+}
+
+void FaultInject(char *name)
+{
+  FaultChannel *fc;
+
+  if((fc = FaultFind(name)) == NULL) return;
+  fc->Inject = fc->Debounce;
+  SendACK;
+}
+
+void FaultSetDebounce(char *name, char *count)
+{
+  FaultChannel *fc;
+  int          i;
+
+  if((fc = FaultFind(name)) == NULL) return;
+  if((sscanf(count, "%d", &i) != 1) || (i < 1) || (i > 100)) BADARG;
+  fc->Debounce = i;
+  SendACK;
+}
+
+void FaultSetRetries(char *name, char *count)
+{
+  FaultChannel *fc;
+  int          i;
+
+  if((fc = FaultFind(name)) == NULL) return;
+  if((sscanf(count, "%d", &i) != 1) || (i < 0) || (i > 10)) BADARG;
+  fc->Retries = i;
+  SendACK;
+}
+
+void FaultSetDelay(char *name, char *msec)
+{
+  FaultChannel *fc;
+  int          i;
+
+  if((fc = FaultFind(name)) == NULL) return;
+  if((sscanf(msec, "%d", &i) != 1) || (i < 0) || (i > 600000)) BADARG;
+  fc->RetryDelay = i;
+  SendACK;
+}
+
+void FaultReportPolicy(char *name)
+{
+  FaultChannel *fc;
+
+  if((fc = FaultFind(name)) == NULL) return;
+  SendACKonly;
+  if(SerialMute) return;
+  serial->print(fc->Debounce);
+  serial->print(",");
+  serial->print(fc->Retries);
+  serial->print(",");
+  serial->print(fc->RetryDelay);
+  serial->print(",");
+  serial->println(fc->RetryWindow);
+}
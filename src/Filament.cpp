@@ -1064,6 +1064,41 @@ void GetFilamentPower(int channel)
   if (!SerialMute) serial->println(Fpowers[b][Channel2Index(channel - 1)]);
 }
 
+// The following functions return the filtered readback values computed by the filament
+// loop without sending any response to the host. They return false if the channel is invalid.
+bool FilamentGetReadbackI(int channel, float *fVal)
+{
+  int b,i;
+
+  if (!IsFilamentChannelValid(channel, false)) return false;
+  if ((b = BoardFromSelectedFilamentChannel(channel-1)) == -1) return false;
+  if ((i = Channel2Index(channel - 1)) == -1) return false;
+  *fVal = Fcurrents[b][i];
+  return true;
+}
+
+bool FilamentGetReadbackV(int channel, float *fVal)
+{
+  int b,i;
+
+  if (!IsFilamentChannelValid(channel, false)) return false;
+  if ((b = BoardFromSelectedFilamentChannel(channel-1)) == -1) return false;
+  if ((i = Channel2Index(channel - 1)) == -1) return false;
+  *fVal = Fvoltages[b][i];
+  return true;
+}
+
+bool FilamentGetReadbackP(int channel, float *fVal)
+{
+  int b,i;
+
+  if (!IsFilamentChannelValid(channel, false)) return false;
+  if ((b = BoardFromSelectedFilamentChannel(channel-1)) == -1) return false;
+  if ((i = Channel2Index(channel - 1)) == -1) return false;
+  *fVal = Fpowers[b][i];
+  return true;
+}
+
 // Returns the current ramp rate in amps per seconds for filament channel number selected
 void GetCurrentRampRate(int channel)
 {
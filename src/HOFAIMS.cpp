@@ -35,6 +35,7 @@ HOFAIMSdata  hofaims;   // This is the display / UI data structure
 // The servo timer runs with a 656,250 Hz and is set to with a terminal
 // count of 32,000 to generate a ~20 Hz rep rate, 
 MIPStimer ServoTMR(TMR_servos); 
+TimerUser ServoTimer = {"SERVO", TMR_servos, TMRPhigh, NULL};
 int ServoCount[2] = {ServoMaxTimerCount - 1000,ServoMaxTimerCount - 1000};
 
 int   HOFAIMSmodule            = 1;
@@ -288,15 +289,19 @@ void HOFAIMS_init(int8_t Board, int8_t addr)
     HOFAIMSthread.setInterval(100);
     // Add threads to the controller
     control.add(&HOFAIMSthread);
-    // Setup the timer and ISR for the servo control
-    ServoTMR.begin();  
-    ServoTMR.setClock(TC_CMR_TCCLKS_TIMER_CLOCK4);
-    ServoTMR.attachInterruptRA(ServoActive);
-    ServoTMR.attachInterrupt(ServoLow);
-    ServoTMR.setRC(ServoMaxTimerCount);
-    ServoTMR.setTIOAeffect(ServoCount[0],TC_CMR_ACPA_TOGGLE | TC_CMR_ACPC_TOGGLE);
-    ServoTMR.enableTrigger();
-    ServoTMR.softwareTrigger();
+    // Setup the timer and ISR for the servo control, the servos run all the time so the
+    // timer is never released
+    if(TimerClaim(&ServoTimer))
+    {
+      ServoTMR.begin();  
+      ServoTMR.setClock(TC_CMR_TCCLKS_TIMER_CLOCK4);
+      ServoTMR.attachInterruptRA(ServoActive);
+      ServoTMR.attachInterrupt(ServoLow);
+      ServoTMR.setRC(ServoMaxTimerCount);
+      ServoTMR.setTIOAeffect(ServoCount[0],TC_CMR_ACPA_TOGGLE | TC_CMR_ACPC_TOGGLE);
+      ServoTMR.enableTrigger();
+      ServoTMR.softwareTrigger();
+    }
   }
   else
   {
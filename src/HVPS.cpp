@@ -48,6 +48,7 @@ void SetHVPSenable(char *chan, char *value);
 void GetHVPSenable(int chan);
 void DAC7678write(uint8_t addr, int data);
 void DAC7678(uint8_t addr, uint8_t chan, uint16_t counts);
+void DAC7678(uint8_t addr, HVPSwrites *w);
 int  HVPSgetBoard(int chan);
 int  HVPSgetCh(int chan);
 void SetHVPSpositive(int chan, int voltage);
@@ -202,6 +203,7 @@ const Commands  HVPSCmdArray[] = {
   {"SHVPSPCAL",CMDfunctionLine, 0, (char *)SetHVPSposCal},      // Sets a positive channel slope and offset DAC parameters
   {"GHVPSNCAL",CMDfunction, 1, (char *)GetHVPSnegCal},          // Reports a negative channel slope and offset DAC parameters
   {"SHVPSNCAL",CMDfunctionLine, 0, (char *)SetHVPSnegCal},      // Sets a negative channel slope and offset DAC parameters
+  {"GHVPSLOOP",CMDfunction, 0, (char *)HVPSreportLoop},         // Report the loop time for each module, module,uS,max uS one per line
  
 // End of table marker
   {0},
@@ -404,6 +406,13 @@ void HVPS_init(int8_t Board, int8_t addr)
   if(Board < 2) *HVPSarray[Board] = HVPS_Rev_1;
   else  *HVPSarray[Board] = HVPS_Rev_2;
   for(i=0;i<8;i++) HVPSrbs[i] = 0;
+  for(i=0;i<2;i++)
+  {
+    HVPSstates[Board]->HVPSCH[i].Enable = false;
+    HVPSstates[Board]->HVPSCH[i].Voltage = 0;
+    HVPSstates[Board]->HVPSCH[i].Phase = HVPSPidle;
+  }
+  HVPSstates[Board]->LoopTime = HVPSstates[Board]->MaxLoop = 0;
   HVPSstates[Board]->Update = true;
   // Set active board to board being inited
   SelectedHVPSboard = Board;
@@ -469,6 +478,33 @@ void DAC7678(uint8_t addr, uint8_t chan, uint16_t counts)
   ReleaseTWI();
 }
 
+// Sends all the queued channel writes in one transfer. The DAC7678 accepts another command
+// and data byte triplet after each one, each write updates its channel when its last byte
+// is received.
+void DAC7678(uint8_t addr, HVPSwrites *w)
+{
+  if(w->Num == 0) return;
+  AcquireTWI();
+  Wire.beginTransmission(addr);
+  for(int i=0;i<w->Num;i++)
+  {
+    Wire.write(w->Chan[i] | 0x30);
+    Wire.write((w->Counts[i]>>8) & 0xFF);
+    Wire.write(w->Counts[i] & 0xFF);
+  }
+  Wire.endTransmission();
+  ReleaseTWI();
+  w->Num = 0;
+}
+
+// Adds a DAC channel write to the module's writes for this pass.
+void HVPSqueue(HVPSwrites *w, DACchan *dc, float value)
+{
+  if(w->Num >= HVPSmaxWrites) return;
+  w->Chan[w->Num] = dc->Chan;
+  w->Counts[w->Num++] = Value2Counts(value, dc);
+}
+
 // HVPSgetBoard returns the board index for a specified HVPS logical channel number by scanning up to four HVPS 
 // data structures and counting their channels until it finds a match. It returns the matching board index or -1 
 // if the requested channel is not present, with the intended channel range being 0 through 7.
@@ -549,128 +585,130 @@ void HVPS_ADC_Control(void)
   }
 }
 
-// HVPS_loop is the 100 ms HVPS service routine that scans up to four module slots, applies channel 
-// enable and voltage changes to the DAC-controlled positive/negative outputs (including polarity-change 
-// handling by disabling and re-enabling the channel), clears each module’s update flag, and refreshes 
-// the HVPS UI when the relevant dialog is active. It then samples each mapped channel’s ADC monitor 
-// input, stores a filtered readback value in HVPSrbs, tracks the maximum absolute readback in MaxHVvoltage, 
-// and does so for all mapped channels even though the code comments indicate that disabled channels should 
-// be forced to zero.
-void HVPS_loop(void)
+// Queues the DAC writes to turn off a channel, the control voltages go to 0 and both the pos
+// and neg switches open.
+void HVPSchannelOff(HVPSchannel *ch, HVPSwrites *w)
 {
-  int   i,j,k;
-  float fVal;
-  
-  MaxHVvoltage = 0;
-  HVPS_ADC_Control();
-  // Loop through all modules and process any enable and setpoint changes
-  for(i=0; i<4; i++)
+  HVPSqueue(w, &ch->DCPctrl, 0);
+  HVPSqueue(w, &ch->DCNctrl, 0);
+  HVPSqueue(w, &ch->DCPena, 0);
+  HVPSqueue(w, &ch->DCNena, 0);
+}
+
+// Processes one channel's enable and setpoint changes and queues its DAC writes. Turning a
+// channel on sets the pos and neg control voltages to 0 and enters the settle phase, the
+// switch for the output polarity is closed and the setpoint applied on the first pass after
+// HVPSsettleMS. A polarity change turns the channel off and lets the enable logic turn it
+// back on with the new polarity.
+void HVPSupdateChannel(HVPSchannel *ch, HVPSchState *st, bool update, HVPSwrites *w)
+{
+  if(update || ((st->Phase == HVPSPidle) && (ch->Enable != st->Enable)))
   {
-    if(HVPSarray[i] != NULL)
+    if(ch->Enable)
     {
-      // Select the board
-      SelectBoard(i & 1);
-      for(j=0; j<HVPSarray[i]->NumChannels; j++)
-      {
-        if((HVPSstates[i]->Update) || (HVPSarray[i]->HVPSCH[j].Enable != HVPSstates[i]->HVPSCH[j].Enable))
-        {
-          //
-          // Process enable changes...
-          //
-          if(HVPSarray[i]->HVPSCH[j].Enable)
-          {
-            // Here to enable this channel, set the voltages for pos and neg to 0 first then enable.
-            // This assumes all switches are off.
-            DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCPctrl.Chan,Value2Counts(0, &HVPSarray[i]->HVPSCH[j].DCPctrl));
-            DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCNctrl.Chan,Value2Counts(0, &HVPSarray[i]->HVPSCH[j].DCNctrl));
-            delay(10);
-            if(HVPSarray[i]->HVPSCH[j].Voltage >= 0)
-            {
-              // Turn on the positive switch
-              DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCPena.Chan,Value2Counts(2.5, &HVPSarray[i]->HVPSCH[j].DCPena));
-              DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCPctrl.Chan,Value2Counts(HVPSarray[i]->HVPSCH[j].Voltage, &HVPSarray[i]->HVPSCH[j].DCPctrl));
-            }
-            else
-            {
-              // Turn on the negative switch
-              DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCNena.Chan,Value2Counts(2.5, &HVPSarray[i]->HVPSCH[j].DCNena));
-              DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCNctrl.Chan,Value2Counts(HVPSarray[i]->HVPSCH[j].Voltage, &HVPSarray[i]->HVPSCH[j].DCNctrl));
-            }
-          }
-          else
-          {
-            // Here to disable this channel, set pos and neg voltages to 0 and disable switches on both 
-            // pos and neg supplies
-            DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCPctrl.Chan,Value2Counts(0, &HVPSarray[i]->HVPSCH[j].DCPctrl));
-            DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCNctrl.Chan,Value2Counts(0, &HVPSarray[i]->HVPSCH[j].DCNctrl));
-            DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCPena.Chan,Value2Counts(0, &HVPSarray[i]->HVPSCH[j].DCPena));
-            DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCNena.Chan,Value2Counts(0, &HVPSarray[i]->HVPSCH[j].DCNena));
-          }
-          HVPSstates[i]->HVPSCH[j].Enable = HVPSarray[i]->HVPSCH[j].Enable;
-        }
-        if((HVPSstates[i]->Update) || (HVPSarray[i]->HVPSCH[j].Voltage != HVPSstates[i]->HVPSCH[j].Voltage))
-        {
-          //
-          // Process voltage changes... 
-          //    - if the polarity changes we need to change the enable switches
-          //    - if the channel is disabled then do nothing
-          //    - if the update flag is set do nothing, it will be handeled by enable code
-          //
-          if(!HVPSstates[i]->Update && HVPSstates[i]->HVPSCH[j].Enable)
-          {
-            if(((HVPSarray[i]->HVPSCH[j].Voltage >= 0) && (HVPSstates[i]->HVPSCH[j].Voltage < 0)) || ((HVPSarray[i]->HVPSCH[j].Voltage < 0) && (HVPSstates[i]->HVPSCH[j].Voltage >= 0)))
-            {
-              // Here with a polarity change so disable everything and let the enable logic re-enable
-              DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCPctrl.Chan,Value2Counts(0, &HVPSarray[i]->HVPSCH[j].DCPctrl));
-              DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCNctrl.Chan,Value2Counts(0, &HVPSarray[i]->HVPSCH[j].DCNctrl));
-              DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCPena.Chan,Value2Counts(0, &HVPSarray[i]->HVPSCH[j].DCPena));
-              DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCNena.Chan,Value2Counts(0, &HVPSarray[i]->HVPSCH[j].DCNena));
-              HVPSstates[i]->HVPSCH[j].Enable = false;
-            }
-            else
-            {
-              // Here for a voltage change only, no polarity change.
-              if(HVPSstates[i]->HVPSCH[j].Voltage >=0)
-              {
-                DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCPctrl.Chan,Value2Counts(HVPSarray[i]->HVPSCH[j].Voltage, &HVPSarray[i]->HVPSCH[j].DCPctrl));
-              }
-              else
-              {
-                DAC7678(HVPSarray[i]->TWIdac,HVPSarray[i]->HVPSCH[j].DCNctrl.Chan,Value2Counts(HVPSarray[i]->HVPSCH[j].Voltage, &HVPSarray[i]->HVPSCH[j].DCNctrl));
-              }
-            }
-            HVPSstates[i]->HVPSCH[j].Voltage = HVPSarray[i]->HVPSCH[j].Voltage;
-          }
-        }
-      }
-      HVPSstates[i]->Update = false;
+      // This assumes all switches are off.
+      HVPSqueue(w, &ch->DCPctrl, 0);
+      HVPSqueue(w, &ch->DCNctrl, 0);
+      st->Phase = HVPSPsettle;
+      st->SettleStart = millis();
+    }
+    else
+    {
+      HVPSchannelOff(ch, w);
+      st->Phase = HVPSPidle;
     }
+    st->Enable = ch->Enable;
+    return;
   }
-  // Read and update all readback values. If a channel is enabled and voltage is >= 0
-  // then use positive channel readback, else negative channel readback. If channel is
-  // disabled then set to 0.
-  for(i=0;i<8;i++)
+  if(st->Phase == HVPSPsettle)
   {
-    j = HVPSgetBoard(i);
-    k = HVPSgetCh(i);
-    if(j < 0) break;
-    if(k < 0) break;
- //   if(HVPSarray[j]->HVPSCH[k].Enable)
+    if(!ch->Enable)
+    {
+      HVPSchannelOff(ch, w);
+      st->Phase = HVPSPidle;
+      st->Enable = false;
+    }
+    else if((millis() - st->SettleStart) >= HVPSsettleMS)
     {
-      SelectBoard(j & 1);
-      if(HVPSarray[j]->HVPSCH[k].Voltage >= 0)
+      if(ch->Voltage >= 0)
       {
-        fVal = Counts2Value(AD7994(HVPSarray[j]->TWIadc,HVPSarray[j]->HVPSCH[k].DCPmon.Chan),&HVPSarray[j]->HVPSCH[k].DCPmon);
-        HVPSrbs[i] = Filter * fVal + (1 - Filter) * HVPSrbs[i];
-        if(abs(HVPSrbs[i]) > MaxHVvoltage) MaxHVvoltage = abs(HVPSrbs[i]);
+        HVPSqueue(w, &ch->DCPena, 2.5);
+        HVPSqueue(w, &ch->DCPctrl, ch->Voltage);
       }
       else
       {
-        fVal = Counts2Value(AD7994(HVPSarray[j]->TWIadc,HVPSarray[j]->HVPSCH[k].DCNmon.Chan),&HVPSarray[j]->HVPSCH[k].DCNmon);
-        HVPSrbs[i] = Filter * fVal + (1 - Filter) * HVPSrbs[i];
-        if(abs(HVPSrbs[i]) > MaxHVvoltage) MaxHVvoltage = abs(HVPSrbs[i]);
+        HVPSqueue(w, &ch->DCNena, 2.5);
+        HVPSqueue(w, &ch->DCNctrl, ch->Voltage);
       }
+      st->Voltage = ch->Voltage;
+      st->Phase = HVPSPidle;
     }
+    return;
+  }
+  if((ch->Voltage == st->Voltage) || !st->Enable) return;
+  if((ch->Voltage >= 0) != (st->Voltage >= 0))
+  {
+    // Polarity change, turn off and let the enable logic turn the channel back on
+    HVPSchannelOff(ch, w);
+    st->Enable = false;
+  }
+  else if(st->Voltage >= 0) HVPSqueue(w, &ch->DCPctrl, ch->Voltage);
+  else HVPSqueue(w, &ch->DCNctrl, ch->Voltage);
+  st->Voltage = ch->Voltage;
+}
+
+// HVPS_loop is the 100 ms HVPS service routine. For each module it processes the channel enable
+// and setpoint changes, sends all of the module's DAC writes in one transfer, then reads the
+// monitor channel for each channel's output polarity with one AD7994 sequence read and filters
+// the readbacks into HVPSrbs. MaxHVvoltage tracks the largest readback. The time for each module
+// is saved for GHVPSLOOP.
+void HVPS_loop(void)
+{
+  int        i,j,ch=0;
+  uint8_t    mask;
+  uint16_t   vals[4];
+  uint32_t   start;
+  float      fVal;
+  HVPSwrites w;
+  ADCchan    *mon;
+  
+  MaxHVvoltage = 0;
+  HVPS_ADC_Control();
+  w.Num = 0;
+  for(i=0; i<4; i++)
+  {
+    if(HVPSarray[i] == NULL) continue;
+    start = micros();
+    // Select the board
+    SelectBoard(i & 1);
+    for(j=0; j<HVPSarray[i]->NumChannels; j++)
+    {
+      HVPSupdateChannel(&HVPSarray[i]->HVPSCH[j], &HVPSstates[i]->HVPSCH[j], HVPSstates[i]->Update, &w);
+    }
+    HVPSstates[i]->Update = false;
+    DAC7678(HVPSarray[i]->TWIdac, &w);
+    // Read the readback values. If the voltage is >= 0 then use positive channel readback,
+    // else negative channel readback.
+    mask = 0;
+    for(j=0; j<HVPSarray[i]->NumChannels; j++)
+    {
+      if(HVPSarray[i]->HVPSCH[j].Voltage >= 0) mask |= 1 << (HVPSarray[i]->HVPSCH[j].DCPmon.Chan & 3);
+      else mask |= 1 << (HVPSarray[i]->HVPSCH[j].DCNmon.Chan & 3);
+    }
+    if(AD7994seq(HVPSarray[i]->TWIadc, mask, vals) == 0)
+    {
+      for(j=0; j<HVPSarray[i]->NumChannels; j++)
+      {
+        if(HVPSarray[i]->HVPSCH[j].Voltage >= 0) mon = &HVPSarray[i]->HVPSCH[j].DCPmon;
+        else mon = &HVPSarray[i]->HVPSCH[j].DCNmon;
+        fVal = Counts2Value(vals[mon->Chan & 3], mon);
+        HVPSrbs[ch+j] = Filter * fVal + (1 - Filter) * HVPSrbs[ch+j];
+        if(abs(HVPSrbs[ch+j]) > MaxHVvoltage) MaxHVvoltage = abs(HVPSrbs[ch+j]);
+      }
+    }
+    ch += HVPSarray[i]->NumChannels;
+    HVPSstates[i]->LoopTime = micros() - start;
+    if(HVPSstates[i]->LoopTime > HVPSstates[i]->MaxLoop) HVPSstates[i]->MaxLoop = HVPSstates[i]->LoopTime;
   }
   // Update the UI
   if (ActiveDialog == &HVPSDialog) RefreshAllDialogEntries(&HVPSDialog);
@@ -739,6 +777,15 @@ void GetHVPSvoltageRB(int chan)
   if(!SerialMute) serial->println((int)HVPSrbs[chan-1]);
 }
 
+// Returns the filtered voltage readback for the channel without sending any response
+// to the host. Returns false if the channel is invalid.
+bool HVPSgetReadback(int chan, float *fVal)
+{
+  if((HVPSgetBoard(chan-1) < 0) || (HVPSgetCh(chan-1) < 0)) return false;
+  *fVal = HVPSrbs[chan-1];
+  return true;
+}
+
 void SetHVPSenable(char *chan, char *value)
 {
   String Token;
@@ -927,4 +974,22 @@ void SetHVPSnegCal(void)
   BADARG;
 }
 
+// Reports the update and readback time of each module, module,uS,max uS one per line, the
+// module is 1 thru 4.
+void HVPSreportLoop(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  for(int i=0;i<4;i++)
+  {
+    if(HVPSarray[i] == NULL) continue;
+    serial->print(i + 1);
+    serial->print(",");
+    serial->print(HVPSstates[i]->LoopTime);
+    serial->print(",");
+    serial->println(HVPSstates[i]->MaxLoop);
+  }
+  serial->println("");
+}
+
 #endif
@@ -54,6 +54,7 @@ DIOops  dioops[8] = {DI0,0,false,false,0,false,0,NULL,
                      };
 
 MIPStimer FreqBurst(TMR_TrigOut);
+TimerUser BurstTimer = {"BURST", TMR_TrigOut, TMRPnormal, NULL};
 
 void FreqBurstISR()
 {
@@ -73,18 +74,25 @@ void FreqBurstISR()
   TriggerOut(PulseWidth,true);
   if(BurstCount < 0) return;
   CurrentCount++;
-  if(CurrentCount >= BurstCount) FreqBurst.stop();
+  if(CurrentCount >= BurstCount)
+  {
+    FreqBurst.stop();
+    TimerRelease(&BurstTimer);
+  }
 }
 
 // This function will generate a burst of clock pulses defined by PulseWidth and PulseFreq
 void GenerateBurst(int num)
 {
-  SendACK;
   if(num == 0)
   {
-    FreqBurst.stop();
+    if(BurstTimer.Active) FreqBurst.stop();
+    TimerRelease(&BurstTimer);
+    SendACK;
     return;
   }
+  if(!TimerClaim(&BurstTimer)) ERR(ERR_TIMERINUSE);
+  SendACK;
   BurstCount = num;
   // Start the real time interrupt
   CurrentCount=0;
@@ -103,6 +111,7 @@ void ProcessBurst(void)
 {
   if(!BurstQueued) return;
   BurstQueued = false;
+  if(!TimerClaim(&BurstTimer)) return;
   CurrentCount=0;
   FreqBurst.attachInterrupt(FreqBurstISR);
   FreqBurst.setFrequency((double)PulseFreq);
@@ -813,12 +822,11 @@ int ReadInput(char inputCH)
 //
 // There seems to be an arduino limit of 32 on the requestFrom function
 // so the data is walked out 32 bytes at a time.
-int ReadEEPROM(void *src, uint16_t dadr, uint16_t address, uint16_t count)
+static int ReadEEPROMbytes(void *src, uint16_t dadr, uint16_t address, uint16_t count)
 {
   byte  *bval;
   int   iStat, i = 0, num;
 
-  AcquireTWI();
   num = count;
   bval = (byte *)src;
 //  delay(10);
@@ -827,35 +835,37 @@ int ReadEEPROM(void *src, uint16_t dadr, uint16_t address, uint16_t count)
     Wire.beginTransmission(dadr | ((address >> 8) & 1));
     Wire.write(address & 0xFF);
     iStat = Wire.endTransmission(true);
-    if (iStat != 0) 
-    {
-      ReleaseTWI();
-      return (iStat);
-    }
+    if (iStat != 0) return (iStat);
     if (num > 32) Wire.requestFrom(dadr | ((address >> 8) & 1), 32);
     else Wire.requestFrom(dadr | ((address >> 8) & 1), num);
     while (Wire.available())
     {
       *(bval++) = Wire.read();
       i++;
-      if (i > count) 
-      {
-        ReleaseTWI();
-        return (-1);
-      }
+      if (i > count) return (-1);
     }
     if (num <= 32) break;
     num -= 32;
     address += 32;
   }
-  if (i != count) 
-  {
-    ReleaseTWI();
-    return (-1);
-  }
+  if (i != count) return (-1);
   return (0);
 }
 
+// Runs the read at the EEPROM's profile clock, see TWIprofile.h
+int ReadEEPROM(void *src, uint16_t dadr, uint16_t address, uint16_t count)
+{
+  TWIprofile *tp;
+  int        iStat;
+
+  AcquireTWI();
+  tp = TWIbegin(0, dadr, TWIcEEPROM);
+  iStat = ReadEEPROMbytes(src, dadr, address, count);
+  TWIfinish(tp, iStat);
+  ReleaseTWI();
+  return (iStat);
+}
+
 // This function is resiged to read from emulated EEPROM in modules such as the
 // DCBswitch. The data read in 32 byte block with the initial byte defining the 
 // address. The address can be extended if the first address byte is 0x80. 0x80
@@ -865,12 +875,11 @@ int ReadEEPROM(void *src, uint16_t dadr, uint16_t address, uint16_t count)
 // dard is the TWI device address.
 // address is the start address in the EEPROM.
 // count is the total number of bytes to read.
-int ReadEEPROMext(void *src, uint16_t dadr, uint16_t address, uint16_t count)
+static int ReadEEPROMextbytes(void *src, uint16_t dadr, uint16_t address, uint16_t count)
 {
   byte  *bval;
   int   iStat, i = 0, num;
 
-  AcquireTWI();
   num = count;
   bval = (byte *)src;
   while (1)
@@ -884,35 +893,36 @@ int ReadEEPROMext(void *src, uint16_t dadr, uint16_t address, uint16_t count)
       Wire.write(address >> 8);
     }
     iStat = Wire.endTransmission(true);
-    if (iStat != 0) 
-    {
-      ReleaseTWI();
-      return (iStat);
-    }
+    if (iStat != 0) return (iStat);
     if (num > 32) Wire.requestFrom(dadr, 32);
     else Wire.requestFrom(dadr, num);
     while (Wire.available())
     {
       *(bval++) = Wire.read();
       i++;
-      if (i > count) 
-      {
-        ReleaseTWI();
-        return (-1);
-      }
+      if (i > count) return (-1);
     }
     if (num <= 32) break;
     num -= 32;
     address += 32;
   }
-  if (i != count) 
-  {
-    ReleaseTWI();
-    return (-1);
-  }
+  if (i != count) return (-1);
   return (0);
 }
 
+int ReadEEPROMext(void *src, uint16_t dadr, uint16_t address, uint16_t count)
+{
+  TWIprofile *tp;
+  int        iStat;
+
+  AcquireTWI();
+  tp = TWIbegin(0, dadr, TWIcSmart);
+  iStat = ReadEEPROMextbytes(src, dadr, address, count);
+  TWIfinish(tp, iStat);
+  ReleaseTWI();
+  return (iStat);
+}
+
 
 // src points to buffer used to hold the data.
 // dard is the TWI device address.
@@ -920,12 +930,11 @@ int ReadEEPROMext(void *src, uint16_t dadr, uint16_t address, uint16_t count)
 // count is the total number of bytes to write.
 //
 // Returns 0 if no errors are detected.
-int WriteEEPROM(void *src, uint16_t dadr, uint16_t address, uint16_t count)
+static int WriteEEPROMbytes(void *src, uint16_t dadr, uint16_t address, uint16_t count)
 {
   byte  *bval;
   int   iStat, i = 0, num;
 
-  AcquireTWI();
   num = count;
   bval = (byte *)src;
   delay(10);
@@ -941,43 +950,42 @@ int WriteEEPROM(void *src, uint16_t dadr, uint16_t address, uint16_t count)
       i++;
     }
     iStat = Wire.endTransmission(true);
-    if (iStat != 0) 
-    {
-      ReleaseTWI();
-      return (iStat);
-    }
+    if (iStat != 0) return (iStat);
     // wait for it to finish writting 16 bytes or timeout
     for (int k = 0; k < 21; k++)
     {
       Wire.beginTransmission(dadr); 
       Wire.write(0);
       if (Wire.endTransmission(true) == 0) break;
-      if (k == 20)
-      {
-        ReleaseTWI();
-        return (-1); // Timeout!
-      }
+      if (k == 20) return (-1); // Timeout!
     }
     // Setup for the next loop
     if (num <= 16) break;
     num -= 16;
     address += 16;
   }
-  if (i != count) 
-  {
-    ReleaseTWI();
-    return (-1);
-  }
-  ReleaseTWI();
+  if (i != count) return (-1);
   return (0);
 }
 
-int WriteEEPROMext(void *src, uint16_t dadr, uint16_t address, uint16_t count)
+int WriteEEPROM(void *src, uint16_t dadr, uint16_t address, uint16_t count)
+{
+  TWIprofile *tp;
+  int        iStat;
+
+  AcquireTWI();
+  tp = TWIbegin(0, dadr, TWIcEEPROM);
+  iStat = WriteEEPROMbytes(src, dadr, address, count);
+  TWIfinish(tp, iStat);
+  ReleaseTWI();
+  return (iStat);
+}
+
+static int WriteEEPROMextbytes(void *src, uint16_t dadr, uint16_t address, uint16_t count)
 {
   byte  *bval;
   int   iStat, i = 0, num;
 
-  AcquireTWI();
   num = count;
   bval = (byte *)src;
   delay(10);
@@ -999,37 +1007,37 @@ int WriteEEPROMext(void *src, uint16_t dadr, uint16_t address, uint16_t count)
       i++;
     }
     iStat = Wire.endTransmission(true);
-    if (iStat != 0) 
-    {
-      ReleaseTWI();
-      return (iStat);
-    }
+    if (iStat != 0) return (iStat);
     // wait for it to finish writting 16 bytes or timeout
     for (int k = 0; k < 21; k++)
     {
       Wire.beginTransmission(dadr); 
       Wire.write(0);
       if (Wire.endTransmission(true) == 0) break;
-      if (k == 20)
-      {
-        ReleaseTWI();
-        return (-1); // Timeout!
-      }
+      if (k == 20) return (-1); // Timeout!
     }
     // Setup for the next loop
     if (num <= 16) break;
     num -= 16;
     address += 16;
   }
-  if (i != count) 
-  {
-    ReleaseTWI();
-    return (-1);
-  }
-  ReleaseTWI();
+  if (i != count) return (-1);
   return (0);
 }
 
+int WriteEEPROMext(void *src, uint16_t dadr, uint16_t address, uint16_t count)
+{
+  TWIprofile *tp;
+  int        iStat;
+
+  AcquireTWI();
+  tp = TWIbegin(0, dadr, TWIcSmart);
+  iStat = WriteEEPROMextbytes(src, dadr, address, count);
+  TWIfinish(tp, iStat);
+  ReleaseTWI();
+  return (iStat);
+}
+
 // The following routines support the Analog Devices DAC and ADC used to monitor and
 // control voltages in the MIPS system.
 
@@ -1109,9 +1117,11 @@ int AD7994(int8_t adr, uint16_t *vals)
 
 int AD7994_b(int8_t adr, int8_t chan)
 {
+  TWIprofile   *tp;
   unsigned int val;
   
   AcquireTWI();
+  tp = TWIbegin(0, adr, TWIcADC);
   chan++;
   if (chan == 3) chan = 4;
   else if (chan == 4) chan = 8;
@@ -1122,6 +1132,7 @@ int AD7994_b(int8_t adr, int8_t chan)
   {
     TWIerror();
     TWIfails++;
+    TWIfinish(tp, -1);
     ReleaseTWI();
     return(-1);
   }
@@ -1138,6 +1149,7 @@ int AD7994_b(int8_t adr, int8_t chan)
  //   ReleaseTWI();
  //   return(-1);
  // }
+  TWIfinish(tp, 0);
   ReleaseTWI();
   return(val);
 }
@@ -1172,6 +1184,58 @@ int AD7994(int8_t adr, int8_t chan)
   return(-1); 
 }
 
+// Reads the AD7994 channels selected by mask, bit 0 = channel 0 thru bit 3 = channel 3, in
+// one transfer. Setting more than one channel bit in the command byte makes the ADC convert
+// the selected channels in sequence, lowest first, the 2 byte results are read back in the
+// same order and carry the channel ID in bits 12 and 13. Results are saved in vals by channel.
+// Returns 0 if no errors.
+int AD7994seq(int8_t adr, uint8_t mask, uint16_t *vals)
+{
+  uint8_t  buf[8];
+  int      i, n = 0;
+
+  for(i = 0; i < 4; i++) if(mask & (1 << i)) n++;
+  if(n == 0) return(0);
+  AcquireTWI();
+  if(MIPSconfigData.TWIhardware)
+  {
+    Wire.beginTransmission(adr);
+    Wire.write((mask & 0x0F) << 4);
+    if((Wire.endTransmission(false) != 0) || (Wire.requestFrom(adr, n * 2) != n * 2))
+    {
+      TWIerror();
+      TWIfails++;
+      ReleaseTWI();
+      return(-1);
+    }
+    for(i = 0; i < n * 2; i++) buf[i] = Wire.read();
+  }
+  else
+  {
+    i = 0;
+    while(1)
+    {
+      TWI_START();
+      if (TWI_WRITE(adr << 1) == false) break;
+      if (TWI_WRITE((mask & 0x0F) << 4) == false) break;
+      TWI_START();
+      if (TWI_WRITE((adr << 1) + 1) == false) break;
+      for(i = 0; i < n * 2; i++) buf[i] = TWI_READ(i == (n * 2 - 1) ? HIGH : LOW);
+      TWI_STOP();
+      break;
+    }
+    Wire.begin();  // Release control of clock and data lines
+    if(i != n * 2)
+    {
+      ReleaseTWI();
+      return(-1);
+    }
+  }
+  ReleaseTWI();
+  for(i = 0; i < n; i++) vals[(buf[i * 2] >> 4) & 3] = ((((buf[i * 2] << 8) | buf[i * 2 + 1]) & 0xFFF) << 4);
+  return(0);
+}
+
 // This function reads one channel from the AD7998 ADC
 // March 26, 2019
 // This function needs to be rewitten. Basicalliy it needs to
@@ -1181,10 +1245,12 @@ int AD7994(int8_t adr, int8_t chan)
 //   val |= (Wire.read()) & 0xFF;
 int AD7998_b (int8_t adr, int8_t chan)
 {
+  TWIprofile   *tp;
   unsigned int val;
   int          i;
   
   AcquireTWI();
+  tp = TWIbegin(0, adr, TWIcADC);
   while(true)
   {
     Wire.beginTransmission(adr);
@@ -1204,10 +1270,12 @@ int AD7998_b (int8_t adr, int8_t chan)
     if((val & 0x7000) != (unsigned int)(chan<<12)) break;
     val &= 0xFFF;
     val <<= 4;
+    TWIfinish(tp, 0);
     ReleaseTWI();
     return(val);
   }
   TWIerror();
+  TWIfinish(tp, -1);
   ReleaseTWI();
   return -1;
 }
@@ -1296,9 +1364,11 @@ int ADS7828(TwoWire *wire, int8_t adr, int8_t chan)
 
 int ADS7828(int8_t adr, int8_t chan)
 {
-  int val;
+  TWIprofile *tp;
+  int        val;
 
   AcquireTWI();
+  tp = TWIbegin(0, adr, TWIcADC);
   //AtomicBlock< Atomic_RestoreState > a_Block;
   Wire.beginTransmission(adr);
   Wire.write(0x8C | ((chan & 0x06)) << 3 | ((chan & 0x01) << 6));
@@ -1306,6 +1376,7 @@ int ADS7828(int8_t adr, int8_t chan)
   {
     TWIerror();
     TWIfails++;
+    TWIfinish(tp, -1);
     ReleaseTWI();
     return(-1);
   }
@@ -1318,6 +1389,7 @@ int ADS7828(int8_t adr, int8_t chan)
       val |= (Wire.read()) & 0xFF;
       val &= 0xFFF;
       val <<= 4;
+      TWIfinish(tp, 0);
       ReleaseTWI();
       return(val);
     }
@@ -1326,6 +1398,7 @@ int ADS7828(int8_t adr, int8_t chan)
   // Timeout waiting for data from device
   TWIerror();
   TWIfails++;
+  TWIfinish(tp, -1);
   ReleaseTWI();
   return(-1);
 }
@@ -1341,14 +1414,17 @@ int ADS7828(int8_t adr, int8_t chan)
 //    vvvv = value
 int AD5629write(uint8_t addr, uint32_t val)
 {
-  int iStat;
+  TWIprofile *tp;
+  int        iStat;
 
   AcquireTWI();
+  tp = TWIbegin(0, addr, TWIcDAC);
   Wire.beginTransmission(addr);
   Wire.write((val>>16) & 0xFF);
   Wire.write((val>>8) & 0xFF);
   Wire.write(val & 0xFF);
   iStat = Wire.endTransmission();
+  TWIfinish(tp, iStat);
   ReleaseTWI();
   return (iStat);
 }
@@ -1361,9 +1437,11 @@ int AD5629write(uint8_t addr, uint32_t val)
 // Return 0 if no error else an error code is returned
 int AD5593write(uint8_t addr, uint8_t pb, uint16_t val)
 {
-  int iStat;
+  TWIprofile *tp;
+  int        iStat;
   
   AcquireTWI();
+  tp = TWIbegin(0, addr, TWIcDAC);
   Wire.beginTransmission(addr);
   Wire.write(pb);
   Wire.write((val >> 8) & 0xFF);
@@ -1372,6 +1450,7 @@ int AD5593write(uint8_t addr, uint8_t pb, uint16_t val)
     //AtomicBlock< Atomic_RestoreState > a_Block;
     iStat = Wire.endTransmission();
   }
+  TWIfinish(tp, iStat);
   ReleaseTWI();
   return (iStat);
 }
@@ -1380,9 +1459,11 @@ int AD5593write(uint8_t addr, uint8_t pb, uint16_t val)
 // returns -1 on any error
 int AD5593readWord(uint8_t addr, uint8_t pb)
 {
-  int iStat;
+  TWIprofile *tp;
+  int        iStat;
   
   AcquireTWI();
+  tp = TWIbegin(0, addr, TWIcDAC);
   Wire.beginTransmission(addr);
   Wire.write(pb);
   {
@@ -1391,6 +1472,7 @@ int AD5593readWord(uint8_t addr, uint8_t pb)
   }
   if(iStat != 0)
   {
+    TWIfinish(tp, iStat);
     ReleaseTWI();
     return (-1);
   }
@@ -1405,6 +1487,7 @@ int AD5593readWord(uint8_t addr, uint8_t pb)
 //  }
   j = Wire.read() << 8;
   j |= Wire.read();
+  TWIfinish(tp, 0);
   ReleaseTWI();
   return(j);
 }
@@ -1453,8 +1536,10 @@ int AD5593writeDAC(int8_t addr, int8_t chan, int val)
 // Return 0 if no error else an error code is returned
 int AD5593writeWire1(uint8_t addr, uint8_t pb, uint16_t val)
 {
-  int iStat;
+  TWIprofile *tp;
+  int        iStat;
   
+  tp = TWIbegin(1, addr, TWIcDAC);
   Wire1.beginTransmission(addr);
   Wire1.write(pb);
   Wire1.write((val >> 8) & 0xFF);
@@ -1463,6 +1548,7 @@ int AD5593writeWire1(uint8_t addr, uint8_t pb, uint16_t val)
     AtomicBlock< Atomic_RestoreState > a_Block;
     iStat = Wire1.endTransmission();
   }
+  TWIfinish(tp, iStat);
   return (iStat);
 }
 
@@ -1470,14 +1556,17 @@ int AD5593writeWire1(uint8_t addr, uint8_t pb, uint16_t val)
 // returns -1 on any error
 int AD5593readWordWire1(uint8_t addr, uint8_t pb)
 {
-  int iStat;
+  TWIprofile *tp;
+  int        iStat;
 
+  tp = TWIbegin(1, addr, TWIcDAC);
   Wire1.beginTransmission(addr);
   Wire1.write(pb);
   {
     AtomicBlock< Atomic_RestoreState > a_Block;
     iStat = Wire1.endTransmission();
   }
+  TWIfinish(tp, iStat);
   if(iStat != 0) return (-1);
   // Now read the data word
   int j = 0;
@@ -1576,9 +1665,11 @@ int AD5625(int8_t adr, uint8_t chan, uint16_t val)
 
 int AD5625(int8_t adr, uint8_t chan, uint16_t val,int8_t Cmd)
 {
-  int iStat;
+  TWIprofile *tp;
+  int        iStat;
 
   AcquireTWI();
+  tp = TWIbegin(0, adr, TWIcDAC);
 //  interrupts();
   Wire.beginTransmission(adr);
   Wire.write((Cmd << 3) | chan);
@@ -1594,6 +1685,7 @@ int AD5625(int8_t adr, uint8_t chan, uint16_t val,int8_t Cmd)
        TWIfails++;
     }
   }
+  TWIfinish(tp, iStat);
   ReleaseTWI();
   return (iStat);
 }
@@ -1602,14 +1694,17 @@ int AD5625(int8_t adr, uint8_t chan, uint16_t val,int8_t Cmd)
 // AD5625
 int AD5625_EnableRef(int8_t adr)
 {
-  int iStat;
+  TWIprofile *tp;
+  int        iStat;
 
   AcquireTWI();
+  tp = TWIbegin(0, adr, TWIcDAC);
   Wire.beginTransmission(adr);
   Wire.write(0x38);
   Wire.write(0);
   Wire.write(1);
   iStat = Wire.endTransmission();
+  TWIfinish(tp, iStat);
   ReleaseTWI();
   return (iStat);
 }
@@ -1812,6 +1907,7 @@ void MCP4725(uint8_t addr, uint8_t cmd, uint16_t value)
 //
 DIhandler *DIdelayedTrigger = NULL;
 MIPStimer *DelayTriggerTMR = NULL;
+TimerUser DelayTriggerTimer = {"DTRIG", TMR_DelayedTrigger, TMRPnormal, NULL};
 void  (*DelayedTrigFunction)() = NULL;
 char DtrigInput[3] = "NA";
 char DtrigLevel[5] = "NA";
@@ -1831,6 +1927,19 @@ void DelayedTriggerTMR_ISR(void)
   DelayTriggerTMR->setRC((DtrigPeriod * 105)/10);
 }
 
+// Sets up the timer after each claim, timer 0 is shared with the pulse train so the
+// callbacks and RA are set every time
+void DelayTrigTimerSetup(void)
+{
+  if(DelayTriggerTMR == NULL) DelayTriggerTMR = new MIPStimer(TMR_DelayedTrigger);
+  DelayTriggerTMR->detachInterrupt();
+  DelayTriggerTMR->begin();
+  DelayTriggerTMR->attachInterrupt(DelayedTriggerTMR_ISR);
+  DelayTriggerTMR->setRA(0);
+  DelayTriggerTMR->setTrigger(TC_CMR_EEVTEDG_NONE);
+  DelayTriggerTMR->setClock(TC_CMR_TCCLKS_TIMER_CLOCK2);   // 10.5 MHz clock
+}
+
 // This function is called as a result of the hardware trigger and calls the trigger function and processes any 
 // timer needs
 void DelayedTriggerISR(void)
@@ -1884,17 +1993,10 @@ void SetDelayTrigInput(char *input, char *level)
        return;
      }
   }
-  // Allocate handler and timer if null
-  if(DelayTriggerTMR == NULL)
-  {
-    DelayTriggerTMR = new MIPStimer(TMR_DelayedTrigger);
-    DelayTriggerTMR->begin();
-    DelayTriggerTMR->attachInterrupt(DelayedTriggerTMR_ISR);
-    DelayTriggerTMR->setTrigger(TC_CMR_EEVTEDG_NONE);
-    DelayTriggerTMR->setClock(TC_CMR_TCCLKS_TIMER_CLOCK2);   // 10.5 MHz clock
-  }
-  DelayTriggerTMR->stop();
+  // Stop any current trigger, the timer is claimed again when the trigger is enabled
   DtrigEnable = false;
+  if(DelayTriggerTimer.Active) DelayTriggerTMR->stop();
+  TimerRelease(&DelayTriggerTimer);
   if(input[0] == 't')
   {
     // Queue trigger function to start the delay
@@ -1904,7 +2006,7 @@ void SetDelayTrigInput(char *input, char *level)
   {
      QueueTpulseFunction(DelayedTriggerISR,false);
      if(DIdelayedTrigger == NULL) DIdelayedTrigger = new DIhandler;
-     if((DelayTriggerTMR == NULL) || (DIdelayedTrigger == NULL))
+     if(DIdelayedTrigger == NULL)
      {
        SetErrorCode(ERR_INTERNAL);
        SendNAK;  
@@ -1928,13 +2030,16 @@ void SetDelayTrigEnable(char *sena)
   if(Sena == "FALSE")
   {
     DtrigEnable = false;
-    DelayTriggerTMR->stop();
+    if(DelayTriggerTimer.Active) DelayTriggerTMR->stop();
+    TimerRelease(&DelayTriggerTimer);
     SendACK;
     return;
   }
   else if(Sena == "TRUE")
   {
     // Here with enable request
+    if(!TimerClaim(&DelayTriggerTimer)) ERR(ERR_TIMERINUSE);
+    DelayTrigTimerSetup();
     DtrigEnable = true;
     SendACK;
     return;    
@@ -2007,6 +2112,7 @@ void (*DMAisr)() = NULL;
 void DMAC_Handler(void)
 {
    if(DMAisr != NULL) DMAisr();
+   else (void)DMAC->DMAC_EBCISR;
 }
 
 // The function sends a buffer to the SPI interface. The transfers are 32 bit
@@ -2047,6 +2153,7 @@ void spiDmaTX(uint32_t* src, uint16_t count,void (*isr)())
       NVIC_ClearPendingIRQ(DMAC_IRQn);
       NVIC_EnableIRQ(DMAC_IRQn);
   }
+  else DMAC->DMAC_EBCIDR = 1 << (SPI_DMAC_TX_CH);
 
   dmac_channel_enable(SPI_DMAC_TX_CH);
 }
@@ -1,11 +1,26 @@
 #include <Arduino.h>
+#include "SD.h"
 #include "Variants.h"
 #include "Log.h"
+#include "AtomicBlock.h"
 
 extern DialogBox MIPSconfig;
+extern bool SDcardPresent;
+extern volatile bool TableReady;
+#if FAIMSFBcode
+extern TimerUser FAIMSfbScanTimer;
+#endif
+#if DMSDMSMB
+extern TimerUser DMSDMSScanTimer;
+#endif
 
 LogData logdata;
 
+// Cached RTC anchor, unix time minus the uptime seconds
+int32_t  LogOffset = 0;
+bool     LogAnchored = false;
+uint32_t LogAnchorMillis = 0;
+
 DialogBoxEntry MIPSlogEntries[] = {
   {"   Return to main menu  ", 0, 11, D_DIALOG, 0, 0, 0, 0, false, NULL, &MIPSconfig, NULL, NULL},
   {NULL},
@@ -32,31 +47,160 @@ void DisplayLog(void)
   }
 }
 
-void LogMessage(char const *mess)
+// Returns the uptime in microseconds, extends micros() to 64 bits. Must be called at least
+// once every 71 minutes, Log_loop does this.
+uint64_t LogUptime(void)
 {
-  uint8_t day,month,hour,minute,second,week;
+  static uint32_t last = 0;
+  static uint32_t high = 0;
+  uint32_t now = micros();
+
+  if(now < last) high++;
+  last = now;
+  return(((uint64_t)high << 32) | now);
+}
+
+// Reads the RTC and updates the anchor. The anchor is only moved if it is off by more than
+// a second, this keeps the time stamps monotonic unless the RTC is set.
+void LogAnchorRTC(void)
+{
+  uint8_t  day,month,hour,minute,second,week;
   uint16_t year;
-  bool isPM,is12H;
+  bool     isPM,is12H;
+  int32_t  offset;
 
   rtc.read(day, month, year, hour, minute, second, isPM, is12H, week);
-  if(!logdata.enabled) return;
-  if(logdata.count >= MAXLOG) LogGetMessage(NULL,NULL);
   DateTime now = DateTime(year,month,day,hour,minute,second);
-  logdata.LogTime[logdata.tail] = now.unixtime();
-  logdata.Mess[logdata.tail++] = mess;
-  if(logdata.tail >= MAXLOG) logdata.tail = 0;
-  logdata.count++;
+  offset = now.unixtime() - (uint32_t)(LogUptime() / 1000000);
+  if(!LogAnchored || (abs(offset - LogOffset) > 1)) LogOffset = offset;
+  LogAnchored = true;
+  LogAnchorMillis = millis();
+}
+
+// Returns the sequence number of the oldest record in the ring
+uint32_t LogFirst(void)
+{
+  if(logdata.Next > (logdata.Cleared + LOGsize)) return(logdata.Next - LOGsize);
+  return logdata.Cleared;
+}
+
+// Prints a record as a CSV line, seq,seconds,usec,severity,code,module,board,chan,value,message.
+// rec is a copy of the record or NULL to print the record in the ring.
+void LogPrintRecord(Print *p, uint32_t seq, LogRecord *rec)
+{
+  if(rec == NULL) rec = &logdata.Rec[seq % LOGsize];
+
+  p->print(seq);
+  p->print(",");
+  p->print(rec->Seconds);
+  p->print(",");
+  p->print(rec->Usec);
+  p->print(",");
+  p->print(rec->Severity);
+  p->print(",");
+  p->print(rec->Code);
+  p->print(",");
+  p->print(rec->Module);
+  p->print(",");
+  p->print(rec->Board);
+  p->print(",");
+  p->print(rec->Chan);
+  p->print(",");
+  p->print(rec->Value);
+  p->print(",");
+  p->println(rec->Mess);
+}
+
+// Returns true while a table or scan is running, the SD card is not written in these modes
+bool LogTimingCritical(void)
+{
+  if(TableReady) return true;
+#if FAIMScode
+  if(cvscan.Running) return true;
+#endif
+#if FAIMSFBcode
+  if(FAIMSfbScanTimer.Active) return true;
+#endif
+#if DMSDMSMB
+  if(DMSDMSScanTimer.Active) return true;
+#endif
+  return false;
+}
+
+// Appends the records not yet written to the SD card. Records that were overwritten before
+// they could be written are skipped, the sequence numbers in the file show the gap. The
+// records are copied with interrupts off and written to the card with interrupts on.
+void LogSpill(void)
+{
+  File      file;
+  LogRecord rec[LOGspillMax];
+  uint32_t  seq, n = 0;
+
+  if(!logdata.Spill || !SDcardPresent || LogTimingCritical()) return;
+  {
+    AtomicBlock< Atomic_RestoreState > a_Block;
+    if(logdata.Spilled < LogFirst()) logdata.Spilled = LogFirst();
+    seq = logdata.Spilled;
+    for(;(n<LOGspillMax) && (logdata.Spilled < logdata.Next);n++) rec[n] = logdata.Rec[logdata.Spilled++ % LOGsize];
+  }
+  if(n == 0) return;
+  SD.begin(_sdcs);
+  if(!(file=SD.open(LOGspillFile,FILE_WRITE)))
+  {
+    logdata.Spill = false;
+    return;
+  }
+  for(uint32_t i=0;i<n;i++) LogPrintRecord(&file, seq + i, &rec[i]);
+  file.close();
+}
+
+// Called from the system loop. Keeps the uptime counter current and once per second
+// updates the RTC anchor and spills new records.
+void Log_loop(void)
+{
+  LogUptime();
+  if(LogAnchored && ((millis() - LogAnchorMillis) < 1000)) return;
+  LogAnchorRTC();
+  LogSpill();
 }
 
+// Saves an event in the log. The message must be a constant string, only its pointer is saved.
+void LogEvent(LogCode code, LogSeverity severity, LogModule module, int board, int chan, float value, char const *mess)
+{
+  LogRecord *rec;
+  uint64_t  us;
+
+  if(!logdata.enabled || (severity < logdata.Level)) return;
+  if(!LogAnchored) LogAnchorRTC();
+  us = LogUptime();
+  rec = &logdata.Rec[logdata.Next % LOGsize];
+  rec->Seconds  = LogOffset + (uint32_t)(us / 1000000);
+  rec->Usec     = us % 1000000;
+  rec->Code     = code;
+  rec->Severity = severity;
+  rec->Module   = module;
+  rec->Board    = board;
+  rec->Chan     = chan;
+  rec->Value    = value;
+  rec->Mess     = mess;
+  logdata.Next++;
+}
+
+void LogMessage(char const *mess)
+{
+  LogEvent(LOGCmessage, LOGinfo, LOGMsystem, -1, -1, 0, mess);
+}
+
+// Returns the oldest record not yet read by this function, used by the display and LOGREP.
 bool LogGetMessage(uint32_t *logTime, char **mess)
 {
-  if(logdata.count == 0) return false;
-  if(logTime != NULL) *logTime = logdata.LogTime[logdata.head];
-  if(mess != NULL) *mess = (char *)logdata.Mess[logdata.head];
-  *mess = (char *)logdata.Mess[logdata.head];
-  logdata.head++;
-  if(logdata.head >= MAXLOG) logdata.head = 0;
-  logdata.count--;
+  LogRecord *rec;
+
+  if(logdata.Read < LogFirst()) logdata.Read = LogFirst();
+  if(logdata.Read >= logdata.Next) return false;
+  rec = &logdata.Rec[logdata.Read++ % LOGsize];
+  if(logTime != NULL) *logTime = rec->Seconds;
+  if(mess != NULL) *mess = (char *)rec->Mess;
   return true;
 }
 
@@ -74,3 +218,41 @@ void ReportLogEntry(void)
   }
   serial->println("");
 }
+
+// Reports up to count records starting at sequence number first, one record per line.
+// If first has been overwritten the report starts at the oldest record.
+void ReportLogPage(int first, int count)
+{
+  uint32_t seq;
+
+  if((first < 0) || (count < 1) || (count > LOGsize)) BADARG;
+  SendACKonly;
+  if(SerialMute) return;
+  seq = first;
+  if(seq < LogFirst()) seq = LogFirst();
+  for(;(count > 0) && (seq < logdata.Next);count--) LogPrintRecord(serial, seq++, NULL);
+  serial->println("");
+}
+
+// Reports the sequence numbers of the oldest record and the next record, first,next
+void ReportLogSequence(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  serial->print(LogFirst());
+  serial->print(",");
+  serial->println(logdata.Next);
+}
+
+void ClearLog(void)
+{
+  logdata.Cleared = logdata.Read = logdata.Spilled = logdata.Next;
+  SendACK;
+}
+
+void SetLogLevel(int level)
+{
+  if((level < LOGinfo) || (level > LOGfault)) BADARG;
+  logdata.Level = level;
+  SendACK;
+}
@@ -968,6 +968,7 @@ void setup()
   tft.setTextColor(ILI9340_WHITE, ILI9340_BLACK);
   tft.setTextSize(1);
   tft.println("Initializing....");
+  BootMark("DISPLAY");
 
   SerialInit();
   delay(250);
@@ -998,6 +999,7 @@ void setup()
   }
   LOADparms("default.cfg");   // Load the defaults if the file is present
   SPI.setClockDivider(11);    // If SD card init fails it will slow down the SPI interface
+  BootMark("SDCONFIG");
   SetBackLight();
   DisplayIntensity();
   MIPSsystemLoop();
@@ -1007,6 +1009,7 @@ void setup()
     tft.disableDisplay(DisableDisplay);
   }
   else MIPSconfigData.BootImage[0] = 0;
+  BootMark("BOOTIMAGE");
   // Setup the hardware pin directions. Note setting pinMode to output
   // will drive the output pin high.
   Init_IOpins();
@@ -1030,7 +1033,9 @@ void setup()
   //  Timer3.attachInterrupt(RealTimeISR);
   //  Timer3.start(100000); // Calls every 100ms
   // Initial splash screen
+  BootMark("IO");
   Signon();
+  BootMark("SIGNON");
   ButtonPressed = false;
   ButtonRotated = false;
   // Set ActiveDialog to not NULL, this will stop any module from displaying.
@@ -1038,7 +1043,19 @@ void setup()
   if(MIPSconfigData.StartupDelay == 0) ActiveDialog = (DialogBox *)(-1);
   // Init the baords
   ScanHardware();
+  BootMark("SCAN");
   DIO_init();
+  Telemetry_init();
+  FaultMonitor_init();
+  MacroEngine_init();
+  TimerManager_init();
+  DIcapture_init();
+  PulseTrain_init();
+  MemPool_init();
+  BootProfile_init();
+  DisplayQueue_init();
+  TWIprofile_init();
+  BootMark("SYSTEM");
   if(ActiveDialog == (DialogBox *)(-1)) MenuDisplay(&MainMenu);
   // Configure Threads
   MIPSsystemThread.setName("System");
@@ -1056,6 +1073,7 @@ void setup()
     MacroPlay(MIPSconfigData.StartupMacro, true);
   }
   Ethernet_init();
+  BootMark("MACRO_ENET");
   watchdogEnable();
   LogMessage("System starting up!");
 }
@@ -1065,6 +1083,9 @@ void MIPSsystemLoop(void)
 {
 
   if ((BrightTime + 30000) < millis()) SetBackLight();
+  Log_loop();
+  DIcapture_loop();
+  TimerManager_loop();
   float MaxVoltage;
   // Determine the maximum output voltage and set the proper button color
   MaxVoltage = MaxRFVoltage;
@@ -1150,8 +1171,11 @@ void MIPSsystemLoop(void)
 // This same set of addresses appears for board select A and B
 void ScanHardware(void)
 {
-  uint8_t addr;
-  char    signature[100];
+  uint8_t  addr;
+  char     signature[BOOTsigSize + 1];
+  uint32_t t;
+
+  signature[BOOTsigSize] = 0;
 
 #ifdef TestFilament
   Filament_init(0);
@@ -1166,7 +1190,8 @@ void ScanHardware(void)
     addr = ModuleAddresses[i];
     // Set board select to A
     ENA_BRD_A;
-    if (ReadEEPROM(signature, addr, 0, 100) == 0)
+    t = micros();
+    if (ReadEEPROM(signature, addr, 0, BOOTsigSize) == 0)
     {
       // Test the signature and init the system if the signature is known
       if (strcmp(&signature[2], "DAC") == 0) DAC_init(0, addr);
@@ -1197,11 +1222,13 @@ void ScanHardware(void)
 #if DCBswitchCode
       if (strcmp(&signature[2], "DCBswitch") == 0) DCBswitch_init(0, addr);
 #endif
+      BootModuleFound(0, addr, signature, micros() - t);
     }
     if (!MIPSconfigData.UseBRDSEL) continue;
     // Set board select to B
     ENA_BRD_B;
-    if (ReadEEPROM(signature, addr, 0, 100) == 0)
+    t = micros();
+    if (ReadEEPROM(signature, addr, 0, BOOTsigSize) == 0)
     {
       // Test the signature and init the system if the signature is known
       if (strcmp(&signature[2], "DAC") == 0) DAC_init(1, addr);
@@ -1232,6 +1259,7 @@ void ScanHardware(void)
 #if DCBswitchCode
       if (strcmp(&signature[2], "DCBswitch") == 0) DCBswitch_init(1, addr);
 #endif
+      BootModuleFound(1, addr, signature, micros() - t);
     }
   }
   // Now look for the FAIMS board. This is done last because field driven FAIMS mode is selected if
@@ -1241,14 +1269,14 @@ void ScanHardware(void)
   {
     // Set board select to A
     ENA_BRD_A;
-    if (ReadEEPROM(signature, addr, 0, 100) == 0)
+    if (ReadEEPROM(signature, addr, 0, BOOTsigSize) == 0)
     {
       // Test the signature and init the system if the signature is known
       if (strcmp(&signature[2], "FAIMS") == 0) FAIMS_init(0);
     }
     // Set board select to B
     ENA_BRD_B;
-    if (ReadEEPROM(signature, addr, 0, 100) == 0)
+    if (ReadEEPROM(signature, addr, 0, BOOTsigSize) == 0)
     {
       // Test the signature and init the system if the signature is known
       if (strcmp(&signature[2], "FAIMS") == 0) FAIMS_init(1);
@@ -0,0 +1,923 @@
+//
+// MacroEngine
+//
+// Macro script engine, see MacroEngine.h for the script syntax.
+//
+// The script is compiled into a list of lines with the expressions in RPN and the command text
+// in a text pool, so running a line needs no parsing beyond the $ substitutions. Commands are run
+// by calling ExecuteCommand with the serial output redirected to a capture stream, this gives the
+// value a readback returns and tells if the command was NAKed. A NAK stops the script with an
+// error.
+//
+// The thread runs up to MSstepsPerRun lines per pass and returns on WAIT and WAITFOR, the thread
+// is only added to the controller while a script is running.
+//
+// Commands:
+//    MSLOAD,name             Compile a script, name.mac on the SD card
+//    MSRUN,name,p1,...p9     Run a script with up to 9 parameters, compiles the script if its
+//                            not the loaded one
+//    MSSTOP                  Stop the running script
+//    GMSSTAT                 Report name,state,line
+//    GMSERR                  Report the last error, line,message
+//    GMSVAR,name             Return a script variable
+//    SMSVAR,name,value       Set a script variable
+//
+#include <Arduino.h>
+#include <Thread.h>
+#include <ThreadController.h>
+#include "SD.h"
+#include "Variants.h"
+#include "MacroEngine.h"
+
+extern ThreadController control;
+extern bool SDcardPresent;
+
+//MIPS Threads
+Thread MacroThread = Thread();
+
+MSprogram *msprog = NULL;
+MSrun     msrun = {MSSidle, 0};
+
+const char *MSstateNames[] = {"IDLE", "RUNNING", "WAITING", "ERROR"};
+
+// Compiler state
+const char *MSp;                  // Parse pointer
+const char *MScompErr;            // Compile error message, NULL if no error
+uint8_t    MSblkOp[MSmaxDepth];   // Open IF, ELSE, LOOP, and WHILE blocks
+int16_t    MSblkInst[MSmaxDepth];
+int        MSdepth;
+
+// Captures the output of a command run by a script. The first non empty line is saved and
+// a NAK is flagged.
+class MacroCapture : public Stream
+{
+public:
+  char Line[32];
+  int  Len;
+  bool Nak;
+  bool Done;
+  void clear(void) {Line[0] = 0; Len = 0; Nak = Done = false;}
+  virtual size_t write(uint8_t ch);
+  virtual int  available(void) {return 0;}
+  virtual int  read(void) {return -1;}
+  virtual int  peek(void) {return -1;}
+  virtual void flush(void) {}
+};
+
+size_t MacroCapture::write(uint8_t ch)
+{
+  if(ch == NAK) Nak = true;
+  if(Done || (ch == ACK) || (ch == NAK) || (ch == '\r')) return 1;
+  if(ch == '\n')
+  {
+    if(Len > 0) Done = true;
+    return 1;
+  }
+  if(Len < (int)sizeof(Line) - 1)
+  {
+    Line[Len++] = ch;
+    Line[Len] = 0;
+  }
+  return 1;
+}
+
+MacroCapture MScapture;
+
+const Commands  MacroEngineCmdArray[] = {
+// Start of command block
+//
+// Macro script commands
+//
+  {"MSLOAD",  CMDfunctionStr, 1, (char *)MacroScriptLoad},      // Compile a macro script, file name without the .mac extension
+  {"MSRUN",   CMDfunctionLine, 0, (char *)MacroScriptRun},      // Run a macro script, name followed by up to 9 parameters
+  {"MSSTOP",  CMDfunction, 0, (char *)MacroScriptStop},         // Stop the running macro script
+  {"GMSSTAT", CMDfunction, 0, (char *)MacroScriptStatus},       // Report the macro script status, name,state,line
+  {"GMSERR",  CMDfunction, 0, (char *)MacroScriptError},        // Report the last macro script error, line,message
+  {"GMSVAR",  CMDfunctionStr, 1, (char *)MacroScriptGetVar},    // Return a macro script variable, name
+  {"SMSVAR",  CMDfunctionStr, 2, (char *)MacroScriptSetVar},    // Set a macro script variable, name,value
+// End of table marker
+  {0},
+};
+
+CommandList MacroEngineCmdList = { (Commands *)MacroEngineCmdArray, NULL };
+
+void MacroEngine_init(void)
+{
+  MacroThread.setName("Macro");
+  MacroThread.onRun(MacroEngine_loop);
+  MacroThread.setInterval(10);
+  AddToCommandList(&MacroEngineCmdList);
+}
+
+bool MSbusy(void)
+{
+  return (msrun.State == MSSrunning) || (msrun.State == MSSwaiting);
+}
+
+//
+// Compiler
+//
+
+void MSskip(void)
+{
+  while((*MSp == ' ') || (*MSp == '\t')) MSp++;
+}
+
+// Returns the index of a variable, if create is true the variable is added if not found.
+// Returns -1 if not found or it can't be added.
+int MSvarIndex(const char *name, int len, bool create)
+{
+  for(int i=0;i<msprog->NumVars;i++)
+  {
+    if(((int)strlen(msprog->VarName[i]) == len) && (strncmp(msprog->VarName[i], name, len) == 0)) return i;
+  }
+  if(!create) return -1;
+  if((len == 0) || (len >= MSnameLen)) MScompErr = "Bad variable name";
+  else if(msprog->NumVars >= MSmaxVars) MScompErr = "Too many variables";
+  else
+  {
+    memcpy(msprog->VarName[msprog->NumVars], name, len);
+    msprog->VarName[msprog->NumVars][len] = 0;
+    return msprog->NumVars++;
+  }
+  return -1;
+}
+
+// Adds text to the text pool, returns its offset or -1 if the pool is full
+int MSaddText(const char *text, int len)
+{
+  int offset = msprog->TextLen;
+
+  if((offset + len + 1) > MSmaxText)
+  {
+    MScompErr = "Script text too long";
+    return -1;
+  }
+  memcpy(&msprog->Text[offset], text, len);
+  msprog->Text[offset + len] = 0;
+  msprog->TextLen += len + 1;
+  return offset;
+}
+
+bool MSemit(uint8_t type, char op, int index, float value)
+{
+  MStoken *t;
+
+  if(msprog->NumTokens >= MSmaxTokens)
+  {
+    MScompErr = "Too many expression terms";
+    return false;
+  }
+  t = &msprog->Expr[msprog->NumTokens++];
+  t->Type  = type;
+  t->Op    = op;
+  t->Index = index;
+  t->Value = value;
+  return true;
+}
+
+bool MSparseLogic(void);
+
+bool MSparsePrimary(void)
+{
+  const char *start;
+  char       *end;
+  int        i;
+
+  MSskip();
+  if(isdigit(*MSp) || (*MSp == '.'))
+  {
+    float v = strtod(MSp, &end);
+    MSp = end;
+    return MSemit(MSTnum, 0, 0, v);
+  }
+  if(*MSp == '(')
+  {
+    MSp++;
+    if(!MSparseLogic()) return false;
+    MSskip();
+    if(*MSp++ != ')')
+    {
+      MScompErr = "Missing )";
+      return false;
+    }
+    return true;
+  }
+  if(*MSp == '[')
+  {
+    start = ++MSp;
+    while((*MSp != ']') && (*MSp != 0)) MSp++;
+    if(*MSp != ']')
+    {
+      MScompErr = "Missing ]";
+      return false;
+    }
+    if((i = MSaddText(start, MSp++ - start)) < 0) return false;
+    return MSemit(MSTread, 0, i, 0);
+  }
+  if(*MSp == '$')
+  {
+    MSp++;
+    if((*MSp >= '1') && (*MSp <= '9')) return MSemit(MSTparam, 0, *MSp++ - '1', 0);
+  }
+  if(isalpha(*MSp) || (*MSp == '_'))
+  {
+    start = MSp;
+    while(isalnum(*MSp) || (*MSp == '_')) MSp++;
+    if((i = MSvarIndex(start, MSp - start, true)) < 0) return false;
+    return MSemit(MSTvar, 0, i, 0);
+  }
+  MScompErr = "Expected a value";
+  return false;
+}
+
+bool MSparseUnary(void)
+{
+  MSskip();
+  if((*MSp == '-') || ((*MSp == '!') && (MSp[1] != '=')))
+  {
+    char op = (*MSp++ == '-') ? 'n' : '!';
+    if(!MSparseUnary()) return false;
+    return MSemit(MSTop, op, 0, 0);
+  }
+  return MSparsePrimary();
+}
+
+bool MSparseTerm(void)
+{
+  char op;
+
+  if(!MSparseUnary()) return false;
+  while(true)
+  {
+    MSskip();
+    op = *MSp;
+    if((op != '*') && (op != '/')) return true;
+    MSp++;
+    if(!MSparseUnary()) return false;
+    if(!MSemit(MSTop, op, 0, 0)) return false;
+  }
+}
+
+bool MSparseSum(void)
+{
+  char op;
+
+  if(!MSparseTerm()) return false;
+  while(true)
+  {
+    MSskip();
+    op = *MSp;
+    if((op != '+') && (op != '-')) return true;
+    MSp++;
+    if(!MSparseTerm()) return false;
+    if(!MSemit(MSTop, op, 0, 0)) return false;
+  }
+}
+
+// Relational operators, coded as < > L(<=) G(>=) E(==) N(!=)
+bool MSparseCompare(void)
+{
+  char op = 0;
+
+  if(!MSparseSum()) return false;
+  MSskip();
+  if((MSp[0] == '<') && (MSp[1] == '=')) op = 'L';
+  else if((MSp[0] == '>') && (MSp[1] == '=')) op = 'G';
+  else if((MSp[0] == '=') && (MSp[1] == '=')) op = 'E';
+  else if((MSp[0] == '!') && (MSp[1] == '=')) op = 'N';
+  else if((MSp[0] == '<') || (MSp[0] == '>')) op = MSp[0];
+  if(op == 0) return true;
+  MSp += ((op == '<') || (op == '>')) ? 1 : 2;
+  if(!MSparseSum()) return false;
+  return MSemit(MSTop, op, 0, 0);
+}
+
+// && and ||, same precedence, evaluated left to right
+bool MSparseLogic(void)
+{
+  char op;
+
+  if(!MSparseCompare()) return false;
+  while(true)
+  {
+    MSskip();
+    if(((MSp[0] == '&') && (MSp[1] == '&')) || ((MSp[0] == '|') && (MSp[1] == '|')))
+    {
+      op = MSp[0];
+      MSp += 2;
+      if(!MSparseCompare()) return false;
+      if(!MSemit(MSTop, op, 0, 0)) return false;
+    }
+    else return true;
+  }
+}
+
+// Compiles an expression, returns its index in the token pool or -1 on error
+int MSexpression(void)
+{
+  int start = msprog->NumTokens;
+
+  if(!MSparseLogic()) return -1;
+  if(!MSemit(MSTend, 0, 0, 0)) return -1;
+  return start;
+}
+
+MSinst *MSnewInst(uint8_t op, int line)
+{
+  MSinst *in;
+
+  if(msprog->NumInst >= MSmaxLines)
+  {
+    MScompErr = "Too many lines";
+    return NULL;
+  }
+  in = &msprog->Prog[msprog->NumInst++];
+  in->Op   = op;
+  in->Var  = 0;
+  in->Line = line;
+  in->Jump = in->Expr = in->Expr2 = in->Text = -1;
+  return in;
+}
+
+bool MSpushBlock(uint8_t op)
+{
+  if(MSdepth >= MSmaxDepth)
+  {
+    MScompErr = "Blocks nested too deep";
+    return false;
+  }
+  MSblkOp[MSdepth] = op;
+  MSblkInst[MSdepth++] = msprog->NumInst - 1;
+  return true;
+}
+
+// Returns the instruction index of the open block if its one of the ops, else -1
+int MStopBlock(uint8_t op1, uint8_t op2)
+{
+  if(MSdepth == 0) return -1;
+  if((MSblkOp[MSdepth - 1] != op1) && (MSblkOp[MSdepth - 1] != op2)) return -1;
+  return MSblkInst[MSdepth - 1];
+}
+
+bool MSkeyword(const char *kw, int len, const char *name)
+{
+  return ((int)strlen(name) == len) && (strncmp(kw, name, len) == 0);
+}
+
+// Compiles the MIPS commands on a line, commands are separated by ;
+bool MScompileCommands(char *line, int num)
+{
+  MSinst *in;
+  char   *end;
+
+  while(*line != 0)
+  {
+    while((*line == ' ') || (*line == '\t')) line++;
+    for(end = line; (*end != ';') && (*end != 0); end++);
+    if(end > line)
+    {
+      if((in = MSnewInst(MSOcmd, num)) == NULL) return false;
+      if((in->Text = MSaddText(line, end - line)) < 0) return false;
+    }
+    line = (*end == ';') ? end + 1 : end;
+  }
+  return true;
+}
+
+bool MScompileLine(char *line, int num)
+{
+  MSinst     *in = NULL;
+  const char *kw, *name;
+  int        len, i;
+
+  MSp = line;
+  MSskip();
+  if((*MSp == 0) || (*MSp == '#')) return true;
+  // A keyword is a word followed by a space or the end of the line
+  kw = MSp;
+  while(isalpha(*MSp)) MSp++;
+  len = MSp - kw;
+  if((*MSp != 0) && (*MSp != ' ') && (*MSp != '\t')) len = 0;
+  if(MSkeyword(kw, len, "LET"))
+  {
+    if((in = MSnewInst(MSOlet, num)) == NULL) return false;
+    MSskip();
+    name = MSp;
+    while(isalnum(*MSp) || (*MSp == '_')) MSp++;
+    if((i = MSvarIndex(name, MSp - name, true)) < 0) return false;
+    in->Var = i;
+    MSskip();
+    if(*MSp++ != '=')
+    {
+      MScompErr = "Missing =";
+      return false;
+    }
+    if((in->Expr = MSexpression()) < 0) return false;
+  }
+  else if(MSkeyword(kw, len, "IF") || MSkeyword(kw, len, "LOOP") || MSkeyword(kw, len, "WHILE") || MSkeyword(kw, len, "WAIT"))
+  {
+    if(kw[0] == 'I') in = MSnewInst(MSOif, num);
+    else if(kw[0] == 'L') in = MSnewInst(MSOloop, num);
+    else if(kw[1] == 'H') in = MSnewInst(MSOwhile, num);
+    else in = MSnewInst(MSOwait, num);
+    if(in == NULL) return false;
+    if((in->Expr = MSexpression()) < 0) return false;
+    if((in->Op != MSOwait) && !MSpushBlock(in->Op)) return false;
+  }
+  else if(MSkeyword(kw, len, "WAITFOR"))
+  {
+    if((in = MSnewInst(MSOwaitfor, num)) == NULL) return false;
+    if((in->Expr = MSexpression()) < 0) return false;
+    MSskip();
+    if(*MSp++ != ',')
+    {
+      MScompErr = "Missing timeout";
+      return false;
+    }
+    if((in->Expr2 = MSexpression()) < 0) return false;
+  }
+  else if(MSkeyword(kw, len, "ELSE"))
+  {
+    if((i = MStopBlock(MSOif, MSOif)) < 0)
+    {
+      MScompErr = "ELSE without IF";
+      return false;
+    }
+    if((in = MSnewInst(MSOelse, num)) == NULL) return false;
+    // A false IF goes to the line after the ELSE, the ELSE jump is set by ENDIF
+    msprog->Prog[i].Jump = msprog->NumInst;
+    MSblkOp[MSdepth - 1] = MSOelse;
+    MSblkInst[MSdepth - 1] = msprog->NumInst - 1;
+  }
+  else if(MSkeyword(kw, len, "ENDIF"))
+  {
+    if((i = MStopBlock(MSOif, MSOelse)) < 0)
+    {
+      MScompErr = "ENDIF without IF";
+      return false;
+    }
+    if((in = MSnewInst(MSOendif, num)) == NULL) return false;
+    msprog->Prog[i].Jump = msprog->NumInst - 1;
+    MSdepth--;
+  }
+  else if(MSkeyword(kw, len, "ENDLOOP") || MSkeyword(kw, len, "ENDWHILE"))
+  {
+    uint8_t op = (kw[3] == 'L') ? MSOloop : MSOwhile;
+    if((i = MStopBlock(op, op)) < 0)
+    {
+      MScompErr = (op == MSOloop) ? "ENDLOOP without LOOP" : "ENDWHILE without WHILE";
+      return false;
+    }
+    if((in = MSnewInst((op == MSOloop) ? MSOendloop : MSOendwhile, num)) == NULL) return false;
+    // ENDLOOP goes back to the first line in the loop, ENDWHILE goes back to the WHILE test
+    in->Jump = (op == MSOloop) ? i + 1 : i;
+    msprog->Prog[i].Jump = msprog->NumInst;
+    MSdepth--;
+  }
+  else if(MSkeyword(kw, len, "STOP"))
+  {
+    if((in = MSnewInst(MSOstop, num)) == NULL) return false;
+  }
+  else return MScompileCommands(line, num);
+  MSskip();
+  if(*MSp != 0)
+  {
+    MScompErr = "Unexpected text";
+    return false;
+  }
+  return true;
+}
+
+// Compiles name.mac, returns 0 or an error code. Syntax errors are saved for GMSERR.
+int MSload(char *name)
+{
+  char fname[30], line[MSlineLen + 1];
+  File mfile;
+  int  c, len = 0, num = 1;
+
+  if(!SDcardPresent) return ERR_NOSDCARD;
+  if(strlen(name) > 20) return ERR_FILENAMETOOLONG;
+  if(msprog == NULL) msprog = new MSprogram;
+  if(msprog == NULL) return ERR_CANTALLOCATE;
+  msprog->Name[0] = 0;
+  msprog->NumInst = msprog->NumTokens = msprog->TextLen = msprog->NumVars = 0;
+  MSdepth = 0;
+  MScompErr = NULL;
+  MSvarIndex("TIMEOUT", 7, true);
+  SD.begin(_sdcs);
+  sprintf(fname, "%s.mac", name);
+  if(!(mfile = SD.open(fname, FILE_READ))) return ERR_CANTOPENFILE;
+  while(true)
+  {
+    c = mfile.read();
+    if((c == -1) || (c == '\n'))
+    {
+      line[len] = 0;
+      if(!MScompileLine(line, num) || (c == -1)) break;
+      len = 0;
+      num++;
+      continue;
+    }
+    if(c == '\r') continue;
+    if(len >= MSlineLen)
+    {
+      MScompErr = "Line too long";
+      break;
+    }
+    line[len++] = c;
+  }
+  mfile.close();
+  if((MScompErr == NULL) && (MSdepth > 0))
+  {
+    MScompErr = "Block not closed";
+    num = msprog->Prog[MSblkInst[MSdepth - 1]].Line;
+  }
+  if(MScompErr != NULL)
+  {
+    msprog->NumInst = 0;
+    msrun.ErrLine = num;
+    msrun.ErrMess = MScompErr;
+    return ERR_MACROSYNTAX;
+  }
+  strcpy(msprog->Name, name);
+  return 0;
+}
+
+//
+// Run time
+//
+
+// Flags a run time error at the current line, always returns false
+bool MSerror(const char *mess)
+{
+  msrun.State   = MSSerror;
+  msrun.ErrLine = msprog->Prog[msrun.PC].Line;
+  msrun.ErrMess = mess;
+  return false;
+}
+
+void MSformat(float v, char *buf)
+{
+  if((v == (int)v) && (fabs(v) < 1000000000)) sprintf(buf, "%d", (int)v);
+  else sprintf(buf, "%.3f", v);
+}
+
+// Copies a command line replacing $name with the variable and $1 to $9 with the parameters
+bool MSexpand(const char *src, char *dst)
+{
+  char       val[MSargLen];
+  const char *s, *name;
+  int        n = 0, i;
+
+  while(*src != 0)
+  {
+    if(*src != '$')
+    {
+      if(n >= MSlineLen) return MSerror("Line too long");
+      dst[n++] = *src++;
+      continue;
+    }
+    src++;
+    if((*src >= '1') && (*src <= '9')) s = msrun.Params[*src++ - '1'];
+    else
+    {
+      name = src;
+      while(isalnum(*src) || (*src == '_')) src++;
+      if((i = MSvarIndex(name, src - name, false)) < 0) return MSerror("Unknown variable");
+      MSformat(msrun.Vars[i], val);
+      s = val;
+    }
+    while(*s != 0)
+    {
+      if(n >= MSlineLen) return MSerror("Line too long");
+      dst[n++] = *s++;
+    }
+  }
+  dst[n] = 0;
+  return true;
+}
+
+// Runs a MIPS command with its output captured. If value is not NULL the readback value
+// is returned. Returns false if the command fails.
+bool MScommand(char *line, float *value)
+{
+  char     args[4][MSargLen];
+  char     *sarg1 = args[1], *sarg2 = args[2];
+  int      n = 0, len = 0, arg1 = 0, arg2 = 0;
+  float    farg1 = 0;
+  Commands *cmd;
+  Stream   *s;
+  bool     mute;
+
+  // Split the line into the command and up to 3 arguments
+  for(;;line++)
+  {
+    if((*line == ',') || (*line == 0))
+    {
+      args[n][len] = 0;
+      len = 0;
+      if(*line == 0) break;
+      if(++n > 3) return MSerror("Too many arguments");
+      continue;
+    }
+    if((*line != ' ') && (len < MSargLen - 1)) args[n][len++] = *line;
+  }
+  if((cmd = FindCommand(args[0])) == NULL) return MSerror("Unknown command");
+  if((cmd->Type == CMDfunctionLine) || (cmd->Type == CMDlongStr)) return MSerror("Command not supported in scripts");
+  if(n != cmd->NumArgs) return MSerror("Wrong number of arguments");
+  // Convert the arguments the same way as the command processor
+  if(n >= 1)
+  {
+    sscanf(args[1], "%d", &arg1);
+    sscanf(args[1], "%f", &farg1);
+  }
+  if(n >= 2) sscanf(args[2], "%d", &arg2);
+  if(n >= 3)
+  {
+    sscanf(args[3], "%f", &farg1);
+    sarg1 = args[3];
+  }
+  s = serial;
+  mute = SerialMute;
+  MScapture.clear();
+  serial = &MScapture;
+  SerialMute = false;
+  ExecuteCommand(cmd, arg1, arg2, sarg1, sarg2, farg1);
+  serial = s;
+  SerialMute = mute;
+  if(MScapture.Nak) return MSerror("Command NAK");
+  if(value == NULL) return true;
+  if(strcmp(MScapture.Line, "TRUE") == 0) *value = 1;
+  else if(strcmp(MScapture.Line, "FALSE") == 0) *value = 0;
+  else if(sscanf(MScapture.Line, "%f", value) != 1) return MSerror("Readback is not a number");
+  return true;
+}
+
+// Evaluates an RPN expression, returns false on a run time error
+bool MSeval(int expr, float *result)
+{
+  float   stack[16], a, b;
+  int     sp = 0;
+  char    text[MSlineLen + 1];
+  MStoken *t;
+
+  for(t = &msprog->Expr[expr]; t->Type != MSTend; t++)
+  {
+    if(sp >= 16) return MSerror("Expression too complex");
+    switch(t->Type)
+    {
+      case MSTnum:
+        stack[sp++] = t->Value;
+        break;
+      case MSTvar:
+        stack[sp++] = msrun.Vars[t->Index];
+        break;
+      case MSTparam:
+        stack[sp++] = atof(msrun.Params[t->Index]);
+        break;
+      case MSTread:
+        if(!MSexpand(&msprog->Text[t->Index], text)) return false;
+        if(!MScommand(text, &stack[sp])) return false;
+        sp++;
+        break;
+      case MSTop:
+        if(t->Op == 'n')
+        {
+          stack[sp - 1] = -stack[sp - 1];
+          break;
+        }
+        if(t->Op == '!')
+        {
+          stack[sp - 1] = (stack[sp - 1] == 0);
+          break;
+        }
+        b = stack[--sp];
+        a = stack[--sp];
+        switch(t->Op)
+        {
+          case '+': a = a + b; break;
+          case '-': a = a - b; break;
+          case '*': a = a * b; break;
+          case '/':
+            if(b == 0) return MSerror("Divide by zero");
+            a = a / b;
+            break;
+          case '<': a = a < b; break;
+          case '>': a = a > b; break;
+          case 'L': a = a <= b; break;
+          case 'G': a = a >= b; break;
+          case 'E': a = a == b; break;
+          case 'N': a = a != b; break;
+          case '&': a = (a != 0) && (b != 0); break;
+          case '|': a = (a != 0) || (b != 0); break;
+        }
+        stack[sp++] = a;
+        break;
+    }
+  }
+  *result = stack[0];
+  return true;
+}
+
+// Runs the current line. Returns true to run the next line, false to give up the thread
+// for a wait, at the end, or on an error.
+bool MacroStep(void)
+{
+  MSinst *in;
+  float  v;
+  char   text[MSlineLen + 1];
+
+  if(!MSbusy()) return false;
+  if(msrun.PC >= msprog->NumInst)
+  {
+    msrun.State = MSSidle;
+    return false;
+  }
+  in = &msprog->Prog[msrun.PC];
+  switch(in->Op)
+  {
+    case MSOcmd:
+      if(!MSexpand(&msprog->Text[in->Text], text)) return false;
+      if(!MScommand(text, NULL)) return false;
+      break;
+    case MSOlet:
+      if(!MSeval(in->Expr, &v)) return false;
+      msrun.Vars[in->Var] = v;
+      break;
+    case MSOif:
+    case MSOwhile:
+      if(!MSeval(in->Expr, &v)) return false;
+      if(v == 0)
+      {
+        msrun.PC = in->Jump;
+        return true;
+      }
+      break;
+    case MSOelse:
+    case MSOendwhile:
+      msrun.PC = in->Jump;
+      return true;
+    case MSOloop:
+      if(!MSeval(in->Expr, &v)) return false;
+      if(v < 1)
+      {
+        msrun.PC = in->Jump;
+        return true;
+      }
+      if(msrun.LoopDepth >= MSmaxDepth) return MSerror("Loops nested too deep");
+      msrun.LoopCount[msrun.LoopDepth++] = v;
+      break;
+    case MSOendloop:
+      if(--msrun.LoopCount[msrun.LoopDepth - 1] > 0)
+      {
+        msrun.PC = in->Jump;
+        return true;
+      }
+      msrun.LoopDepth--;
+      break;
+    case MSOwait:
+    case MSOwaitfor:
+      if(msrun.State != MSSwaiting)
+      {
+        if(!MSeval((in->Op == MSOwait) ? in->Expr : in->Expr2, &v)) return false;
+        msrun.WaitStart = millis();
+        msrun.WaitTime  = (v > 0) ? v : 0;
+        msrun.State     = MSSwaiting;
+      }
+      if(in->Op == MSOwaitfor)
+      {
+        if(!MSeval(in->Expr, &v)) return false;
+        if(v != 0)
+        {
+          msrun.Vars[0] = 0;
+          msrun.State = MSSrunning;
+          break;
+        }
+      }
+      if((millis() - msrun.WaitStart) < msrun.WaitTime) return false;
+      if(in->Op == MSOwaitfor) msrun.Vars[0] = 1;
+      msrun.State = MSSrunning;
+      break;
+    case MSOstop:
+      msrun.State = MSSidle;
+      return false;
+    default:
+      break;
+  }
+  msrun.PC++;
+  return true;
+}
+
+void MacroEngine_loop(void)
+{
+  for(int i=0;(i<MSstepsPerRun) && MacroStep();i++);
+  if(MSbusy()) return;
+  control.remove(&MacroThread);
+  if(msrun.State == MSSerror) LogEvent(LOGCmessage, LOGerror, LOGMsystem, -1, -1, msrun.ErrLine, msrun.ErrMess);
+}
+
+//
+// Host commands
+//
+
+void MacroScriptLoad(char *name)
+{
+  int err;
+
+  if(MSbusy()) ERR(ERR_MACRORUNNING);
+  if((err = MSload(name)) != 0) ERR(err);
+  SendACK;
+}
+
+void MacroScriptRun(void)
+{
+  char name[21], params[MSmaxParams][MSargLen];
+  char *tkn;
+  int  n = 0, err;
+
+  name[0] = 0;
+  memset(params, 0, sizeof(params));
+  // Read the whole line before testing the arguments
+  if((tkn = TokenFromCommandLine(',')) != NULL)
+  {
+    strncpy(name, tkn, 20);
+    name[20] = 0;
+    while((tkn = TokenFromCommandLine(',')) != NULL)
+    {
+      if(n < MSmaxParams) strncpy(params[n], tkn, MSargLen - 1);
+      n++;
+    }
+  }
+  if((name[0] == 0) || (n > MSmaxParams)) BADARG;
+  if(MSbusy()) ERR(ERR_MACRORUNNING);
+  if((msprog == NULL) || (msprog->NumInst == 0) || (strcmp(msprog->Name, name) != 0))
+  {
+    if((err = MSload(name)) != 0) ERR(err);
+  }
+  memcpy(msrun.Params, params, sizeof(params));
+  memset(msrun.Vars, 0, sizeof(msrun.Vars));
+  msrun.PC = msrun.LoopDepth = 0;
+  msrun.State = MSSrunning;
+  control.remove(&MacroThread);
+  if(!control.add(&MacroThread))
+  {
+    msrun.State = MSSidle;
+    ERR(ERR_INTERNAL);
+  }
+  SendACK;
+}
+
+void MacroScriptStop(void)
+{
+  control.remove(&MacroThread);
+  if(MSbusy()) msrun.State = MSSidle;
+  SendACK;
+}
+
+void MacroScriptStatus(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  if(msprog != NULL) serial->print(msprog->Name);
+  serial->print(",");
+  serial->print(MSstateNames[msrun.State]);
+  serial->print(",");
+  if(MSbusy() && (msrun.PC < msprog->NumInst)) serial->println(msprog->Prog[msrun.PC].Line);
+  else serial->println(0);
+}
+
+void MacroScriptError(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  if(msrun.ErrMess == NULL)
+  {
+    serial->println("0,None");
+    return;
+  }
+  serial->print(msrun.ErrLine);
+  serial->print(",");
+  serial->println(msrun.ErrMess);
+}
+
+void MacroScriptGetVar(char *name)
+{
+  int i;
+
+  if((msprog == NULL) || ((i = MSvarIndex(name, strlen(name), false)) < 0)) BADARG;
+  SendACKonly;
+  if(SerialMute) return;
+  serial->println(msrun.Vars[i]);
+}
+
+void MacroScriptSetVar(char *name, char *value)
+{
+  String token;
+  int    i;
+
+  if((msprog == NULL) || ((i = MSvarIndex(name, strlen(name), false)) < 0)) BADARG;
+  token = value;
+  msrun.Vars[i] = token.toFloat();
+  SendACK;
+}
@@ -0,0 +1,255 @@
+//
+// MemPool
+//
+// Node pools, tracked block allocation, and heap telemetry, see MemPool.h.
+//
+// Commands:
+//    GMEMSTAT                Report the heap, size,peak,used,free,largest block,stack gap
+//    GMEMUSE                 Report the subsystem and pool usage, name,bytes,peak,blocks,failed
+//
+#include "Variants.h"
+#include "MemPool.h"
+#include "MemoryFix.h"
+#include <malloc.h>
+
+extern size_t __malloc_margin;
+
+// Tracked block header, 8 bytes to keep the block 8 byte aligned
+typedef struct
+{
+  uint32_t   Size;
+  uint32_t   Sub;
+} MemHeader;
+
+MemUsage  MemUse[MEMnumSubsystems] = {{"TABLE"}, {"DCBL"}, {"ADC"}};
+
+MemPool   DCstatePool     = {"DCSTATE", MEMdcbl, sizeof(DCstate)};
+MemPool   DCsegmentPool   = {"DCSEGMENT", MEMdcbl, sizeof(DCsegment)};
+MemPool   DCtimePointPool = {"DCTIMEPOINT", MEMdcbl, sizeof(DCsegmentTP)};
+
+MemPool   *MemPools[] = {&DCstatePool, &DCsegmentPool, &DCtimePointPool, NULL};
+
+const Commands  MemPoolCmdArray[] = {
+// Start of command block
+//
+// Memory commands
+//
+  {"GMEMSTAT", CMDfunction, 0, (char *)MemReportStatus},        // Report the heap, size,peak,used,free,largest block,stack gap in bytes
+  {"GMEMUSE",  CMDfunction, 0, (char *)MemReportUsage},         // Report subsystem and pool usage, name,bytes,peak,blocks,failed one per line
+// End of table marker
+  {0},
+};
+
+CommandList MemPoolCmdList = { (Commands *)MemPoolCmdArray, NULL };
+
+// Called once from setup
+void MemPool_init(void)
+{
+  for(int i=0;MemPools[i] != NULL;i++)
+  {
+    MemPools[i]->Size = (MemPools[i]->Size + 3) & ~3;
+    if(MemPools[i]->Size < sizeof(MemNode)) MemPools[i]->Size = sizeof(MemNode);
+  }
+  AddToCommandList(&MemPoolCmdList);
+}
+
+//
+// Tracked blocks
+//
+
+static void MemCharge(int sub, int32_t bytes, int blocks)
+{
+  MemUse[sub].Bytes += bytes;
+  MemUse[sub].Blocks += blocks;
+  if(MemUse[sub].Bytes > MemUse[sub].Peak) MemUse[sub].Peak = MemUse[sub].Bytes;
+}
+
+// Allocates a block for subsystem sub, returns NULL if out of memory.
+void *MemAlloc(int sub, size_t size)
+{
+  MemHeader *mh;
+
+  if((mh = (MemHeader *)malloc(sizeof(MemHeader) + size)) == NULL)
+  {
+    MemUse[sub].Failed++;
+    return NULL;
+  }
+  mh->Size = size;
+  mh->Sub = sub;
+  MemCharge(sub, size, 1);
+  return (void *)(mh + 1);
+}
+
+// Resizes a block, ptr can be NULL. If out of memory NULL is returned and the block is
+// unchanged, same as realloc.
+void *MemRealloc(int sub, void *ptr, size_t size)
+{
+  MemHeader *mh;
+  uint32_t  old;
+
+  if(ptr == NULL) return MemAlloc(sub, size);
+  mh = (MemHeader *)ptr - 1;
+  old = mh->Size;
+  if((mh = (MemHeader *)realloc((void *)mh, sizeof(MemHeader) + size)) == NULL)
+  {
+    MemUse[sub].Failed++;
+    return NULL;
+  }
+  mh->Size = size;
+  MemCharge(sub, (int32_t)size - (int32_t)old, 0);
+  return (void *)(mh + 1);
+}
+
+void MemFree(void *ptr)
+{
+  MemHeader *mh;
+
+  if(ptr == NULL) return;
+  mh = (MemHeader *)ptr - 1;
+  MemUse[mh->Sub].Bytes -= mh->Size;
+  MemUse[mh->Sub].Blocks--;
+  free((void *)mh);
+}
+
+// Returns the size of a tracked block, 0 if ptr is NULL.
+size_t MemSize(void *ptr)
+{
+  if(ptr == NULL) return 0;
+  return ((MemHeader *)ptr - 1)->Size;
+}
+
+//
+// Node pools
+//
+
+// Returns a node, adds a chunk to the pool if there are no free nodes. Returns NULL if out of memory.
+void *MemPoolGet(MemPool *mp)
+{
+  MemChunk *mc;
+  MemNode  *mn;
+  uint8_t  *p;
+
+  if(mp->Free == NULL)
+  {
+    if((mc = (MemChunk *)MemAlloc(mp->Sub, sizeof(MemChunk) + mp->Size * MEMnodesPerChunk)) == NULL)
+    {
+      mp->Failed++;
+      return NULL;
+    }
+    mc->next = mp->Chunk;
+    mp->Chunk = mc;
+    mp->Chunks++;
+    p = (uint8_t *)(mc + 1);
+    for(int i=0;i<MEMnodesPerChunk;i++,p += mp->Size)
+    {
+      mn = (MemNode *)p;
+      mn->next = mp->Free;
+      mp->Free = mn;
+    }
+  }
+  mn = mp->Free;
+  mp->Free = mn->next;
+  if(++mp->InUse > mp->Peak) mp->Peak = mp->InUse;
+  return (void *)mn;
+}
+
+// Returns a node to the pool's free list.
+void MemPoolPut(MemPool *mp, void *node)
+{
+  MemNode *mn;
+
+  if(node == NULL) return;
+  mn = (MemNode *)node;
+  mn->next = mp->Free;
+  mp->Free = mn;
+  mp->InUse--;
+}
+
+// Returns all of the pool's chunks to the heap if no nodes are in use.
+void MemPoolCompact(MemPool *mp)
+{
+  MemChunk *mc;
+
+  if(mp->InUse != 0) return;
+  while(mp->Chunk != NULL)
+  {
+    mc = mp->Chunk;
+    mp->Chunk = mc->next;
+    MemFree((void *)mc);
+  }
+  mp->Free = NULL;
+  mp->Chunks = 0;
+}
+
+//
+// Heap telemetry
+//
+
+// Returns the largest block that can be allocated without using a freed hole in the heap,
+// the free space at the top of the heap plus the space that can still be added below the stack.
+// A hole left by a free can be larger, GMEMSTAT's free count includes the holes.
+int MemLargestBlock(void)
+{
+  struct mallinfo mi = mallinfo();
+  int    gap;
+
+  gap = freeMemory() - (int)__malloc_margin;
+  if(gap < 0) gap = 0;
+  return mi.keepcost + gap - sizeof(MemHeader);
+}
+
+//
+// Host commands
+//
+
+void MemReportStatus(void)
+{
+  struct mallinfo mi = mallinfo();
+
+  SendACKonly;
+  if(SerialMute) return;
+  serial->print(heapSize());
+  serial->print(",");
+  serial->print(heapPeak());
+  serial->print(",");
+  serial->print(mi.uordblks);
+  serial->print(",");
+  serial->print(mi.fordblks);
+  serial->print(",");
+  serial->print(MemLargestBlock());
+  serial->print(",");
+  serial->println(freeMemory());
+}
+
+void MemReportUsage(void)
+{
+  MemPool *mp;
+
+  SendACKonly;
+  if(SerialMute) return;
+  for(int i=0;i<MEMnumSubsystems;i++)
+  {
+    serial->print(MemUse[i].Name);
+    serial->print(",");
+    serial->print(MemUse[i].Bytes);
+    serial->print(",");
+    serial->print(MemUse[i].Peak);
+    serial->print(",");
+    serial->print(MemUse[i].Blocks);
+    serial->print(",");
+    serial->println(MemUse[i].Failed);
+  }
+  for(int i=0;(mp = MemPools[i]) != NULL;i++)
+  {
+    serial->print(mp->Name);
+    serial->print(",");
+    serial->print(mp->InUse * mp->Size);
+    serial->print(",");
+    serial->print(mp->Peak * mp->Size);
+    serial->print(",");
+    serial->print(mp->InUse);
+    serial->print(",");
+    serial->println(mp->Failed);
+  }
+  serial->println("");
+}
@@ -45,6 +45,7 @@ extern void _kill( int pid, int sig ) ;
 
 #define ENOMEM 12
 size_t __malloc_margin = 4 * (size_t)1024;
+static const unsigned char *heapMax = (unsigned char *)&_end;
 extern caddr_t _sbrk (int incr) {
     static const unsigned char *       heap      = (unsigned char *)&_end ;
     const unsigned char * const prev_heap = heap;
@@ -82,6 +83,7 @@ extern caddr_t _sbrk (int incr) {
     }
 
     heap      += incr ;
+    if(heap > heapMax) heapMax = heap;
     return (caddr_t) prev_heap ;
 }
 
@@ -92,3 +94,13 @@ int freeMemory() {
   return &top - reinterpret_cast<char*>(sbrk(0));
 }
 
+// Returns the current heap size, the bytes between the end of the static data and the heap top.
+int heapSize() {
+  return reinterpret_cast<char*>(sbrk(0)) - reinterpret_cast<char*>(&_end);
+}
+
+// Returns the largest the heap has been since reset.
+int heapPeak() {
+  return heapMax - reinterpret_cast<const unsigned char*>(&_end);
+}
+
@@ -2,6 +2,8 @@
 #define MEMORYFIX_H
 
 int freeMemory();
+int heapSize();
+int heapPeak();
 
 #endif
 
@@ -261,8 +261,11 @@ void DisplayWindow(Window *wn)
   uint16_t w = wn->Width;
   uint16_t h = wn->Height;
 
-  // Clear the menu area of screen
-  tft.fillRect(x, y, w, h, wn->Bcolor);
+  // Clear the menu area of screen, the dialog entries must be redrawn and the queued
+  // entries are for the old window
+  DialogInvalidate();
+  DSPdiscard();
+  DSPfillRect(x, y, w, h, wn->Bcolor);
   // Print the title and center, if defined
   if (wn->Title != NULL)
   {
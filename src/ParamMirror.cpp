@@ -0,0 +1,204 @@
+//
+// ParamMirror
+//
+// Change tracked parameter mirrors for smart TWI modules, see ParamMirror.h.
+//
+// Commands:
+//    GMIRRORS                Report the mirrors, name,params,syncs,writes,clamped,failed,readback failed one per line
+//
+#include "Variants.h"
+#include "ParamMirror.h"
+#include "TWIprofile.h"
+#include "AtomicBlock.h"
+#include <Wire.h>
+
+PMmirror  *PMmirrors[PMmaxMirrors];
+int       PMnum = 0;
+
+const Commands  ParamMirrorCmdArray[] = {
+// Start of command block
+//
+// Parameter mirror commands
+//
+  {"GMIRRORS", CMDfunction, 0, (char *)PMreport},               // Report the mirrors, name,params,syncs,writes,clamped,failed,readback failed one per line
+// End of table marker
+  {0},
+};
+
+CommandList ParamMirrorCmdList = { (Commands *)ParamMirrorCmdArray, NULL };
+
+static int PMsize(PMparam *pp)
+{
+  if((pp->Type == PMbool) || (pp->Type == PMint8)) return 1;
+  return 4;
+}
+
+// Called from the module init, sets the module address and board and forces a full update.
+// A mirror is only added to the report once.
+void PMregister(PMmirror *pm, uint8_t TWIadd, int8_t brd)
+{
+  int i;
+
+  pm->TWIadd = TWIadd;
+  pm->Brd = brd;
+  pm->Update = true;
+  for(i=0;i<PMnum;i++) if(PMmirrors[i] == pm) return;
+  if(PMnum >= PMmaxMirrors) return;
+  if(PMnum == 0) AddToCommandList(&ParamMirrorCmdList);
+  PMmirrors[PMnum++] = pm;
+}
+
+// Clamps the parameter to its limits, returns true if the value was changed.
+static bool PMclamp(PMparam *pp)
+{
+  float v;
+
+  if(pp->Min == pp->Max) return false;
+  switch(pp->Type)
+  {
+    case PMfloat:
+      v = *(float *)pp->Value;
+      if(v < pp->Min) *(float *)pp->Value = pp->Min;
+      else if(v > pp->Max) *(float *)pp->Value = pp->Max;
+      else return false;
+      return true;
+    case PMint:
+      v = *(int *)pp->Value;
+      if(v < pp->Min) *(int *)pp->Value = pp->Min;
+      else if(v > pp->Max) *(int *)pp->Value = pp->Max;
+      else return false;
+      return true;
+    case PMint8:
+      v = *(int8_t *)pp->Value;
+      if(v < pp->Min) *(int8_t *)pp->Value = pp->Min;
+      else if(v > pp->Max) *(int8_t *)pp->Value = pp->Max;
+      else return false;
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool PMchanged(PMparam *pp)
+{
+  return memcmp(pp->Value, &pp->Sent, PMsize(pp)) != 0;
+}
+
+// Sends the parameters that changed since the last sync, all of them if Update is set.
+// Returns the number of parameters sent.
+int PMsync(PMmirror *pm)
+{
+  PMparam    *pp;
+  TWIprofile *tp;
+  uint8_t    *b;
+  int        i, n = 0, cb = -1;
+  bool       ok;
+
+  if(pm->Brd == -1) return 0;
+  for(pp = pm->Params; pp->Value != NULL; pp++)
+  {
+    if(PMclamp(pp)) pm->Clamped++;
+    if(!pm->Update && !PMchanged(pp)) continue;
+    if(n++ == 0)
+    {
+      AcquireTWI();
+      cb = SelectedBoard();
+      SelectBoard(pm->Brd);
+    }
+    tp = TWIbegin(0, pm->TWIadd, TWIcSmart);
+    Wire.beginTransmission(pm->TWIadd);
+    Wire.write(pp->Cmd);
+    if(pp->Ch != -1) Wire.write(pp->Ch);
+    b = (uint8_t *)pp->Value;
+    for(i=0;i<PMsize(pp);i++) Wire.write(b[i]);
+    {
+      AtomicBlock< Atomic_RestoreState > a_Block;
+      ok = (Wire.endTransmission() == 0);
+    }
+    TWIfinish(tp, !ok);
+    pm->Writes++;
+    if(ok) memcpy(&pp->Sent, pp->Value, PMsize(pp));
+    else pm->Failed++;
+  }
+  pm->Update = false;
+  if(n == 0) return 0;
+  if(cb != pm->Brd) SelectBoard(cb);
+  ReleaseTWI();
+  pm->Syncs++;
+  return n;
+}
+
+// Marks a variable's current value as sent, used for values read back from the module.
+void PMaccept(PMmirror *pm, void *value)
+{
+  PMparam *pp;
+
+  for(pp = pm->Params; pp->Value != NULL; pp++)
+  {
+    if(pp->Value != value) continue;
+    memcpy(&pp->Sent, pp->Value, PMsize(pp));
+    return;
+  }
+}
+
+// Returns true if every float field in the limits table is a number in range.
+bool PMvalid(void *rb, const PMlimit *limits)
+{
+  float v;
+
+  for(;limits->Offset != -1;limits++)
+  {
+    v = *(float *)((uint8_t *)rb + limits->Offset);
+    if((fpclassify(v) != FP_NORMAL) && (fpclassify(v) != FP_ZERO)) return false;
+    if((v < limits->Min) || (v > limits->Max)) return false;
+  }
+  return true;
+}
+
+// Reads a readback structure for channel ch, dest is only updated if the full structure
+// was read and is valid.
+bool PMreadBlock(PMmirror *pm, int ch, int cmd, void *dest, int size, const PMlimit *limits)
+{
+  uint8_t rb[PMmaxReadback];
+
+  if((pm->Brd == -1) || (size > PMmaxReadback)) return false;
+  if(!TWIreadBlock(pm->TWIadd, pm->Brd, ch, cmd, (void *)rb, size) || !PMvalid((void *)rb, limits))
+  {
+    pm->RBfailed++;
+    return false;
+  }
+  memcpy(dest, rb, size);
+  return true;
+}
+
+//
+// Host commands
+//
+
+void PMreport(void)
+{
+  PMmirror *pm;
+  int      n;
+
+  SendACKonly;
+  if(SerialMute) return;
+  for(int i=0;i<PMnum;i++)
+  {
+    pm = PMmirrors[i];
+    for(n=0;pm->Params[n].Value != NULL;n++);
+    serial->print(pm->Name);
+    serial->print(",");
+    serial->print(n);
+    serial->print(",");
+    serial->print(pm->Syncs);
+    serial->print(",");
+    serial->print(pm->Writes);
+    serial->print(",");
+    serial->print(pm->Clamped);
+    serial->print(",");
+    serial->print(pm->Failed);
+    serial->print(",");
+    serial->println(pm->RBfailed);
+  }
+  serial->println("");
+}
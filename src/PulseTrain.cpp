@@ -0,0 +1,430 @@
+//
+// PulseTrain
+//
+// Timer driven pulse train and burst generator, see PulseTrain.h. The settings are applied
+// when the generator is enabled, SPTRENA,TRUE.
+//
+// Commands:
+//    SPTROUT,out             Set the output, D2, TRGOUT, AUXTRG, or A thru P
+//    SPTRWIDTH,uS            Set the pulse width
+//    SPTRPERIOD,uS           Set the pulse period
+//    SPTRDELAY,uS            Set the delay from the trigger to the first pulse
+//    SPTRCOUNT,n             Set the pulses per trigger, 0 = run until disabled
+//    SPTRTRG,source,level    Set the trigger source, SW, TABLE, TRIGOUT, AUX, or Q thru X, level
+//                            is POS, NEG, or BOTH for Q thru X and NA for the others
+//    SPTRENA,state           TRUE claims the timer and arms the generator, FALSE stops it
+//    PTRTRG                  Software trigger
+//    GPTRSTAT                Report enable,bursts,missed triggers,max ISR latency in nS
+//    GPTRJIT,input           Report the jitter measured on a captured input, see PTRreportJitter
+//
+#include "Variants.h"
+#include "PulseTrain.h"
+#include "AtomicBlock.h"
+#include <DIhandler.h>
+#include <MIPStimer.h>
+
+PTRdata  ptrdata = {"D2", "SW", "NA", 1.0, 10.0, 0.0, 1, false};
+
+void PTRrelease(void);
+
+MIPStimer *PTRtimer = NULL;
+DIhandler *PTRdi = NULL;
+TimerUser PTRtimerUser = {"PTRAIN", TMR_PulseTrain, TMRPnormal, PTRrelease};
+
+// Values used by the ISRs, set when the generator is enabled
+int       PTRout;                   // PTRoutputs
+Pio       *PTRpio;
+uint32_t  PTRpin;
+bool      PTRidleHigh;              // Output level at the trigger
+bool      PTRactive = false;        // True while a software driven output is in the pulse
+uint32_t  PTRwidth;                 // Timer counts
+uint32_t  PTRperiod;
+uint32_t  PTRdelay;
+int       PTRcount;
+volatile int PTRphase = PTRPidle;
+volatile int PTRstarted;
+
+// Statistics
+uint32_t  PTRbursts = 0;
+uint32_t  PTRmissed = 0;
+uint32_t  PTRmaxLatency = 0;        // Longest RC ISR entry delay in timer counts
+
+const Commands  PulseTrainCmdArray[] = {
+// Start of command block
+//
+// Pulse train generator commands
+//
+  {"SPTROUT",    CMDfunctionStr, 1, (char *)PTRsetOutput},      // Set the pulse train output, D2, TRGOUT, AUXTRG, or A thru P
+  {"GPTROUT",    CMDstr, 0, (char *)ptrdata.Output},            // Returns the pulse train output
+  {"SPTRWIDTH",  CMDfloat, 1, (char *)&ptrdata.Width},          // Set the pulse width in uS
+  {"GPTRWIDTH",  CMDfloat, 0, (char *)&ptrdata.Width},          // Returns the pulse width in uS
+  {"SPTRPERIOD", CMDfloat, 1, (char *)&ptrdata.Period},         // Set the pulse period in uS
+  {"GPTRPERIOD", CMDfloat, 0, (char *)&ptrdata.Period},         // Returns the pulse period in uS
+  {"SPTRDELAY",  CMDfloat, 1, (char *)&ptrdata.Delay},          // Set the delay from trigger to the first pulse in uS
+  {"GPTRDELAY",  CMDfloat, 0, (char *)&ptrdata.Delay},          // Returns the delay from trigger to the first pulse in uS
+  {"SPTRCOUNT",  CMDint, 1, (char *)&ptrdata.Count},            // Set the pulses per trigger, 0 = run until disabled
+  {"GPTRCOUNT",  CMDint, 0, (char *)&ptrdata.Count},            // Returns the pulses per trigger
+  {"SPTRTRG",    CMDfunctionStr, 2, (char *)PTRsetTrigger},     // Set the trigger source, SW, TABLE, TRIGOUT, AUX, or Q thru X, and level, POS, NEG, BOTH, or NA
+  {"GPTRTRG",    CMDfunction, 0, (char *)PTRreportTrigger},     // Returns the trigger source and level
+  {"SPTRENA",    CMDfunctionStr, 1, (char *)PTRsetEnable},      // TRUE applies the settings and arms the generator, FALSE stops it
+  {"GPTRENA",    CMDbool, 0, (char *)&ptrdata.Enable},          // Returns the pulse train enable status
+  {"PTRTRG",     CMDfunction, 0, (char *)PTRsoftwareTrigger},   // Software trigger
+  {"GPTRSTAT",   CMDfunction, 0, (char *)PTRreportStatus},      // Report enable,bursts,missed triggers,max ISR latency in nS
+  {"GPTRJIT",    CMDfunctionStr, 1, (char *)PTRreportJitter},   // Report the jitter measured on a captured input Q thru X, periods,mean,min,max,peak to peak,min width,max width in nS
+// End of table marker
+  {0},
+};
+
+CommandList PulseTrainCmdList = { (Commands *)PulseTrainCmdArray, NULL };
+
+// Called once from setup
+void PulseTrain_init(void)
+{
+  AddToCommandList(&PulseTrainCmdList);
+}
+
+// Returns the output type and sets the pin for the trigger outputs, -1 if not valid
+int PTRoutputType(char *output, Pio **pio, uint32_t *pin)
+{
+  int p = -1;
+
+  if(strcmp(output, "D2") == 0) return PTRoutHW;
+  if(strcmp(output, "TRGOUT") == 0) p = TRGOUT;
+  else if(strcmp(output, "AUXTRG") == 0) p = AUXTRGOUT;
+  if(p != -1)
+  {
+    *pio = g_APinDescription[p].pPort;
+    *pin = g_APinDescription[p].ulPin;
+    return PTRoutPin;
+  }
+  if((output[0] >= 'A') && (output[0] <= 'P') && (output[1] == 0)) return PTRoutDIO;
+  return -1;
+}
+
+// Drives the software outputs, the D2 output is driven by the timer.
+void PTRsetLevel(bool active)
+{
+  bool high = active ^ PTRidleHigh;
+
+  PTRactive = active;
+  if(PTRout == PTRoutPin)
+  {
+    if(high) PTRpio->PIO_SODR = PTRpin;
+    else PTRpio->PIO_CODR = PTRpin;
+  }
+  else if(PTRout == PTRoutDIO)
+  {
+    SDIO_Set_Image(ptrdata.Output[0], high ? '1' : '0');
+    DOrefresh;
+    PulseLDAC;
+  }
+}
+
+// Starts a pulse. On the last pulse of the burst the RC compare no longer sets TIOA and
+// stops the counter, so the burst ends on time even if the ISR is late. The software trigger
+// still sets TIOA, a single pulse with no delay is started by the trigger after this call.
+void PTRstartPulse(void)
+{
+  PTRstarted++;
+  PTRsetLevel(true);
+  if((PTRcount == 0) || (PTRstarted < PTRcount))
+  {
+    PTRphase = PTRPrun;
+    return;
+  }
+  PTRtimer->setTIOAeffectNOIO(PTRwidth, TC_CMR_ACPA_CLEAR | TC_CMR_ASWTRG_SET);
+  PTRtimer->stopOnRC();
+  PTRphase = PTRPlast;
+}
+
+// RC compare, end of the delay or period. The counter value is the time since the compare.
+void PTRrcISR(void)
+{
+  uint32_t latency = PTRtimer->getCounter();
+
+  switch(PTRphase)
+  {
+    case PTRPdelay:
+      PTRtimer->setRC(PTRperiod);
+      // Fall through to start the first pulse
+    case PTRPrun:
+      if(latency > PTRmaxLatency) PTRmaxLatency = latency;
+      PTRstartPulse();
+      break;
+    case PTRPlast:
+      PTRphase = PTRPidle;
+      PTRbursts++;
+      break;
+    default:
+      break;
+  }
+}
+
+// RA compare, end of the pulse. RA also matches during the delay when the width is less
+// than the delay, that match is ignored.
+void PTRraISR(void)
+{
+  if((PTRphase == PTRPidle) || (PTRphase == PTRPdelay)) return;
+  PTRsetLevel(false);
+}
+
+// Starts a burst, called from the trigger source ISRs or the PTRTRG command.
+void PTRtrigger(void)
+{
+  if(!ptrdata.Enable || (PTRtimer == NULL)) return;
+  if(PTRphase != PTRPidle)
+  {
+    PTRmissed++;
+    return;
+  }
+  PTRstarted = 0;
+  PTRtimer->begin();
+  PTRtimer->setClock(TC_CMR_TCCLKS_TIMER_CLOCK1);
+  if(PTRdelay > 0)
+  {
+    PTRtimer->setRC(PTRdelay);
+    PTRtimer->setTIOAeffectNOIO(PTRwidth, TC_CMR_ACPA_CLEAR | TC_CMR_ACPC_SET | TC_CMR_ASWTRG_CLEAR);
+    PTRphase = PTRPdelay;
+  }
+  else
+  {
+    PTRtimer->setRC(PTRperiod);
+    PTRtimer->setTIOAeffectNOIO(PTRwidth, TC_CMR_ACPA_CLEAR | TC_CMR_ACPC_SET | TC_CMR_ASWTRG_SET);
+    PTRstartPulse();
+  }
+  PTRtimer->softwareTrigger();
+}
+
+// Removes the generator from all the trigger sources
+void PTRclearTriggers(void)
+{
+  AtomicBlock< Atomic_RestoreState > a_Block;
+  if(TableStartFunction == PTRtrigger) TableStartFunction = NULL;
+  if(AuxTriggerFunction == PTRtrigger) AuxTriggerFunction = NULL;
+  QueueTpulseFunction(PTRtrigger, false);
+  if(PTRdi != NULL) PTRdi->detach();
+}
+
+// Stops the timer and returns the output to its idle level
+void PTRstop(void)
+{
+  AtomicBlock< Atomic_RestoreState > a_Block;
+  ptrdata.Enable = false;
+  PTRphase = PTRPidle;
+  if(PTRactive) PTRsetLevel(false);
+  // Leave the timer alone if another user has taken it
+  if((PTRtimer == NULL) || !PTRtimerUser.Active) return;
+  PTRtimer->stop();
+  if(PTRout == PTRoutHW)
+  {
+    // Force TIOA low in case the timer was stopped in a pulse
+    PTRtimer->setTIOAeffectNOIO(PTRwidth, TC_CMR_ASWTRG_CLEAR);
+    PTRtimer->softwareTrigger();
+    PTRtimer->stop();
+  }
+}
+
+// Called by the timer manager with interrupts disabled when a higher priority user takes
+// the timer.
+void PTRrelease(void)
+{
+  if(PTRtimer != NULL) PTRtimer->stop();
+  ptrdata.Enable = false;
+  PTRphase = PTRPidle;
+}
+
+//
+// Host commands
+//
+
+void PTRsetOutput(char *output)
+{
+  Pio      *pio;
+  uint32_t pin;
+
+  if((strlen(output) >= sizeof(ptrdata.Output)) || (PTRoutputType(output, &pio, &pin) == -1)) BADARG;
+  strcpy(ptrdata.Output, output);
+  SendACK;
+}
+
+void PTRsetTrigger(char *source, char *level)
+{
+  int dil;
+
+  if((strcmp(source, "SW") == 0) || (strcmp(source, "TABLE") == 0) || (strcmp(source, "TRIGOUT") == 0) || (strcmp(source, "AUX") == 0))
+  {
+    strcpy(ptrdata.Source, source);
+    strcpy(ptrdata.Level, "NA");
+    SendACK;
+    return;
+  }
+  if(FindInList(DIlist, source) < 2) BADARG;
+  // DILlist is NA,LOW,HIGH,BOTH,NEG,POS, BOTH thru POS map to CHANGE, FALLING, and RISING
+  dil = FindInList(DILlist, level) - 2;
+  if((dil != CHANGE) && (dil != FALLING) && (dil != RISING)) BADARG;
+  strcpy(ptrdata.Source, source);
+  strcpy(ptrdata.Level, level);
+  SendACK;
+}
+
+void PTRreportTrigger(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  serial->print(ptrdata.Source);
+  serial->print(",");
+  serial->println(ptrdata.Level);
+}
+
+void PTRsetEnable(char *state)
+{
+  float minPeriod;
+  int   type;
+
+  if(strcmp(state, "FALSE") == 0)
+  {
+    PTRclearTriggers();
+    PTRstop();
+    TimerRelease(&PTRtimerUser);
+    SendACK;
+    return;
+  }
+  if(strcmp(state, "TRUE") != 0) BADARG;
+  if((type = PTRoutputType(ptrdata.Output, &PTRpio, &PTRpin)) == -1) BADARG;
+  minPeriod = PTRminPeriodHW;
+  if(type == PTRoutPin) minPeriod = PTRminPeriodSW;
+  if(type == PTRoutDIO) minPeriod = PTRminPeriodDIO;
+  if((ptrdata.Width <= 0) || (ptrdata.Period < minPeriod) || (ptrdata.Period > PTRmaxTime)) BADARG;
+  if((ptrdata.Period - ptrdata.Width) < PTRminGap) BADARG;
+  if((ptrdata.Delay < 0) || (ptrdata.Delay > PTRmaxTime) || (ptrdata.Count < 0)) BADARG;
+  if(!TimerClaim(&PTRtimerUser)) ERR(ERR_TIMERINUSE);
+  PTRclearTriggers();
+  PTRstop();
+  // Timer 0 is shared with the delayed trigger, the callbacks are set after every claim
+  if(PTRtimer == NULL) PTRtimer = new MIPStimer(TMR_PulseTrain);
+  PTRtimer->detachInterrupt();
+  PTRtimer->begin();
+  PTRtimer->attachInterrupt(PTRrcISR);
+  // The compare hardware ends the pulse on D2, only the software outputs need the RA interrupt
+  if(type != PTRoutHW) PTRtimer->attachInterruptRA(PTRraISR);
+  PTRout = type;
+  PTRwidth = ptrdata.Width * PTRticksPerUS;
+  PTRperiod = ptrdata.Period * PTRticksPerUS;
+  PTRdelay = ptrdata.Delay * PTRticksPerUS;
+  PTRcount = ptrdata.Count;
+  if(PTRout == PTRoutHW) PTRtimer->setTIOAeffect(PTRwidth, TC_CMR_ASWTRG_CLEAR);
+  else if(PTRout == PTRoutPin) PTRidleHigh = (PTRpio->PIO_ODSR & PTRpin) != 0;
+  else PTRidleHigh = ((ptrdata.Output[0] >= 'I' ? MIPSconfigData.DOmsb : MIPSconfigData.DOlsb) >> ((ptrdata.Output[0] - 'A') & 7)) & 1;
+  PTRbursts = PTRmissed = PTRmaxLatency = 0;
+  // Connect the trigger source
+  if(strcmp(ptrdata.Source, "TABLE") == 0) TableStartFunction = PTRtrigger;
+  else if(strcmp(ptrdata.Source, "AUX") == 0) AuxTriggerFunction = PTRtrigger;
+  else if(strcmp(ptrdata.Source, "TRIGOUT") == 0)
+  {
+    if(!QueueTpulseFunction(PTRtrigger, true))
+    {
+      TimerRelease(&PTRtimerUser);
+      ERR(ERR_INTERNAL);
+    }
+  }
+  else if(strcmp(ptrdata.Source, "SW") != 0)
+  {
+    if(PTRdi == NULL) PTRdi = new DIhandler;
+    if(PTRdi == NULL)
+    {
+      TimerRelease(&PTRtimerUser);
+      ERR(ERR_INTERNAL);
+    }
+    PTRdi->attached(ptrdata.Source[0], FindInList(DILlist, ptrdata.Level) - 2, PTRtrigger);
+  }
+  ptrdata.Enable = true;
+  SendACK;
+}
+
+void PTRsoftwareTrigger(void)
+{
+  if(!ptrdata.Enable) ERR(ERR_PTRNOTENABLED);
+  {
+    AtomicBlock< Atomic_RestoreState > a_Block;
+    PTRtrigger();
+  }
+  SendACK;
+}
+
+void PTRreportStatus(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  if(ptrdata.Enable) serial->print("TRUE,");
+  else serial->print("FALSE,");
+  serial->print(PTRbursts);
+  serial->print(",");
+  serial->print(PTRmissed);
+  serial->print(",");
+  serial->println((float)PTRmaxLatency * 1000.0 / PTRticksPerUS, 0);
+}
+
+// Measures the output timing from the capture records for an input wired to the output,
+// the records are not removed. The leading edge is rising unless the input captures only
+// falling edges. An interval longer than 1.5 periods is a gap between bursts and is not
+// used. Widths are only reported when the input captures both edges.
+void PTRreportJitter(char *input)
+{
+  DICrecord *rec;
+  uint64_t  t, lead = 0;
+  uint32_t  head, d, expected;
+  uint32_t  minP = 0xFFFFFFFF, maxP = 0, minW = 0xFFFFFFFF, maxW = 0;
+  uint32_t  periods = 0;
+  float     sum = 0, nS = 1000000000.0 / (float)VARIANT_MCK;
+  bool      haveLead = false, inPulse = false;
+  int       i, leadLevel;
+
+  if((i = DIcaptureInput(input)) == -1) BADARG;
+  leadLevel = 1;
+  if(dicdata.Edge[i] == FALLING) leadLevel = 0;
+  expected = ptrdata.Period * ((float)VARIANT_MCK / 1000000.0);
+  head = dicdata.Head;
+  for(uint32_t n = dicdata.Tail; n != head; n++)
+  {
+    rec = &dicdata.Rec[n & (DICmaxRecords - 1)];
+    if(rec->Input != i) continue;
+    t = ((uint64_t)rec->TimeHigh << 32) | rec->Time;
+    if(rec->Level == leadLevel)
+    {
+      if(haveLead && ((d = t - lead) < (expected + expected / 2)))
+      {
+        periods++;
+        sum += d;
+        if(d < minP) minP = d;
+        if(d > maxP) maxP = d;
+      }
+      lead = t;
+      haveLead = inPulse = true;
+    }
+    else if(inPulse)
+    {
+      d = t - lead;
+      if(d < minW) minW = d;
+      if(d > maxW) maxW = d;
+      inPulse = false;
+    }
+  }
+  SendACKonly;
+  if(SerialMute) return;
+  if(periods == 0) minP = 0;
+  if(maxW == 0) minW = 0;
+  serial->print(periods);
+  serial->print(",");
+  if(periods > 0) serial->print(sum / (float)periods * nS, 0);
+  else serial->print("0");
+  serial->print(",");
+  serial->print((float)minP * nS, 0);
+  serial->print(",");
+  serial->print((float)maxP * nS, 0);
+  serial->print(",");
+  serial->print((float)(maxP - minP) * nS, 0);
+  serial->print(",");
+  serial->print((float)minW * nS, 0);
+  serial->print(",");
+  serial->println((float)maxW * nS, 0);
+}
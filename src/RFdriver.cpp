@@ -95,28 +95,44 @@ float RFnVpp;
 float Power;
 
 // Auto tune parameters
-bool TuneRequest     = false;
-bool RetuneRequest   = false;
-bool Tuning          = false;
+bool Tuning          = false;   // True if any model 1 channel is tuning
 bool Tuning2         = false;
-bool TuneReport      = false;
 bool TuneAbort       = false;
 bool TuneRFfullRange = false;
 int  TuningChannel   = 0;
-int  TuneRFChan;
-int  TuneRFBoard;
+RFtuneState RFtune[2][2];       // Model 1 tune state, board, channel
+float RFrawVpps[2][2];          // Unfiltered RF+ plus RF- amplitude, used by auto tune
 
 // Tune states
+#define TUNE_IDLE      0
 #define TUNE_SCAN_DOWN 1
-#define TUNE_SCAN_UP 2
-
-#define MaxNumDown 5
-#define MAXSTEP    100000
+#define TUNE_SCAN_UP   2
+#define TUNE_START     3
+#define TUNE_RESTART   4
+#define TUNE_FIT       5
+
+#define MaxNumDown    5
+#define MAXSTEP       100000
+#define MaxShifts     10        // Limit on fit window moves in a fine stage
+#define TunePassMax   20        // Maximum loop passes to wait for a sample to settle
+#define TuneSettleV   1.0       // A sample has settled when two readings agree within this
+#define TuneSettleTol 0.01      // voltage or this fraction of the reading, whichever is larger
+
+// Closed loop control parameters, model 1 drivers only. The gains are not saved in the module
+// EEPROM, the defaults are used after power up.
+#define RFpiKp       0.002      // Default proportional gain, %/V
+#define RFpiKi       0.04       // Default integral gain, %/V/s, same integral action as the old controller
+#define RFpiSlew     20.0       // Default drive slew limit, %/s
+#define RFpiFilter   0.5        // Amplitude filter for the controller, much lighter than Filter
+#define RFpwrBackoff 1.0        // Drive reduction rate when over the power limit, %/s
+RFpiControl RFpi[2][2] = {{{RFpiKp, RFpiKi, RFpiSlew}, {RFpiKp, RFpiKi, RFpiSlew}}, {{RFpiKp, RFpiKi, RFpiSlew}, {RFpiKp, RFpiKi, RFpiSlew}}};
+int RFctlLogCH = 0;             // Channel to log the control loop for, 0 = disabled
 
 // Arc detection parameters
 int   RFarcCH = 0;
 float RFarcDrv = 0;
 float RFarcV = 0;
+FaultChannel RFarcFault = {"RFARC", 1, 0, 0, 0};   // Trips on the first detection, no automatic restart
 
 bool  RFgatingOff = false;
 DIhandler *DIh[2][2];
@@ -187,11 +203,7 @@ void RFat(void)
     TWIcmd(RFdrvCMDadd(RFDDarray[SelectedRFBoard]->EEPROMadr), SelectedRFBoard, TWI_RF_SET_ATUNE);
     DisplayMessage("Tune in process");
   }
-  else
-  {
-    TuneRFChan = SelectedRFChan;
-    TuneRequest = true;  
-  }
+  else RFtuneStart(SelectedRFChan, false, false);
 }
 
 // Called from the UI to enable auto retune, only works in manual mode
@@ -211,11 +223,7 @@ void RFart(void)
     TWIcmd(RFdrvCMDadd(RFDDarray[SelectedRFBoard]->EEPROMadr), SelectedRFBoard, TWI_RF_SET_RTUNE);
     DisplayMessage("Retune in process");
   }
-  else
-  {
-    TuneRFChan = SelectedRFChan;
-    RetuneRequest = true;  
-  }
+  else RFtuneStart(SelectedRFChan, true, false);
 }
 
 void RFmodeChange(void)
@@ -421,6 +429,7 @@ void RFdriver_init(int8_t Board, int8_t addr)
 {
   DialogBox *sd;
   
+  FaultRegister(&RFarcFault);
   // Determine if this is a model 2 module connected via TWI
   if(TWItest(RFdrvCMDadd(addr)))
   {
@@ -514,198 +523,358 @@ void RFdriver_init(int8_t Board, int8_t addr)
 
 // This function checks the power limits and performs control functions.
 // This function is only valid for model 1 drivers.
+//
+// In auto mode the drive level is set by a PI controller. The drive is limited to MaxDrive and
+// by the slew rate, and the limit is lowered at RFpwrBackoff while the head power is over
+// MaxPower. When the output is limited the integrator is back calculated so it does not wind
+// up. In manual mode the drive level is reduced at the same rate while over the power limit.
 void RFcontrol(void)
 {
-  int board, chan;
-  float es,g;
-
-  // Check the power and reduce the drive level if power is over its limit
-  for (board = 0; board < 2; board++)
-  {
-    for (chan = 0; chan < 2; chan++)
+  static uint32_t LastTime = 0;
+  RFpiControl   *pi;
+  RFchannelData *cd;
+  int   board, chan;
+  float dt, e, P, u, umax;
+
+  dt = (float)(millis() - LastTime) / 1000.0;
+  LastTime = millis();
+  if((dt <= 0) || (dt > 1.0)) dt = 0.1;
+  for (int i = 0; i < NumberOfRFChannels; i++)
+  {
+    board = BoardFromSelectedChannel(i);
+    if((board > 1) || RFdriverModel2[board]) continue;
+    chan = i & 1;
+    pi = &RFpi[board][chan];
+    cd = &RFDDarray[board]->RFCD[chan];
+    pi->Vpp = RFpiFilter * RFrawVpps[board][chan] / 2 + (1 - RFpiFilter) * pi->Vpp;
+    if (cd->RFmode != RF_AUTO)
     {
-      if (Powers[board][chan] > RFDDarray[board]->RFCD[chan].MaxPower) RFDDarray[board]->RFCD[chan].DriveLevel -= 0.1;
-      if (RFDDarray[board]->RFCD[chan].DriveLevel < 0) RFDDarray[board]->RFCD[chan].DriveLevel = 0;
-      // Only process if  this channel is not gated off
-      if(!DIh[board][chan]->test(RFDDarray[board]->RFgateTrig[chan])) continue;
-      if ((SelectedRFBoard == board) && ((SelectedRFChan & 1) == chan))
-      {
-        RFCD.DriveLevel = RFDDarray[board]->RFCD[chan].DriveLevel;
-      }
-      // If we are in auto mode (closed loop control) then adjust drive as needed to maintain Vpp
-      if (RFDDarray[board]->RFCD[chan].RFmode == RF_AUTO)
+      pi->Active = false;
+      if (Powers[board][chan] > cd->MaxPower) cd->DriveLevel -= RFpwrBackoff * dt;
+      if (cd->DriveLevel < 0) cd->DriveLevel = 0;
+    }
+    // Only process if  this channel is not gated off
+    else if(DIh[board][chan]->test(RFDDarray[board]->RFgateTrig[chan]))
+    {
+      if(!pi->Active)
       {
-        if(((RFpVpps[board][chan] + RFnVpps[board][chan]) / 2) > RFDDarray[board]->RFCD[chan].Setpoint) es = ((RFpVpps[board][chan] + RFnVpps[board][chan]) / 2) / RFDDarray[board]->RFCD[chan].Setpoint;
-        if(((RFpVpps[board][chan] + RFnVpps[board][chan]) / 2) < RFDDarray[board]->RFCD[chan].Setpoint) es = RFDDarray[board]->RFCD[chan].Setpoint / ((RFpVpps[board][chan] + RFnVpps[board][chan]) / 2);
-        es = abs(RFDDarray[board]->RFCD[chan].Setpoint - ((RFpVpps[board][chan] + RFnVpps[board][chan]) / 2));
-        g = es * 0.05;
-        if (((RFpVpps[board][chan] + RFnVpps[board][chan]) / 2) > RFDDarray[board]->RFCD[chan].Setpoint) RFDDarray[board]->RFCD[chan].DriveLevel -= 0.08 * g;
-        else RFDDarray[board]->RFCD[chan].DriveLevel += 0.08 * g;
-        RFDDarray[board]->RFCD[chan].DriveLevel = (float)((int)(RFDDarray[board]->RFCD[chan].DriveLevel * 100)) / 100.0;        
-        if (RFDDarray[board]->RFCD[chan].DriveLevel < 0) RFDDarray[board]->RFCD[chan].DriveLevel = 0;
-        if (RFDDarray[board]->RFCD[chan].DriveLevel > RFDDarray[board]->RFCD[chan].MaxDrive) RFDDarray[board]->RFCD[chan].DriveLevel = RFDDarray[board]->RFCD[chan].MaxDrive;
-        if ((SelectedRFBoard == board) && ((SelectedRFChan & 1) == chan))
-        {
-          RFCD.DriveLevel = RFDDarray[board]->RFCD[chan].DriveLevel;
-        }
+        // Bumpless start from the current drive level
+        pi->Integral = cd->DriveLevel;
+        pi->Vpp = (RFpVpps[board][chan] + RFnVpps[board][chan]) / 2;
+        pi->Active = true;
       }
+      e = cd->Setpoint - pi->Vpp;
+      P = pi->Kp * e;
+      pi->Integral += pi->Ki * e * dt;
+      u = P + pi->Integral;
+      umax = cd->MaxDrive;
+      if ((Powers[board][chan] > cd->MaxPower) && (umax > cd->DriveLevel - RFpwrBackoff * dt)) umax = cd->DriveLevel - RFpwrBackoff * dt;
+      if (u > cd->DriveLevel + pi->Slew * dt) u = cd->DriveLevel + pi->Slew * dt;
+      if (u < cd->DriveLevel - pi->Slew * dt) u = cd->DriveLevel - pi->Slew * dt;
+      if (u > umax) u = umax;
+      if (u < 0) u = 0;
+      // Anti windup, the integrator holds the applied drive less the proportional term
+      if (u != P + pi->Integral) pi->Integral = u - P;
+      cd->DriveLevel = u;
+    }
+    if ((SelectedRFBoard == board) && ((SelectedRFChan & 1) == chan))
+    {
+      RFCD.DriveLevel = cd->DriveLevel;
+    }
+    // Step response log, time in mS, setpoint, amplitude, drive, integrator
+    if ((RFctlLogCH == i + 1) && !SerialMute)
+    {
+      serial->print("RFCTL,");
+      serial->print(millis());
+      serial->print(",");
+      serial->print(cd->Setpoint);
+      serial->print(",");
+      serial->print(pi->Vpp);
+      serial->print(",");
+      serial->print(cd->DriveLevel);
+      serial->print(",");
+      serial->println(pi->Integral);
     }
   }
 }
 
-// Auto tune algorithm, procedure is as follows:
-// 1.) Set power tp 10%
-// 2.) Set frequency to 1MHz
-// 3.) Go down in frequency in 100KHz steps and record amplitude, stop when 5 steps in a row are all decreasing
-// 4.) Go up in frequency from 1MHzin 100KHz steps and record amplitude, stop when 5 steps in a row are all decreasing
-// 5.) Use the peak found in steps 3 and 4 and sweep in 10K steps using the same procedure in 3 and 4
-// 6.) Use the peak found in step 5 and sweep in 1K steps using the same procedure in 3 and 4
-// 7.) Done!
+// Auto tune algorithm for model 1 drivers. Each channel has its own state machine so channels on
+// different boards tune at the same time. The procedure is as follows:
+// 1.) Set power to 10% and frequency to 1MHz
+// 2.) Coarse scan, go down in frequency in 100KHz steps and record amplitude, stop when 5 steps in
+//     a row are all decreasing. Then go up from 1MHz in 100KHz steps using the same procedure.
+// 3.) Fit a resonance model to the peak sample and its two neighbors and move to the fitted peak.
+// 4.) Fine stages, measure the amplitude one step below and above the fitted peak using 10KHz
+//     steps. If an edge sample is the largest the window moves that way, else the model is fit
+//     again and the step is reduced to 1KHz for the final stage.
+// 5.) Done!
+// Retune starts at the current frequency and runs only the 1KHz stage.
+//
+// A sample is taken once the unfiltered amplitude read on two loop passes in a row agree, or
+// after TunePassMax passes. The heads respond in a few mS so this is normally 2 passes, the
+// filtered readback values take several seconds to settle and are not used here.
 //
-// Called from the main processing loop, this function does not block, uses a state machine to perform thge logic
-// States
-//  TUNE_SCAN_DOWN
-//  TUNE_SCAN_UP
-// Only valid for model 1 drivers
+// The resonance is close to a Lorentzian near the peak, for a Lorentzian 1/A^2 is a parabola in
+// frequency so the peak is found by fitting a parabola to 1/A^2 through the three samples.
+//
+// Called from the main processing loop, this function does not block.
+// Only valid for model 1 drivers.
+
+// Start auto tune or retune on a model 1 channel, chan is 0 to 3. The tune state machine
+// starts on the next loop pass. Returns false if a channel on this board is already tuning.
+bool RFtuneStart(int chan, bool retune, bool report)
+{
+  int brd = BoardFromSelectedChannel(chan);
+
+  if((brd < 0) || (brd > 1) || RFtuneBusy(brd)) return false;
+  if(retune) RFtune[brd][chan & 1].State = TUNE_RESTART;
+  else RFtune[brd][chan & 1].State = TUNE_START;
+  RFtune[brd][chan & 1].Report = report;
+  RFtune[brd][chan & 1].Chan = chan;
+  if(!Tuning)
+  {
+    TuneAbort = false;
+    ButtonPressed = false;
+    if(retune) DisplayMessage("Retune in process");
+    else DisplayMessage("Tune in process");
+  }
+  Tuning = true;
+  return true;
+}
+
+// Returns true if a channel on this model 1 board is tuning.
+bool RFtuneBusy(int brd)
+{
+  if((brd < 0) || (brd > 1)) return false;
+  if((RFtune[brd][0].State != TUNE_IDLE) || (RFtune[brd][1].State != TUNE_IDLE)) return true;
+  return false;
+}
+
+// Set the frequency of the next sample, the loop applies it to the clock generator.
+void RFtuneSetFreq(int brd, int ch, int freq)
+{
+  if(freq < MinFreq) freq = MinFreq;
+  if(freq > MaxFreq) freq = MaxFreq;
+  RFtune[brd][ch].Freq = freq;
+  RFtune[brd][ch].Passes = 0;
+  RFDDarray[brd]->RFCD[ch].Freq = freq;
+}
+
+// Returns true when the amplitude at the current frequency has settled, the amplitude is
+// returned in amp.
+bool RFtuneSettled(RFtuneState *ts, float raw, float *amp)
+{
+  ts->Passes++;
+  if((ts->Passes >= 2) && ((abs(raw - ts->Prev) <= max(TuneSettleV, raw * TuneSettleTol)) || (ts->Passes >= TunePassMax)))
+  {
+    *amp = (raw + ts->Prev) / 2;
+    return true;
+  }
+  ts->Prev = raw;
+  return false;
+}
+
+// Clears the peak and its neighbors at the start of a stage
+void RFtuneClearPeak(RFtuneState *ts, int freq)
+{
+  ts->FreqMax = freq;
+  ts->Amp[0] = ts->Amp[1] = ts->Amp[2] = -1;
+  ts->Shifts = 0;
+}
+
+// Records a coarse scan sample, tracking the peak and the samples one step either side of it.
+void RFtuneRecord(RFtuneState *ts, float amp)
+{
+  if(amp > ts->Amp[1])
+  {
+    ts->Amp[0] = ts->Amp[2] = -1;
+    if(ts->LastFreq == ts->Freq - ts->Step) ts->Amp[0] = ts->Last;
+    if(ts->LastFreq == ts->Freq + ts->Step) ts->Amp[2] = ts->Last;
+    ts->Amp[1] = amp;
+    ts->FreqMax = ts->Freq;
+  }
+  else if(ts->Freq == ts->FreqMax - ts->Step) ts->Amp[0] = amp;
+  else if(ts->Freq == ts->FreqMax + ts->Step) ts->Amp[2] = amp;
+  if(ts->Freq == ts->Start) ts->StartAmp = amp;
+  ts->LastFreq = ts->Freq;
+  ts->Last = amp;
+}
+
+// Returns the peak frequency from the model fit, if the three points are not all valid
+// or do not bracket a peak the peak sample frequency is returned.
+int RFtunePeak(RFtuneState *ts)
+{
+  float y0,y1,y2,d;
+
+  if((ts->Amp[0] <= 0) || (ts->Amp[1] <= 0) || (ts->Amp[2] <= 0)) return ts->FreqMax;
+  y0 = 1.0 / (ts->Amp[0] * ts->Amp[0]);
+  y1 = 1.0 / (ts->Amp[1] * ts->Amp[1]);
+  y2 = 1.0 / (ts->Amp[2] * ts->Amp[2]);
+  d = y0 - 2.0 * y1 + y2;
+  if(d <= 0) return ts->FreqMax;
+  d = (float)ts->Step * (y0 - y2) / (2.0 * d);
+  if(d > ts->Step) d = ts->Step;
+  if(d < -ts->Step) d = -ts->Step;
+  return ts->FreqMax + (int)d;
+}
+
+// Starts a fine stage centered on freq, the center is kept far enough from the limits
+// for both neighbors to be measured.
+void RFtuneFine(int brd, int ch, int step, int freq)
+{
+  RFtuneState *ts = &RFtune[brd][ch];
+
+  if(freq < MinFreq + step) freq = MinFreq + step;
+  if(freq > MaxFreq - step) freq = MaxFreq - step;
+  ts->Step = step;
+  RFtuneClearPeak(ts, freq);
+  ts->State = TUNE_FIT;
+  RFtuneSetFreq(brd, ch, freq - step);
+}
+
+// Called when all three fit points are measured. Moves the window if an edge is the
+// largest, else fits the peak and starts the next stage or finishes.
+// Returns true when tuning is complete.
+bool RFtuneEvaluate(int brd, int ch)
+{
+  RFtuneState *ts = &RFtune[brd][ch];
+  int freq;
+
+  if((ts->Amp[0] > ts->Amp[1]) && (ts->Amp[0] >= ts->Amp[2]) && (ts->FreqMax - 2 * ts->Step >= MinFreq) && (ts->Shifts < MaxShifts))
+  {
+    ts->FreqMax -= ts->Step;
+    ts->Amp[2] = ts->Amp[1];
+    ts->Amp[1] = ts->Amp[0];
+    ts->Amp[0] = -1;
+    ts->Shifts++;
+    RFtuneSetFreq(brd, ch, ts->FreqMax - ts->Step);
+    return false;
+  }
+  if((ts->Amp[2] > ts->Amp[1]) && (ts->Amp[2] > ts->Amp[0]) && (ts->FreqMax + 2 * ts->Step <= MaxFreq) && (ts->Shifts < MaxShifts))
+  {
+    ts->FreqMax += ts->Step;
+    ts->Amp[0] = ts->Amp[1];
+    ts->Amp[1] = ts->Amp[2];
+    ts->Amp[2] = -1;
+    ts->Shifts++;
+    RFtuneSetFreq(brd, ch, ts->FreqMax + ts->Step);
+    return false;
+  }
+  if((ts->Amp[1] >= ts->Amp[0]) && (ts->Amp[1] >= ts->Amp[2])) freq = RFtunePeak(ts);
+  else if(ts->Amp[0] > ts->Amp[2]) freq = ts->FreqMax - ts->Step;
+  else freq = ts->FreqMax + ts->Step;
+  if(ts->Step <= 1000)
+  {
+    RFtuneSetFreq(brd, ch, freq);
+    return true;
+  }
+  RFtuneFine(brd, ch, ts->Step / 10, freq);
+  return false;
+}
+
 void RFdriver_tune(void)
 {
-   static int    TuneStep = 100000, TuneState;
-   static float  Max, Current, Last;
-   static int    FreqMax, Freq;
-   static int    NumDown,Nth;
+  RFtuneState *ts;
+  float amp;
+  bool  done;
 
-   if(TuneRequest)
-   {
-     TuneAbort = false;
-     ButtonPressed = false;
-     TuneRFBoard = BoardFromSelectedChannel(TuneRFChan); 
-     // Set freq to 1MHz
-     RFDDarray[TuneRFBoard]->RFCD[TuneRFChan & 1].Freq = 1000000;
-     // Set drive to 10%
-     RFDDarray[TuneRFBoard]->RFCD[TuneRFChan & 1].DriveLevel = 10;
-     Tuning = true;
-     TuneStep = MAXSTEP;
-     Freq = 1000000;
-     Last = Max = 0;
-     NumDown = -MaxNumDown;
-     TuneRequest = false;
-     TuneState = TUNE_SCAN_DOWN;
-     Nth = 20;
-     DisplayMessage("Tune in process");
-     return;
-   }
-   if(RetuneRequest)
-   {
-     TuneAbort = false;
-     ButtonPressed = false;
-     TuneRFBoard = BoardFromSelectedChannel(TuneRFChan); 
-     // Set freq to current
-     Freq = RFDDarray[TuneRFBoard]->RFCD[TuneRFChan & 1].Freq;
-     Tuning = true;
-     TuneStep = 1000;
-     Last = Max = 0;
-     NumDown = 0;
-     RetuneRequest = false;
-     TuneState = TUNE_SCAN_DOWN;
-     Nth = 20;
-     DisplayMessage("Retune in process");
-     return;
-   }
-   if(!Tuning) return;
-   // Here if the system is tuning
-   if((TuneAbort) || (ButtonPressed))
-   {
-      TuneAbort = false;
-      ButtonPressed = false;
-      Tuning = false;
-      DismissMessage();
-      if(TuneReport && !SerialMute)
+  if(!Tuning) return;
+  Tuning = false;
+  for(int b=0;b<2;b++)
+  {
+    if((rfddarray[b] == NULL) || RFdriverModel2[b]) continue;
+    for(int c=0;c<2;c++)
+    {
+      ts = &RFtune[b][c];
+      if(ts->State == TUNE_IDLE) continue;
+      if((TuneAbort) || (ButtonPressed))
       {
-        serial->print("Auto tune aborted, channel = ");
-        serial->println(TuneRFChan + 1);
-      }
-      TuneReport = false;
-      return;    
-   }
-   if(--Nth > 0) return;
-   Nth = 20;
-   Current = RFpVpps[TuneRFBoard][TuneRFChan & 1] + RFnVpps[TuneRFBoard][TuneRFChan & 1];
-   TuneRFBoard = BoardFromSelectedChannel(TuneRFChan);
-   switch (TuneState)
-   {
-     case TUNE_SCAN_DOWN:
-        if(Current <= (Last + 1)) NumDown++;
-        else 
-        {
-          NumDown = 0;
-          if(TuneStep == MAXSTEP) NumDown = -MaxNumDown;
-        }
-        RFDDarray[TuneRFBoard]->RFCD[TuneRFChan & 1].Freq -= TuneStep;
-        if((NumDown >= MaxNumDown) || (RFDDarray[TuneRFBoard]->RFCD[TuneRFChan & 1].Freq < MinFreq))
-        {
-          TuneState = TUNE_SCAN_UP;
-          RFDDarray[TuneRFBoard]->RFCD[TuneRFChan & 1].Freq = Freq;
-          NumDown = 0;
-          if(TuneStep == MAXSTEP) NumDown = -MaxNumDown;
-        }
-        if(Current > Max)  // Move this code here to force tune system to not use the limit value
-        {
-          Max = Current;
-          FreqMax = RFDDarray[TuneRFBoard]->RFCD[TuneRFChan & 1].Freq;
-        }
-        if(Current <= (Last + 1)) NumDown++;
-        break;
-     case TUNE_SCAN_UP:
-        if(Current > Max)
-        {
-          Max = Current;
-          FreqMax = RFDDarray[TuneRFBoard]->RFCD[TuneRFChan & 1].Freq;
-        }
-        if(Current <= (Last + 1)) NumDown++;
-        else 
+        ts->State = TUNE_IDLE;
+        if(ts->Report && !SerialMute)
         {
-          NumDown = 0;
-          if(TuneStep == MAXSTEP) NumDown = -MaxNumDown;
+          serial->print("Auto tune aborted, channel = ");
+          serial->println(ts->Chan + 1);
         }
-        if((Current == 0) && (Last == 0)) NumDown--;
-        if((TuneRFfullRange) && (TuneStep == MAXSTEP)) NumDown = 0;
-        RFDDarray[TuneRFBoard]->RFCD[TuneRFChan & 1].Freq += TuneStep;
-        if((NumDown >= MaxNumDown) || (RFDDarray[TuneRFBoard]->RFCD[TuneRFChan & 1].Freq > MaxFreq))
-        {
-          // Here we have found the peak for this step size, this
-          // process repeats until step size is 1KHz
-          Freq = FreqMax;
-          if(Freq < MinFreq) Freq = MinFreq;
-          if(Freq > MaxFreq) Freq = MaxFreq;
-          RFDDarray[TuneRFBoard]->RFCD[TuneRFChan & 1].Freq = Freq;
-          if(TuneStep == 1000)
-          {
-            // If here we are done!
-            Tuning = false;
-            DismissMessage();
-            if(TuneReport && !SerialMute)
-            {
-              serial->print("Auto tune complete, channel = ");
-              serial->print(TuneRFChan + 1);
-              serial->print(", frequency = ");
-              serial->println(Freq);
-            }
-            TuneReport = false;
-            return;
-          }
-          else 
+        continue;
+      }
+      Tuning = true;
+      done = false;
+      switch (ts->State)
+      {
+        case TUNE_START:
+          // Set drive to 10% and start the coarse scan at 1MHz
+          RFDDarray[b]->RFCD[c].DriveLevel = 10;
+          ts->Step = MAXSTEP;
+          ts->Start = 1000000;
+          ts->StartAmp = ts->Last = 0;
+          ts->LastFreq = -1;
+          ts->NumDown = -MaxNumDown;
+          RFtuneClearPeak(ts, ts->Start);
+          ts->State = TUNE_SCAN_DOWN;
+          RFtuneSetFreq(b, c, ts->Start);
+          break;
+        case TUNE_RESTART:
+          RFtuneFine(b, c, 1000, RFDDarray[b]->RFCD[c].Freq);
+          break;
+        case TUNE_SCAN_DOWN:
+          if(!RFtuneSettled(ts, RFrawVpps[b][c], &amp)) break;
+          if(amp <= (ts->Last + 1)) ts->NumDown++;
+          else ts->NumDown = -MaxNumDown;
+          RFtuneRecord(ts, amp);
+          if((ts->NumDown >= MaxNumDown) || (ts->Freq - ts->Step < MinFreq))
           {
-            if(TuneStep == MAXSTEP) TuneStep = 10000;
-            else TuneStep /= 10;
+            // Scan up from the start, the start sample is the previous sample
+            ts->State = TUNE_SCAN_UP;
+            ts->NumDown = -MaxNumDown;
+            ts->LastFreq = ts->Start;
+            ts->Last = ts->StartAmp;
+            RFtuneSetFreq(b, c, ts->Start + ts->Step);
           }
-          TuneState = TUNE_SCAN_DOWN;
-          NumDown = 0;
+          else RFtuneSetFreq(b, c, ts->Freq - ts->Step);
+          break;
+        case TUNE_SCAN_UP:
+          if(!RFtuneSettled(ts, RFrawVpps[b][c], &amp)) break;
+          if(amp <= (ts->Last + 1)) ts->NumDown++;
+          else ts->NumDown = -MaxNumDown;
+          if((amp == 0) && (ts->Last == 0)) ts->NumDown--;
+          if(TuneRFfullRange) ts->NumDown = 0;
+          RFtuneRecord(ts, amp);
+          if((ts->NumDown >= MaxNumDown) || (ts->Freq + ts->Step > MaxFreq)) RFtuneFine(b, c, 10000, RFtunePeak(ts));
+          else RFtuneSetFreq(b, c, ts->Freq + ts->Step);
+          break;
+        case TUNE_FIT:
+          if(!RFtuneSettled(ts, RFrawVpps[b][c], &amp)) break;
+          ts->Amp[(ts->Freq - ts->FreqMax) / ts->Step + 1] = amp;
+          // Measure the next missing point, evaluate when all three are known
+          if(ts->Amp[0] < 0) RFtuneSetFreq(b, c, ts->FreqMax - ts->Step);
+          else if(ts->Amp[1] < 0) RFtuneSetFreq(b, c, ts->FreqMax);
+          else if(ts->Amp[2] < 0) RFtuneSetFreq(b, c, ts->FreqMax + ts->Step);
+          else done = RFtuneEvaluate(b, c);
+          break;
+        default:
+          ts->State = TUNE_IDLE;
+          break;
+      }
+      if(done)
+      {
+        ts->State = TUNE_IDLE;
+        if(ts->Report && !SerialMute)
+        {
+          serial->print("Auto tune complete, channel = ");
+          serial->print(ts->Chan + 1);
+          serial->print(", frequency = ");
+          serial->println(ts->Freq);
         }
-        break;
-     default:
-        break;
-   }
-   Last = Current;
+      }
+    }
+  }
+  for(int b=0;b<2;b++) for(int c=0;c<2;c++) if(RFtune[b][c].State != TUNE_IDLE) Tuning = true;
+  if(!Tuning)
+  {
+    TuneAbort = false;
+    ButtonPressed = false;
+    DismissMessage();
+  }
 }
 
 float RFdriverCounts2Volts(int Rev, int ADCcounts, ADCchan *adcchan)
@@ -896,6 +1065,8 @@ void RFdriver_loop_model1(void)
         Pv = PWLlookup(i+1,0,ADCvals[RFDD->RFCD[i & 1].RFpADCchan.Chan]);
         Nv = PWLlookup(i+1,1,ADCvals[RFDD->RFCD[i & 1].RFnADCchan.Chan]);
       }
+      // Unfiltered amplitude for auto tune
+      RFrawVpps[SelectedRFBoard][i & 1] = max(Pv + Nv, 0);
       // Filter with 1st order difference equation
       RFpVpps[SelectedRFBoard][i & 1] = Filter * Pv + (1 - Filter) * RFpVpps[SelectedRFBoard][i & 1];
       RFnVpps[SelectedRFBoard][i & 1] = Filter * Nv + (1 - Filter) * RFnVpps[SelectedRFBoard][i & 1];
@@ -906,10 +1077,10 @@ void RFdriver_loop_model1(void)
       {
          Pv = (Pv + Nv) / 2.0;   // Average unfiltered
          Nv = (RFpVpps[SelectedRFBoard][i & 1] + RFnVpps[SelectedRFBoard][i & 1]) / 2.0;  // Average filtered
-         if((Nv > 500) && (Pv < 0.75*Nv) && (RFDDarray[SelectedRFBoard]->RFCD[i & 1].DriveLevel > 0))
+         if(FaultCheck(&RFarcFault, (Nv > 500) && (Pv < 0.75*Nv) && (RFDDarray[SelectedRFBoard]->RFCD[i & 1].DriveLevel > 0), Pv))
          {
            DisplayMessageButtonDismiss(" Arc detected! ");
-           LogMessage("RF arc detected.");
+           LogEvent(LOGCtrip, LOGfault, LOGMrf, SelectedRFBoard, i & 1, Pv, "RF arc detected.");
            RFarcDrv = RFDDarray[SelectedRFBoard]->RFCD[i & 1].DriveLevel;
            RFarcV   = Nv;
            RFDDarray[SelectedRFBoard]->RFCD[i & 1].DriveLevel = 0;
@@ -1327,15 +1498,15 @@ void RFautoTune(int channel)
 
   // If channel is invalid send NAK and exit
   if (!IsChannelValid(channel)) return;
-  // Exit if we are already tuning
-  if((Tuning) || (Tuning2))
+  // Exit if we are already tuning, model 1 channels on different boards can tune at the same time
+  i = BoardFromSelectedChannel(channel - 1);
+  if((Tuning2) || (Tuning && (RFdriverModel2[i] || RFtuneBusy(i))))
   {
     SetErrorCode(ERR_TUNEINPROCESS);
     SendNAK;
     return;
   }
   // Exit if not in manual mode for this channel
-  i = BoardFromSelectedChannel(channel - 1);
   if(RFDDarray[i]->RFCD[(channel - 1) & 1].RFmode != RF_MANUAL)
   {
     SetErrorCode(ERR_NOTINMANMODE);
@@ -1352,12 +1523,7 @@ void RFautoTune(int channel)
     TWIcmd(RFdrvCMDadd(RFDDarray[i]->EEPROMadr), i, TWI_RF_SET_ATUNE);
     DisplayMessage("Tune in process");
   }
-  else
-  {
-    TuneRFChan = channel - 1;
-    TuneRequest = true;
-    TuneReport = true;   // Causes the auto tune algorithm to send report
-  }
+  else RFtuneStart(channel - 1, false, true);   // Report is sent when tuning finishes
 }
 
 // Auto retune a selected channel, this function starts and the current freq and power settings and
@@ -1368,15 +1534,15 @@ void RFautoRetune(int channel)
 
   // If channel is invalid send NAK and exit
   if (!IsChannelValid(channel)) return;
-  // Exit if we are already tuning
-  if((Tuning) || (Tuning2))
+  // Exit if we are already tuning, model 1 channels on different boards can tune at the same time
+  i = BoardFromSelectedChannel(channel - 1);
+  if((Tuning2) || (Tuning && (RFdriverModel2[i] || RFtuneBusy(i))))
   {
     SetErrorCode(ERR_TUNEINPROCESS);
     SendNAK;
     return;
   }
   // Exit if not in manual mode for this channel
-  i = BoardFromSelectedChannel(channel - 1);
   if(RFDDarray[i]->RFCD[(channel - 1) & 1].RFmode != RF_MANUAL)
   {
     SetErrorCode(ERR_NOTINMANMODE);
@@ -1393,12 +1559,7 @@ void RFautoRetune(int channel)
     TWIcmd(RFdrvCMDadd(RFDDarray[i]->EEPROMadr), i, TWI_RF_SET_RTUNE);
     DisplayMessage("Retune in process");
   }
-  else
-  {
-    TuneRFChan = channel - 1;
-    RetuneRequest = true;
-    TuneReport = true;   // Causes the auto tune algorithm to send report
-  }
+  else RFtuneStart(channel - 1, true, true);   // Report is sent when tuning finishes
 }
 
 void RFvoltageReportP(int channel)
@@ -1463,6 +1624,63 @@ void RFheadPower(int channel)
   else serial->println(Powers[i][(channel - 1) & 1]);
 }
 
+// The following functions return the filtered readback values computed by the RF driver
+// loop without sending any response to the host. They return false if the channel is invalid.
+bool RFgetReadbackP(int channel, float *fVal)
+{
+  int i;
+
+  if (!IsChannelValid(channel, false)) return false;
+  if ((i = BoardFromSelectedChannel(channel - 1)) == -1) return false;
+  if(RFdriverModel2[i])
+  {
+    if(RFrb[i][(channel - 1) & 1] == NULL) return false;
+    *fVal = RFrb[i][(channel - 1) & 1]->RFP;
+  }
+  else *fVal = RFpVpps[i][(channel - 1) & 1];
+  return true;
+}
+
+bool RFgetReadbackN(int channel, float *fVal)
+{
+  int i;
+
+  if (!IsChannelValid(channel, false)) return false;
+  if ((i = BoardFromSelectedChannel(channel - 1)) == -1) return false;
+  if(RFdriverModel2[i])
+  {
+    if(RFrb[i][(channel - 1) & 1] == NULL) return false;
+    *fVal = RFrb[i][(channel - 1) & 1]->RFN;
+  }
+  else *fVal = RFnVpps[i][(channel - 1) & 1];
+  return true;
+}
+
+bool RFgetDriveLevel(int channel, float *fVal)
+{
+  int i;
+
+  if (!IsChannelValid(channel, false)) return false;
+  if ((i = BoardFromSelectedChannel(channel - 1)) == -1) return false;
+  *fVal = RFDDarray[i]->RFCD[(channel - 1) & 1].DriveLevel;
+  return true;
+}
+
+bool RFgetPower(int channel, float *fVal)
+{
+  int i;
+
+  if (!IsChannelValid(channel, false)) return false;
+  if ((i = BoardFromSelectedChannel(channel - 1)) == -1) return false;
+  if(RFdriverModel2[i])
+  {
+    if(RFrb[i][(channel - 1) & 1] == NULL) return false;
+    *fVal = RFrb[i][(channel - 1) & 1]->PWR;
+  }
+  else *fVal = Powers[i][(channel - 1) & 1];
+  return true;
+}
+
 void GetRFpwrLimit(int channel)
 {
   int i;
@@ -1920,3 +2138,57 @@ void getRFgatedDrv(int Chan)
   if(SerialMute) return;
   serial->println(gatedDrive[Chan - 1]);
 }
+
+// The following functions set and report the closed loop control parameters for model 1 drivers.
+
+// Returns the control parameters for a channel, 1 to 4. Returns NULL and sends NAK if the
+// channel is invalid or not on a model 1 driver.
+RFpiControl *RFgetPI(int Chan)
+{
+  if (!IsChannelValid(Chan)) return NULL;
+  int brd = BoardFromSelectedChannel(Chan - 1);
+  if((brd > 1) || RFdriverModel2[brd])
+  {
+    SetErrorCode(ERR_BADARG);
+    SendNAK;
+    return NULL;
+  }
+  return &RFpi[brd][(Chan - 1) & 1];
+}
+
+// Sets a control parameter, value must be positive or zero
+void setRFpiParm(char *Chan, char *Val, int parm)
+{
+  RFpiControl *pi;
+  String token;
+  float  fval;
+
+  token = Chan;
+  if((pi = RFgetPI(token.toInt())) == NULL) return;
+  token = Val;
+  fval = token.toFloat();
+  if(fval < 0) BADARG;
+  if(parm == 0) pi->Kp = fval;
+  else if(parm == 1) pi->Ki = fval;
+  else pi->Slew = fval;
+  SendACK;
+}
+
+void getRFpiParm(int Chan, int parm)
+{
+  RFpiControl *pi;
+
+  if((pi = RFgetPI(Chan)) == NULL) return;
+  SendACKonly;
+  if(SerialMute) return;
+  if(parm == 0) serial->println(pi->Kp, 4);
+  else if(parm == 1) serial->println(pi->Ki, 4);
+  else serial->println(pi->Slew);
+}
+
+void setRFkp(char *Chan, char *Val)   { setRFpiParm(Chan, Val, 0); }
+void getRFkp(int Chan)                { getRFpiParm(Chan, 0); }
+void setRFki(char *Chan, char *Val)   { setRFpiParm(Chan, Val, 1); }
+void getRFki(int Chan)                { getRFpiParm(Chan, 1); }
+void setRFslew(char *Chan, char *Val) { setRFpiParm(Chan, Val, 2); }
+void getRFslew(int Chan)              { getRFpiParm(Chan, 2); }
@@ -141,6 +141,9 @@ const Commands  CmdArray[] = 	{
   {"LEDOVRD", CMDbool, 1, (char *)&LEDoverride},               // Override the LED operation is true, always false on startup
   {"LED",  CMDint, 1, (char *)&LEDstate},                      // Define the LEDs state you are looking for.
   {"DSPOFF", CMDbool, 1, (char *)&DisableDisplay},             // Print the UseAnalog flag, true or false
+  {"GDSPSTAT", CMDfunction, 0, (char *)DialogReportStats},     // Report dialog entries drawn/S, skipped/S, pixels/S, and SPI bytes/S
+  {"SDSPBUDGET", CMDint, 1, (char *)&DialogFrameBudget},       // Set the dialog refresh time per call in uS
+  {"GDSPBUDGET", CMDint, 0, (char *)&DialogFrameBudget},       // Report the dialog refresh time per call in uS
   {"STRTDLY", CMDint, 1, (char *)&MIPSconfigData.StartupDelay},// Startup delay in seconds
   {"CHKIMAGE",  CMDfunctionStr, 1, (char *)CheckImage},        // Reports the image file status
   {"LOADIMAGE",  CMDfunctionStr, 1, (char *)LoadImage},        // Loads an image file to the display
@@ -217,6 +220,14 @@ const Commands  CmdArray[] = 	{
   {"SLOGENA", CMDbool, 1, (char *)&logdata.enabled},                // Enables logging if TRUE, disable if FALSE
   {"GLOGENA", CMDbool, 0, (char *)&logdata.enabled},                // Returns the log enable status
   {"LOGREP", CMDfunction, 0, (char *)ReportLogEntry},               // Reports the current log entries
+  {"GLOGPG", CMDfunction, 2, (char *)ReportLogPage},                // Reports log records from sequence number, count. One record per line,
+                                                                    // seq,seconds,usec,severity,code,module,board,chan,value,message
+  {"GLOGSEQ", CMDfunction, 0, (char *)ReportLogSequence},           // Returns the sequence numbers of the oldest and next log records, first,next
+  {"CLOG", CMDfunction, 0, (char *)ClearLog},                       // Clears the log
+  {"SLOGLVL", CMDfunction, 1, (char *)SetLogLevel},                 // Sets the minimum logged severity, 0=info, 1=warning, 2=error, 3=fault
+  {"GLOGLVL", CMDint, 0, (char *)&logdata.Level},                   // Returns the minimum logged severity
+  {"SLOGSPILL", CMDbool, 1, (char *)&logdata.Spill},                // Appends log records to MIPSLOG.CSV on the SD card if TRUE
+  {"GLOGSPILL", CMDbool, 0, (char *)&logdata.Spill},                // Returns the log spill status
 // Real time clock functions. Note, no battery backup so the clock reset every time the hardware boots.
   {"STIME", CMDfunctionLine, 0, (char *)SetTime},                  // Sets the current time, 00:00:00 format
   {"GTIME", CMDfunction, 0, (char *)GetTime},                      // Returns the current time, 00:00:00 format
@@ -418,6 +429,16 @@ const Commands  CmdArray[] = 	{
   {"GRFACRCH", CMDint, 0, (char *)&RFarcCH},              // Return the RF arc detection channel
   {"GRFACV", CMDfloat, 0, (char *)&RFarcV},               // Return the voltage at last arc
   {"GRFACDRV", CMDfloat, 0, (char *)&RFarcDrv},           // Return the drive level at last arc
+  // Closed loop control parameters, model 1 RF drivers only. Not saved, defaults are used at power up
+  {"SRFKP", CMDfunctionStr, 2, (char *)setRFkp},          // Set the auto mode proportional gain, channel, gain in %/V
+  {"GRFKP", CMDfunction, 1, (char *)getRFkp},             // Return the auto mode proportional gain, channel
+  {"SRFKI", CMDfunctionStr, 2, (char *)setRFki},          // Set the auto mode integral gain, channel, gain in %/V/s
+  {"GRFKI", CMDfunction, 1, (char *)getRFki},             // Return the auto mode integral gain, channel
+  {"SRFSLEW", CMDfunctionStr, 2, (char *)setRFslew},      // Set the auto mode drive slew limit, channel, limit in %/s
+  {"GRFSLEW", CMDfunction, 1, (char *)getRFslew},         // Return the auto mode drive slew limit, channel
+  {"SRFCTLLOG", CMDint, 1, (char *)&RFctlLogCH},          // Set the RF channel to log the control loop, 0 = disabled. Each loop pass
+                                                          // sends RFCTL,time,setpoint,Vpp,drive,integrator
+  {"GRFCTLLOG", CMDint, 0, (char *)&RFctlLogCH},          // Return the RF control loop log channel
 // DIO module commands
   {"SDIO", CMDfunctionStr, 2, (char *)SDIO_Serial},	        // Set DIO output bit
   {"GDIO", CMDfunctionStr, 1, (char *)GDIO_Serial},	        // Get DIO output bit
@@ -488,7 +509,9 @@ const Commands  CmdArray[] = 	{
   {"STBLVDLT",CMDbool, 1, (char *)&tableBasedRamping},     // If true voltage delta mode is enable in table
   {"GTBLVDLT",CMDbool, 0, (char *)&tableBasedRamping},
   {"TBLCHK",CMDfunction, 0, (char *)TableCheck},           // The function tests a table for timing violations and prints the results
+  {"TBLLINT",CMDfunction, 0, (char *)TableLint},           // Table timing linter, one line per time point, table,count,uS,setup,queued,needed,gap,status, then points,violations
   {"STBLRMPENA", CMDfunctionStr, 2, (char *)EnableRamp},   // Enable the table ramp mode and set ramp ISR frequency
+  {"GTBLRMPSTAT", CMDfunction, 0, (char *)RampReportStatus},// Returns ramp timing, ticks,overruns,max ISR uS
   // ADC change triggering of table
   {"STPADJ",CMDfunction,2, (char *)SelectTPforAdjust},     // Select table time point for adjustment on ADC change detection
   {"SADJRNG",CMDfunction,2, (char *)DefineAdjustRange},    // Define the time point valid range for ADC
@@ -555,11 +578,12 @@ const Commands  CmdArray[] = 	{
   // There are two ARB sweep systems, the following commands start the sweep functions controlled
   // from the MIPS system. These work on both ARB and TWAVE systems and support only channel 1 and 2.
   // The new ARB (version 1.14 and later) support ARB module sweeping and you can use all 4 ARB board.
-  // The above setup commands work for both system. The following 3 commands are only the old system.
+  // The above setup commands work for both system. The following 4 commands are only the old system.
   // Look in the ARB secton for the new sweep start/stop/status commands.
   {"STWSGO",CMDfunction, 1, (char *)StartSweepTWSW},           // Start the sweep
   {"STWSHLT",CMDfunction, 1, (char *)StopSweepTWSW},           // Stop the sweep
   {"GTWSTA",CMDfunction, 1, (char *)GetStatusTWSW},            // Return the TWAVE sweep status
+  {"GTWSJIT",CMDfunction, 0, (char *)GetJitterTWSW},           // Return the sweep tick stats, ticks,max jitter uS,average jitter uS,TIMER or LOOP
 // Twave configuration commands  
   {"STWCCLK", CMDbool, 1, (char *)&TDarray[0].UseCommonClock},   // Flag to indicate common clock mode for two Twave modules.
   {"STWCMP", CMDbool, 1, (char *)&TDarray[0].CompressorEnabled}, // Flag to indicate Twave compressor mode is enabled.
@@ -16,6 +16,7 @@
 #include <Wire.h>
 #include "TWIext.h"
 #include "Variants.h"
+#include "TWIprofile.h"
 
 #include "AtomicBlock.h"
 int  SelectedBoard(void);
@@ -326,205 +327,171 @@ void TWIend(uint8_t add, int board)
 }
 
 // TWI command routines used to send and received various data types to and from MIPS modules.
+// All of the transactions go through TWIsend and TWIrecv, these run each transaction at the
+// module's profile clock and send a command that is not acknowledged again up to the
+// profile's retry count, see TWIprofile.h.
 
-void TWIcmd(uint8_t add, int board, int cmd)
+// Sends n bytes to the module, returns the endTransmission status, 0 if acknowledged.
+int TWIsend(uint8_t add, int board, uint8_t *buf, int n, bool atomic)
 {
+  TWIprofile *tp;
+  int        iStat, tries;
+
   AcquireTWI();
   int cb=SelectedBoard();
   SelectBoard(board);
-  Wire.beginTransmission(add);
-  Wire.write(cmd);
+  tp = TWIbegin(0, add, TWIcSmart);
+  tries = (tp == NULL) ? 0 : tp->Retries;
+  while(true)
   {
-    AtomicBlock< Atomic_RestoreState > a_Block;
-    Wire.endTransmission();
+    Wire.beginTransmission(add);
+    Wire.write(buf, n);
+    if(atomic)
+    {
+      AtomicBlock< Atomic_RestoreState > a_Block;
+      iStat = Wire.endTransmission();
+    }
+    else iStat = Wire.endTransmission();
+    if((iStat == 0) || (tries-- <= 0)) break;
+    tp->Retried++;
   }
+  TWIfinish(tp, iStat);
   if(cb != board) SelectBoard(cb);
   ReleaseTWI();
+  return iStat;
 }
 
-void TWIcmd(uint8_t add, int board, int ch, int cmd)
+// Command and read for TWIrecv, returns the number of bytes read or -1 if the command was
+// not acknowledged.
+static int TWIxfer(TWIprofile *tp, uint8_t add, uint8_t *cmd, int ncmd, uint8_t *dest, int n)
 {
-  AcquireTWI();
-  int cb=SelectedBoard();
-  SelectBoard(board);
-  Wire.beginTransmission(add);
-  Wire.write(cmd);
-  if(ch != -1) Wire.write(ch);
+  int tries = (tp == NULL) ? 0 : tp->Retries;
+  int i = 0;
+
+  while(ncmd > 0)
   {
-    AtomicBlock< Atomic_RestoreState > a_Block;
-    Wire.endTransmission();
+    Wire.beginTransmission(add);
+    Wire.write(cmd, ncmd);
+    if(Wire.endTransmission() == 0) break;
+    if(tries-- <= 0) return -1;
+    tp->Retried++;
   }
-  if(cb != board) SelectBoard(cb);
-  ReleaseTWI();
+  Wire.requestFrom((uint8_t)add, (uint8_t)n);
+  while (Wire.available())
+  {
+    if(i < n) dest[i] = Wire.read();
+    else Wire.read();
+    i++;
+  }
+  return i;
 }
 
-void TWIsetBool(uint8_t add, int board, int cmd, bool flag)
+// Sends ncmd command bytes, none if ncmd is 0, then reads n bytes into dest. Returns the
+// number of bytes read or -1 if the command was not acknowledged.
+int TWIrecv(uint8_t add, int board, uint8_t *cmd, int ncmd, uint8_t *dest, int n, bool atomic)
 {
+  TWIprofile *tp;
+  int        i;
+
   AcquireTWI();
   int cb=SelectedBoard();
   SelectBoard(board);
-  Wire.beginTransmission(add);
-  Wire.write(cmd);
-  Wire.write(flag);
+  tp = TWIbegin(0, add, TWIcSmart);
+  if(atomic)
   {
     AtomicBlock< Atomic_RestoreState > a_Block;
-    Wire.endTransmission();
+    i = TWIxfer(tp, add, cmd, ncmd, dest, n);
   }
+  else i = TWIxfer(tp, add, cmd, ncmd, dest, n);
+  TWIfinish(tp, i != n);
   if(cb != board) SelectBoard(cb);
   ReleaseTWI();
+  return i;
+}
+
+void TWIcmd(uint8_t add, int board, int cmd)
+{
+  uint8_t buf[1] = {(uint8_t)cmd};
+
+  TWIsend(add, board, buf, 1, true);
+}
+
+void TWIcmd(uint8_t add, int board, int ch, int cmd)
+{
+  uint8_t buf[2] = {(uint8_t)cmd, (uint8_t)ch};
+
+  TWIsend(add, board, buf, (ch != -1) ? 2 : 1, true);
+}
+
+void TWIsetBool(uint8_t add, int board, int cmd, bool flag)
+{
+  uint8_t buf[2] = {(uint8_t)cmd, (uint8_t)flag};
+
+  TWIsend(add, board, buf, 2, true);
 }
 
 void TWIsetByte(uint8_t add, int board, int cmd, byte bval)
 {
-  AcquireTWI();
-  int cb=SelectedBoard();
-  SelectBoard(board);
-  Wire.beginTransmission(add);
-  Wire.write(cmd);
-  Wire.write(bval);
-  {
-    //AtomicBlock< Atomic_RestoreState > a_Block;  // 11/17/22
-    Wire.endTransmission();
-  }
-  if(cb != board) SelectBoard(cb);
-  ReleaseTWI();
+  uint8_t buf[2] = {(uint8_t)cmd, bval};
+
+  TWIsend(add, board, buf, 2, false);  // Not atomic, 11/17/22
 }
 
 void TWIsetWord(uint8_t add, int board, int cmd, uint16_t wval)
 {
-  AcquireTWI();
-  int cb=SelectedBoard();
-  SelectBoard(board);
-  Wire.beginTransmission(add);
-  Wire.write(cmd);
-  Wire.write(wval & 0xFF);
-  Wire.write((wval >> 8) & 0xFF);
-  {
-    AtomicBlock< Atomic_RestoreState > a_Block;
-    Wire.endTransmission();
-  }
-  if(cb != board) SelectBoard(cb);
-  ReleaseTWI();
+  uint8_t buf[3] = {(uint8_t)cmd, (uint8_t)(wval & 0xFF), (uint8_t)((wval >> 8) & 0xFF)};
+
+  TWIsend(add, board, buf, 3, true);
+}
+
+// Sends the command followed by the first n bytes of ival, low byte first
+static void TWIsetBytes(uint8_t add, int board, int cmd, int ival, int n)
+{
+  uint8_t buf[5];
+
+  buf[0] = cmd;
+  memcpy(&buf[1], &ival, n);
+  TWIsend(add, board, buf, n + 1, true);
 }
 
 void TWIset16bitInt(uint8_t add, int board, int cmd, int ival)
 {
-  AcquireTWI();
-  int cb=SelectedBoard();
-  SelectBoard(board);
-  uint8_t *b = (uint8_t *)&ival;
-  Wire.beginTransmission(add);
-  Wire.write(cmd);
-  Wire.write(b[0]);
-  Wire.write(b[1]);
-  {
-    AtomicBlock< Atomic_RestoreState > a_Block;
-    Wire.endTransmission();
-  }
-  if(cb != board) SelectBoard(cb);
-  ReleaseTWI();  
+  TWIsetBytes(add, board, cmd, ival, 2);
 }
 
 void TWIset24bitInt(uint8_t add, int board, int cmd, int ival)
 {
-  AcquireTWI();
-  int cb=SelectedBoard();
-  SelectBoard(board);
-  uint8_t *b = (uint8_t *)&ival;
-  Wire.beginTransmission(add);
-  Wire.write(cmd);
-  Wire.write(b[0]);
-  Wire.write(b[1]);
-  Wire.write(b[2]);
-  {
-    AtomicBlock< Atomic_RestoreState > a_Block;
-    Wire.endTransmission();
-  }
-  if(cb != board) SelectBoard(cb);
-  ReleaseTWI();  
+  TWIsetBytes(add, board, cmd, ival, 3);
 }
 
 void TWIsetInt(uint8_t add, int board, int cmd, int ival)
 {
-  AcquireTWI();
-  int cb=SelectedBoard();
-  SelectBoard(board);
-  uint8_t *b = (uint8_t *)&ival;
-  Wire.beginTransmission(add);
-  Wire.write(cmd);
-  Wire.write(b[0]);
-  Wire.write(b[1]);
-  Wire.write(b[2]);
-  Wire.write(b[3]);
-  {
-    AtomicBlock< Atomic_RestoreState > a_Block;
-    Wire.endTransmission();
-  }
-  if(cb != board) SelectBoard(cb);
-  ReleaseTWI();  
+  TWIsetBytes(add, board, cmd, ival, 4);
 }
 
 void TWIsetFloat(uint8_t add, int board, int cmd, float fval)
 {
-  AcquireTWI();
-  int cb=SelectedBoard();
-  //SelectedBoard();
-  SelectBoard(board);
-  uint8_t *b = (uint8_t *)&fval;
-  Wire.beginTransmission(add);
-  Wire.write(cmd);
-  Wire.write(b[0]);
-  Wire.write(b[1]);
-  Wire.write(b[2]);
-  Wire.write(b[3]);
-  {
-    AtomicBlock< Atomic_RestoreState > a_Block;
-    Wire.endTransmission();
-  }
-  if(cb != board) SelectBoard(cb);
-  ReleaseTWI();  
+  TWIsetFloat(add, board, -1, cmd, fval);
 }
 
 void TWIsetFloat(uint8_t add, int board, int ch, int cmd, float fval)
 {
-  AcquireTWI();
-  int cb=SelectedBoard();
-  //SelectedBoard();
-  SelectBoard(board);
-  uint8_t *b = (uint8_t *)&fval;
-  Wire.beginTransmission(add);
-  Wire.write(cmd);
-  if(ch != -1) Wire.write(ch);
-  Wire.write(b[0]);
-  Wire.write(b[1]);
-  Wire.write(b[2]);
-  Wire.write(b[3]);
-  {
-    AtomicBlock< Atomic_RestoreState > a_Block;
-    Wire.endTransmission();
-  }
-  if(cb != board) SelectBoard(cb);
-  ReleaseTWI();  
+  uint8_t buf[6];
+  int     n = 0;
+
+  buf[n++] = cmd;
+  if(ch != -1) buf[n++] = ch;
+  memcpy(&buf[n], &fval, 4);
+  TWIsend(add, board, buf, n + 4, true);
 }
 
 bool TWIreadFloat(uint8_t add, int board,int ch,int cmd, float *value)
 {
-  byte *b;
-  int  i=0;
+  uint8_t buf[2] = {(uint8_t)cmd, (uint8_t)ch};
+  int     i;
 
-  AcquireTWI();
-  b = (byte *)value;
-  int cb=SelectedBoard();
-  SelectBoard(board);
-  //AtomicBlock< Atomic_RestoreState > a_Block;
-  Wire.beginTransmission(add);
-  Wire.write(cmd);
-  if(ch !=-1) Wire.write(ch);
-  if(Wire.endTransmission() !=0) {if(cb != board) SelectBoard(cb); ReleaseTWI(); return false;}
-  Wire.requestFrom((uint8_t)add, (uint8_t)4);
-  while (Wire.available()) b[i++] = Wire.read();
-  if(cb != board) SelectBoard(cb);
-  ReleaseTWI();
+  i = TWIrecv(add, board, buf, (ch != -1) ? 2 : 1, (uint8_t *)value, 4, false);
+  if(i == -1) return false;
   if((fpclassify(*value) != FP_NORMAL) && (fpclassify(*value) != FP_ZERO))
   {
     *value = 0;
@@ -541,138 +508,49 @@ bool TWIreadFloat(uint8_t add, int board,int cmd, float *value)
 
 bool TWIread32bitInt(uint8_t add, int board,int cmd, int *value)
 {
-  byte *b;
-  int  i=0;
+  uint8_t buf[1] = {(uint8_t)cmd};
 
-  AcquireTWI();
-  b = (byte *)value;
-  int cb=SelectedBoard();
-  SelectBoard(board);
-  AtomicBlock< Atomic_RestoreState > a_Block;
-  Wire.beginTransmission(add);
-  Wire.write(cmd);
-  if(Wire.endTransmission() !=0) {if(cb != board) SelectBoard(cb);ReleaseTWI(); return false;}
-  Wire.requestFrom((uint8_t)add, (uint8_t)4);
-  while (Wire.available()) b[i++] = Wire.read();
-  if(cb != board) SelectBoard(cb);
-  ReleaseTWI();
-  if(i==4) return true;
-  return false;
+  return TWIrecv(add, board, buf, 1, (uint8_t *)value, 4, true) == 4;
 }
 
 bool TWIread24bitUnsigned(uint8_t add, int board,int cmd, int *value)
 {
-  byte *b;
-  int  i=0;
+  uint8_t buf[1] = {(uint8_t)cmd};
 
-  AcquireTWI();
   *value = 0;
-  b = (byte *)value;
-  int cb=SelectedBoard();
-  SelectBoard(board);
-  AtomicBlock< Atomic_RestoreState > a_Block;
-  Wire.beginTransmission(add);
-  Wire.write(cmd);
-  if(Wire.endTransmission() !=0) {if(cb != board) SelectBoard(cb); ReleaseTWI(); return false;}
-  Wire.requestFrom((uint8_t)add, (uint8_t)3);
-  while (Wire.available()) b[i++] = Wire.read();
-  if(cb != board) SelectBoard(cb);
-  ReleaseTWI();
-  if(i==3) return true;
-  return false;
+  return TWIrecv(add, board, buf, 1, (uint8_t *)value, 3, true) == 3;
 }
 
 bool TWIread16bitUnsigned(uint8_t add, int board,int cmd, int *value)
 {
-  byte *b;
-  int  i=0;
+  uint8_t buf[1] = {(uint8_t)cmd};
 
-  AcquireTWI();
   *value = 0;
-  b = (byte *)value;
-  int cb=SelectedBoard();
-  SelectBoard(board);
-  AtomicBlock< Atomic_RestoreState > a_Block;
-  Wire.beginTransmission(add);
-  Wire.write(cmd);
-  if(Wire.endTransmission() !=0) {if(cb != board) SelectBoard(cb); ReleaseTWI(); return false;}
-  Wire.requestFrom((uint8_t)add, (uint8_t)2);
-  while (Wire.available()) b[i++] = Wire.read();
-  if(cb != board) SelectBoard(cb);
-  ReleaseTWI();
-  if(i==2) return true;
-  return false;
+  return TWIrecv(add, board, buf, 1, (uint8_t *)value, 2, true) == 2;
 }
 
 // If cmd == -1 then only perform the read
 bool TWIread8bitUnsigned(uint8_t add, int board,int cmd, int *value)
 {
-  byte *b;
-  int  i=0;
+  uint8_t buf[1] = {(uint8_t)cmd};
 
-  AcquireTWI();
   *value = 0;
-  b = (byte *)value;
-  int cb=SelectedBoard();
-  SelectBoard(board);
-  AtomicBlock< Atomic_RestoreState > a_Block;
-  if( cmd != -1)
-  {
-    Wire.beginTransmission(add);
-    Wire.write(cmd);
-    if(Wire.endTransmission() !=0) {if(cb != board) SelectBoard(cb); ReleaseTWI(); return false;}
-  }
-  Wire.requestFrom((uint8_t)add, (uint8_t)1);
-  while (Wire.available()) b[i++] = Wire.read();
-  if(cb != board) SelectBoard(cb);
-  ReleaseTWI();
-  if(i==1) return true;
-  return false;
+  return TWIrecv(add, board, buf, (cmd != -1) ? 1 : 0, (uint8_t *)value, 1, true) == 1;
 }
 
+// If cmd == 0 then only perform the read
 bool TWIreadBlock(uint8_t add, int board,int cmd, void *ptr, int numbytes)
 {
-  AcquireTWI();
-  int cb=SelectedBoard();
-  SelectBoard(board);
-  if(cmd != 0)
-  {
-    Wire.beginTransmission(add);
-    Wire.write(cmd);
-    if(Wire.endTransmission() !=0) {if(cb != board) SelectBoard(cb); ReleaseTWI(); return false;}  
-  }
-  uint8_t  *bptr;
-  int i = 0;
-  bptr = (uint8_t *)ptr;
-  Wire.requestFrom((uint8_t)add, (uint8_t)numbytes);
-  while (Wire.available()) bptr[i++] = Wire.read();
-  if(cb != board) SelectBoard(cb);
-  ReleaseTWI();
-  if(i==numbytes) return true;
-  return false;
+  uint8_t buf[1] = {(uint8_t)cmd};
+
+  return TWIrecv(add, board, buf, (cmd != 0) ? 1 : 0, (uint8_t *)ptr, numbytes, false) == numbytes;
 }
 
 bool TWIreadBlock(uint8_t add, int board,int ch, int cmd, void *ptr, int numbytes)
 {
-  AcquireTWI();
-  int cb=SelectedBoard();
-  SelectBoard(board);
-  if(cmd != 0)
-  {
-    Wire.beginTransmission(add);
-    Wire.write(cmd);
-    Wire.write(ch);
-    if(Wire.endTransmission() !=0) {if(cb != board) SelectBoard(cb); ReleaseTWI(); return false;}  
-  }
-  uint8_t  *bptr;
-  int i = 0;
-  bptr = (uint8_t *)ptr;
-  Wire.requestFrom((uint8_t)add, (uint8_t)numbytes);
-  while (Wire.available()) bptr[i++] = Wire.read();
-  if(cb != board) SelectBoard(cb);
-  ReleaseTWI();
-  if(i==numbytes) return true;
-  return false;
+  uint8_t buf[2] = {(uint8_t)cmd, (uint8_t)ch};
+
+  return TWIrecv(add, board, buf, (cmd != 0) ? 2 : 0, (uint8_t *)ptr, numbytes, false) == numbytes;
 }
 
 void setTWIspeed(int ch, int speed)
@@ -681,12 +559,12 @@ void setTWIspeed(int ch, int speed)
   if(ch == 0)
   {
     WireDefaultSpeed = speed;
-    Wire.setClock(speed);
+    TWIsetBusClock(0, speed);
   }
   else
   {
     Wire1DefaultSpeed = speed;
-    Wire1.setClock(speed);
+    TWIsetBusClock(1, speed);
   }
 }
 void getTWIspeed(int ch)
@@ -0,0 +1,296 @@
+//
+// TWIprofile
+//
+// Per device TWI bus clock and transaction settings, see TWIprofile.h.
+//
+// Commands:
+//    GTWIPROF                Report the profiles, bus,board,address,class,clock,gap,retries,transactions,errors,retried,downshifts
+//    STWIPROF                Set a profile, bus,board,address hex,clock,gap uS,retries
+//    TWICHAR,tries           Measure the error rate of each device at each clock, bus,board,address,clock,errors,tries
+//                            one per line, then set each device's clock
+//
+#include "Variants.h"
+#include "TWIprofile.h"
+#include "AtomicBlock.h"
+#include <Wire.h>
+
+TWIprofile  TWIprofiles[TWImaxProfiles];
+int         TWInumProfiles = 0;
+uint32_t    TWIbusClock[2] = {0, 0};       // Clock last set on each bus, 0 if unknown
+
+// Class limits, the Due TWI runs up to 400 kHz
+const TWIclassData TWIclasses[] = {
+  {"EEPROM", 400000, 0},
+  {"SMART",  400000, 2},
+  {"DAC",    400000, 0},
+  {"ADC",    400000, 0},
+};
+
+// Clocks tried by TWICHAR, slowest first
+const uint32_t TWIclocks[] = {50000, 100000, 200000, 400000};
+#define TWInumClocks  (int)(sizeof(TWIclocks) / sizeof(uint32_t))
+
+const Commands  TWIprofileCmdArray[] = {
+// Start of command block
+//
+// TWI profile commands
+//
+  {"GTWIPROF", CMDfunction, 0, (char *)TWIreportProfiles},     // Report the profiles, bus,board,address,class,clock,gap,retries,transactions,errors,retried,downshifts one per line
+  {"STWIPROF", CMDfunctionLine, 0, (char *)TWIsetProfile},     // Set a profile, bus,board,address hex,clock,gap uS,retries
+  {"TWICHAR",  CMDfunction, 1, (char *)TWIcharacterize},       // Measure each device's error rate at each clock, bus,board,address,clock,errors,tries one per line, then set the clocks
+// End of table marker
+  {0},
+};
+
+CommandList TWIprofileCmdList = { (Commands *)TWIprofileCmdArray, NULL };
+
+// Called once from setup
+void TWIprofile_init(void)
+{
+  AddToCommandList(&TWIprofileCmdList);
+}
+
+static uint32_t TWIdefaultClock(int bus)
+{
+  if(bus == 1) return Wire1DefaultSpeed;
+  return WireDefaultSpeed;
+}
+
+// Sets the bus clock, the clock is only written when it changes
+void TWIsetBusClock(int bus, uint32_t clock)
+{
+  if(TWIbusClock[bus] == clock) return;
+  if(bus == 1) Wire1.setClock(clock);
+  else Wire.setClock(clock);
+  TWIbusClock[bus] = clock;
+}
+
+TWIprofile *TWIprofileFind(int bus, int brd, uint8_t add)
+{
+  if(bus == 1) brd = -1;
+  for(int i=0;i<TWInumProfiles;i++)
+  {
+    if((TWIprofiles[i].Bus == bus) && (TWIprofiles[i].Brd == brd) && (TWIprofiles[i].Addr == add)) return &TWIprofiles[i];
+  }
+  return NULL;
+}
+
+// Adds a profile at the bus default clock, returns the existing profile if the device is
+// already registered. Returns NULL if the table is full.
+TWIprofile *TWIprofileAdd(int bus, int brd, uint8_t add, uint8_t cls)
+{
+  TWIprofile *tp;
+
+  if(bus == 1) brd = -1;
+  if((tp = TWIprofileFind(bus, brd, add)) != NULL) return tp;
+  AtomicBlock< Atomic_RestoreState > a_Block;
+  if(TWInumProfiles >= TWImaxProfiles) return NULL;
+  tp = &TWIprofiles[TWInumProfiles];
+  memset(tp, 0, sizeof(TWIprofile));
+  tp->Bus = bus;
+  tp->Brd = brd;
+  tp->Addr = add;
+  tp->Class = cls;
+  tp->Clock = TWIdefaultClock(bus);
+  tp->Retries = TWIclasses[cls].Retries;
+  TWInumProfiles++;
+  return tp;
+}
+
+// Called after the board is selected and before the transaction, returns the profile or
+// NULL if the table is full and the device runs at the default clock.
+TWIprofile *TWIbegin(int bus, uint8_t add, uint8_t cls)
+{
+  TWIprofile *tp;
+
+  if((tp = TWIprofileAdd(bus, SelectedBoard(), add, cls)) == NULL) return NULL;
+  if(tp->Gap > 0) while((micros() - tp->LastEnd) < tp->Gap);
+  TWIsetBusClock(bus, tp->Clock);
+  tp->Transactions++;
+  return tp;
+}
+
+// Called at the end of the transaction, status is 0 if the transaction worked
+void TWIfinish(TWIprofile *tp, int status)
+{
+  int i;
+
+  if(tp == NULL) return;
+  tp->LastEnd = micros();
+  // A device that has never answered is dropped, ScanHardware reads every module address
+  if((status != 0) && (tp->Transactions == 1) && (tp == &TWIprofiles[TWInumProfiles-1]))
+  {
+    TWInumProfiles--;
+    TWIsetBusClock(tp->Bus, TWIdefaultClock(tp->Bus));
+    return;
+  }
+  if(status == 0) tp->Fails = 0;
+  else
+  {
+    tp->Errors++;
+    if(++tp->Fails >= TWIdownshift)
+    {
+      tp->Fails = 0;
+      for(i=TWInumClocks-1;i>0;i--) if(TWIclocks[i] < tp->Clock) break;
+      if(TWIclocks[i] < tp->Clock)
+      {
+        tp->Clock = TWIclocks[i];
+        tp->Downshifts++;
+      }
+    }
+  }
+  TWIsetBusClock(tp->Bus, TWIdefaultClock(tp->Bus));
+}
+
+//
+// Characterization
+//
+
+// Reads the first 4 bytes of an EEPROM, returns 0 if the read worked
+static int TWIreadSignature(TwoWire *wire, uint8_t add, uint8_t *buf)
+{
+  int i = 0;
+
+  wire->beginTransmission(add);
+  wire->write((uint8_t)0);
+  if(wire->endTransmission(true) != 0) return -1;
+  wire->requestFrom(add, (uint8_t)4);
+  while(wire->available())
+  {
+    if(i < 4) buf[i] = wire->read();
+    else wire->read();
+    i++;
+  }
+  if(i != 4) return -1;
+  return 0;
+}
+
+// Returns the number of failed tries of the device at the current bus clock
+static int TWIprobe(TWIprofile *tp, uint8_t *ref, int tries)
+{
+  TwoWire *wire = (tp->Bus == 1) ? &Wire1 : &Wire;
+  uint8_t buf[4];
+  int     errors = 0;
+
+  for(int i=0;i<tries;i++)
+  {
+    WDT_Restart(WDT);
+    if(tp->Class == TWIcEEPROM)
+    {
+      if((TWIreadSignature(wire, tp->Addr, buf) != 0) || (memcmp(buf, ref, 4) != 0)) errors++;
+    }
+    else
+    {
+      wire->beginTransmission(tp->Addr);
+      if(wire->endTransmission(true) != 0) errors++;
+    }
+  }
+  return errors;
+}
+
+void TWIcharacterize(int tries)
+{
+  TWIprofile *tp, *sp;
+  uint8_t    ref[4];
+  int        i, j, errors, cb;
+  uint32_t   best;
+  bool       clean;
+
+  if((tries < 1) || (tries > TWImaxTries)) BADARG;
+  if(!AcquireTWI()) ERR(ERR_TWIBUSY);
+  SendACKonly;
+  cb = SelectedBoard();
+  for(i=0;i<TWInumProfiles;i++)
+  {
+    tp = &TWIprofiles[i];
+    if(tp->Class == TWIcSmart) continue;
+    if(tp->Brd != -1) SelectBoard(tp->Brd);
+    // The reference signature is read at the default clock
+    TWIsetBusClock(tp->Bus, TWIdefaultClock(tp->Bus));
+    if((tp->Class == TWIcEEPROM) && (TWIreadSignature((tp->Bus == 1) ? &Wire1 : &Wire, tp->Addr, ref) != 0)) continue;
+    best = 0;
+    clean = true;
+    for(j=0;j<TWInumClocks;j++)
+    {
+      if(TWIclocks[j] > TWIclasses[tp->Class].MaxClock) break;
+      TWIsetBusClock(tp->Bus, TWIclocks[j]);
+      errors = TWIprobe(tp, ref, tries);
+      if(errors != 0) clean = false;
+      if(clean) best = TWIclocks[j];
+      if(!SerialMute)
+      {
+        serial->print(tp->Bus); serial->print(",");
+        serial->print(tp->Brd); serial->print(",");
+        serial->print(tp->Addr, HEX); serial->print(",");
+        serial->print(TWIclocks[j]); serial->print(",");
+        serial->print(errors); serial->print(",");
+        serial->println(tries);
+      }
+    }
+    TWIsetBusClock(tp->Bus, TWIdefaultClock(tp->Bus));
+    if(best == 0) continue;
+    tp->Clock = best;
+    tp->Fails = 0;
+    // The module processor's command port takes the clock found for its EEPROM
+    if((tp->Class == TWIcEEPROM) && ((sp = TWIprofileFind(tp->Bus, tp->Brd, tp->Addr | 0x20)) != NULL) && (sp->Class == TWIcSmart))
+    {
+      sp->Clock = best;
+      sp->Fails = 0;
+    }
+  }
+  SelectBoard(cb);
+  ReleaseTWI();
+  if(!SerialMute) serial->println("");
+}
+
+//
+// Host commands
+//
+
+void TWIreportProfiles(void)
+{
+  TWIprofile *tp;
+
+  SendACKonly;
+  if(SerialMute) return;
+  for(int i=0;i<TWInumProfiles;i++)
+  {
+    tp = &TWIprofiles[i];
+    serial->print(tp->Bus); serial->print(",");
+    serial->print(tp->Brd); serial->print(",");
+    serial->print(tp->Addr, HEX); serial->print(",");
+    serial->print(TWIclasses[tp->Class].Name); serial->print(",");
+    serial->print(tp->Clock); serial->print(",");
+    serial->print(tp->Gap); serial->print(",");
+    serial->print(tp->Retries); serial->print(",");
+    serial->print(tp->Transactions); serial->print(",");
+    serial->print(tp->Errors); serial->print(",");
+    serial->print(tp->Retried); serial->print(",");
+    serial->println(tp->Downshifts);
+  }
+  serial->println("");
+}
+
+void TWIsetProfile(void)
+{
+  TWIprofile *tp;
+  char       *tkn;
+  int        args[6], n = 0;
+
+  // Read the whole line before testing the arguments
+  while((tkn = TokenFromCommandLine(',')) != NULL)
+  {
+    if(n < 6) args[n] = strtol(tkn, NULL, n == 2 ? 16 : 10);
+    n++;
+  }
+  if(n != 6) BADARG;
+  if((args[0] < 0) || (args[0] > 1) || (args[1] < 0) || (args[1] > 1)) BADARG;
+  if((args[3] < TWIclocks[0]) || (args[3] > (int)TWIclocks[TWInumClocks-1])) BADARG;
+  if((args[4] < 0) || (args[4] > 10000) || (args[5] < 0) || (args[5] > 10)) BADARG;
+  if((tp = TWIprofileFind(args[0], args[1], args[2])) == NULL) BADARG;
+  tp->Clock = args[3];
+  tp->Gap = args[4];
+  tp->Retries = args[5];
+  tp->Fails = 0;
+  SendACK;
+}
@@ -144,6 +144,7 @@ TBLSTRT
 extern ThreadController control;
 
 MIPStimer MPT(TMR_Table);               // timer used for pulse sequence generation
+TimerUser TableTimer = {"TABLE", TMR_Table, TMRPhigh, NULL};
 #define   MPTtc   TC2->TC_CHANNEL[2]    // Pointer to the timers control block
 
 static Pio *pio     = g_APinDescription[BRDSEL].pPort;
@@ -219,6 +220,8 @@ enum TableModes   TableMode   = LOC;
 int  TableClockFreq = VARIANT_MCK/128;
 
 bool IssueSoftwareTableStart = false;
+// Called from the trigger ISR or the software start each time a table starts, used to chain the pulse train generator
+void (*TableStartFunction)(void) = NULL;
 
 // Used for the compress and state hardware lines to the ARBs
 char Cstate;
@@ -248,8 +251,15 @@ typedef struct
 bool      RampEnabled = false;      // Must be set to true to enable this feature
 bool      Ramping     = false;
 MIPStimer *RampClock  = NULL;
+TimerUser RampTimer   = {"RAMP", TMR_RampClock, TMRPhigh, NULL};
 volatile  RampEntry RE[NUM_RAMPS];
 
+uint32_t  RampPeriod = 0;           // Ramp clock period in cycles
+// Ramp statistics, cleared at table start
+uint32_t  RampTicks;
+uint32_t  RampOverruns;             // Ticks where the ISR ran longer than the ramp clock period
+uint32_t  RampMaxISR;               // Cycles
+
 // Table based ramping parameters
 
 bool	tableBasedRamping = false;     // Must be set to true to enable this feature
@@ -507,6 +517,20 @@ void SetTableAdvance(char *cmd)
     else SendNAK;
 }
 
+// Claims the table timer and the ramp clock if ramps are enabled. Sends NAK and returns false
+// if another module owns either timer.
+bool ClaimTableTimers(void)
+{
+  if(TimerClaim(&TableTimer))
+  {
+    if(!RampEnabled || TimerClaim(&RampTimer)) return true;
+    TimerRelease(&TableTimer);
+  }
+  SetErrorCode(ERR_TIMERINUSE);
+  SendNAK;
+  return false;
+}
+
 // This command will place the system in table mode and enable the triggers, both software
 // and hardware.
 void SetTableMode(char *cmd)
@@ -540,6 +564,7 @@ void SetTableMode(char *cmd)
             SendNAK;
             return;
         }
+        if(!ClaimTableTimers()) return;
         if(strcmp(cmd,"TBL") == 0) TableN = 0;
         else TableN = 1;
         SendACK;
@@ -548,6 +573,7 @@ void SetTableMode(char *cmd)
     }
     else if((TableN = token.toInt()) > 0)
     {
+        if(!ClaimTableTimers()) return;
         SendACK;
         ProcessTables();
         return;      
@@ -682,6 +708,7 @@ void PerformSoftwareStart(void)
     if(!IssueSoftwareTableStart) return;
     // If there is a update at count 0 then fire LDAC and setup for the next event
     StartTimer();
+    if(TableStartFunction != NULL) TableStartFunction();
     if(MPT.getRAcounter() == 0) 
     {
       ProcessTableQueue();
@@ -733,7 +760,7 @@ TableEntry *FindTableEntry(int Count,int Chan)
    TH = (TableHeader *) &(VoltageTable[CT][i]); i += sizeof(TableHeader);
    while(1)
    {
-       if(i >= MaxTable) return NULL;
+       if(i >= (int)MemSize(VoltageTable[CT])) return NULL;
        // Make sure there is a table header
        if(TH->TableName == 0) return NULL;
        // Loop thhrough all the entries in the table
@@ -768,7 +795,7 @@ TableEntryHeader *FindTableEntryHeader(int Count,int Chan)
    TH = (TableHeader *) &(VoltageTable[CT][i]); i += sizeof(TableHeader);
    while(1)
    {
-       if(i >= MaxTable) return NULL;
+       if(i >= (int)MemSize(VoltageTable[CT])) return NULL;
        // Make sure there is a table header
        if(TH->TableName == 0) return NULL;
        // Loop thhrough all the entries in the table
@@ -842,13 +869,94 @@ void SetTableEntryValue(int Count, int Chan, float fval)
 #define DCBchanTime      11
 #define DIOchanTime      19
 #define FunctionTime     50  // This number has not been validated
+#define ISRentryTime     3   // Timer ISR entry and the table queue scan
+#define TWIchanTime      120 // RF drive or ARB update, sent over TWI from the table queue
+#define QueueFuncTime    5   // Other queued functions, sync, compress, burst, ramp
+#define RampISRtime      2   // Ramp ISR entry and board select restore for each ramp clock tick
+#define RampChanTime     3   // Ramp ISR time for each ramping channel, board select and SPI.transfer
+
+// Returns the table clock period in uS, 0 if the table uses an external clock and ExtFreq
+// is not defined.
+float TablePeriodUS(void)
+{
+   float Period=0;
+
+   if(ClockMode == MCK2)   Period = 2.0/(float)VARIANT_MCK;
+   if(ClockMode == MCK8)   Period = 8.0/(float)VARIANT_MCK;
+   if(ClockMode == MCK32)  Period = 32.0/(float)VARIANT_MCK;
+   if(ClockMode == MCK128) Period = 128.0/(float)VARIANT_MCK;
+   if((Period == 0) && (ExtFreq == 0)) return 0;
+   if(Period == 0) Period = 1.0 / (float)ExtFreq;
+   return Period * 1000000.0;
+}
+
+// Returns the estimated time in uS to setup a table entry, this is the SetupNextEntry time
+// after the previous time point. The time the queued functions will take at the entry's
+// own time point is returned in queueT and the number of table queue slots used in queued.
+int TableEntryCost(TableEntryHeader *TEH, TableEntry *TE, int *queueT, int *queued)
+{
+   int  setupT = FixedSetupTime;
+   bool DIOdetected = false;
+   bool rf = false, arb = false;
+   int  j;
+
+   *queueT = 0;
+   *queued = 0;
+   for(j=0;j<TEH->NumChans;j++)
+   {
+       // DC bias channel
+       if((TE[j].Chan >= 0)&&(TE[j].Chan <= 31)) setupT += DCBchanTime;
+       // if Chan is A through P its a DIO to process
+       else if((TE[j].Chan >= 'A') && (TE[j].Chan <= 'P')) DIOdetected = true;
+       else if(TE[j].Chan == ']') setupT += 2;
+       else if(TE[j].Chan == '[') setupT += 2;
+       else if((TE[j].Chan == 'a') || (TE[j].Chan == 'd') || (TE[j].Chan == 'p') || (TE[j].Chan == 'u')) setupT += 1;
+       // Queued functions, unique ones are only queued once per entry
+       else if((TE[j].Chan >= 33) && (TE[j].Chan <= 36))
+       {
+           setupT += 2;
+           if(!rf) {*queueT += TWIchanTime; (*queued)++;}
+           rf = true;
+       }
+       else if((TE[j].Chan >= 101) && (TE[j].Chan <= 108))
+       {
+           setupT += 2;
+           if(!arb) {*queueT += TWIchanTime; (*queued)++;}
+           arb = true;
+       }
+       else if(TE[j].Chan == 't')
+       {
+           setupT += 2;
+           *queueT += QueueFuncTime;
+           if(TE[j].Value > 0) *queueT += TE[j].Value;   // Pulse width, TriggerOut waits for it
+           (*queued)++;
+       }
+       else if((TE[j].Chan == 'r') || (TE[j].Chan == 's') || (TE[j].Chan == 'b') || (TE[j].Chan == 'c'))
+       {
+           setupT += 2;
+           *queueT += QueueFuncTime;
+           (*queued)++;
+       }
+       else if((TE[j].Chan & RAMP) != 0)
+       {
+           setupT += 2;
+           *queueT += QueueFuncTime;
+           (*queued)++;
+       }
+       // Everything else, assume the slowest function
+       else setupT += FunctionTime;
+   }
+   if(DIOdetected) setupT += DIOchanTime;
+   return setupT;
+}
 
 // The function checks a table and looks for any timing violations.
 void TableCheck(void)
 {
    int   i=0;
-   int   j,k;
+   int   k,queueT,queued;
    int   setupT;    // Needed setup time in uS
+   int   lastQueueT = 0;
    int   lastTimePoint = -1;
    float Period=0;
    TableHeader      *TH;
@@ -863,24 +971,18 @@ void TableCheck(void)
    }
    // Calculate the clock period, if external clock then the ExtFreq value is used, if
    // ExtFreq is undefined this function quits.
-   if(ClockMode == MCK2)   Period = 2.0/(float)VARIANT_MCK;
-   if(ClockMode == MCK8)   Period = 8.0/(float)VARIANT_MCK;
-   if(ClockMode == MCK32)  Period = 32.0/(float)VARIANT_MCK;
-   if(ClockMode == MCK128) Period = 128.0/(float)VARIANT_MCK;
-   if((Period == 0) && (ExtFreq == 0))
+   if((Period = TablePeriodUS()) == 0)
    {
        serial->println("System in external clock mode and external frequency");
        serial->println("is not defined, can't evaluate table!");
        return;
    }
-   if(Period == 0) Period = 1.0 / (float)ExtFreq;
-   Period *= 1000000.0;  // Period in uS
    //serial->println(Period);
    // Walk through the table 
    TH = (TableHeader *) &(VoltageTable[CT][i]); i += sizeof(TableHeader);
    while(1)
    {
-       if(i >= MaxTable) break;
+       if(i >= (int)MemSize(VoltageTable[CT])) break;
        // Make sure there is a table header
        if(TH->TableName == 0) break;
        // Loop thhrough all the entries in the table and sum the times
@@ -888,22 +990,12 @@ void TableCheck(void)
        {
            TEH = (TableEntryHeader *) &(VoltageTable[CT][i]); i += sizeof(TableEntryHeader);
            TE = (TableEntry *) &(VoltageTable[CT][i]);
-           setupT = FixedSetupTime;
-           bool DIOdetected = false;
-           for(j=0;j<TEH->NumChans;j++)
-           {
-               // DC bias channel
-               if((TE[j].Chan >= 0)&&(TE[j].Chan <= 31)) setupT += DCBchanTime;
-               // if Chan is A through P its a DIO to process
-               else if((TE[j].Chan >= 'A') && (TE[j].Chan <= 'P')) DIOdetected = true;
-               else if(TE[j].Chan == ']') setupT += 2;
-               else if(TE[j].Chan == '[') setupT += 2;
-               // Everything else, assume the slowest function
-               else setupT += FunctionTime;               
-           }
-           if(DIOdetected) setupT += DIOchanTime;
+           setupT = TableEntryCost(TEH, TE, &queueT, &queued);
            // SetupT now has the needed time for this event to load all the parameters. The previous
-           // time point must provide this time or there is a timing violation
+           // time point must provide this time plus the time its queued functions take or there
+           // is a timing violation
+           setupT += lastQueueT;
+           lastQueueT = queueT;
            if(lastTimePoint > 0)
            {
               //serial->println(setupT);
@@ -930,6 +1022,87 @@ void TableCheck(void)
    serial->println("Done!");
 }
 
+// Table timing linter, a machine readable version of TableCheck that also counts the previous
+// time point's queued functions, the timer ISR entry, and the ramp ISR load against each gap.
+// The ramp load is the ramp ticks in the gap times the ramp ISR time for the channels ramping
+// after the previous time point, at most NUM_RAMPS. table_lint.py runs the same model on the host.
+// The entries are walked in table order, loops are not unrolled. After the ACK one line is sent
+// for each time point:
+//    table,count,time uS,setup uS,queued uS,needed uS,gap uS,status
+// status is OK, TIME if the needed time exceeds the gap, or QUEUE if the entry queues more
+// functions than the table queue holds. The last line is points,violations followed by a
+// blank line. NAKs if no table is loaded or the external clock frequency, SEXTFREQ, is not set.
+void TableLint(void)
+{
+   int   i=0,k,points=0,violations=0;
+   int   j,setupT,queueT,queued,needT,lastQueueT=0;
+   int   lastTimePoint = -1;
+   int   rampT = RampISRtime;
+   uint32_t rampMask = 0;          // DC bias channels ramping
+   float Period,gapT,rampFreq=0;
+   TableHeader      *TH;
+   TableEntryHeader *TEH;
+   TableEntry       *TE;
+
+   if(TablesLoaded[CT] == 0) ERR(ERR_NOTBLLOADED);
+   if((Period = TablePeriodUS()) == 0) ERR(ERR_BADARG);
+   if(RampEnabled && (RampClock != NULL)) rampFreq = RampClock->getFrequency();
+   SendACKonly;
+   if(SerialMute) return;
+   TH = (TableHeader *) &(VoltageTable[CT][i]); i += sizeof(TableHeader);
+   while(1)
+   {
+       if(i >= (int)MemSize(VoltageTable[CT])) break;
+       if(TH->TableName == 0) break;
+       lastTimePoint = -1;
+       for(k=0;k<TH->NumEntries;k++)
+       {
+           TEH = (TableEntryHeader *) &(VoltageTable[CT][i]); i += sizeof(TableEntryHeader);
+           TE = (TableEntry *) &(VoltageTable[CT][i]);
+           setupT = TableEntryCost(TEH, TE, &queueT, &queued);
+           needT = setupT;
+           gapT = 0;
+           if(lastTimePoint >= 0)
+           {
+              gapT = (abs(TEH->Count) - lastTimePoint) * Period;
+              needT += ISRentryTime + lastQueueT + (int)(gapT * rampFreq / 1000000.0) * rampT;
+           }
+           points++;
+           serial->print(TH->TableName);
+           serial->print(",");
+           serial->print(abs(TEH->Count));
+           serial->print(",");
+           serial->print(abs(TEH->Count) * Period, 2);
+           serial->print(",");
+           serial->print(setupT);
+           serial->print(",");
+           serial->print(queueT);
+           serial->print(",");
+           serial->print(needT);
+           serial->print(",");
+           serial->print(gapT, 2);
+           if(queued > MaxTableQueue) {serial->println(",QUEUE"); violations++;}
+           else if((lastTimePoint >= 0) && (gapT < needT)) {serial->println(",TIME"); violations++;}
+           else serial->println(",OK");
+           lastTimePoint = abs(TEH->Count);
+           lastQueueT = queueT;
+           // A ramp runs from a RAMP entry with a step until a RAMP entry with a 0 step
+           for(j=0;j<TEH->NumChans;j++) if((TE[j].Chan & (RAMP | INITIAL)) == RAMP)
+           {
+              if(TE[j].Value != 0) rampMask |= 1 << (TE[j].Chan & 0x1F);
+              else rampMask &= ~(1 << (TE[j].Chan & 0x1F));
+           }
+           rampT = RampISRtime + min(__builtin_popcount(rampMask), NUM_RAMPS) * RampChanTime;
+           i += sizeof(TableEntry) * TEH->NumChans;
+       }
+       TH = (TableHeader *) &(VoltageTable[CT][i]); i += sizeof(TableHeader);
+   }
+   serial->print(points);
+   serial->print(",");
+   serial->println(violations);
+   serial->println("");
+}
+
 void GetTableStatus(void)
 {
   SendACKonly;
@@ -1007,11 +1180,15 @@ void ParseTableCommand(void)
     TablesLoaded[CT] = 0;    // Number of tables loaded
     TestNesting      = 0;    // Clear this error counter
     iStat            = 0;
-    if(VoltageTable[CT] == NULL) 
+    if(VoltageTable[CT] == NULL) VoltageTable[CT] = (unsigned char *)MemAlloc(MEMtable, MEMtableStep);
+    if(VoltageTable[CT] == NULL)
     {
-      VoltageTable[CT] = (unsigned char *)realloc((void *)VoltageTable[CT], 1000);
-      MaxTable = 1000;
+      while((TK=NextToken()) != NULL);
+      SetErrorCode(ERR_TBLTOOBIG);
+      SendNAK;
+      return;
     }
+    MaxTable = MemSize(VoltageTable[CT]);
     while(1)
     {
         // Start of table, pointer setup
@@ -1065,8 +1242,16 @@ void ParseTableCommand(void)
         {
             if((unsigned int)(MaxTable - ptr) < (sizeof(TableHeader) + sizeof(TableEntryHeader) + sizeof(TableEntry)))
             {
-                VoltageTable[CT] = (unsigned char *)realloc((void *)VoltageTable[CT], MaxTable += 1000);
-                if(VoltageTable[CT] == NULL)
+                // The buffer can move, TH is kept as an offset
+                int thOffset = (unsigned char *)TH - VoltageTable[CT];
+                unsigned char *vt = (unsigned char *)MemRealloc(MEMtable, VoltageTable[CT], MaxTable + MEMtableStep);
+                if(vt != NULL)
+                {
+                   VoltageTable[CT] = vt;
+                   MaxTable += MEMtableStep;
+                   TH = (TableHeader *) &(VoltageTable[CT][thOffset]);
+                }
+                else
                 {
                    // Out of space!
                    iStat = PEerror;
@@ -1120,6 +1305,13 @@ void ParseTableCommand(void)
                 // Mark the next table name with a 0 to flag the end
                 TH = (TableHeader *) &(VoltageTable[CT][ptr]);
                 TH->TableName = 0;
+                // Trim the buffer to the loaded table so the space is free until the next load
+                unsigned char *vt = (unsigned char *)MemRealloc(MEMtable, VoltageTable[CT], ptr + sizeof(TableHeader));
+                if(vt != NULL)
+                {
+                   VoltageTable[CT] = vt;
+                   MaxTable = ptr + sizeof(TableHeader);
+                }
                 //ReportTable(ptr);
                 SendACK;
                 return;
@@ -1509,6 +1701,8 @@ void ProcessTables(void)
     Aborted = false;
     TableMode = LOC;
     StopTimer();
+    TimerRelease(&RampTimer);
+    TimerRelease(&TableTimer);
     LDACcapture;
     pinMode(LDAC,OUTPUT);
     LDAClow;
@@ -2033,6 +2227,7 @@ void Trigger_ISR(void)
 {
    TBLstopedonRC = false;
    if((TriggerMode == EDGE)||(TriggerMode == POS)||(TriggerMode == NEG)) MPT.softwareTrigger();  // Need to make sure its running!
+   if(TableStartFunction != NULL) TableStartFunction();
    uint32_t csb = pio->PIO_ODSR & pin;
    if(MPT.getRAcounter() == 0)
    {
@@ -2141,9 +2336,11 @@ void RampISR()
 {
    volatile int sum=0,k;
    volatile uint8_t *s,*d;
+   uint32_t start = DWT->CYCCNT;
 
    AtomicBlock< Atomic_RestoreState > a_Block;
    uint32_t csb = pio->PIO_ODSR & pin;  // Save board select and restore on exit
+   RampTicks++;
    Ramping = false;
    for(int i=0;i<NUM_RAMPS;i++) if((RE[i].chan & RAMP_DONE) == 0)
    {
@@ -2161,7 +2358,6 @@ void RampISR()
         s[1] = (s[1] & 0xF0) | (d[2] & 0x0F);
         s[0] = 3;
         // send to DAC output register, no LDAC
-        //AtomicBlock< Atomic_RestoreState > a_Block;
         k = RE[i].initial;
         if((pioA->PIO_PDSR & 7) != ((Chan2Brd[RE[i].chan] >> 4) & 7))
         {
@@ -2170,12 +2366,13 @@ void RampISR()
         }              
         SelectBoard(Chan2Brd[RE[i].chan & ~RAMP_DONE] & 1);
         SPI.transfer(SPI_CS, (uint8_t *)&k, 4);
-        //delayMicroseconds(25);
         Ramping = true;
       }
    }  
    if(csb == 0)  pio->PIO_CODR = pin;
    else pio->PIO_SODR = pin; 
+   if((DWT->CYCCNT - start) > RampMaxISR) RampMaxISR = DWT->CYCCNT - start;
+   if((DWT->CYCCNT - start) > RampPeriod) RampOverruns++;
 }
 
 // This function is called by the command processor and enables the ramp capability.
@@ -2195,12 +2392,36 @@ void EnableRamp(char *ena, char *freq)
      SendNAK;
      return;    
   }
+  // Do not touch the clock if another module owns the timer
+  TimerRegister(&RampTimer);
+  if((TimerOwner(TMR_RampClock) != NULL) && (TimerOwner(TMR_RampClock) != &RampTimer))
+  {
+     RampEnabled = false;
+     SetErrorCode(ERR_TIMERINUSE);
+     SendNAK;
+     return;
+  }
   SendACK;
   token = freq;
   Freq = token.toFloat();
   if(RampClock == NULL) RampClock = new MIPStimer(TMR_RampClock);
   RampClock->attachInterrupt(RampISR);
   RampClock->setFrequency((double)Freq);
+  if(Freq > 0) RampPeriod = (float)VARIANT_MCK / Freq;
+}
+
+// Reports the ramp engine timing since the table started, ticks,overruns,max ISR time in uS.
+// An overrun is a tick where the ISR ran longer than the ramp clock period, the ramp clock is
+// faster than the ramp channels can be sent.
+void RampReportStatus(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  serial->print(RampTicks);
+  serial->print(",");
+  serial->print(RampOverruns);
+  serial->print(",");
+  serial->println((float)RampMaxISR * 1000000.0 / (float)VARIANT_MCK, 2);
 }
 
 // Called at table setup time to enable the ramp clock
@@ -2208,6 +2429,7 @@ void StartRampClock(void)
 {
   if(!RampEnabled) return;
   for(int i=0;i<NUM_RAMPS;i++) RE[i].chan = 0xFF;
+  RampTicks = RampOverruns = RampMaxISR = 0;
   RampClock->start(-1, 0, false);  
   RampClock->softwareTrigger();
 }
@@ -2266,7 +2488,7 @@ uint32_t TVramp(int chan, uint32_t value)
    if(TVD == NULL)
    {
    		// Allocate and init the data struct
-      TVD = (TVrampData *)malloc(sizeof(TVrampData));
+      TVD = (TVrampData *)MemAlloc(MEMtable, sizeof(TVrampData));
       if(TVD == NULL) return 0xFFFFFFFF;
       for(uint8_t i=0;i<MAXTVRAMP;i++) TVD->chan[i] = 0xFF;
    }
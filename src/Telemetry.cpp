@@ -0,0 +1,204 @@
+//
+// Telemetry
+//
+// This file contains the telemetry push capability. The host defines a list of readback
+// signals and a period, a thread then sends a binary frame with all the selected values
+// every period. This replaces host polling with one command per value, which at high
+// rates competes with control commands for the serial interface and the command processor.
+//
+// The values are read from the filtered readback variables the module loops maintain,
+// so building a frame does no TWI or SPI traffic. See Telemetry.h for the frame format.
+//
+// Commands:
+//    TLMADD,name,chan    Add a signal, name is the readback command, for example GDCBV
+//    TLMCLR              Remove all signals and stop telemetry
+//    TLMLIST             Report the subscribed signals, one per line, name,chan
+//    TLMSRCS             Report the supported signal names
+//    STLMPRD,period      Set the frame period in mS, 10 to 60000
+//    GTLMPRD             Return the frame period
+//    STLMENA,state       TRUE starts telemetry, FALSE stops
+//    GTLMENA             Return the telemetry enable state
+//
+#include <Arduino.h>
+#include <Thread.h>
+#include <ThreadController.h>
+#include "Variants.h"
+#include "Telemetry.h"
+
+extern ThreadController control;
+
+//MIPS Threads
+Thread TelemetryThread  = Thread();
+
+TLMdata tlmdata = {false, 100, 0, 0};
+
+// List of supported readback sources. The names are the readback commands that report
+// the same value.
+const TLMsource TLMsources[] = {
+  {"GDCBV",   DCbiasGetReadback},
+  {"GRFPPVP", RFgetReadbackP},
+  {"GRFPPVN", RFgetReadbackN},
+  {"GRFDRV",  RFgetDriveLevel},
+  {"GRFPWR",  RFgetPower},
+  {"GHVV",    ESIgetReadbackV},
+  {"GHVI",    ESIgetReadbackI},
+#if HVPScode
+  {"GHVPSV",  HVPSgetReadback},
+#endif
+  {"GFLAI",   FilamentGetReadbackI},
+  {"GFLV",    FilamentGetReadbackV},
+  {"GFLPWR",  FilamentGetReadbackP},
+  {NULL, NULL},
+};
+
+const Commands  TelemetryCmdArray[] = {
+// Start of command block
+//
+// Telemetry commands
+//
+  {"TLMADD",  CMDfunctionStr, 2, (char *)TelemetryAdd},        // Add a telemetry signal, readback command name, channel. For example GDCBV,1
+  {"TLMCLR",  CMDfunction, 0, (char *)TelemetryClear},         // Remove all telemetry signals and stop telemetry
+  {"TLMLIST", CMDfunction, 0, (char *)TelemetryList},          // Report the subscribed telemetry signals, name,channel one per line
+  {"TLMSRCS", CMDfunction, 0, (char *)TelemetrySources},       // Report the supported telemetry signal names
+  {"STLMPRD", CMDfunction, 1, (char *)SetTelemetryPeriod},     // Set the telemetry frame period in mS, 10 to 60000
+  {"GTLMPRD", CMDint, 0, (char *)&tlmdata.Period},             // Return the telemetry frame period in mS
+  {"STLMENA", CMDfunctionStr, 1, (char *)SetTelemetryEnable},  // Start telemetry frames if TRUE, stop if FALSE
+  {"GTLMENA", CMDbool, 0, (char *)&tlmdata.Enabled},           // Return the telemetry enable status, TRUE or FALSE
+// End of table marker
+  {0},
+};
+
+CommandList TelemetryCmdList = { (Commands *)TelemetryCmdArray, NULL };
+
+// Called once from setup after the hardware scan. The thread is only added to the
+// controller while telemetry is enabled.
+void Telemetry_init(void)
+{
+  TelemetryThread.setName("Telemetry");
+  TelemetryThread.onRun(Telemetry_loop);
+  TelemetryThread.setInterval(tlmdata.Period);
+  AddToCommandList(&TelemetryCmdList);
+}
+
+// Builds and sends one telemetry frame.
+void Telemetry_loop(void)
+{
+  uint8_t  frame[TLMframeSize];
+  uint32_t t = millis();
+  uint8_t  sum = 0;
+  float    fVal;
+  int      n = 0;
+
+  if((tlmdata.NumSignals == 0) || SerialMute) return;
+  frame[n++] = TLMsync1;
+  frame[n++] = TLMsync2;
+  frame[n++] = tlmdata.NumSignals;
+  frame[n++] = tlmdata.Sequence & 0xFF;
+  frame[n++] = (tlmdata.Sequence >> 8) & 0xFF;
+  frame[n++] = t & 0xFF;
+  frame[n++] = (t >> 8) & 0xFF;
+  frame[n++] = (t >> 16) & 0xFF;
+  frame[n++] = (t >> 24) & 0xFF;
+  for(int i=0;i<tlmdata.NumSignals;i++)
+  {
+    // A module can go away, for example a power fail, so the value is marked invalid
+    // rather than dropped to keep the frame layout fixed.
+    if(!tlmdata.Signals[i].Source->Read(tlmdata.Signals[i].Chan, &fVal)) fVal = NAN;
+    memcpy(&frame[n], &fVal, sizeof(float));
+    n += sizeof(float);
+  }
+  for(int i=2;i<n;i++) sum += frame[i];
+  frame[n++] = (uint8_t)(-sum);
+  serial->write(frame, n);
+  tlmdata.Sequence++;
+}
+
+// Finds a source by its name, returns NULL if not found.
+const TLMsource *TelemetryFindSource(char *name)
+{
+  for(int i=0;TLMsources[i].Name != NULL;i++)
+  {
+    if(strcmp(TLMsources[i].Name, name) == 0) return &TLMsources[i];
+  }
+  return NULL;
+}
+
+void TelemetryAdd(char *name, char *chan)
+{
+  const TLMsource *src;
+  int   ch;
+  float fVal;
+
+  if((src = TelemetryFindSource(name)) == NULL) BADARG;
+  if(sscanf(chan, "%d", &ch) != 1) BADARG;
+  if(!src->Read(ch, &fVal)) ERR(ERR_INVALIDCHAN);
+  if(tlmdata.NumSignals >= TLMmaxSignals) ERR(ERR_VALUERANGE);
+  tlmdata.Signals[tlmdata.NumSignals].Source = src;
+  tlmdata.Signals[tlmdata.NumSignals].Chan = ch;
+  tlmdata.NumSignals++;
+  SendACK;
+}
+
+void TelemetryClear(void)
+{
+  control.remove(&TelemetryThread);
+  tlmdata.Enabled = false;
+  tlmdata.NumSignals = 0;
+  SendACK;
+}
+
+void TelemetryList(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  for(int i=0;i<tlmdata.NumSignals;i++)
+  {
+    serial->print(tlmdata.Signals[i].Source->Name);
+    serial->print(",");
+    serial->println(tlmdata.Signals[i].Chan);
+  }
+  serial->println("");
+}
+
+void TelemetrySources(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  for(int i=0;TLMsources[i].Name != NULL;i++)
+  {
+    if(i > 0) serial->print(",");
+    serial->print(TLMsources[i].Name);
+  }
+  serial->println("");
+}
+
+void SetTelemetryPeriod(int period)
+{
+  if((period < TLMminPeriod) || (period > TLMmaxPeriod)) BADARG;
+  tlmdata.Period = period;
+  TelemetryThread.setInterval(period);
+  SendACK;
+}
+
+void SetTelemetryEnable(char *state)
+{
+  String token;
+
+  token = state;
+  if(token == "TRUE")
+  {
+    if(tlmdata.NumSignals == 0) BADARG;
+    control.remove(&TelemetryThread);
+    tlmdata.Sequence = 0;
+    TelemetryThread.setInterval(tlmdata.Period);
+    if(!control.add(&TelemetryThread)) ERR(ERR_INTERNAL);
+    tlmdata.Enabled = true;
+  }
+  else if(token == "FALSE")
+  {
+    control.remove(&TelemetryThread);
+    tlmdata.Enabled = false;
+  }
+  else BADARG;
+  SendACK;
+}
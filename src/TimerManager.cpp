@@ -0,0 +1,198 @@
+//
+// TimerManager
+//
+// Tracks which module owns each hardware timer channel, see TimerManager.h.
+//
+// Commands:
+//    GTMRLIST                Report the owner of each timer channel, timer,owner
+//    GTMRUSERS               Report all registered users, name,timer,priority,state,claims,denied,preempted
+//    GTMRCONF                Report the channels with more than one registered user, timer,user,user...
+//
+#include "Variants.h"
+#include "TimerManager.h"
+#include "AtomicBlock.h"
+
+TimerUser   *TimerUsers[TMRmaxUsers];
+int         NumTimerUsers = 0;
+
+TimerUser   *TimerOwners[TMRnumTimers];
+bool        TimerManagerReady = false;
+
+const char  *TimerPriorityNames[] = {"LOW", "NORMAL", "HIGH"};
+
+const Commands  TimerManagerCmdArray[] = {
+// Start of command block
+//
+// Timer manager commands
+//
+  {"GTMRLIST",  CMDfunction, 0, (char *)TimerReportList},       // Report the owner of each timer channel, timer,owner one per line, owner is FREE if not in use
+  {"GTMRUSERS", CMDfunction, 0, (char *)TimerReportUsers},      // Report all timer users, name,timer,priority,state,claims,denied,preempted one per line
+  {"GTMRCONF",  CMDfunction, 0, (char *)TimerReportConflicts},  // Report timer channels with more than one user, timer,user,user... one per line
+// End of table marker
+  {0},
+};
+
+CommandList TimerManagerCmdList = { (Commands *)TimerManagerCmdArray, NULL };
+
+// Returns true if another user is registered on the same channel
+bool TimerConflict(TimerUser *tu)
+{
+  for(int i=0;i<NumTimerUsers;i++) if((TimerUsers[i] != tu) && (TimerUsers[i]->Timer == tu->Timer)) return true;
+  return false;
+}
+
+// Called after all the modules are initialized, logs the users registered at startup that
+// share a channel.
+void TimerManager_init(void)
+{
+  AddToCommandList(&TimerManagerCmdList);
+  for(int i=0;i<NumTimerUsers;i++) if(TimerConflict(TimerUsers[i])) LogEvent(LOGCtimer, LOGwarning, LOGMsystem, -1, TimerUsers[i]->Timer, 0, TimerUsers[i]->Name);
+  TimerManagerReady = true;
+}
+
+// Called from the system loop, logs the denials, preemptions, and conflicts flagged since the
+// last call. Claims are made from ISRs so they don't log.
+void TimerManager_loop(void)
+{
+  TimerUser *tu;
+  uint8_t   pending;
+
+  for(int i=0;i<NumTimerUsers;i++)
+  {
+    tu = TimerUsers[i];
+    if(tu->Pending == 0) continue;
+    {
+      AtomicBlock< Atomic_RestoreState > a_Block;
+      pending = tu->Pending;
+      tu->Pending = 0;
+    }
+    if(pending & TMRlogConflict) LogEvent(LOGCtimer, LOGwarning, LOGMsystem, -1, tu->Timer, 0, tu->Name);
+    if(pending & TMRlogDenied) LogEvent(LOGCtimer, LOGerror, LOGMsystem, -1, tu->Timer, 0, tu->Name);
+    if(pending & TMRlogPreempted) LogEvent(LOGCtimer, LOGwarning, LOGMsystem, -1, tu->Timer, 0, tu->Name);
+  }
+}
+
+// Adds a user, a user can be registered more than once. Users registered after startup
+// are logged when they share a channel.
+void TimerRegister(TimerUser *tu)
+{
+  if((tu->Timer < 0) || (tu->Timer >= TMRnumTimers)) return;
+  for(int i=0;i<NumTimerUsers;i++) if(TimerUsers[i] == tu) return;
+  if(NumTimerUsers >= TMRmaxUsers) return;
+  TimerUsers[NumTimerUsers++] = tu;
+  if(TimerManagerReady && TimerConflict(tu)) tu->Pending |= TMRlogConflict;
+}
+
+// Call before starting the timer, returns false if the channel is owned by another user.
+// Registers the user if it was not registered at init.
+bool TimerClaim(TimerUser *tu)
+{
+  TimerUser *owner;
+
+  if((tu->Timer < 0) || (tu->Timer >= TMRnumTimers)) return false;
+  AtomicBlock< Atomic_RestoreState > a_Block;
+  TimerRegister(tu);
+  owner = TimerOwners[tu->Timer];
+  if(owner == tu) return true;
+  if(owner != NULL)
+  {
+    if((owner->Release == NULL) || (owner->Priority >= tu->Priority))
+    {
+      tu->Denied++;
+      tu->Pending |= TMRlogDenied;
+      return false;
+    }
+    owner->Active = false;
+    owner->Preempted++;
+    owner->Release();
+    owner->Pending |= TMRlogPreempted;
+  }
+  TimerOwners[tu->Timer] = tu;
+  tu->Active = true;
+  tu->Claims++;
+  return true;
+}
+
+// Call after stopping the timer, does nothing if the user does not own the channel.
+void TimerRelease(TimerUser *tu)
+{
+  if((tu->Timer < 0) || (tu->Timer >= TMRnumTimers)) return;
+  AtomicBlock< Atomic_RestoreState > a_Block;
+  if(TimerOwners[tu->Timer] != tu) return;
+  TimerOwners[tu->Timer] = NULL;
+  tu->Active = false;
+}
+
+TimerUser *TimerOwner(int timer)
+{
+  if((timer < 0) || (timer >= TMRnumTimers)) return NULL;
+  return TimerOwners[timer];
+}
+
+//
+// Host commands
+//
+
+void TimerReportList(void)
+{
+  SendACKonly;
+  if(SerialMute) return;
+  for(int i=0;i<TMRnumTimers;i++)
+  {
+    serial->print(i);
+    serial->print(",");
+    if(TimerOwners[i] == NULL) serial->println("FREE");
+    else serial->println(TimerOwners[i]->Name);
+  }
+  serial->println("");
+}
+
+void TimerReportUsers(void)
+{
+  TimerUser *tu;
+
+  SendACKonly;
+  if(SerialMute) return;
+  for(int i=0;i<NumTimerUsers;i++)
+  {
+    tu = TimerUsers[i];
+    serial->print(tu->Name);
+    serial->print(",");
+    serial->print(tu->Timer);
+    serial->print(",");
+    serial->print(TimerPriorityNames[tu->Priority]);
+    serial->print(",");
+    if(tu->Active) serial->print("ACTIVE");
+    else serial->print("IDLE");
+    serial->print(",");
+    serial->print(tu->Claims);
+    serial->print(",");
+    serial->print(tu->Denied);
+    serial->print(",");
+    serial->println(tu->Preempted);
+  }
+  serial->println("");
+}
+
+void TimerReportConflicts(void)
+{
+  int n;
+
+  SendACKonly;
+  if(SerialMute) return;
+  for(int t=0;t<TMRnumTimers;t++)
+  {
+    n = 0;
+    for(int i=0;i<NumTimerUsers;i++) if(TimerUsers[i]->Timer == t) n++;
+    if(n < 2) continue;
+    serial->print(t);
+    for(int i=0;i<NumTimerUsers;i++)
+    {
+      if(TimerUsers[i]->Timer != t) continue;
+      serial->print(",");
+      serial->print(TimerUsers[i]->Name);
+    }
+    serial->println("");
+  }
+  serial->println("");
+}
@@ -147,6 +147,8 @@ int  CompressorProcessLoop(int Count);
 //MIPStimer TwaveClk(6);
 //MIPStimer TwaveClk(TMR_TwaveClk);
 MIPStimer *TwaveClk = NULL;
+TimerUser TwaveClkTimer = {"TWCLK", TMR_TwaveClk, TMRPhigh, NULL};
+TimerUser TwaveCmpTimer = {"TWCMP", TMR_TwaveCmp, TMRPnormal, NULL};
 
 // DAC channel assignment
 #define  DAC_PulseVoltage    0
@@ -621,7 +623,8 @@ void SetVelocity(int ModuleIndex)
   else if (TDarray[ModuleIndex].Rev == 3)
   {
     // Rev 3 supports the on module FS7140 clock chip.
-    if(TDarray[0].CompressorEnabled)
+    // The timer clock is only used in compressor mode, it is never released
+    if(TDarray[0].CompressorEnabled && TimerClaim(&TwaveClkTimer))
     {
       TwaveClk->attachInterrupt(CompressorClockISR);
       TwaveClk->setFrequency((double)TDarray[0].Velocity);
@@ -634,6 +637,7 @@ void SetVelocity(int ModuleIndex)
 #ifdef UseTimer
     // The 8 times multiplier is because the output toggles on each clock thus divides
     // by two and the rev 2 hardware has a 4x division.
+    if(!TimerClaim(&TwaveClkTimer)) return;
     TwaveClk->setFrequency((double)(TDarray[ModuleIndex].Velocity * 8));
     TwaveClk->setTIOAeffect(1, TC_CMR_ACPA_TOGGLE);
     TwaveClk->start(-1, 0, true);
@@ -648,6 +652,7 @@ void SetVelocity(int ModuleIndex)
 #ifdef UseTimer
     // The 2 times multiplier is because the output toggles on each clock thus divides
     // by two.
+    if(!TimerClaim(&TwaveClkTimer)) return;
     TwaveClk->setFrequency((double)(TDarray[ModuleIndex].Velocity * 2));
     TwaveClk->setTIOAeffect(1, TC_CMR_ACPA_TOGGLE);
     TwaveClk->start(-1, 0, true);
@@ -1182,6 +1187,7 @@ void Twave_init(int8_t Board, uint8_t addr)
     {
       #ifdef UseTimer
       TwaveClk = new MIPStimer(6);    // These REVs have to use timer 6 for clock generation
+      TwaveClkTimer.Timer = 6;
       #endif
     }
     if(TwaveClk == NULL) TwaveClk = new MIPStimer(TMR_TwaveClk);
@@ -1907,6 +1913,7 @@ void ConfigureTrig(void)
   CtrigInput->detach();
   CtrigInput->setPriority(TD.Ctrig, 8);
   CtrigInput->attached(TD.Ctrig, TD.CtrigLevel, CompressorTriggerISR);  
+  TimerRegister(&TwaveCmpTimer);
 }
 
 // Set the switch state based on user dialog box selection
@@ -2034,6 +2041,7 @@ void CompressorTimerISR(void)
   {
     // Stop the timer
     CompressorTimer.stop();
+    TimerRelease(&TwaveCmpTimer);
     // Restore the mode
     if(TDarray[0].Rev >= 4) TWcpldLoad(0,false);
     UpdateMode();
@@ -2048,6 +2056,8 @@ void CompressorTimerISR(void)
 void CompressorTriggerISR(void)
 {
     AtomicBlock< Atomic_RestoreState > a_Block;  // uncommented, 8/22/17
+  // Ignore the trigger if another module owns the timer
+  if(!TimerClaim(&TwaveCmpTimer)) return;
   // Clear and setup variables
   ClockReset = 8;             // Put system in normal mode
   CrampCounter = 0;
@@ -2431,9 +2441,12 @@ void CompressorInit(void)
       if(i < 8) ClockArray[i] |= g_APinDescription[CLOCK_B].ulPin;
     }
     // Setup the timer and the ISR for the clock
-    TwaveClk->attachInterrupt(CompressorClockISR);
-    TwaveClk->setFrequency((double)TDarray[0].Velocity);
-    TwaveClk->start(-1, 0, false);
+    if(TimerClaim(&TwaveClkTimer))
+    {
+      TwaveClk->attachInterrupt(CompressorClockISR);
+      TwaveClk->setFrequency((double)TDarray[0].Velocity);
+      TwaveClk->start(-1, 0, false);
+    }
     //NVIC_SetPriority(TC7_IRQn, 0);
   }
   // Clear the switch output
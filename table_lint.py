@@ -0,0 +1,338 @@
+#!/usr/bin/env python3
+# Host side table timing linter, runs the TBLLINT cost model on STBLDAT text without a MIPS box
+# so tables can be checked in CI before they are sent to the system.
+#
+#   python table_lint.py table.txt [--clock MCK128] [--extfreq HZ] [--ramp HZ] [--timeline]
+#
+# The file holds the STBLDAT command or just the table text that follows it, newlines are
+# ignored. The table is parsed the way ParseTableCommand and ParseEntry parse it and each time
+# point is costed with TableEntryCost and TableLint. The timing constants are read from
+# src/Table.cpp and include/Table.h so the model is always the firmware's own.
+#
+# One line is printed for each time point, the same as TBLLINT:
+#    table,count,time uS,setup uS,queued uS,needed uS,gap uS,status
+# status is OK, TIME, or QUEUE. Unnamed tables are shown as -. The last line is
+# points,violations. --timeline adds a line for every channel output change,
+#    table,count,time uS,channel,value
+# after its time point line. Loops are not unrolled, the entries are listed in table order.
+#
+# Exit status is 0 if the table passes, 1 if there are violations, and 2 if the table does not
+# parse, the error and the token number are printed.
+import argparse
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.abspath(__file__))
+
+# Constants taken from the firmware source
+CONSTANTS = {
+    os.path.join("src", "Table.cpp"):       ["FixedSetupTime", "DCBchanTime", "DIOchanTime", "FunctionTime",
+                                             "ISRentryTime", "TWIchanTime", "QueueFuncTime", "RampISRtime",
+                                             "RampChanTime", "NUM_RAMPS", "RAMP", "INITIAL"],
+    os.path.join("include", "Table.h"):     ["MaxTableQueue", "MaxNesting"],
+    os.path.join("variants", "arduino_due_x", "variant.h"): ["VARIANT_MCK"],
+}
+
+CLOCK_DIVIDERS = {"MCK2": 2, "MCK8": 8, "MCK32": 32, "MCK128": 128}
+
+# DIO and function channels ParseEntry accepts, and the ones that take an integer value
+LETTER_CHANNELS = "ABCDEFGHIJKLMNOPrstubcdpa><="
+INT_CHANNELS    = "tbdp><="
+
+DELIMITERS = "\n;:,][/"
+
+
+def load_constants():
+    """Read the cost model constants from the firmware source."""
+    c = {}
+    for path, names in CONSTANTS.items():
+        with open(os.path.join(ROOT, path), encoding="utf-8", errors="replace") as f:
+            text = f.read()
+        for name in names:
+            m = re.search(r'^\s*#define\s+' + name + r'\s+(0x[0-9A-Fa-f]+|\d+)', text, re.M)
+            if m is None:
+                sys.exit(f"table_lint: {name} not found in {path}")
+            c[name] = int(m.group(1), 0)
+    return c
+
+
+class TableError(Exception):
+    pass
+
+
+class Tokens:
+    """Splits the text the way GetToken does, each delimiter is its own token."""
+
+    def __init__(self, text):
+        self.tokens = []
+        tk = ""
+        for ch in text:
+            if ch in " \t\r":
+                continue
+            if ch in DELIMITERS:
+                if tk:
+                    self.tokens.append(tk)
+                tk = ""
+                if ch != "\n":
+                    self.tokens.append(ch)
+            else:
+                tk += ch
+        if tk:
+            self.tokens.append(tk)
+        # Drop the command name
+        if self.tokens and self.tokens[0].upper() == "STBLDAT":
+            self.tokens = self.tokens[2:]
+        self.pos = 0
+
+    def next(self):
+        if self.pos >= len(self.tokens):
+            raise TableError("unexpected end of table")
+        self.pos += 1
+        return self.tokens[self.pos - 1]
+
+    def expect(self, delimiter):
+        if self.next() != delimiter:
+            raise TableError(f"expected {delimiter}")
+
+    def int(self):
+        m = re.match(r'[+-]?\d+', self.next())
+        return int(m.group(0)) if m else 0
+
+    def float(self):
+        m = re.match(r'[+-]?(\d+\.?\d*|\.\d+)([eE][+-]?\d+)?', self.next())
+        return float(m.group(0)) if m else 0.0
+
+
+def new_table(tables):
+    th = {"name": None, "repeat": 1, "entries": []}
+    tables.append(th)
+    return th
+
+
+def parse_entry(tok, count, tk, state, c):
+    """ParseEntry, returns the status and the time point, count and list of chan,value."""
+    chans = []
+    entry = (count, chans)
+    while True:
+        if tk == ",":
+            return "PROCESSED", entry
+        if tk == ";":
+            return "END", entry
+        if tk == "W":
+            tk = tok.next()
+            continue
+        if tk == "[":
+            state["nesting"] += 1
+            if state["nesting"] > c["MaxNesting"]:
+                raise TableError("nesting too deep")
+            return "NEWNAMED", entry
+        if tk == "]":
+            state["nesting"] -= 1
+            if state["nesting"] < 0:
+                raise TableError("missing open bracket")
+            chans.append((ord("]"), 0))
+            if tok.next() == ";":
+                return "END", entry
+            return "NEWTABLE", entry
+        if tk[0] in LETTER_CHANNELS:
+            chan = ord(tk[0])
+            tok.expect(":")
+            if tk[0] in INT_CHANNELS:
+                value = tok.int()
+            else:
+                value = ord(tok.next()[0])
+        else:
+            m = re.match(r'[+-]?\d+', tk)
+            i = int(m.group(0)) if m else 0
+            tok.expect(":")
+            value = tok.float()
+            chan = i & 0xFF
+            if (((1 <= i <= 32) or (i & (c["RAMP"] | c["INITIAL"])) != 0)) and ((i - 1) & 0x20) == 0:
+                chan = (i - 1) & 0xFF
+        tk = tok.next()
+        if tk == ":":
+            tk = tok.next()
+        chans.append((chan, value))
+
+
+def parse_table(tok, c):
+    """ParseTableCommand, returns the list of tables."""
+    tables = []
+    state = {"nesting": 0}
+    istat = None
+    i = 0
+    tk = None
+    while True:
+        th = new_table(tables)
+        if istat is None:
+            i = tok.int()
+            tok.expect(":")
+            tk = tok.next()
+        if tk == "[" or istat == "NEWNAMED":
+            if istat is None and i > 0:
+                # A table that starts after 0 gets an empty entry for the delay
+                th["entries"].append((i, []))
+                th = new_table(tables)
+            if istat != "NEWNAMED":
+                state["nesting"] += 1
+            th["name"] = tok.next()[0]
+            tok.expect(":")
+            th["repeat"] = tok.int()
+            tok.expect(",")
+            i = tok.int()
+            tok.expect(":")
+            tk = tok.next()
+        while True:
+            istat, entry = parse_entry(tok, i, tk, state, c)
+            th["entries"].append(entry)
+            if istat == "PROCESSED":
+                i = tok.int()
+                tk = tok.next()
+                if tk != "]":
+                    if tk != ":":
+                        raise TableError("expected :")
+                    tk = tok.next()
+            elif istat == "NEWNAMED":
+                break
+            elif istat == "NEWTABLE":
+                i = tok.int()
+                tok.expect(":")
+                tk = tok.next()
+                break
+            elif istat == "END":
+                return tables
+
+
+def entry_cost(chans, c):
+    """TableEntryCost, returns setup uS, queued uS, and queued functions."""
+    setup_t = c["FixedSetupTime"]
+    queue_t = 0
+    queued = 0
+    dio = rf = arb = False
+    for chan, value in chans:
+        if 0 <= chan <= 31:
+            setup_t += c["DCBchanTime"]
+        elif ord("A") <= chan <= ord("P"):
+            dio = True
+        elif chan in (ord("]"), ord("[")):
+            setup_t += 2
+        elif chr(chan) in "adpu":
+            setup_t += 1
+        elif 33 <= chan <= 36:
+            setup_t += 2
+            if not rf:
+                queue_t += c["TWIchanTime"]
+                queued += 1
+            rf = True
+        elif 101 <= chan <= 108:
+            setup_t += 2
+            if not arb:
+                queue_t += c["TWIchanTime"]
+                queued += 1
+            arb = True
+        elif chan == ord("t"):
+            setup_t += 2
+            queue_t += c["QueueFuncTime"]
+            if value > 0:
+                queue_t += value
+            queued += 1
+        elif chr(chan) in "rsbc" or (chan & c["RAMP"]) != 0:
+            setup_t += 2
+            queue_t += c["QueueFuncTime"]
+            queued += 1
+        else:
+            setup_t += c["FunctionTime"]
+    if dio:
+        setup_t += c["DIOchanTime"]
+    return setup_t, queue_t, queued
+
+
+def channel_name(chan, c):
+    if chan & c["RAMP"]:
+        return f"R{(chan & 0x1F) + 1}"
+    if 0 <= chan <= 31:
+        return str(chan + 1)
+    if 33 <= chan <= 36 or 101 <= chan <= 108:
+        return str(chan)
+    return chr(chan)
+
+
+def lint(tables, period, ramp_freq, timeline, c):
+    """TableLint, prints the time point lines and returns the number of violations."""
+    points = violations = 0
+    for th in tables:
+        name = th["name"] if th["name"] is not None else "-"
+        last_time_point = -1
+        last_queue_t = 0
+        ramp_t = c["RampISRtime"]
+        ramps = set()
+        for count, chans in th["entries"]:
+            count = abs(count)
+            setup_t, queue_t, queued = entry_cost(chans, c)
+            need_t = setup_t
+            gap_t = 0.0
+            if last_time_point >= 0:
+                gap_t = (count - last_time_point) * period
+                need_t += c["ISRentryTime"] + last_queue_t + int(gap_t * ramp_freq / 1000000.0) * ramp_t
+            points += 1
+            if queued > c["MaxTableQueue"]:
+                status = "QUEUE"
+            elif last_time_point >= 0 and gap_t < need_t:
+                status = "TIME"
+            else:
+                status = "OK"
+            if status != "OK":
+                violations += 1
+            print(f"{name},{count},{count * period:.2f},{setup_t},{queue_t},{need_t},{gap_t:.2f},{status}")
+            if timeline:
+                for chan, value in chans:
+                    if chan != ord("]"):
+                        print(f"{name},{count},{count * period:.2f},{channel_name(chan, c)},{value}")
+            last_time_point = count
+            last_queue_t = queue_t
+            # A ramp runs from a RAMP entry with a step until a RAMP entry with a 0 step
+            for chan, value in chans:
+                if (chan & (c["RAMP"] | c["INITIAL"])) == c["RAMP"]:
+                    if value != 0:
+                        ramps.add(chan & 0x1F)
+                    else:
+                        ramps.discard(chan & 0x1F)
+            ramp_t = c["RampISRtime"] + min(len(ramps), c["NUM_RAMPS"]) * c["RampChanTime"]
+    print(f"{points},{violations}")
+    return violations
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Host side MIPS table timing linter, the TBLLINT cost model")
+    parser.add_argument("table", help="file with the STBLDAT table text, - for stdin")
+    parser.add_argument("--clock", default="MCK128", choices=sorted(CLOCK_DIVIDERS),
+                        help="table clock, STBLCLK, default MCK128")
+    parser.add_argument("--extfreq", type=float, default=0,
+                        help="external table clock in Hz, SEXTFREQ, overrides --clock")
+    parser.add_argument("--ramp", type=float, default=0,
+                        help="ramp clock in Hz, STBLRMPENA, 0 if ramping is off")
+    parser.add_argument("--timeline", action="store_true", help="list every channel output change")
+    args = parser.parse_args()
+
+    c = load_constants()
+    if args.extfreq > 0:
+        period = 1000000.0 / args.extfreq
+    else:
+        period = CLOCK_DIVIDERS[args.clock] * 1000000.0 / c["VARIANT_MCK"]
+    if args.table == "-":
+        text = sys.stdin.read()
+    else:
+        with open(args.table, encoding="utf-8", errors="replace") as f:
+            text = f.read()
+    tok = Tokens(text)
+    try:
+        tables = parse_table(tok, c)
+    except TableError as e:
+        print(f"table_lint: {e} at token {tok.pos}", file=sys.stderr)
+        return 2
+    return 1 if lint(tables, period, args.ramp, args.timeline, c) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())